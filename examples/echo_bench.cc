@@ -0,0 +1,138 @@
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <chrono>
+#include <flexy/flexy.h>
+#include <mutex>
+
+// 回显压测: 同一个 IOManager 内起服务端和 N 个客户端连接
+// 每个连接串行发送 M 个请求, 统计每个请求的系统调用次数和延迟
+// 用法: echo_bench [epoll|uring] [连接数] [每连接请求数] [消息大小]
+// 系统调用次数需要以 -DFLEXY_SYSCALL_STATS=ON 构建, 否则为 0
+
+using namespace flexy;
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+static void serve(int client, size_t size) {
+    std::string buf(size, '\0');
+    ssize_t n = 0;
+    while ((n = read(client, buf.data(), buf.size())) > 0) {
+        if (write(client, buf.data(), n) != n) {
+            break;
+        }
+    }
+    close(client);
+}
+
+static void request(uint16_t port, int requests, size_t size,
+                    std::vector<uint64_t>& latency, std::mutex& mtx) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(sock, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        FLEXY_LOG_ERROR(g_logger) << "connect errno = " << errno;
+        close(sock);
+        return;
+    }
+    std::string out(size, 'x'), in(size, '\0');
+    std::vector<uint64_t> used;
+    used.reserve(requests);
+    for (int i = 0; i < requests; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        if (send(sock, out.data(), size, 0) != (ssize_t)size) {
+            break;
+        }
+        size_t got = 0;
+        while (got < size) {
+            ssize_t n = recv(sock, in.data() + got, size - got, 0);
+            if (n <= 0) {
+                break;
+            }
+            got += n;
+        }
+        if (got != size) {
+            break;
+        }
+        used.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count());
+    }
+    close(sock);
+    LOCK_GUARD(mtx);
+    latency.insert(latency.end(), used.begin(), used.end());
+}
+
+int main(int argc, char** argv) {
+    bool uring = argc > 1 && strcmp(argv[1], "uring") == 0;
+    int conns = argc > 2 ? atoi(argv[2]) : 64;
+    int requests = argc > 3 ? atoi(argv[3]) : 1000;
+    size_t size = argc > 4 ? atoi(argv[4]) : 64;
+    FLEXY_LOG_NAME("system")->setLevel(LogLevel::INFO);
+    Config::LookupBase("iomanager.io_uring")->fromString(uring ? "1" : "0");
+
+    std::vector<uint64_t> latency;
+    std::mutex mtx;
+    uint64_t syscalls = 0;
+    std::chrono::duration<double> total;
+    {
+        IOManager iom(1, false, "bench");
+        if (iom.isUring() != uring) {
+            FLEXY_LOG_ERROR(g_logger) << "io_uring not available";
+            return 1;
+        }
+        uint64_t begin_syscalls = syscall_count();
+        auto begin = std::chrono::steady_clock::now();
+        // 监听 socket 需要在 hook 开启的线程中创建, 否则 accept 会阻塞线程
+        iom.async([&]() {
+            int listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(listen_sock, (sockaddr*)&addr, sizeof(addr));
+            listen(listen_sock, conns);
+            socklen_t len = sizeof(addr);
+            getsockname(listen_sock, (sockaddr*)&addr, &len);
+            uint16_t port = ntohs(addr.sin_port);
+
+            go [listen_sock, conns, size]() {
+                for (int i = 0; i < conns; ++i) {
+                    int client = accept(listen_sock, nullptr, nullptr);
+                    if (client < 0) {
+                        break;
+                    }
+                    go std::bind(serve, client, size);
+                }
+                close(listen_sock);
+            };
+            for (int i = 0; i < conns; ++i) {
+                go [&, port]() { request(port, requests, size, latency, mtx); };
+            }
+        });
+        iom.stop();
+        total = std::chrono::steady_clock::now() - begin;
+        syscalls = syscall_count() - begin_syscalls;
+    }
+
+    if (latency.empty()) {
+        FLEXY_LOG_ERROR(g_logger) << "no request finished";
+        return 1;
+    }
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&latency](double p) {
+        return latency[std::min(latency.size() - 1,
+                                (size_t)(latency.size() * p))];
+    };
+    FLEXY_LOG_INFO(g_logger)
+        << (uring ? "io_uring" : "epoll") << " conns = " << conns
+        << " requests = " << latency.size() << " size = " << size
+        << " qps = " << (uint64_t)(latency.size() / total.count())
+        << " syscalls/req = " << (double)syscalls / latency.size()
+        << " p50 = " << percentile(0.5) << "us"
+        << " p99 = " << percentile(0.99) << "us";
+    return 0;
+}
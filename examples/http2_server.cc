@@ -0,0 +1,52 @@
+#include <flexy/flexy.h>
+#include <flexy/http2.h>
+
+// HTTP/2 服务器, 同时接受 h2c (prior knowledge)、Upgrade: h2c 和 HTTP/1.1 请求
+// curl --http2-prior-knowledge http://127.0.0.1:8021/hello
+// curl --http2 http://127.0.0.1:8021/hello
+
+using namespace flexy;
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+void run() {
+    auto addr = Address::LookupAnyIPAddress("0.0.0.0:8021");
+    if (!addr) {
+        FLEXY_LOG_ERROR(g_logger) << "get address error";
+        return;
+    }
+
+    auto server = std::make_shared<http2::Http2Server>(true);
+    server->getServletDispatch()->addServlet(
+        "/hello", [](const http::HttpRequest::ptr& req,
+                     const http::HttpResponse::ptr& rsp,
+                     const SockStream::ptr&) {
+            rsp->setHeader("content-type", "text/plain");
+            rsp->setBody("hello http" +
+                         std::string(req->getVersion() == 0x20 ? "/2" : "/1.1") +
+                         "\n");
+            return 0;
+        });
+    server->getServletDispatch()->addServlet(
+        "/echo", [](const http::HttpRequest::ptr& req,
+                    const http::HttpResponse::ptr& rsp,
+                    const SockStream::ptr&) {
+            rsp->setBody(std::string(req->getBody()));
+            return 0;
+        });
+
+    while (!server->bind(addr)) {
+        sleep(1);
+    }
+    server->start();
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::INFO);
+    int count = 1;
+    if (argc > 1) {
+        count = atoi(argv[1]);
+    }
+    IOManager worker(count, true, "worker");
+    go run;
+}
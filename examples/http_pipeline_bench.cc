@@ -0,0 +1,129 @@
+#include <chrono>
+#include <flexy/flexy.h>
+
+// HTTP/1.1 pipelining 压测: 同一个 IOManager 内起 HttpServer 和 N 个客户端连接
+// 每个连接一次发送 depth 个请求, 读完全部响应后再发送下一批
+// 分别以 http.server.pipeline_batch = 1 和默认值运行, 统计 qps 和每个请求的系统调用次数
+// 用法: http_pipeline_bench [连接数] [流水线深度] [每连接请求数]
+// 系统调用次数需要以 -DFLEXY_SYSCALL_STATS=ON 构建, 否则为 0
+
+using namespace flexy;
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+class BenchServer : public http::HttpServer {
+public:
+    using HttpServer::HttpServer;
+    Address::ptr getAddress() const { return socks_[0]->getLocalAddress(); }
+};
+
+static const char s_request[] = "GET /hello HTTP/1.1\r\nHost: bench\r\n\r\n";
+
+// 读取 count 个响应, 响应只有 content-length 一种长度信息
+static bool ReadResponses(const Socket::ptr& sock, std::string& buf, int count) {
+    size_t pos = 0;
+    while (count > 0) {
+        size_t header_end = buf.find("\r\n\r\n", pos);
+        if (header_end != std::string::npos) {
+            size_t cl = buf.find("content-length: ", pos);
+            size_t length = atoi(buf.c_str() + cl + 16);
+            size_t end = header_end + 4 + length;
+            if (end <= buf.size()) {
+                pos = end;
+                --count;
+                continue;
+            }
+        }
+        char tmp[16 * 1024];
+        int n = sock->recv(tmp, sizeof(tmp));
+        if (n <= 0) {
+            return false;
+        }
+        buf.append(tmp, n);
+    }
+    buf.erase(0, pos);
+    return true;
+}
+
+static void client(const Address::ptr& addr, int depth, int requests,
+                   std::atomic<uint64_t>& done) {
+    auto sock = Socket::CreateTCP(addr->getFamily());
+    if (!sock->connect(addr)) {
+        FLEXY_LOG_ERROR(g_logger) << "connect fail";
+        return;
+    }
+    std::string batch;
+    for (int i = 0; i < depth; ++i) {
+        batch.append(s_request);
+    }
+    std::string buf;
+    for (int i = 0; i < requests; i += depth) {
+        if (sock->send(batch.data(), batch.size()) != (int)batch.size() ||
+            !ReadResponses(sock, buf, depth)) {
+            break;
+        }
+        done += depth;
+    }
+    sock->close();
+}
+
+static void run(uint32_t pipeline_batch, int conns, int depth, int requests) {
+    Config::LookupBase("http.server.pipeline_batch")
+        ->fromString(std::to_string(pipeline_batch));
+    std::atomic<uint64_t> done = 0;
+    uint64_t syscalls = 0;
+    std::chrono::duration<double> used;
+    {
+        IOManager iom(1, false, "bench");
+        uint64_t begin_syscalls = syscall_count();
+        auto begin = std::chrono::steady_clock::now();
+        // 监听 socket 需要在 hook 开启的线程中创建
+        iom.async([&]() {
+            auto server = std::make_shared<BenchServer>(true);
+            server->getServletDispatch()->addServlet(
+                "/hello", [](const http::HttpRequest::ptr&,
+                             const http::HttpResponse::ptr& rsp,
+                             const SockStream::ptr&) {
+                    rsp->setBodyRef("hello world");
+                    return 0;
+                });
+            auto addr = IPv4Address::Create("127.0.0.1");
+            if (!server->bind(addr)) {
+                FLEXY_LOG_ERROR(g_logger) << "bind fail";
+                return;
+            }
+            server->start();
+            auto local = server->getAddress();
+            std::atomic<int> running = conns;
+            for (int i = 0; i < conns; ++i) {
+                go [&, local]() {
+                    client(local, depth, requests, done);
+                    if (--running == 0) {
+                        server->stop();
+                    }
+                };
+            }
+            while (running) {
+                this_fiber::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+        iom.stop();
+        used = std::chrono::steady_clock::now() - begin;
+        syscalls = syscall_count() - begin_syscalls;
+    }
+    FLEXY_LOG_INFO(g_logger)
+        << "pipeline_batch = " << pipeline_batch << " conns = " << conns
+        << " depth = " << depth << " requests = " << done
+        << " qps = " << (uint64_t)(done / used.count())
+        << " syscalls/req = " << (double)syscalls / std::max<uint64_t>(done, 1);
+}
+
+int main(int argc, char** argv) {
+    int conns = argc > 1 ? atoi(argv[1]) : 16;
+    int depth = argc > 2 ? atoi(argv[2]) : 16;
+    int requests = argc > 3 ? atoi(argv[3]) : 10000;
+    FLEXY_LOG_NAME("system")->setLevel(LogLevel::INFO);
+    run(1, conns, depth, requests);
+    run(16, conns, depth, requests);
+    return 0;
+}
@@ -12,7 +12,7 @@ detail::__task handlers[65];
 static void signal_handler(int sig) {
     auto iom = Scheduler::GetThis();
     if (iom) {
-        iom->async(handlers[sig]);
+        iom->async([sig]() { handlers[sig](); });
     } else {
         handlers[sig]();
     }
@@ -0,0 +1,129 @@
+#include "flexy/fiber/allocator.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <vector>
+#include "flexy/util/config.h"
+#include "flexy/util/macro.h"
+
+static auto g_logger = FLEXY_LOG_NAME("system");
+
+static auto g_stack_pool_max_cached =
+    flexy::Config::Lookup("fiber.stack_pool.max_cached", 64u,
+                          "max cached fiber stacks per size class per thread");
+
+static const size_t s_page_size = sysconf(_SC_PAGESIZE);
+
+static std::atomic<uint64_t> s_hits{0};
+static std::atomic<uint64_t> s_misses{0};
+static std::atomic<uint64_t> s_outstanding{0};
+static std::atomic<uint64_t> s_cached{0};
+
+namespace {
+
+// 线程私有的空闲栈缓存, 按页数区分大小类
+// 协程栈大小通常只有一两种, 线性查找即可
+struct StackCache {
+    struct SizeClass {
+        size_t pages;               // 不含保护页的页数
+        std::vector<void*> stacks;  // mmap 得到的起始地址
+    };
+
+    ~StackCache();
+
+    std::vector<void*>& get(size_t pages) {
+        for (auto& c : classes) {
+            if (c.pages == pages) {
+                return c.stacks;
+            }
+        }
+        return classes.emplace_back(SizeClass{pages, {}}).stacks;
+    }
+
+    std::vector<SizeClass> classes;
+};
+
+}  // namespace
+
+// 线程退出时缓存已经析构, 之后释放的栈直接 munmap
+static thread_local bool t_cache_destroyed = false;
+
+static StackCache* GetCache() {
+    if (FLEXY_UNLIKELY(t_cache_destroyed)) {
+        return nullptr;
+    }
+    static thread_local StackCache s_cache;
+    return &s_cache;
+}
+
+static void* MapStack(size_t total) {
+    void* base = mmap(nullptr, total + s_page_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (FLEXY_UNLIKELY(base == MAP_FAILED)) {
+        FLEXY_LOG_ERROR(g_logger) << "mmap fiber stack size = " << total
+                                  << " errno = " << errno
+                                  << " errstr = " << strerror(errno);
+        throw std::bad_alloc();
+    }
+    // 栈向低地址增长, 保护页放在最低处
+    int rt = mprotect(base, s_page_size, PROT_NONE);
+    FLEXY_ASSERT2(rt == 0, "mprotect errno = " << errno);
+    return base;
+}
+
+static void UnmapStack(void* base, size_t total) {
+    int rt = munmap(base, total + s_page_size);
+    FLEXY_ASSERT2(rt == 0, "munmap errno = " << errno);
+}
+
+StackCache::~StackCache() {
+    for (auto& c : classes) {
+        for (auto base : c.stacks) {
+            UnmapStack(base, c.pages * s_page_size);
+        }
+        s_cached -= c.stacks.size();
+    }
+    t_cache_destroyed = true;
+}
+
+// 返回的内存块末尾与映射区末尾对齐, 页对齐多出的部分留在栈底
+void* PooledStackAllocator::Alloc(size_t size) {
+    size_t total = (size + s_page_size - 1) / s_page_size * s_page_size;
+    void* base = nullptr;
+    if (auto cache = GetCache()) {
+        auto& stacks = cache->get(total / s_page_size);
+        if (!stacks.empty()) {
+            base = stacks.back();
+            stacks.pop_back();
+            --s_cached;
+            ++s_hits;
+        }
+    }
+    if (!base) {
+        base = MapStack(total);
+        ++s_misses;
+    }
+    ++s_outstanding;
+    return (char*)base + s_page_size + (total - size);
+}
+
+void PooledStackAllocator::Dealloc(void* vp, size_t size) {
+    size_t total = (size + s_page_size - 1) / s_page_size * s_page_size;
+    void* base = (char*)vp - (total - size) - s_page_size;
+    --s_outstanding;
+    if (auto cache = GetCache()) {
+        auto& stacks = cache->get(total / s_page_size);
+        if (stacks.size() < g_stack_pool_max_cached->getValue()) {
+            stacks.push_back(base);
+            ++s_cached;
+            return;
+        }
+    }
+    UnmapStack(base, total);
+}
+
+PooledStackAllocator::Stats PooledStackAllocator::GetStats() {
+    return {s_hits, s_misses, s_outstanding, s_cached};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdlib.h>
+#include <cstdint>
 #include <memory>
 // #include <memory_resource>
 
@@ -21,6 +22,24 @@ private:
     static std::allocator<char> a;
 };
 
+// 基于 mmap 的协程栈池
+// 每块栈的最低地址处有一个 PROT_NONE 保护页, 栈溢出时直接触发 SIGSEGV
+// 按页数划分大小类, 每个线程缓存释放的栈供后续复用,
+// 每个大小类最多缓存 fiber.stack_pool.max_cached 块
+class PooledStackAllocator {
+public:
+    struct Stats {
+        uint64_t hits;         // 从缓存中复用的次数
+        uint64_t misses;       // 调用 mmap 新分配的次数
+        uint64_t outstanding;  // 正在被协程使用的栈数量
+        uint64_t cached;       // 各线程缓存中空闲的栈数量
+    };
+
+    static void* Alloc(size_t size);
+    static void Dealloc(void* vp, size_t size);
+    static Stats GetStats();
+};
+
 // static std::pmr::polymorphic_allocator<char> a;
 
 // class PolymorphicAllocator {
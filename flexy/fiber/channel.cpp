@@ -0,0 +1,360 @@
+#include "flexy/fiber/channel.h"
+#include <algorithm>
+#include <mutex>
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/macro.h"
+#include "flexy/util/util.h"
+
+namespace flexy::fiber {
+
+using detail::ChannelEntry;
+using detail::ChannelWaiter;
+
+static uint32_t FastRand() {
+    static thread_local uint32_t t_seed =
+        static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&t_seed)) | 1;
+    t_seed ^= t_seed << 13;
+    t_seed ^= t_seed >> 17;
+    t_seed ^= t_seed << 5;
+    return t_seed;
+}
+
+void ChannelWaiter::wake() {
+    Scheduler* s = scheduler;
+    Fiber::ptr f = std::move(fiber);
+    s->async(std::move(f));
+}
+
+void ChannelBase::link(ChannelEntry* entry, bool send) {
+    auto& list = send ? senders_ : receivers_;
+    entry->prev = list.tail;
+    entry->next = nullptr;
+    if (list.tail) {
+        list.tail->next = entry;
+    } else {
+        list.head = entry;
+    }
+    list.tail = entry;
+    entry->linked = true;
+    (send ? sendWaiting_ : recvWaiting_).fetch_add(1, std::memory_order_seq_cst);
+}
+
+void ChannelBase::unlink(ChannelEntry* entry, bool send) {
+    if (!entry->linked) {
+        return;
+    }
+    auto& list = send ? senders_ : receivers_;
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        list.head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        list.tail = entry->prev;
+    }
+    entry->prev = entry->next = nullptr;
+    entry->linked = false;
+    (send ? sendWaiting_ : recvWaiting_).fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ChannelBase::notifyOne(bool send, bool locked) {
+    std::unique_lock<Spinlock> lock(mutex_, std::defer_lock);
+    if (!locked) {
+        lock.lock();
+    }
+    auto& list = send ? senders_ : receivers_;
+    while (auto entry = list.head) {
+        // 已经被其他通道唤醒的 select 留下的项直接摘除
+        unlink(entry, send);
+        if (entry->waiter->claim(entry->index)) {
+            if (lock) {
+                lock.unlock();
+            }
+            entry->waiter->wake();
+            return;
+        }
+    }
+}
+
+ChannelBase::Result ChannelBase::trySendImpl(void* value, bool locked) {
+    if (buffered_) {
+        if (closed_.load(std::memory_order_acquire)) {
+            return kClosed;
+        }
+        if (!push(value)) {
+            return kBlock;
+        }
+        // 与接收方登记等待后的检查配对, 双方至少有一方能看到对方
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (recvWaiting_.load(std::memory_order_relaxed) > 0) {
+            notifyOne(false, locked);
+        }
+        return kOk;
+    }
+
+    std::unique_lock<Spinlock> lock(mutex_, std::defer_lock);
+    if (!locked) {
+        lock.lock();
+    }
+    if (closed_.load(std::memory_order_relaxed)) {
+        return kClosed;
+    }
+    while (auto entry = receivers_.head) {
+        unlink(entry, false);
+        if (entry->waiter->claim(entry->index)) {
+            move(entry->value, value);
+            entry->ok = true;
+            entry->done = true;
+            if (lock) {
+                lock.unlock();
+            }
+            entry->waiter->wake();
+            return kOk;
+        }
+    }
+    return kBlock;
+}
+
+ChannelBase::Result ChannelBase::tryRecvImpl(void* out, bool locked) {
+    if (buffered_) {
+        // 关闭后仍然可以取出缓冲区中剩余的值
+        if (pop(out) || (closed_.load(std::memory_order_acquire) && pop(out))) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sendWaiting_.load(std::memory_order_relaxed) > 0) {
+                notifyOne(true, locked);
+            }
+            return kOk;
+        }
+        return closed_.load(std::memory_order_acquire) ? kClosed : kBlock;
+    }
+
+    std::unique_lock<Spinlock> lock(mutex_, std::defer_lock);
+    if (!locked) {
+        lock.lock();
+    }
+    while (auto entry = senders_.head) {
+        unlink(entry, true);
+        if (entry->waiter->claim(entry->index)) {
+            move(out, entry->value);
+            entry->ok = true;
+            entry->done = true;
+            if (lock) {
+                lock.unlock();
+            }
+            entry->waiter->wake();
+            return kOk;
+        }
+    }
+    return closed_.load(std::memory_order_relaxed) ? kClosed : kBlock;
+}
+
+ChannelBase::Result ChannelBase::sendImpl(void* value, uint64_t timeout_ms) {
+    Result res = trySendImpl(value, false);
+    if (res != kBlock || timeout_ms == 0) {
+        return res;
+    }
+    SelectCase c{this, value, true};
+    if (Wait(&c, 1, timeout_ms, 0) < 0) {
+        return kBlock;
+    }
+    return c.ok ? kOk : kClosed;
+}
+
+ChannelBase::Result ChannelBase::recvImpl(void* out, uint64_t timeout_ms) {
+    Result res = tryRecvImpl(out, false);
+    if (res != kBlock || timeout_ms == 0) {
+        return res;
+    }
+    SelectCase c{this, out, false};
+    if (Wait(&c, 1, timeout_ms, 0) < 0) {
+        return kBlock;
+    }
+    return c.ok ? kOk : kClosed;
+}
+
+void ChannelBase::close() {
+    ChannelEntry* wakes = nullptr;
+    {
+        LOCK_GUARD(mutex_);
+        if (closed_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        closed_.store(true, std::memory_order_release);
+        for (bool send : {true, false}) {
+            auto& list = send ? senders_ : receivers_;
+            while (auto entry = list.head) {
+                unlink(entry, send);
+                if (entry->waiter->claim(entry->index)) {
+                    // 有缓冲通道的接收方被唤醒后还要取完缓冲区
+                    if (!buffered_) {
+                        entry->ok = false;
+                        entry->done = true;
+                    }
+                    entry->next = wakes;
+                    wakes = entry;
+                }
+            }
+        }
+    }
+    while (wakes) {
+        auto next = wakes->next;
+        wakes->waiter->wake();
+        wakes = next;
+    }
+}
+
+int ChannelBase::Wait(SelectCase* cases, size_t count, uint64_t timeout_ms,
+                      size_t start) {
+    FLEXY_ASSERT(Scheduler::GetThis());
+    FLEXY_ASSERT2(Fiber::GetFiberId() != 0, "Main Fiber cannot wait");
+    IOManager* iom = nullptr;
+    uint64_t deadline = 0;
+    if (timeout_ms != kInfinite) {
+        iom = IOManager::GetThis();
+        FLEXY_ASSERT2(iom, "select with timeout must run in IOManager");
+        deadline = GetTimeMs() + timeout_ms;
+    }
+
+    // 分支不多时不分配内存
+    constexpr size_t kInline = 4;
+    ChannelEntry inline_entries[kInline];
+    ChannelBase* inline_channels[kInline];
+    std::unique_ptr<ChannelEntry[]> heap_entries;
+    std::unique_ptr<ChannelBase*[]> heap_channels;
+    ChannelEntry* entries = inline_entries;
+    ChannelBase** channels = inline_channels;
+    if (count > kInline) {
+        heap_entries.reset(new ChannelEntry[count]);
+        heap_channels.reset(new ChannelBase*[count]);
+        entries = heap_entries.get();
+        channels = heap_channels.get();
+    }
+    // 按地址顺序加锁, 同一个通道只加一次锁
+    for (size_t i = 0; i < count; ++i) {
+        channels[i] = cases[i].channel;
+    }
+    std::sort(channels, channels + count);
+    size_t nchannels = std::unique(channels, channels + count) - channels;
+    auto lock_all = [&]() {
+        for (size_t i = 0; i < nchannels; ++i) {
+            channels[i]->mutex_.lock();
+        }
+    };
+    auto unlock_all = [&]() {
+        for (size_t i = nchannels; i > 0; --i) {
+            channels[i - 1]->mutex_.unlock();
+        }
+    };
+    auto unlink_all = [&]() {
+        lock_all();
+        for (size_t i = 0; i < count; ++i) {
+            cases[i].channel->unlink(&entries[i], cases[i].send);
+        }
+        unlock_all();
+    };
+
+    for (;;) {
+        // 带超时时, 定时器回调可能在返回之后才执行, waiter 放在堆上由回调共同持有
+        // 每一轮使用新的 waiter, 避免上一轮的定时器误唤醒
+        ChannelWaiter local_waiter;
+        std::shared_ptr<ChannelWaiter> shared_waiter;
+        ChannelWaiter* waiter = &local_waiter;
+        if (iom) {
+            shared_waiter = std::make_shared<ChannelWaiter>();
+            waiter = shared_waiter.get();
+        }
+        waiter->scheduler = Scheduler::GetThis();
+        waiter->fiber = Fiber::GetThis();
+
+        lock_all();
+        // 加锁后再尝试一次, 无缓冲通道的配对只在锁内进行, 不会错过对方
+        for (size_t k = 0; k < count; ++k) {
+            size_t i = (start + k) % count;
+            auto& c = cases[i];
+            Result res = c.send ? c.channel->trySendImpl(c.value, true)
+                                : c.channel->tryRecvImpl(c.value, true);
+            if (res != kBlock) {
+                unlock_all();
+                c.ok = res == kOk;
+                return i;
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            auto& entry = entries[i];
+            entry = ChannelEntry();
+            entry.waiter = waiter;
+            entry.value = cases[i].value;
+            entry.index = static_cast<int>(i);
+            cases[i].channel->link(&entry, cases[i].send);
+        }
+        unlock_all();
+
+        // 有缓冲通道无锁路径上的操作只在完成后检查等待计数,
+        // 登记之后需要再检查一次缓冲区, 避免错过登记前发生的操作
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool ready = false;
+        for (size_t i = 0; i < count && !ready; ++i) {
+            ChannelBase* ch = cases[i].channel;
+            ready = ch->buffered_ &&
+                    (ch->isClosed() ||
+                     (cases[i].send ? ch->writable() : ch->readable()));
+        }
+        if (ready && waiter->claim(ChannelWaiter::kRetry)) {
+            unlink_all();
+            continue;
+        }
+
+        Timer::ptr timer;
+        if (iom) {
+            uint64_t now = GetTimeMs();
+            timer = iom->addTimer(deadline > now ? deadline - now : 0,
+                                  [shared_waiter]() {
+                                      if (shared_waiter->claim(
+                                              ChannelWaiter::kTimeout)) {
+                                          shared_waiter->wake();
+                                      }
+                                  });
+        }
+        Fiber::Yield();
+        if (timer) {
+            timer->cancel();
+        }
+
+        int reason = waiter->state.load(std::memory_order_acquire);
+        unlink_all();
+        if (reason == ChannelWaiter::kTimeout) {
+            return -1;
+        }
+        auto& entry = entries[reason];
+        if (entry.done) {
+            cases[reason].ok = entry.ok;
+            return reason;
+        }
+        // 有缓冲通道的通知, 优先重试被通知的分支
+        start = reason;
+    }
+}
+
+int select(SelectCase* cases, size_t count, uint64_t timeout_ms) {
+    FLEXY_ASSERT(count > 0);
+    // 随机起点, 避免总是选中靠前的分支
+    size_t start = FastRand() % count;
+    for (size_t k = 0; k < count; ++k) {
+        size_t i = (start + k) % count;
+        auto& c = cases[i];
+        auto res = c.send ? c.channel->trySendImpl(c.value, false)
+                          : c.channel->tryRecvImpl(c.value, false);
+        if (res != ChannelBase::kBlock) {
+            c.ok = res == ChannelBase::kOk;
+            return i;
+        }
+    }
+    if (timeout_ms == 0) {
+        return -1;
+    }
+    return ChannelBase::Wait(cases, count, timeout_ms, start);
+}
+
+}  // namespace flexy::fiber
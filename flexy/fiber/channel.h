@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "flexy/fiber/fiber.h"
+#include "flexy/thread/mpmc_queue.h"
+#include "flexy/thread/mutex.h"
+#include "flexy/util/noncopyable.h"
+
+namespace flexy {
+
+class Scheduler;
+
+}  // namespace flexy
+
+namespace flexy::fiber {
+
+class ChannelBase;
+
+// select 的一个分支
+// send 为 true 时发送 *value (成功后被移走), 否则接收到 *value
+// 返回后 ok 表示该分支是否成功, 为 false 说明通道已关闭
+struct SelectCase {
+    ChannelBase* channel;
+    void* value;
+    bool send;
+    bool ok = false;
+};
+
+// 等待 cases 中任意一个分支完成, 返回完成的分支下标, 超时返回 -1
+// 多个分支同时就绪时随机选择一个; timeout_ms 为 0 时不阻塞, ~0 时不超时
+// 需要超时时必须在 IOManager 中调用
+int select(SelectCase* cases, size_t count, uint64_t timeout_ms);
+
+// 数组版本; 指针版本的超时没有缺省值, 避免 select(cases, ms) 被当作分支数量
+template <size_t N>
+int select(SelectCase (&cases)[N], uint64_t timeout_ms = ~0ull) {
+    return select(cases, N, timeout_ms);
+}
+
+namespace detail {
+
+// 阻塞在一个或多个通道上的协程
+struct ChannelWaiter {
+    static constexpr int kWaiting = -1;
+    static constexpr int kTimeout = -2;
+    static constexpr int kRetry = -3;
+
+    // 抢占唤醒权, 成功的一方负责唤醒
+    bool claim(int reason) {
+        int expected = kWaiting;
+        return state.compare_exchange_strong(expected, reason,
+                                             std::memory_order_acq_rel);
+    }
+    // 唤醒之后 waiter 可能随时失效
+    void wake();
+
+    std::atomic<int> state{kWaiting};  // 等待中或者唤醒的原因(分支下标/超时)
+    Scheduler* scheduler = nullptr;
+    Fiber::ptr fiber;
+};
+
+// 通道等待队列中的一项, 位于等待协程的栈上
+struct ChannelEntry {
+    ChannelEntry* prev = nullptr;
+    ChannelEntry* next = nullptr;
+    ChannelWaiter* waiter = nullptr;
+    void* value = nullptr;
+    int index = 0;        // 在 select 中的分支下标
+    bool linked = false;
+    bool done = false;    // 对方已经完成了操作(无缓冲通道交接值或通道关闭)
+    bool ok = false;      // done 时操作的结果
+};
+
+struct ChannelList {
+    ChannelEntry* head = nullptr;
+    ChannelEntry* tail = nullptr;
+};
+
+}  // namespace detail
+
+// 类型擦除的通道实现, 值通过 void* 传递, 由 Channel<T> 负责具体类型
+// 有缓冲通道: 值存放在无锁环形队列中, 发送/接收在不需要阻塞时不加锁;
+//            阻塞的一方登记到等待队列, 对方操作后检查等待计数再加锁唤醒
+// 无缓冲通道: 在通道锁内将值直接交给等待的一方
+class ChannelBase : noncopyable {
+public:
+    static constexpr uint64_t kInfinite = ~0ull;
+
+    explicit ChannelBase(bool buffered) : buffered_(buffered) {}
+    virtual ~ChannelBase() = default;
+
+    // 关闭通道并唤醒所有等待的协程
+    // 关闭后发送失败, 接收在取完缓冲区中的值后失败
+    void close();
+    bool isClosed() const { return closed_.load(std::memory_order_acquire); }
+
+protected:
+    enum Result { kOk, kBlock, kClosed };
+
+    // 不阻塞地发送/接收, locked 表示调用者已持有 mutex_
+    Result trySendImpl(void* value, bool locked);
+    Result tryRecvImpl(void* out, bool locked);
+    // 阻塞发送/接收, 超时返回 kBlock
+    Result sendImpl(void* value, uint64_t timeout_ms);
+    Result recvImpl(void* out, uint64_t timeout_ms);
+
+    // 缓冲区操作, 只有有缓冲通道会调用
+    virtual bool push(void* value) = 0;
+    virtual bool pop(void* out) = 0;
+    virtual bool readable() const = 0;
+    virtual bool writable() const = 0;
+    // *dst = std::move(*src)
+    virtual void move(void* dst, void* src) = 0;
+
+private:
+    friend int select(SelectCase* cases, size_t count, uint64_t timeout_ms);
+
+    // 登记到所有分支的通道上并挂起, 直到某个分支完成或超时; 从 start 开始尝试
+    static int Wait(SelectCase* cases, size_t count, uint64_t timeout_ms,
+                    size_t start);
+    void link(detail::ChannelEntry* entry, bool send);
+    void unlink(detail::ChannelEntry* entry, bool send);
+    // 唤醒 list 中一个还在等待的协程, 有缓冲通道被唤醒的一方重新尝试
+    void notifyOne(bool send, bool locked);
+
+private:
+    mutable Spinlock mutex_;
+    detail::ChannelList senders_;
+    detail::ChannelList receivers_;
+    std::atomic<uint32_t> sendWaiting_{0};
+    std::atomic<uint32_t> recvWaiting_{0};
+    std::atomic<bool> closed_{false};
+    const bool buffered_;
+};
+
+// Go 风格的协程通道, capacity 为 0 时为无缓冲通道
+// 有缓冲通道的容量向上取整为 2 的幂; 值按移动存取, 不额外分配内存
+// 阻塞操作必须在协程中调用
+template <typename T>
+class Channel : public ChannelBase {
+public:
+    using ptr = std::shared_ptr<Channel>;
+
+    explicit Channel(size_t capacity = 0)
+        : ChannelBase(capacity > 0),
+          queue_(capacity > 0 ? new MPMCQueue<T>(capacity) : nullptr) {}
+
+    // 发送, 通道关闭或超时返回 false
+    bool send(T value, uint64_t timeout_ms = kInfinite) {
+        return sendImpl(&value, timeout_ms) == kOk;
+    }
+    // 接收, 通道关闭且没有剩余值或超时返回 false
+    bool recv(T& value, uint64_t timeout_ms = kInfinite) {
+        return recvImpl(&value, timeout_ms) == kOk;
+    }
+    // 不阻塞地发送, 成功时 value 被移走
+    bool trySend(T& value) { return trySendImpl(&value, false) == kOk; }
+    bool trySend(T&& value) { return trySendImpl(&value, false) == kOk; }
+    // 不阻塞地接收
+    bool tryRecv(T& value) { return tryRecvImpl(&value, false) == kOk; }
+
+    // 用于 select 的分支, value 在 select 返回前必须有效
+    SelectCase sendCase(T& value) { return {this, &value, true}; }
+    SelectCase recvCase(T& value) { return {this, &value, false}; }
+
+    // 缓冲区中值的数量(近似)
+    size_t size() const { return queue_ ? queue_->size() : 0; }
+    size_t capacity() const { return queue_ ? queue_->capacity() : 0; }
+
+protected:
+    bool push(void* value) override {
+        return queue_->tryPush(std::move(*static_cast<T*>(value)));
+    }
+    bool pop(void* out) override {
+        return queue_->tryPop(*static_cast<T*>(out));
+    }
+    bool readable() const override { return !queue_->empty(); }
+    bool writable() const override { return !queue_->full(); }
+    void move(void* dst, void* src) override {
+        *static_cast<T*>(dst) = std::move(*static_cast<T*>(src));
+    }
+
+private:
+    const std::unique_ptr<MPMCQueue<T>> queue_;
+};
+
+}  // namespace flexy::fiber
@@ -2,6 +2,7 @@
 #include <atomic>
 #include "flexy/fiber/allocator.h"
 #include "flexy/schedule/scheduler.h"
+#include "flexy/util/align.h"
 #include "flexy/util/config.h"
 #include "flexy/util/macro.h"
 
@@ -18,20 +19,24 @@ static thread_local Fiber::ptr t_main_fiber = nullptr;  // main fiber
 static auto g_fiber_stack_size =
     Config::Lookup("fiber.stack_size", 128u * 1024u, "fiber stack size");
 
-using StackAllocator = MallocStackAllocator;
+using StackAllocator = PooledStackAllocator;
 
+// 内存布局: [协程栈 stacksize][Fiber], 栈向低地址增长, 栈顶紧挨 Fiber 对象
 Fiber* MallocFiber(size_t& __first) {
     __first = __first ? __first : g_fiber_stack_size->getValue();
+    __first = (__first + max_align_v - 1) & ~(max_align_v - 1);
 
-    Fiber* fiber = (Fiber*)StackAllocator::Alloc(sizeof(Fiber) + __first);
+    char* stack = (char*)StackAllocator::Alloc(__first + sizeof(Fiber));
     // new (fiber) Fiber(__first, std::forward<_Args>(__args)...);
-    return fiber;
+    return (Fiber*)(stack + __first);
 }
 
 std::shared_ptr<Fiber> FreeFiber(Fiber* fiber) {
-    return std::shared_ptr<Fiber>(fiber, [](Fiber* fiber) {
+    size_t stacksize = fiber->stacksize_;
+    return std::shared_ptr<Fiber>(fiber, [stacksize](Fiber* fiber) {
         fiber->~Fiber();
-        StackAllocator::Dealloc(fiber, 0);
+        StackAllocator::Dealloc((char*)fiber - stacksize,
+                                stacksize + sizeof(Fiber));
     });
 }
 
@@ -50,6 +55,7 @@ Fiber::Fiber(size_t stacksize, detail::__task&& task)
     stacksize_ = stacksize;
 
     // stack_ = StackAllocator::Alloc(stacksize_);
+    stack_ = (char*)this - stacksize_;  // 见 MallocFiber
 
     ctx_ = _fl_make_fcontext((char*)stack_ + stacksize_, stacksize_,
                              &Fiber::MainFunc);
@@ -93,9 +99,12 @@ void Fiber::resume() {
 
     auto [ctx, self] = _fl_jump_fcontext(ctx_, caller);
 
-    ctx_ = ctx;
-    if (self)
+    // 切换回来时, ctx 属于切换过来的协程 self, 而不一定是 this:
+    // 协程在其他线程被恢复时, self 是那个线程的主协程
+    if (self) {
+        static_cast<Fiber*>(self)->ctx_ = ctx;
         static_cast<Fiber*>(self)->state_ = READY;
+    }
     FLEXY_ASSERT(t_current_fiber == caller);
 }
 
@@ -26,6 +26,7 @@ public:
     using ptr = std::shared_ptr<Fiber>;
     friend class Scheduler;
     friend transfer_t ontop_callback(transfer_t);
+    friend std::shared_ptr<Fiber> FreeFiber(Fiber* fiber);
 
     template <typename First, typename... Args>
     friend std::shared_ptr<Fiber> fiber_make_shared(First&& first,
@@ -78,7 +79,7 @@ private:
     State state_ = READY;     // 协程状态
     fcontext_t ctx_;          // 协程上下文
     detail::__task cb_;       // 协程执行函数
-    char stack_[];            // 协程栈首指针
+    char* stack_ = nullptr;   // 协程栈首指针
 };
 
 template <typename First, typename... Args>
@@ -1,40 +1,299 @@
 #include "flexy/fiber/mutex.h"
+#include <thread>
 #include "flexy/schedule/scheduler.h"
+#include "flexy/util/config.h"
 #include "flexy/util/macro.h"
+#include "flexy/util/util.h"
 
 namespace flexy::fiber {
 
-mutex::~mutex() { FLEXY_ASSERT(locked_ == false); }
+static auto g_mutex_spin_count =
+    Config::Lookup("fiber.mutex.spin_count", 100u,
+                   "fiber mutex max spin count before parking");
 
-void mutex::lock() {
-    FLEXY_ASSERT(Scheduler::GetThis());
-    FLEXY_ASSERT2(Fiber::GetFiberId() != 0, "Main Fiber cannot wait");
+static std::atomic<uint32_t> s_mutex_spin_count{0};
+
+namespace {
+
+struct _MutexSpinIniter {
+    _MutexSpinIniter() {
+        // 单核上持有者不可能同时运行, 自旋没有意义
+        auto set = [](uint32_t v) {
+            s_mutex_spin_count = std::thread::hardware_concurrency() > 1 ? v : 0;
+        };
+        set(g_mutex_spin_count->getValue());
+        g_mutex_spin_count->addListener(
+            [set](const uint32_t&, const uint32_t& nv) { set(nv); });
+    }
+};
+static _MutexSpinIniter _init;
+
+}  // namespace
+
+static inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+static void Wake(detail::MutexWaiter* w) {
+    // 唤醒之后 w 可能随时失效
+    Scheduler* s = w->scheduler;
+    Fiber::ptr f = std::move(w->fiber);
+    s->async(std::move(f));
+}
+
+// 不在协程中(或者是调度线程的主协程)时无法挂起, 只能让出线程等待
+static bool CanPark() {
+    return Scheduler::GetThis() && Fiber::GetFiberId() != 0;
+}
+
+static void PrepareWaiter(detail::MutexWaiter* w) {
+    w->scheduler = Scheduler::GetThis();
+    w->fiber = Fiber::GetThis();
+}
+
+void detail::MutexWaitList::pushBack(MutexWaiter* w) {
+    w->next = nullptr;
+    if (tail) {
+        tail->next = w;
+    } else {
+        head = w;
+    }
+    tail = w;
+}
+
+void detail::MutexWaitList::pushFront(MutexWaiter* w) {
+    w->next = head;
+    head = w;
+    if (!tail) {
+        tail = w;
+    }
+}
+
+detail::MutexWaiter* detail::MutexWaitList::popFront() {
+    MutexWaiter* w = head;
+    if (w) {
+        head = w->next;
+        if (!head) {
+            tail = nullptr;
+        }
+        w->next = nullptr;
+    }
+    return w;
+}
+
+mutex::~mutex() { FLEXY_ASSERT(state_.load(std::memory_order_relaxed) == 0); }
+
+void mutex::lockSlow() {
+    stats_.contended.fetch_add(1, std::memory_order_relaxed);
+    // 自旋上限参考 glibc 的 adaptive mutex: 最近获得锁所需次数的两倍
+    uint32_t estimate = spinEstimate_.load(std::memory_order_relaxed);
+    uint32_t limit = s_mutex_spin_count.load(std::memory_order_relaxed);
+    limit = limit ? std::min(limit, estimate * 2 + 10) : 0;
+    for (uint32_t i = 0; i < limit; ++i) {
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        if (!(s & kLocked) &&
+            state_.compare_exchange_weak(s, s | kLocked,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+            spinEstimate_.store(estimate + ((int)i - (int)estimate) / 8,
+                                std::memory_order_relaxed);
+            stats_.spinned.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        CpuRelax();
+    }
+    if (limit) {
+        spinEstimate_.store(estimate + ((int)limit - (int)estimate) / 8,
+                            std::memory_order_relaxed);
+    }
+    if (!CanPark()) {
+        for (;;) {
+            uint32_t s = state_.load(std::memory_order_relaxed);
+            if (!(s & kLocked) &&
+                state_.compare_exchange_weak(s, s | kLocked,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    detail::MutexWaiter w;
+    PrepareWaiter(&w);
+    w.parkedUs = GetSteadyUs();
+    bool requeue = false;
+    for (;;) {
+        {
+            LOCK_GUARD(waitMutex_);
+            uint32_t s = state_.load(std::memory_order_relaxed);
+            bool acquired = false;
+            for (;;) {
+                if (!(s & kLocked)) {
+                    if (state_.compare_exchange_weak(s, s | kLocked,
+                                                     std::memory_order_acquire,
+                                                     std::memory_order_relaxed)) {
+                        acquired = true;
+                        break;
+                    }
+                } else if (state_.compare_exchange_weak(
+                               s, s | kParked, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            if (acquired) {
+                break;
+            }
+            // 被唤醒后竞争失败的协程排在队首, 避免一直被新来的协程抢先
+            if (requeue) {
+                waiters_.pushFront(&w);
+            } else {
+                waiters_.pushBack(&w);
+            }
+        }
+        stats_.parked.fetch_add(1, std::memory_order_relaxed);
+        Fiber::Yield();
+        if (w.granted) {
+            break;
+        }
+        requeue = true;
+        PrepareWaiter(&w);
+    }
+    w.fiber.reset();
+    if (requeue || w.granted) {
+        stats_.waitUs.fetch_add(GetSteadyUs() - w.parkedUs,
+                                std::memory_order_relaxed);
+    }
+}
+
+void mutex::unlockSlow() {
+    detail::MutexWaiter* w = nullptr;
     {
-        LOCK_GUARD(mutex_);
-        if (locked_) {
-            waiters_.emplace_back(Scheduler::GetThis(), Fiber::GetThis());
+        LOCK_GUARD(waitMutex_);
+        FLEXY_ASSERT(state_.load(std::memory_order_relaxed) & kLocked);
+        w = waiters_.popFront();
+        uint32_t parked = waiters_.empty() ? 0 : kParked;
+        if (w && fairness_ == kHandoff) {
+            // 不释放锁, 所有权直接转移给 w
+            w->granted = true;
+            state_.store(kLocked | parked, std::memory_order_release);
+            stats_.handoffs.fetch_add(1, std::memory_order_relaxed);
         } else {
-            locked_ = true;
+            state_.store(parked, std::memory_order_release);
+        }
+    }
+    if (w) {
+        Wake(w);
+    }
+}
+
+shared_mutex::~shared_mutex() {
+    FLEXY_ASSERT(state_.load(std::memory_order_relaxed) == 0);
+}
+
+void shared_mutex::lockSlow(bool exclusive) {
+    stats_.contended.fetch_add(1, std::memory_order_relaxed);
+    uint32_t limit = s_mutex_spin_count.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < limit; ++i) {
+        if (exclusive ? try_lock() : try_lock_shared()) {
+            stats_.spinned.fetch_add(1, std::memory_order_relaxed);
             return;
         }
+        CpuRelax();
     }
+    if (!CanPark()) {
+        // 不排队, 也不受挂起位的限制
+        for (;;) {
+            uint32_t s = state_.load(std::memory_order_relaxed);
+            bool free = exclusive ? (s & ~kParked) == 0 : !(s & kWriter);
+            if (free && state_.compare_exchange_weak(
+                            s, exclusive ? (s | kWriter) : (s + kReader),
+                            std::memory_order_acquire,
+                            std::memory_order_relaxed)) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    detail::MutexWaiter w;
+    w.exclusive = exclusive;
+    PrepareWaiter(&w);
+    w.parkedUs = GetSteadyUs();
+    {
+        LOCK_GUARD(waitMutex_);
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        for (;;) {
+            // 挂起位只在持有 waitMutex_ 时修改, 为 0 说明没有协程在排队
+            bool free = exclusive ? (s & ~kParked) == 0
+                                  : !(s & (kWriter | kParked));
+            if (free) {
+                if (state_.compare_exchange_weak(
+                        s, exclusive ? (s | kWriter) : (s + kReader),
+                        std::memory_order_acquire, std::memory_order_relaxed)) {
+                    w.fiber.reset();
+                    return;
+                }
+            } else if (state_.compare_exchange_weak(s, s | kParked,
+                                                    std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        waiters_.pushBack(&w);
+    }
+    stats_.parked.fetch_add(1, std::memory_order_relaxed);
     Fiber::Yield();
+    // 挂起的协程总是由解锁的一方直接交给锁
+    FLEXY_ASSERT(w.granted);
+    stats_.waitUs.fetch_add(GetSteadyUs() - w.parkedUs,
+                            std::memory_order_relaxed);
 }
 
-void mutex::unlock() {
-    std::pair<Scheduler*, Fiber::ptr> waiter;
+void shared_mutex::unlockSlow(bool exclusive) {
+    detail::MutexWaitList wakes;
     {
-        LOCK_GUARD(mutex_);
-        FLEXY_ASSERT(locked_);
-        if (waiters_.empty()) {
-            locked_ = false;
-            return;
+        LOCK_GUARD(waitMutex_);
+        if (exclusive) {
+            state_.fetch_and(~kWriter, std::memory_order_release);
+        }
+        grant(wakes);
+    }
+    while (auto w = wakes.popFront()) {
+        Wake(w);
+    }
+}
+
+void shared_mutex::grant(detail::MutexWaitList& wakes) {
+    uint32_t s = state_.load(std::memory_order_relaxed);
+    uint64_t count = 0;
+    while (!waiters_.empty()) {
+        auto w = waiters_.head;
+        if (w->exclusive) {
+            if (s & ~kParked) {
+                break;
+            }
+            s = state_.fetch_or(kWriter, std::memory_order_acquire) | kWriter;
         } else {
-            waiter = std::move(waiters_.front());
-            waiters_.pop_front();
+            if (s & kWriter) {
+                break;
+            }
+            s = state_.fetch_add(kReader, std::memory_order_acquire) + kReader;
         }
+        waiters_.popFront();
+        w->granted = true;
+        wakes.pushBack(w);
+        ++count;
+    }
+    if (waiters_.empty()) {
+        state_.fetch_and(~kParked, std::memory_order_relaxed);
+    }
+    if (count) {
+        stats_.handoffs.fetch_add(count, std::memory_order_relaxed);
     }
-    waiter.first->async(std::move(waiter.second));
 }
 
-}  // namespace flexy::fiber
\ No newline at end of file
+}  // namespace flexy::fiber
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <atomic>
-#include <deque>
+#include <cstdint>
 #include "flexy/fiber/fiber.h"
 #include "flexy/thread/mutex.h"
 #include "flexy/util/noncopyable.h"
@@ -14,18 +14,194 @@ class Scheduler;
 
 namespace flexy::fiber {
 
+// 锁竞争统计, 只在慢路径上计数
+struct MutexStats {
+    uint64_t contended = 0;  // 快路径失败的次数
+    uint64_t spinned = 0;    // 自旋期间获得锁的次数
+    uint64_t parked = 0;     // 挂起协程的次数
+    uint64_t handoffs = 0;   // 解锁时直接交给等待者的次数
+    uint64_t waitUs = 0;     // 挂起的协程等待的总时间(微秒)
+};
+
+namespace detail {
+
+// 阻塞在锁上的协程, 位于等待协程的栈上
+struct MutexWaiter {
+    MutexWaiter* next = nullptr;
+    Scheduler* scheduler = nullptr;
+    Fiber::ptr fiber;
+    uint64_t parkedUs = 0;  // 开始等待的时间
+    bool exclusive = true;  // shared_mutex 中是否为写者
+    bool granted = false;   // 锁已经直接交给了该协程
+};
+
+// 等待队列, 由锁内部的 Spinlock 保护
+struct MutexWaitList {
+    MutexWaiter* head = nullptr;
+    MutexWaiter* tail = nullptr;
+
+    bool empty() const { return head == nullptr; }
+    void pushBack(MutexWaiter* w);
+    void pushFront(MutexWaiter* w);
+    MutexWaiter* popFront();
+};
+
+struct MutexCounters {
+    std::atomic<uint64_t> contended{0};
+    std::atomic<uint64_t> spinned{0};
+    std::atomic<uint64_t> parked{0};
+    std::atomic<uint64_t> handoffs{0};
+    std::atomic<uint64_t> waitUs{0};
+
+    MutexStats snapshot() const {
+        MutexStats v;
+        v.contended = contended.load(std::memory_order_relaxed);
+        v.spinned = spinned.load(std::memory_order_relaxed);
+        v.parked = parked.load(std::memory_order_relaxed);
+        v.handoffs = handoffs.load(std::memory_order_relaxed);
+        v.waitUs = waitUs.load(std::memory_order_relaxed);
+        return v;
+    }
+};
+
+}  // namespace detail
+
 // Analogous to `std::mutex`, but it's for fiber.
+// 一个原子状态字表示锁和是否有协程挂起; 无竞争时加解锁各一次 CAS
+// 竞争时先自旋一段时间(持有者在其他线程上运行, 临界区很短时可以避免切换),
+// 自旋次数按最近获得锁所需的次数自适应, 上限为 fiber.mutex.spin_count;
+// 仍然失败再挂起到侵入式等待队列, 不额外分配内存;
+// 不在协程中时不挂起, 让出线程直到获得锁
 class mutex : noncopyable {
 public:
-    mutex() = default;
+    enum Fairness {
+        // 解锁时释放锁再唤醒队首, 被唤醒的协程与新来的协程竞争, 吞吐量高;
+        // 竞争失败的协程回到队首
+        kBarging,
+        // 解锁时把锁直接交给队首的协程, 严格先来先得
+        kHandoff,
+    };
+
+    explicit mutex(Fairness fairness = kBarging) : fairness_(fairness) {}
     ~mutex();
-    void lock();
-    void unlock();
+
+    void lock() {
+        uint32_t expected = 0;
+        if (!state_.compare_exchange_strong(expected, kLocked,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+            lockSlow();
+        }
+    }
+    bool try_lock() {
+        uint32_t expected = 0;
+        return state_.compare_exchange_strong(expected, kLocked,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed);
+    }
+    void unlock() {
+        uint32_t expected = kLocked;
+        if (!state_.compare_exchange_strong(expected, 0,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+            unlockSlow();
+        }
+    }
+
+    Fairness getFairness() const { return fairness_; }
+    void setFairness(Fairness v) { fairness_ = v; }
+    MutexStats getStats() const { return stats_.snapshot(); }
+
+private:
+    static constexpr uint32_t kLocked = 1;
+    static constexpr uint32_t kParked = 2;  // 等待队列不为空
+
+    void lockSlow();
+    void unlockSlow();
+
+private:
+    std::atomic<uint32_t> state_{0};
+    std::atomic<uint32_t> spinEstimate_{0};
+    Fairness fairness_;
+    mutable Spinlock waitMutex_;
+    detail::MutexWaitList waiters_;
+    detail::MutexCounters stats_;
+};
+
+// Analogous to `std::shared_mutex`, but it's for fiber.
+// 状态字包含写锁位, 挂起位和读者数量; 有协程挂起时新的读者不再进入,
+// 避免写者饥饿; 挂起的协程按先来先得的顺序直接获得锁,
+// 队首连续的读者一起获得锁
+class shared_mutex : noncopyable {
+public:
+    shared_mutex() = default;
+    ~shared_mutex();
+
+    void lock() {
+        uint32_t expected = 0;
+        if (!state_.compare_exchange_strong(expected, kWriter,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+            lockSlow(true);
+        }
+    }
+    bool try_lock() {
+        uint32_t expected = 0;
+        return state_.compare_exchange_strong(expected, kWriter,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed);
+    }
+    void unlock() {
+        uint32_t expected = kWriter;
+        if (!state_.compare_exchange_strong(expected, 0,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+            unlockSlow(true);
+        }
+    }
+
+    void lock_shared() {
+        if (!try_lock_shared()) {
+            lockSlow(false);
+        }
+    }
+    bool try_lock_shared() {
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        while (!(s & (kWriter | kParked))) {
+            if (state_.compare_exchange_weak(s, s + kReader,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    void unlock_shared() {
+        uint32_t s = state_.fetch_sub(kReader, std::memory_order_release);
+        // 最后一个读者负责唤醒等待的写者
+        if ((s & ~kParked) == kReader && (s & kParked)) {
+            unlockSlow(false);
+        }
+    }
+
+    MutexStats getStats() const { return stats_.snapshot(); }
+
+private:
+    static constexpr uint32_t kWriter = 1;
+    static constexpr uint32_t kParked = 2;
+    static constexpr uint32_t kReader = 4;
+
+    void lockSlow(bool exclusive);
+    void unlockSlow(bool exclusive);
+    // 按顺序把锁交给队首的等待者, 需要持有 waitMutex_
+    // 被唤醒的协程追加到 wakes
+    void grant(detail::MutexWaitList& wakes);
 
 private:
-    bool locked_ = false;
-    mutable Spinlock mutex_;
-    std::deque<std::pair<Scheduler*, Fiber::ptr>> waiters_;
+    std::atomic<uint32_t> state_{0};
+    mutable Spinlock waitMutex_;
+    detail::MutexWaitList waiters_;
+    detail::MutexCounters stats_;
 };
 
-}  // namespace flexy::fiber
\ No newline at end of file
+}  // namespace flexy::fiber
@@ -1,4 +1,7 @@
 #include "http.h"
+#include "http_session.h"
+#include <time.h>
+#include <charconv>
 
 namespace flexy::http {
 
@@ -46,14 +49,79 @@ HttpRequest::HttpRequest(uint8_t version, bool close) :
 }
 
 std::string HttpRequest::getUri() {
-    return path_ + (query_.empty() ? "" : "?" + query_) +
-           (fragment_.empty() ? "" : "#" + fragment_);
+    std::string uri(path_);
+    if (!query_.empty()) {
+        uri.append("?").append(query_);
+    }
+    if (!fragment_.empty()) {
+        uri.append("#").append(fragment_);
+    }
+    return uri;
+}
+
+const HttpRequest::MapType& HttpRequest::getHeaders() const {
+    flushHeaderRefs();
+    return headers_;
+}
+
+void HttpRequest::setHeaders(const MapType& v) {
+    headerRefCount_ = 0;
+    moreHeaderRefs_.clear();
+    headers_ = v;
+}
+
+void HttpRequest::addHeaderRef(std::string_view name, std::string_view value) {
+    if (headerRefCount_ < kInlineHeaderRefs) {
+        inlineHeaderRefs_[headerRefCount_] = {name, value};
+    } else {
+        moreHeaderRefs_.push_back({name, value});
+    }
+    ++headerRefCount_;
+}
+
+void HttpRequest::flushHeaderRefs() const {
+    for (size_t i = 0; i < headerRefCount_; ++i) {
+        auto& ref = headerRef(i);
+        if (!ref.name.empty()) {
+            headers_[std::string(ref.name)] = ref.value;
+        }
+    }
+    headerRefCount_ = 0;
+    moreHeaderRefs_.clear();
+}
+
+void HttpRequest::eraseHeaderRef(std::string_view key) {
+    for (size_t i = 0; i < headerRefCount_; ++i) {
+        auto& ref = headerRef(i);
+        if (ref.name.size() == key.size() &&
+            strncasecmp(ref.name.data(), key.data(), key.size()) == 0) {
+            ref.name = {};
+        }
+    }
+}
+
+bool HttpRequest::findHeader(std::string_view key, std::string_view& val) const {
+    // 同名头部以最后一个为准, 与 map 的覆盖语义一致
+    for (size_t i = headerRefCount_; i > 0; --i) {
+        auto& ref = headerRef(i - 1);
+        if (ref.name.size() == key.size() &&
+            strncasecmp(ref.name.data(), key.data(), key.size()) == 0) {
+            val = ref.value;
+            return true;
+        }
+    }
+    auto it = headers_.find(std::string(key));
+    if (it == headers_.end()) {
+        return false;
+    }
+    val = it->second;
+    return true;
 }
 
 std::string HttpRequest::getHeader(const std::string& key,
                                           const std::string& def) const {
-    auto it = headers_.find(key);
-    return it == headers_.end() ? def : it->second;
+    std::string_view val;
+    return findHeader(key, val) ? std::string(val) : def;
 }
 
 std::string HttpRequest::getParam(const std::string& key,
@@ -73,26 +141,27 @@ void HttpRequest::setUri(std::string_view uri) {
     if (pos == std::string::npos) {
         auto pos2 = uri.find('#');
         if (pos2 == std::string_view::npos) {
-            path_ = uri;
+            setPath(uri);
         } else {
-            path_ = uri.substr(0, pos2);
-            fragment_ = uri.substr(pos2 + 1);
+            setPath(uri.substr(0, pos2));
+            setFragment(uri.substr(pos2 + 1));
         }
     } else {
-        path_ = uri.substr(0, pos);
+        setPath(uri.substr(0, pos));
 
         auto pos2 = uri.find('#', pos + 1);
         if (pos2 == std::string_view::npos) {
-            query_ = uri.substr(pos + 1);
+            setQuery(uri.substr(pos + 1));
         } else {
-            query_ = uri.substr(pos + 1, pos2 - pos - 1);
-            fragment_ = uri.substr(pos2 + 1);
+            setQuery(uri.substr(pos + 1, pos2 - pos - 1));
+            setFragment(uri.substr(pos2 + 1));
         }
     }
 }
 
 void HttpRequest::setHeader(const std::string& key,
                                    const std::string& val) {
+    eraseHeaderRef(key);
     headers_[key] = val;
 }
 
@@ -107,6 +176,7 @@ void HttpRequest::setCookie(const std::string& key,
 }
 
 void HttpRequest::delHeader(const std::string& key) {
+    eraseHeaderRef(key);
     headers_.erase(key);
 }
 
@@ -119,12 +189,12 @@ void HttpRequest::delCookie(const std::string& key) {
 }
 
 bool HttpRequest::hasHeader(const std::string& key, std::string* val) {
-    auto it = headers_.find(key);
-    if (it == headers_.end()) {
+    std::string_view v;
+    if (!findHeader(key, v)) {
         return false;
     }
     if (val) {
-        *val = it->second;
+        *val = v;
     }
     return true;
 }
@@ -158,6 +228,7 @@ std::ostream& HttpRequest::dump(std::ostream& os) const {
        << " HTTP/" << (uint32_t)(version_ >> 4) << "."
        << (uint32_t)(version_ & 0x0f) << "\r\n";
 
+    flushHeaderRefs();
     if (close_) {
         headers_["connection"] = "close";
     }
@@ -186,6 +257,51 @@ void HttpRequest::init() {
     }
 }
 
+void HttpRequest::detach() {
+    if (path_.data() != pathBuf_.data()) {
+        setPath(path_);
+    }
+    if (query_.data() != queryBuf_.data()) {
+        setQuery(query_);
+    }
+    if (fragment_.data() != fragmentBuf_.data()) {
+        setFragment(fragment_);
+    }
+    if (body_.data() != bodyBuf_.data()) {
+        setBody(body_);
+    }
+    flushHeaderRefs();
+}
+
+// 状态码和原因短语 " 200 OK\r\n", 编译期拼接
+static std::string_view StatusLineSuffix(HttpStatus s) {
+    switch (s) {
+#define XX(code, name, msg)    \
+        case HttpStatus::name: \
+            return " " #code " " #msg "\r\n";
+        HTTP_STATUS_MAP(XX);
+#undef XX
+        default:
+            return {};
+    }
+}
+
+// "date: Sat, 17 Oct 2026 14:00:00 GMT\r\n", 每个线程每秒只格式化一次
+static std::string_view DateHeader() {
+    static thread_local time_t s_last = 0;
+    static thread_local char s_buf[64];
+    static thread_local size_t s_len = 0;
+    time_t now = time(nullptr);
+    if (now != s_last) {
+        tm t;
+        gmtime_r(&now, &t);
+        s_len = strftime(s_buf, sizeof(s_buf),
+                         "date: %a, %d %b %Y %H:%M:%S GMT\r\n", &t);
+        s_last = now;
+    }
+    return {s_buf, s_len};
+}
+
 HttpResponse::HttpResponse(uint8_t version, bool close)
     : status_(HttpStatus::OK), version_(version), close_(close) {}
 
@@ -204,6 +320,70 @@ void HttpResponse::delHeader(const std::string &key) {
     headers_.erase(key);
 }
 
+void HttpResponse::serializeHeader(std::string& out) const {
+    char num[24];
+    out.append("HTTP/");
+    out.push_back('0' + (version_ >> 4));
+    out.push_back('.');
+    out.push_back('0' + (version_ & 0x0f));
+    auto suffix = StatusLineSuffix(status_);
+    if (reason_.empty() && !suffix.empty()) {
+        out.append(suffix);
+    } else {
+        out.push_back(' ');
+        out.append(num, std::to_chars(num, num + sizeof(num), (int)status_).ptr);
+        out.push_back(' ');
+        out.append(reason_.empty() ? HttpStatusToString(status_) : reason_);
+        out.append("\r\n");
+    }
+
+    // 没有消息体时保留调用者设置的长度(如 HEAD 或代理的响应), 否则按消息体重新生成
+    bool has_body = bodyStream_ || fileBody_.fd >= 0 || !body_.empty();
+    bool has_date = false, has_length = false;
+    for (auto& [x, y] : headers_) {
+        if (close_ && strcasecmp(x.c_str(), "connection") == 0) {
+            continue;
+        }
+        if (strcasecmp(x.c_str(), "content-length") == 0 ||
+            strcasecmp(x.c_str(), "transfer-encoding") == 0) {
+            if (has_body) {
+                continue;
+            }
+            has_length = true;
+        }
+        has_date = has_date || strcasecmp(x.c_str(), "date") == 0;
+        out.append(x).append(": ").append(y).append("\r\n");
+    }
+    if (close_) {
+        out.append("connection: close\r\n");
+    }
+    if (!has_date) {
+        out.append(DateHeader());
+    }
+    // 1xx 和 204 响应不能携带 content-length, 304 没有消息体
+    int code = (int)status_;
+    if (bodyStream_) {
+        // HTTP/1.0 不支持 chunked, 以关闭连接表示消息体结束
+        if (version_ >= 0x11) {
+            out.append("transfer-encoding: chunked\r\n");
+        }
+    } else if (!has_length && code >= 200 && status_ != HttpStatus::NO_CONTENT &&
+               status_ != HttpStatus::NOT_MODIFIED) {
+        uint64_t length = fileBody_.fd >= 0 ? fileBody_.length : body_.size();
+        out.append("content-length: ");
+        out.append(num, std::to_chars(num, num + sizeof(num), length).ptr);
+        out.append("\r\n");
+    }
+    out.append("\r\n");
+}
+
+Stream::ptr HttpResponse::getBodyStream() {
+    if (!bodyStream_ && session_) {
+        bodyStream_ = std::make_shared<HttpResponseStream>(session_, this);
+    }
+    return bodyStream_;
+}
+
 std::ostream& HttpResponse::dump(std::ostream &os) const {
     os << "HTTP/" << (uint32_t)(version_ >> 4) << "."
        << (uint32_t)(version_ & 0x0f) << " "
@@ -4,6 +4,10 @@
 #include <map>
 #include <memory>
 #include <sstream>
+#include <string_view>
+#include <vector>
+#include "flexy/stream/stream.h"
+#include "flexy/util/noncopyable.h"
 
 namespace flexy::http {
 
@@ -163,6 +167,16 @@ HttpMethod StringToHttpMethod(std::string_view m);
 const char* HttpMethodToString(HttpMethod m);
 const char* HttpStatusToString(HttpStatus s);
 
+class HttpSession;
+
+// 以 sendfile 发送的文件消息体, holder 保证发送完成前 fd 不被关闭
+struct HttpFileBody {
+    std::shared_ptr<const void> holder;
+    int fd = -1;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
 struct CaseInsensitiveLess {
     bool operator()(const std::string& lhs, const std::string& rhs) const {
         return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
@@ -170,25 +184,50 @@ struct CaseInsensitiveLess {
 };
 
 // Http 响应报文
-class HttpResponse {
+// body 以 string_view 保存, setBody 拷贝或接管字符串, setBodyRef 只引用外部数据,
+// 被引用的数据需要在 sendResponse 完成前保持有效
+// 也可以通过 getBodyStream() 流式发送消息体, 此时忽略 body
+class HttpResponse : noncopyable {
 public:
     using ptr = std::unique_ptr<HttpResponse>;
     using MapType = std::map<std::string, std::string, CaseInsensitiveLess>;
     HttpResponse(uint8_t version = 0x11, bool close = true);
     HttpStatus getStatus() const { return status_; }
     uint8_t getVersion() const { return version_; }
-    auto& getBody() const { return body_; }
+    std::string_view getBody() const { return body_; }
     auto& getReason() const { return reason_; }
     auto& getHeaders() const { return headers_; }
 
     void setStatus(HttpStatus status) { status_ = status; }
     void setVersion(uint8_t version) { version_ = version; }
-    void setBody(std::string_view body) { body_ = body; }
+    void setBody(std::string_view v) { body_ = bodyBuf_ = v; }
+    void setBody(std::string&& v) { bodyBuf_ = std::move(v); body_ = bodyBuf_; }
+    void setBody(const char* v) { setBody(std::string_view(v)); }
+    void setBodyRef(std::string_view v) { body_ = v; }
+    // 消息体为文件 fd 中 [offset, offset + length) 的内容, 发送时不经过用户空间
+    void setBodyFile(std::shared_ptr<const void> holder, int fd,
+                     uint64_t offset, uint64_t length) {
+        fileBody_ = {std::move(holder), fd, offset, length};
+    }
+    const HttpFileBody* getBodyFile() const {
+        return fileBody_.fd >= 0 ? &fileBody_ : nullptr;
+    }
     void setReason(std::string_view reason) { reason_ = reason; }
     void setHeaders(const MapType& v) { headers_ = v; }
 
     bool isClose() const { return close_; }
     void setClose(bool v) { close_ = v; }
+    // HEAD 请求的响应只发送头部, content-length 仍为消息体的长度
+    bool isHeadOnly() const { return headOnly_; }
+    void setHeadOnly(bool v) { headOnly_ = v; }
+
+    // 流式发送消息体的输出流, 第一次写入时发送状态行和头部, 之后不能再修改头部
+    // HTTP/1.1 使用 chunked 编码, HTTP/1.0 直接写出并在结束后关闭连接
+    // 只有 HttpServer 处理的 HTTP/1.x 响应支持, 否则返回 nullptr
+    Stream::ptr getBodyStream();
+    bool isStreaming() const { return bodyStream_ != nullptr; }
+    // 响应所属的会话, 由 HttpServer 在分发前设置
+    void setSession(HttpSession* v) { session_ = v; }
 
     std::string getHeader(const std::string& key,
                           const std::string& def = "") const;
@@ -205,6 +244,10 @@ public:
         return getAs(headers_, key, def);
     }
 
+    // 将状态行和头部(含 content-length 和 date)追加到 out, 不包括消息体
+    // 流式发送时 content-length 替换为 transfer-encoding: chunked(HTTP/1.1)
+    void serializeHeader(std::string& out) const;
+
     std::ostream& dump(std::ostream& os) const;
     std::string toString() const {
         std::stringstream ss;
@@ -216,14 +259,30 @@ private:
     HttpStatus status_;  // 响应状态码
     uint8_t version_;    // 版本
     bool close_;         // 是否自动关闭
+    bool headOnly_ = false;  // 不发送消息体
 
-    std::string body_;         // 响应消息体
+    std::string_view body_;    // 响应消息体
+    std::string bodyBuf_;      // setBody 时持有的消息体
+    HttpFileBody fileBody_;    // setBodyFile 设置的文件消息体
     std::string reason_;       // 响应原因
     mutable MapType headers_;  // 响应头部报文
+
+    HttpSession* session_ = nullptr;  // 所属会话, 流式发送时使用
+    Stream::ptr bodyStream_;          // 流式发送的输出流
+};
+
+// 零拷贝解析得到的头部字段, 指向会话的读缓冲区
+struct HttpHeaderRef {
+    std::string_view name;      // 为空表示已删除
+    std::string_view value;
 };
 
 // Htpp请求报文
-class HttpRequest {
+// path/query/fragment/body 以 string_view 保存, 既可以指向自身持有的字符串(setXxx),
+// 也可以直接指向会话的读缓冲区(setXxxRef, 零拷贝解析), 后者在会话读取下一个请求前有效
+// 零拷贝解析的头部保存在扁平数组中, 修改头部或调用 getHeaders() 时才转存到 map
+// 消息体为 chunked 编码或超出会话读缓冲区时不预先读取, 通过 getBodyStream() 增量读取
+class HttpRequest : noncopyable {
 public:
     using ptr = std::unique_ptr<HttpRequest>;
     using MapType = std::map<std::string, std::string, CaseInsensitiveLess>;
@@ -236,36 +295,52 @@ public:
 
     HttpMethod getMehod() const { return method_; }
     uint8_t getVersion() const { return version_; }
-    auto& getPath() const { return path_; }
-    auto& getQuery() const { return query_; }
-    auto& getBody() const { return body_; }
+    std::string_view getPath() const { return path_; }
+    std::string_view getQuery() const { return query_; }
+    std::string_view getFragment() const { return fragment_; }
+    std::string_view getBody() const { return body_; }
+    // 流式读取的消息体; 流式 servlet(Servlet::setStreamBody)总是可以通过它读取,
+    // 其他情况下没有未读取的消息体时为 nullptr
+    const Stream::ptr& getBodyStream() const { return bodyStream_; }
     std::string getUri();
     uint32_t getStreamId() { return streamId_; }
 
-    auto& getHeaders() const { return headers_; }
+    const MapType& getHeaders() const;
     auto& getParams() const { return params_; }
     auto& getCookies() const { return cookies_; }
 
     void setMethod(HttpMethod v) { method_ = v; }
     void setVersion(uint8_t v) { version_ = v; }
 
-    void setPath(std::string_view v) { path_ = v; }
-    void setQuery(std::string_view v) { query_ = v; }
-    void setFragment(std::string_view v) { fragment_ = v; }
-    void setBody(std::string_view v) { body_ = v; }
+    void setPath(std::string_view v) { path_ = pathBuf_ = v; }
+    void setQuery(std::string_view v) { query_ = queryBuf_ = v; }
+    void setFragment(std::string_view v) { fragment_ = fragmentBuf_ = v; }
+    void setBody(std::string_view v) { body_ = bodyBuf_ = v; }
+    void setBody(std::string&& v) { bodyBuf_ = std::move(v); body_ = bodyBuf_; }
+    void setBody(const char* v) { setBody(std::string_view(v)); }
     void setUri(std::string_view v);
     void setStreamId(uint32_t v) { streamId_ = v; }
+    void setBodyStream(Stream::ptr v) { bodyStream_ = std::move(v); }
+
+    // 不拷贝, 直接引用外部内存
+    void setPathRef(std::string_view v) { path_ = v; }
+    void setQueryRef(std::string_view v) { query_ = v; }
+    void setFragmentRef(std::string_view v) { fragment_ = v; }
+    void setBodyRef(std::string_view v) { body_ = v; }
+    void addHeaderRef(std::string_view name, std::string_view value);
 
     bool isClose() const { return close_; }
     void setClose(bool v) { close_ = v; } 
 
-    void setHeaders(const MapType& v) { headers_ = v; }
+    void setHeaders(const MapType& v);
     void setParams(const MapType& v) { params_ = v; }
     void setCookies(const MapType& v) { cookies_ = v; }
 
     std::string getHeader(const std::string& key, const std::string& def = "") const;
     std::string getParam(const std::string& key, const std::string& def = "") const;
     std::string getCookie(const std::string& key, const std::string& def = "") const;
+    // 查找头部, 不存在返回 false
+    bool findHeader(std::string_view key, std::string_view& val) const;
 
     void setHeader(const std::string& key, const std::string& val);
     void setParam (const std::string& key, const std::string& val);
@@ -282,17 +357,34 @@ public:
     template <typename T>
     std::pair<typename MapType::iterator, bool> try_emplaceHeader(
         const std::string& key, T&& val) {
+        flushHeaderRefs();
         return headers_.try_emplace(key, std::forward<T>(val));
     }
 
     template <typename T>
     bool checkGetHeaderAs(const std::string& key, T& val, const T& def = T()) {
-        return checkGetAs(headers_, key, val, def);
+        std::string_view str;
+        if (findHeader(key, str)) {
+            try {
+                val = boost::lexical_cast<T>(str.data(), str.size());
+                return true;
+            } catch (...) {
+            }
+        }
+        val = def;
+        return false;
     }
 
     template <typename T>
     T getHeaderAs(const std::string& key, const T& def = T()) const {
-        return getAs(headers_, key, def);
+        std::string_view str;
+        if (findHeader(key, str)) {
+            try {
+                return boost::lexical_cast<T>(str.data(), str.size());
+            } catch (...) {
+            }
+        }
+        return def;
     }
 
     template <typename T>
@@ -323,7 +415,21 @@ public:
     }
     // 更新connection： close or keep-alive
     void init();
+    // 将引用外部内存的字段转存为自身持有, 之后不再依赖会话的读缓冲区
+    void detach();
+private:
+    // 把零拷贝的头部转存到 headers_ 中
+    void flushHeaderRefs() const;
+    // 删除零拷贝的同名头部
+    void eraseHeaderRef(std::string_view key);
+    // 第 i 个零拷贝头部, 前 kInlineHeaderRefs 个保存在对象内
+    HttpHeaderRef& headerRef(size_t i) const {
+        return i < kInlineHeaderRefs ? inlineHeaderRefs_[i]
+                                     : moreHeaderRefs_[i - kInlineHeaderRefs];
+    }
 private:
+    static constexpr size_t kInlineHeaderRefs = 16;
+
     HttpMethod method_;                     // Http方法
     uint8_t version_;                       // Http 版本
     bool close_;                            // 是否自动关闭
@@ -332,11 +438,20 @@ private:
 
     uint32_t streamId_ = 0;  // http2 流id
 
-    std::string path_;                      // 请求路径
-    std::string query_;                     // 请求参数
-    std::string fragment_;                  // 请求fragment
-    std::string body_;                      // 请求消息体
-
+    std::string_view path_;                 // 请求路径
+    std::string_view query_;                // 请求参数
+    std::string_view fragment_;             // 请求fragment
+    std::string_view body_;                 // 请求消息体
+    std::string pathBuf_;
+    std::string queryBuf_;
+    std::string fragmentBuf_;
+    std::string bodyBuf_;
+    Stream::ptr bodyStream_;                // 流式读取的消息体
+
+    // 零拷贝的请求头部, 超出部分放在 moreHeaderRefs_
+    mutable HttpHeaderRef inlineHeaderRefs_[kInlineHeaderRefs];
+    mutable std::vector<HttpHeaderRef> moreHeaderRefs_;
+    mutable size_t headerRefCount_ = 0;
     mutable MapType headers_;               // 请求头部 Map
     MapType params_;                        // 请求参数 Map
     MapType cookies_;                       // 请求 Cookie Map
@@ -79,17 +79,29 @@ void on_request_uri(void *data, const char *at, size_t length) {
 
 void on_requese_fragment(void *data, const char *at, size_t length) {
     HttpRequestParser* parser = static_cast<HttpRequestParser*>(data);
-    parser->getData()->setFragment(std::string_view(at, length));
+    if (parser->isZeroCopy()) {
+        parser->getData()->setFragmentRef(std::string_view(at, length));
+    } else {
+        parser->getData()->setFragment(std::string_view(at, length));
+    }
 }
 
 void on_request_path(void *data, const char *at, size_t length) {
     HttpRequestParser* parser = static_cast<HttpRequestParser*>(data);
-    parser->getData()->setPath(std::string_view(at, length));
+    if (parser->isZeroCopy()) {
+        parser->getData()->setPathRef(std::string_view(at, length));
+    } else {
+        parser->getData()->setPath(std::string_view(at, length));
+    }
 }
 
 void on_request_query(void *data, const char *at, size_t length) {
     HttpRequestParser* parser = static_cast<HttpRequestParser*>(data);
-    parser->getData()->setQuery(std::string_view(at, length));
+    if (parser->isZeroCopy()) {
+        parser->getData()->setQueryRef(std::string_view(at, length));
+    } else {
+        parser->getData()->setQuery(std::string_view(at, length));
+    }
 }
 
 void on_request_version(void *data, const char *at, size_t length) {
@@ -118,10 +130,16 @@ void on_request_http_field(void *data, const char *field, size_t flen, const cha
         FLEXY_LOG_WARN(g_logger) << "invalid http request field length = 0";
         return; 
     }
-    parser->getData()->setHeader(std::string(field, flen), std::string(value, vlen));
+    if (parser->isZeroCopy()) {
+        parser->getData()->addHeaderRef(std::string_view(field, flen),
+                                        std::string_view(value, vlen));
+    } else {
+        parser->getData()->setHeader(std::string(field, flen), std::string(value, vlen));
+    }
 }
 
-HttpRequestParser::HttpRequestParser() : data_(new HttpRequest), error_(0) {
+HttpRequestParser::HttpRequestParser(bool zero_copy)
+    : data_(new HttpRequest), zeroCopy_(zero_copy), error_(0) {
     http_parser_init(&parser_);
     parser_.request_method = on_request_method;
     parser_.request_uri = on_request_uri;
@@ -140,7 +158,9 @@ uint64_t HttpRequestParser::getContentLength() const {
 
 size_t HttpRequestParser::execute(char* data, size_t len) {
     size_t offset = http_parser_execute(&parser_, data, len, 0);
-    memmove(data, data + offset, len - offset);
+    if (!zeroCopy_) {
+        memmove(data, data + offset, len - offset);
+    }
     return offset;
 }
 
@@ -8,9 +8,12 @@ namespace flexy::http {
 
 class HttpRequestParser {
 public:
-    HttpRequestParser(); 
+    // zero_copy 为 true 时, 请求的 path/query/fragment/头部直接引用被解析的内存,
+    // 不拷贝; 此时 execute 需要传入完整的头部, 且不会移动未解析的数据
+    HttpRequestParser(bool zero_copy = false);
 
     size_t execute(char* data, size_t len);
+    bool isZeroCopy() const { return zeroCopy_; }
     int isFinished();
     int hasError();
     void setError(int v) { error_ = v; }
@@ -24,6 +27,7 @@ public:
 private:
     http_parser parser_;
     HttpRequest::ptr data_;
+    bool zeroCopy_;
     int error_; /*
  * 1000 : invalid method
  * 1001 : invalid version
@@ -1,29 +1,100 @@
 #include "http_server.h"
 #include "http_session.h"
+#include "http_parser.h"
+#include <algorithm>
+#include "flexy/util/config.h"
 #include "flexy/util/log.h"
 
 namespace flexy::http {
 
 static auto g_logger = FLEXY_LOG_NAME("system");
 
+static auto g_http_pipeline_batch = Config::Lookup("http.server.pipeline_batch", 16u,
+    "max pipelined requests handled per read, responses are sent with one writev");
+
 void HttpServer::handleClient(const Socket::ptr& client) {
     // HttpSession::ptr session(new HttpSession(client));
     auto session = std::make_shared<HttpSession>(client);
+    std::vector<HttpRequest::ptr> reqs;
+    handleSession(session, reqs);
+    session->close();
+}
+
+void HttpServer::handleSession(const HttpSession::ptr& session,
+                               std::vector<HttpRequest::ptr>& reqs) {
+    size_t batch = std::max(g_http_pipeline_batch->getValue(), 1u);
+    bool close = false;
     do {
-        auto&& req = session->recvRequest();
-        if (!req) {
+        if (reqs.empty() && session->recvRequests(reqs, batch) == 0) {
              FLEXY_LOG_DEBUG(g_logger) << "recv http request fail, error = "
             << errno << " errstr = " << strerror(errno) << " client = "
-            << *client;
+            << *session->getSocket();
             break;
         }
-        auto rsp = std::make_unique<HttpResponse>(
-            req->getVersion(), req->isClose() || !isKeepalive_);
-        dispatch_->handle(req, rsp, session);
-        session->sendResponse(rsp);
-    } while (isKeepalive_);
+        // 按顺序处理, 响应合并发送; 流式响应在发送头部前先发送之前的响应
+        for (auto& req : reqs) {
+            auto rsp = std::make_unique<HttpResponse>(
+                req->getVersion(), req->isClose() || !isKeepalive_);
+            rsp->setSession(session.get());
+            rsp->setHeadOnly(req->getMehod() == HttpMethod::HEAD);
+            bool pending = req->getBodyStream() != nullptr;
+            // 只匹配一次路由, 准备消息体和处理请求使用同一个 servlet
+            auto slt = dispatch_->getMatchedServlet(req->getMehod(), req->getPath(),
+                                                    req.get());
+            if (prepareBody(req, rsp, slt) && slt) {
+                slt->handle(req, rsp, session);
+            }
+            auto& body = req->getBodyStream();
+            if (pending && body &&
+                !std::static_pointer_cast<HttpBodyStream>(body)->isFinished()) {
+                // 消息体没有读完, 无法定位下一个请求
+                rsp->setClose(true);
+            }
+            close = rsp->isClose();
+            if (rsp->isStreaming()) {
+                auto out = rsp->getBodyStream();
+                out->close();
+                close = close ||
+                        std::static_pointer_cast<HttpResponseStream>(out)->hasError();
+            } else {
+                session->queueResponse(std::move(rsp));
+            }
+            if (close) {
+                break;
+            }
+        }
+        session->flushResponses();
+        reqs.clear();
+    } while (isKeepalive_ && !close);
+}
 
-    session->close();
+bool HttpServer::prepareBody(const HttpRequest::ptr& req,
+                             const HttpResponse::ptr& rsp,
+                             const Servlet::ptr& slt) {
+    auto& body = req->getBodyStream();
+    if (!body && req->getBody().empty()) {
+        return true;
+    }
+    if (slt && slt->isStreamBody()) {
+        if (!body) {
+            req->setBodyStream(std::make_shared<HttpBodyStream>(req->getBody()));
+        }
+        return true;
+    }
+    if (!body) {
+        return true;
+    }
+    std::string data;
+    auto in = std::static_pointer_cast<HttpBodyStream>(body);
+    if (!in->readAll(data, HttpRequestParser::GetHttpRequestMaxBodySize())) {
+        rsp->setStatus(in->hasError() ? HttpStatus::BAD_REQUEST
+                                      : HttpStatus::PAYLOAD_TOO_LARGE);
+        rsp->setClose(true);
+        return false;
+    }
+    req->setBody(std::move(data));
+    req->setBodyStream(nullptr);
+    return true;
 }
 
 HttpServer::HttpServer(bool keepalive, IOManager* worker, IOManager* io_worker,
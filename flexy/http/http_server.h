@@ -1,6 +1,7 @@
 #pragma once
 
 #include "flexy/net/tcp_server.h"
+#include "http_session.h"
 #include "servlet.h"
 
 namespace flexy::http {
@@ -14,7 +15,15 @@ public:
     bool isKeepalive() const { return isKeepalive_; }
 protected:
     void handleClient(const Socket::ptr& client) override;
-private:
+    // 处理 HTTP/1.1 连接上的请求直到连接关闭, reqs 为已经读取但未处理的请求
+    void handleSession(const HttpSession::ptr& session,
+                       std::vector<HttpRequest::ptr>& reqs);
+    // 按匹配到的 servlet 准备请求消息体: 流式 servlet 总是通过 getBodyStream() 读取,
+    // 其他 servlet 预先读取完整的消息体, 超过 http.request.max_bopdy_size 时
+    // 设置 413 响应, 格式错误时设置 400 响应, 并返回 false
+    bool prepareBody(const HttpRequest::ptr& req, const HttpResponse::ptr& rsp,
+                     const Servlet::ptr& slt);
+protected:
     bool isKeepalive_;
     ServletDispatch::ptr dispatch_;
 };
@@ -1,14 +1,219 @@
 #include "http_session.h"
+#include <algorithm>
+#include <charconv>
 #include "http_parser.h"
+#include "flexy/util/config.h"
 
 namespace flexy::http {
 
+static auto g_http_request_zero_copy = Config::Lookup("http.request.zero_copy", 1,
+    "parse http request in the session read buffer without copying, 0: off, 1: on");
+
+// 返回头部结束后的位置(空行之后), 头部不完整时返回 0
+// from 为上次查找过的位置, 避免重复扫描
+static size_t FindHeaderEnd(const char* data, size_t len, size_t from) {
+    for (size_t i = from; i < len; ++i) {
+        if (data[i] != '\n') {
+            continue;
+        }
+        // 解析器同时接受 \r\n 和 \n 作为换行
+        if (i + 1 < len && data[i + 1] == '\n') {
+            return i + 2;
+        }
+        if (i + 2 < len && data[i + 1] == '\r' && data[i + 2] == '\n') {
+            return i + 3;
+        }
+    }
+    return 0;
+}
+
+// Transfer-Encoding 的最后一个编码是否为 chunked
+static bool IsChunked(std::string_view te) {
+    auto pos = te.rfind(',');
+    if (pos != std::string_view::npos) {
+        te.remove_prefix(pos + 1);
+    }
+    while (!te.empty() && (te.front() == ' ' || te.front() == '\t')) {
+        te.remove_prefix(1);
+    }
+    while (!te.empty() && (te.back() == ' ' || te.back() == '\t')) {
+        te.remove_suffix(1);
+    }
+    return te.size() == 7 && strncasecmp(te.data(), "chunked", 7) == 0;
+}
+
 HttpSession::HttpSession(const Socket::ptr& sock, bool owner) 
 : SockStream(sock, owner) {
     
 }
 
 HttpRequest::ptr HttpSession::recvRequest() {
+    if (g_http_request_zero_copy->getValue()) {
+        return recvRequestInPlace();
+    }
+    return recvRequestCopy();
+}
+
+size_t HttpSession::recvRequests(std::vector<HttpRequest::ptr>& reqs,
+                                 size_t max_count) {
+    reqs.clear();
+    if (!g_http_request_zero_copy->getValue()) {
+        if (auto req = recvRequestCopy()) {
+            reqs.push_back(std::move(req));
+        }
+        return reqs.size();
+    }
+    compactBuffer();
+    auto req = parseRequest(true);
+    while (req) {
+        // 未读取的消息体之后才是下一个请求
+        bool streaming = req->getBodyStream() != nullptr;
+        reqs.push_back(std::move(req));
+        if (streaming || reqs.size() >= max_count) {
+            break;
+        }
+        req = parseRequest(false);
+    }
+    return reqs.size();
+}
+
+HttpRequest::ptr HttpSession::recvRequestInPlace() {
+    compactBuffer();
+    return parseRequest(true);
+}
+
+void HttpSession::compactBuffer() {
+    if (consumed_ > 0) {
+        // 丢弃已经处理过的请求, 保留已经读入的后续数据
+        bufferLen_ -= consumed_;
+        memmove(buffer_.get(), buffer_.get() + consumed_, bufferLen_);
+        consumed_ = 0;
+    }
+    uint64_t buff_size = HttpRequestParser::GetHttpRequestBufferSize();
+    if (!buffer_ || (bufferSize_ != buff_size && bufferLen_ <= buff_size)) {
+        std::unique_ptr<char[]> buffer(new char[buff_size]);
+        if (bufferLen_) {
+            memcpy(buffer.get(), buffer_.get(), bufferLen_);
+        }
+        buffer_ = std::move(buffer);
+        bufferSize_ = buff_size;
+    }
+}
+
+HttpRequest::ptr HttpSession::parseRequest(bool may_read) {
+    char* data = buffer_.get() + consumed_;
+    size_t space = bufferSize_ - consumed_;
+    size_t avail = bufferLen_ - consumed_;
+    size_t header_end = FindHeaderEnd(data, avail, 0);
+    while (header_end == 0) {
+        if (!may_read) {
+            return nullptr;
+        }
+        if (avail == space) {                   // 头部过长
+            close();
+            return nullptr;
+        }
+        int len = read(data + avail, space - avail);
+        if (len <= 0) {
+            close();
+            return nullptr;
+        }
+        // 空行可能跨越两次读取
+        size_t from = avail > 2 ? avail - 2 : 0;
+        avail += len;
+        bufferLen_ += len;
+        header_end = FindHeaderEnd(data, avail, from);
+    }
+
+    HttpRequestParser parser(true);
+    parser.execute(data, header_end);
+    if (parser.hasError() || !parser.isFinished()) {
+        // 不读取时留给下一次调用处理, 先发送前面请求的响应
+        if (may_read) {
+            close();
+        }
+        return nullptr;
+    }
+
+    auto& req = parser.getData();
+    uint64_t length = parser.getContentLength();
+    std::string_view te;
+    bool chunked = req->findHeader("transfer-encoding", te) && IsChunked(te);
+    if (chunked || header_end + length > space) {
+        // 消息体不放入缓冲区, 由 HttpBodyStream 增量读取; 读取时缓冲区会被整理,
+        // 请求不能再引用缓冲区
+        if (!may_read) {
+            return nullptr;
+        }
+        consumed_ += header_end;
+        req->init();
+        req->detach();
+        if (chunked) {
+            req->setBodyStream(std::make_shared<HttpBodyStream>(this));
+        } else {
+            req->setBodyStream(std::make_shared<HttpBodyStream>(this, length));
+        }
+        return std::move(req);
+    }
+    if (length > 0) {
+        // 消息体也放在缓冲区中
+        if (avail < header_end + length) {
+            if (!may_read) {
+                return nullptr;
+            }
+            if (readFixSize(data + avail, header_end + length - avail) <= 0) {
+                close();
+                return nullptr;
+            }
+            bufferLen_ = consumed_ + header_end + length;
+        }
+        req->setBodyRef(std::string_view(data + header_end, length));
+    }
+    consumed_ += header_end + length;
+    req->init();
+    return std::move(req);
+}
+
+ssize_t HttpSession::readBody(void* buffer, size_t length) {
+    size_t avail = bufferLen_ - consumed_;
+    if (avail > 0) {
+        size_t len = std::min(avail, length);
+        memcpy(buffer, buffer_.get() + consumed_, len);
+        consumed_ += len;
+        return len;
+    }
+    return read(buffer, length);
+}
+
+bool HttpSession::readLine(std::string_view& line) {
+    size_t from = consumed_;
+    while (true) {
+        char* data = buffer_.get();
+        auto end = (char*)memchr(data + from, '\n', bufferLen_ - from);
+        if (end) {
+            size_t len = end - (data + consumed_);
+            if (len > 0 && data[consumed_ + len - 1] == '\r') {
+                --len;
+            }
+            line = std::string_view(data + consumed_, len);
+            consumed_ = end - data + 1;
+            return true;
+        }
+        size_t scanned = bufferLen_ - consumed_;
+        compactBuffer();
+        if (bufferLen_ == bufferSize_) {
+            return false;
+        }
+        int len = read(buffer_.get() + bufferLen_, bufferSize_ - bufferLen_);
+        if (len <= 0) {
+            return false;
+        }
+        bufferLen_ += len;
+        from = scanned;
+    }
+}
+
+HttpRequest::ptr HttpSession::recvRequestCopy() {
     HttpRequestParser parser;
     uint64_t buff_size = HttpRequestParser::GetHttpRequestBufferSize();
     std::unique_ptr<char[]> buffer(new char[buff_size]);
@@ -45,8 +250,8 @@ body:
         body.resize(length);
         int len = std::min(length, (int64_t)offset);
         memcpy(body.data(), data, len);
-        if (length > 0) {
-            if (readFixSize(&body[len], length) <= 0) {
+        if (length > len) {
+            if (readFixSize(&body[len], length - len) <= 0) {
                 goto error;
             }
         }
@@ -56,11 +261,293 @@ body:
     return std::move(parser.getData());
 }
 
-int HttpSession::sendResponse(const HttpResponse::ptr& rsp) {
-    std::stringstream ss;
-    ss << *rsp;
-    std::string data = ss.str();
-    return writeFixSize(data.c_str(), data.size());
+ssize_t HttpSession::sendResponses(const std::vector<HttpResponse::ptr>& rsps) {
+    std::vector<HttpResponse*> ptrs(rsps.size());
+    std::transform(rsps.begin(), rsps.end(), ptrs.begin(),
+                   [](auto& rsp) { return rsp.get(); });
+    return sendResponses(ptrs.data(), ptrs.size());
+}
+
+ssize_t HttpSession::sendResponses(HttpResponse* const* rsps, size_t count) {
+    // 先序列化全部头部, 写缓冲区扩容后才能确定 iovec 的地址
+    writeBuffer_.clear();
+    headerEnds_.clear();
+    for (size_t i = 0; i < count; ++i) {
+        rsps[i]->serializeHeader(writeBuffer_);
+        headerEnds_.push_back(writeBuffer_.size());
+    }
+    iovecs_.clear();
+    size_t begin = 0;
+    ssize_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        iovecs_.push_back({writeBuffer_.data() + begin, headerEnds_[i] - begin});
+        begin = headerEnds_[i];
+        if (rsps[i]->isHeadOnly()) {
+            continue;
+        }
+        if (auto file = rsps[i]->getBodyFile()) {
+            // 文件之前的数据先发出, MSG_MORE 使头部和文件开头合并为一个报文
+            ssize_t rt = writevFixSize(iovecs_.data(), iovecs_.size(), MSG_MORE);
+            if (rt <= 0) {
+                return rt;
+            }
+            total += rt;
+            iovecs_.clear();
+            if (file->length > 0) {
+                rt = sendFileFixSize(file->fd, file->offset, file->length);
+                if (rt <= 0) {
+                    return rt ? rt : -1;
+                }
+                total += rt;
+            }
+            continue;
+        }
+        auto body = rsps[i]->getBody();
+        if (!body.empty()) {
+            iovecs_.push_back({(void*)body.data(), body.size()});
+        }
+    }
+    if (!iovecs_.empty()) {
+        ssize_t rt = writevFixSize(iovecs_.data(), iovecs_.size());
+        if (rt <= 0) {
+            return rt;
+        }
+        total += rt;
+    }
+    return total;
+}
+
+ssize_t HttpSession::flushResponses() {
+    if (pending_.empty()) {
+        return 0;
+    }
+    ssize_t rt = sendResponses(pending_);
+    pending_.clear();
+    return rt;
+}
+
+ssize_t HttpSession::sendResponse(const HttpResponse::ptr& rsp) {
+    if (rsp->getBodyFile()) {
+        HttpResponse* ptr = rsp.get();
+        return sendResponses(&ptr, 1);
+    }
+    writeBuffer_.clear();
+    rsp->serializeHeader(writeBuffer_);
+    auto body = rsp->isHeadOnly() ? std::string_view() : rsp->getBody();
+    iovec iov[2] = {{writeBuffer_.data(), writeBuffer_.size()},
+                    {(void*)body.data(), body.size()}};
+    return writevFixSize(iov, body.empty() ? 1 : 2);
+}
+
+HttpBodyStream::HttpBodyStream(HttpSession* session, uint64_t content_length)
+    : session_(session), remaining_(content_length) {
+    if (remaining_ == 0) {
+        state_ = State::DONE;
+    }
+}
+
+HttpBodyStream::HttpBodyStream(HttpSession* session)
+    : session_(session), chunked_(true) {}
+
+HttpBodyStream::HttpBodyStream(std::string_view body)
+    : data_(body), remaining_(body.size()) {
+    if (remaining_ == 0) {
+        state_ = State::DONE;
+    }
+}
+
+bool HttpBodyStream::nextChunk() {
+    std::string_view line;
+    if (chunkStarted_ && (!session_->readLine(line) || !line.empty())) {
+        return false;
+    }
+    chunkStarted_ = true;
+    if (!session_->readLine(line)) {
+        return false;
+    }
+    // 忽略块扩展
+    line = line.substr(0, line.find(';'));
+    while (!line.empty() && (line.back() == ' ' || line.back() == '\t')) {
+        line.remove_suffix(1);
+    }
+    uint64_t size = 0;
+    auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), size, 16);
+    if (line.empty() || ec != std::errc() || ptr != line.data() + line.size()) {
+        return false;
+    }
+    if (size == 0) {
+        // trailer 以空行结束
+        do {
+            if (!session_->readLine(line)) {
+                return false;
+            }
+        } while (!line.empty());
+        state_ = State::DONE;
+        return true;
+    }
+    remaining_ = size;
+    return true;
+}
+
+ssize_t HttpBodyStream::read(void* buffer, size_t length) {
+    if (closed_ || state_ == State::DONE) {
+        return 0;
+    }
+    if (state_ == State::ERROR) {
+        return -1;
+    }
+    if (remaining_ == 0) {  // 只有 chunked 编码会在这里读取下一块
+        if (!nextChunk()) {
+            state_ = State::ERROR;
+            return -1;
+        }
+        if (state_ == State::DONE) {
+            return 0;
+        }
+    }
+    size_t len = std::min<uint64_t>(length, remaining_);
+    ssize_t rt = len;
+    if (session_) {
+        rt = session_->readBody(buffer, len);
+    } else {
+        memcpy(buffer, data_.data(), len);
+        data_.remove_prefix(len);
+    }
+    if (rt <= 0) {
+        state_ = State::ERROR;
+        return -1;
+    }
+    remaining_ -= rt;
+    if (remaining_ == 0 && !chunked_) {
+        state_ = State::DONE;
+    }
+    return rt;
+}
+
+ssize_t HttpBodyStream::read(const ByteArray::ptr& ba, size_t length) {
+    std::vector<iovec> iovs;
+    ba->getWriteBuffers(iovs, length);
+    if (iovs.empty()) {
+        return 0;
+    }
+    ssize_t rt = read(iovs[0].iov_base, iovs[0].iov_len);
+    if (rt > 0) {
+        ba->setPosition(ba->getPosition() + rt);
+    }
+    return rt;
+}
+
+bool HttpBodyStream::readAll(std::string& out, uint64_t max_size) {
+    while (state_ == State::DATA && !closed_) {
+        if (chunked_ && remaining_ == 0) {
+            if (!nextChunk()) {
+                state_ = State::ERROR;
+                return false;
+            }
+            continue;
+        }
+        if (remaining_ > max_size - std::min<uint64_t>(out.size(), max_size)) {
+            return false;
+        }
+        size_t offset = out.size();
+        out.resize(offset + remaining_);
+        if (readFixSize(&out[offset], remaining_) <= 0) {
+            return false;
+        }
+    }
+    return isFinished();
+}
+
+HttpResponseStream::HttpResponseStream(HttpSession* session, HttpResponse* rsp)
+    : session_(session), rsp_(rsp), chunked_(rsp->getVersion() >= 0x11) {
+    if (!chunked_) {
+        rsp_->setClose(true);
+    }
+}
+
+bool HttpResponseStream::writeChunk(iovec* iov, size_t iovcnt, size_t length,
+                                    bool last) {
+    if (error_ || finished_) {
+        return false;
+    }
+    iov[0] = {nullptr, 0};
+    if (!headerSent_) {
+        // 先发送之前缓存的响应, 保持 pipelining 的响应顺序
+        if (!session_->pending_.empty() && session_->flushResponses() <= 0) {
+            error_ = true;
+            return false;
+        }
+        auto& header = session_->writeBuffer_;
+        header.clear();
+        rsp_->serializeHeader(header);
+        iov[0] = {header.data(), header.size()};
+        headerSent_ = true;
+    }
+    char size_line[24];
+    iov[1] = {size_line, 0};
+    iov[iovcnt - 1] = {nullptr, 0};
+    if (chunked_) {
+        if (length > 0) {
+            auto end = std::to_chars(size_line, size_line + sizeof(size_line) - 2,
+                                     length, 16).ptr;
+            *end++ = '\r';
+            *end++ = '\n';
+            iov[1].iov_len = end - size_line;
+        }
+        static constexpr std::string_view kLastChunk = "\r\n0\r\n\r\n";
+        // 块数据后的 CRLF, 最后一块前没有数据时不需要
+        auto tail = last ? kLastChunk : kLastChunk.substr(0, 2);
+        if (length == 0) {
+            tail.remove_prefix(2);
+        }
+        iov[iovcnt - 1] = {(void*)tail.data(), tail.size()};
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < iovcnt; ++i) {
+        total += iov[i].iov_len;
+    }
+    if (total > 0 && session_->writevFixSize(iov, iovcnt) <= 0) {
+        error_ = true;
+        return false;
+    }
+    return true;
+}
+
+ssize_t HttpResponseStream::write(const void* buffer, size_t length) {
+    if (length == 0) {
+        return 0;
+    }
+    iovec iov[4];
+    iov[2] = {(void*)buffer, length};
+    return writeChunk(iov, 4, length) ? length : -1;
+}
+
+ssize_t HttpResponseStream::write(const ByteArray::ptr& ba, size_t length) {
+    std::vector<iovec> iov(2);
+    length = ba->getReadBuffers(iov, length);
+    if (length == 0) {
+        return 0;
+    }
+    iov.emplace_back();
+    if (!writeChunk(iov.data(), iov.size(), length)) {
+        return -1;
+    }
+    ba->setPosition(ba->getPosition() + length);
+    return length;
+}
+
+bool HttpResponseStream::flush() {
+    iovec iov[3];
+    return writeChunk(iov, 3, 0);
+}
+
+void HttpResponseStream::close() {
+    if (finished_) {
+        return;
+    }
+    iovec iov[3];
+    writeChunk(iov, 3, 0, true);
+    finished_ = true;
 }
 
-} // namespace flexy http
\ No newline at end of file
+} // namespace flexy http
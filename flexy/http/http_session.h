@@ -6,11 +6,131 @@
 namespace flexy::http {
 
 class HttpSession : public SockStream {
+    friend class HttpBodyStream;
+    friend class HttpResponseStream;
 public:
     using ptr = std::shared_ptr<HttpSession>;
     HttpSession(const Socket::ptr& sock, bool owner = true);
+    // 零拷贝模式(http.request.zero_copy)下, 返回的请求引用会话的读缓冲区,
+    // 在下一次调用 recvRequest 之前有效
+    // 消息体为 chunked 编码或超出读缓冲区时不读取, 请求转存为自身持有(detach),
+    // 消息体通过 HttpRequest::getBodyStream() 读取, 读完之前不能读取下一个请求
     HttpRequest::ptr recvRequest();
-    int sendResponse(const HttpResponse::ptr& rsp); 
+    // 读取至少一个请求, 再解析缓冲区中已经完整的后续请求(HTTP/1.1 pipelining), 不再读取 socket
+    // 最多解析 max_count 个, 返回请求数量, 0 表示连接出错或关闭
+    // 请求引用会话的读缓冲区, 在下一次调用 recvRequest(s) 之前有效
+    size_t recvRequests(std::vector<HttpRequest::ptr>& reqs, size_t max_count);
+    // 头部序列化到会话的写缓冲区, 与消息体一起通过一次 writev 发送, 消息体不拷贝
+    ssize_t sendResponse(const HttpResponse::ptr& rsp);
+    // 按顺序发送多个响应, 合并为一次 writev; 文件消息体(setBodyFile)之前的数据
+    // 以 MSG_MORE 发出, 文件内容通过 sendfile 发送
+    ssize_t sendResponses(const std::vector<HttpResponse::ptr>& rsps);
+    // 缓存响应, 与之后的响应合并发送
+    void queueResponse(HttpResponse::ptr&& rsp) { pending_.push_back(std::move(rsp)); }
+    // 发送缓存的响应, 没有缓存的响应返回 0
+    ssize_t flushResponses();
+private:
+    // 读取消息体, 先取读缓冲区中已读入的数据, 缓冲区为空时直接读 socket
+    ssize_t readBody(void* buffer, size_t length);
+    // 读取一行, 不含换行符, 引用读缓冲区, 在下一次读取前有效
+    // 行超出读缓冲区或连接关闭返回 false
+    bool readLine(std::string_view& line);
+    // 每个请求分配缓冲区, 解析时拷贝
+    HttpRequest::ptr recvRequestCopy();
+    // 在会话的读缓冲区中原地解析
+    HttpRequest::ptr recvRequestInPlace();
+    // 丢弃已经处理过的请求
+    void compactBuffer();
+    // 从缓冲区中 consumed_ 处解析一个请求, may_read 为 false 时数据不完整直接返回 nullptr
+    HttpRequest::ptr parseRequest(bool may_read);
+    ssize_t sendResponses(HttpResponse* const* rsps, size_t count);
+private:
+    std::unique_ptr<char[]> buffer_;    // 读缓冲区
+    size_t bufferSize_ = 0;             // 缓冲区大小
+    size_t bufferLen_ = 0;              // 缓冲区中已读入的数据长度
+    size_t consumed_ = 0;               // 上一个请求占用的长度, 下次读取前丢弃
+    std::string writeBuffer_;           // 响应头部写缓冲区, 每个连接复用
+    std::vector<size_t> headerEnds_;    // 合并发送时每个响应头部在写缓冲区中的结束位置
+    std::vector<iovec> iovecs_;         // 合并发送时的 iovec
+    std::vector<HttpResponse::ptr> pending_;    // 等待合并发送的响应
+};
+
+// 请求消息体的输入流, 按 Content-Length 或 chunked 编码从会话中增量读取,
+// 只在处理请求期间有效; read 返回 0 表示消息体结束
+class HttpBodyStream : public Stream {
+public:
+    using ptr = std::shared_ptr<HttpBodyStream>;
+    // 长度为 content_length 的消息体
+    HttpBodyStream(HttpSession* session, uint64_t content_length);
+    // chunked 编码的消息体
+    explicit HttpBodyStream(HttpSession* session);
+    // 已经完整读入的消息体, 不拷贝
+    explicit HttpBodyStream(std::string_view body);
+
+    ssize_t read(void* buffer, size_t length) override;
+    ssize_t read(const ByteArray::ptr& ba, size_t length) override;
+    ssize_t write(const void* buffer, size_t length) override { return -1; }
+    ssize_t write(const ByteArray::ptr& ba, size_t length) override { return -1; }
+    // 放弃读取剩余的消息体, 之后 read 返回 0, 会话随后关闭连接
+    void close() override { closed_ = true; }
+
+    // 读取剩余的全部消息体追加到 out, 超过 max_size 或出错返回 false
+    bool readAll(std::string& out, uint64_t max_size);
+    bool isChunked() const { return chunked_; }
+    // 消息体已经读完, 会话可以读取下一个请求
+    bool isFinished() const { return state_ == State::DONE; }
+    // 消息体格式错误或连接已关闭
+    bool hasError() const { return state_ == State::ERROR; }
+
+private:
+    enum class State { DATA, DONE, ERROR };
+    // 读取下一块的大小行, 最后一块之后读取并丢弃 trailer
+    bool nextChunk();
+
+private:
+    HttpSession* session_ = nullptr;
+    std::string_view data_;     // 已经读入的消息体
+    uint64_t remaining_ = 0;    // 当前块(或整个消息体)未读取的长度
+    bool chunked_ = false;
+    bool chunkStarted_ = false; // 已经读取过块, 下一块之前有上一块数据的 CRLF
+    bool closed_ = false;
+    State state_ = State::DATA;
+};
+
+// 响应消息体的输出流, 第一次写入时先发送会话中缓存的响应, 再发送状态行和头部
+// 写入直接发送到 socket, 对端接收慢时挂起当前协程, 不在内存中堆积
+// HTTP/1.1 每次写入作为一块, HTTP/1.0 直接写出并在结束后关闭连接
+class HttpResponseStream : public Stream {
+public:
+    using ptr = std::shared_ptr<HttpResponseStream>;
+    HttpResponseStream(HttpSession* session, HttpResponse* rsp);
+
+    ssize_t read(void* buffer, size_t length) override { return -1; }
+    ssize_t read(const ByteArray::ptr& ba, size_t length) override { return -1; }
+    // 全部写入返回 length, 出错返回 -1
+    ssize_t write(const void* buffer, size_t length) override;
+    ssize_t write(const ByteArray::ptr& ba, size_t length) override;
+    // 发送状态行和头部
+    bool flush();
+    // 结束消息体, 发送最后一块, 由 HttpServer 在处理结束后调用
+    void close() override;
+
+    bool isFinished() const { return finished_; }
+    bool hasError() const { return error_; }
+
+private:
+    // 发送一块, 长度为 length 的数据在 iov[2, iovcnt - 1) 中,
+    // iov[0] 预留给未发送的头部, iov[1] 和 iov[iovcnt - 1] 预留给块大小行和 CRLF
+    // last 为 true 时在末尾追加最后一块(0 长度块)
+    bool writeChunk(iovec* iov, size_t iovcnt, size_t length, bool last = false);
+
+private:
+    HttpSession* session_;
+    HttpResponse* rsp_;
+    bool chunked_;
+    bool headerSent_ = false;
+    bool finished_ = false;
+    bool error_ = false;
 };
 
 }  // namespace flexy::http
@@ -0,0 +1,215 @@
+#include "router.h"
+#include "servlet.h"
+#include "flexy/util/log.h"
+
+namespace flexy::http {
+
+static auto g_logger = FLEXY_LOG_NAME("system");
+
+struct Router::Handlers {
+    ServletPtr any;                                      // 不区分方法
+    std::vector<std::pair<HttpMethod, ServletPtr>> methods;  // 指定方法
+
+    bool empty() const { return !any && methods.empty(); }
+
+    const ServletPtr* get(HttpMethod method) const {
+        for (auto& [m, slt] : methods) {
+            if (m == method) {
+                return &slt;
+            }
+        }
+        return any ? &any : nullptr;
+    }
+
+    ServletPtr& slot(const HttpMethod* method) {
+        if (!method) {
+            return any;
+        }
+        for (auto& [m, slt] : methods) {
+            if (m == *method) {
+                return slt;
+            }
+        }
+        return methods.emplace_back(*method, nullptr).second;
+    }
+};
+
+// 静态节点匹配 prefix; 参数节点(param 不为空)匹配一段, prefix 为空
+struct Router::Node {
+    std::string prefix;
+    std::string param;              // 参数节点的参数名
+    std::string indices;            // 静态子节点 prefix 的首字符, 与 children 一一对应
+    std::vector<std::unique_ptr<Node>> children;
+    std::unique_ptr<Node> paramChild;
+    std::string wildcardName;       // 通配的参数名
+    Handlers wildcard;              // 在此处匹配剩余部分的路由
+    Handlers handlers;              // 在此处结束的路由
+};
+
+Router::Router() : root_(std::make_unique<Node>()) {}
+
+Router::~Router() = default;
+
+bool Router::add(std::string_view pattern, const ServletPtr& slt) {
+    auto handlers = insert(pattern);
+    if (!handlers) {
+        return false;
+    }
+    auto& dst = handlers->slot(nullptr);
+    size_ += dst == nullptr;
+    dst = slt;
+    return true;
+}
+
+bool Router::add(HttpMethod method, std::string_view pattern,
+                 const ServletPtr& slt) {
+    auto handlers = insert(pattern);
+    if (!handlers) {
+        return false;
+    }
+    auto& dst = handlers->slot(&method);
+    size_ += dst == nullptr;
+    dst = slt;
+    return true;
+}
+
+bool Router::addPrefix(std::string_view prefix, const ServletPtr& slt) {
+    Node* node = InsertStatic(root_.get(), prefix);
+    if (node->wildcard.empty()) {
+        node->wildcardName = "*";
+    }
+    auto& dst = node->wildcard.slot(nullptr);
+    size_ += dst == nullptr;
+    dst = slt;
+    return true;
+}
+
+Router::Handlers* Router::insert(std::string_view pattern) {
+    Node* node = root_.get();
+    size_t i = 0;
+    while (i < pattern.size()) {
+        bool seg_start = i == 0 || pattern[i - 1] == '/';
+        if (pattern[i] == ':' && seg_start) {
+            size_t end = pattern.find('/', i);
+            end = end == std::string_view::npos ? pattern.size() : end;
+            auto name = pattern.substr(i + 1, end - i - 1);
+            if (!node->paramChild) {
+                node->paramChild = std::make_unique<Node>();
+                node->paramChild->param = name;
+            } else if (node->paramChild->param != name) {
+                FLEXY_LOG_ERROR(g_logger)
+                    << "route " << pattern << " param :" << name
+                    << " conflicts with :" << node->paramChild->param;
+                return nullptr;
+            }
+            node = node->paramChild.get();
+            i = end;
+            continue;
+        }
+        if (pattern[i] == '*' &&
+            pattern.find('/', i) == std::string_view::npos) {
+            // 同一位置的通配路由共用参数名, 以最后加入的为准
+            node->wildcardName = i + 1 == pattern.size() ? "*" : pattern.substr(i + 1);
+            return &node->wildcard;
+        }
+        // 静态部分延伸到下一个段首的 ':' 或结尾的 '*'
+        size_t end = i;
+        while (end < pattern.size()) {
+            if ((pattern[end] == ':' && pattern[end - 1] == '/') ||
+                (pattern[end] == '*' &&
+                 pattern.find('/', end) == std::string_view::npos)) {
+                break;
+            }
+            ++end;
+        }
+        node = InsertStatic(node, pattern.substr(i, end - i));
+        i = end;
+    }
+    return &node->handlers;
+}
+
+Router::Node* Router::InsertStatic(Node* node, std::string_view text) {
+    while (!text.empty()) {
+        auto pos = node->indices.find(text[0]);
+        if (pos == std::string::npos) {
+            auto child = std::make_unique<Node>();
+            child->prefix = text;
+            node->indices.push_back(text[0]);
+            node->children.push_back(std::move(child));
+            return node->children.back().get();
+        }
+        Node* child = node->children[pos].get();
+        size_t common = 0;
+        size_t max = std::min(child->prefix.size(), text.size());
+        while (common < max && child->prefix[common] == text[common]) {
+            ++common;
+        }
+        if (common < child->prefix.size()) {
+            // 分裂: child 变为 prefix[0, common) 的新节点的子节点
+            auto split = std::make_unique<Node>();
+            split->prefix = child->prefix.substr(0, common);
+            child->prefix.erase(0, common);
+            split->indices.push_back(child->prefix[0]);
+            split->children.push_back(std::move(node->children[pos]));
+            node->children[pos] = std::move(split);
+            child = node->children[pos].get();
+        }
+        node = child;
+        text.remove_prefix(common);
+    }
+    return node;
+}
+
+const Router::ServletPtr* Router::find(HttpMethod method, std::string_view path,
+                                       Params* params) const {
+    size_t count = params ? params->size() : 0;
+    auto slt = Match(root_.get(), path, method, params);
+    if (!slt && params) {
+        params->resize(count);
+    }
+    return slt;
+}
+
+// path 为 node 之后剩余的部分
+const Router::ServletPtr* Router::Match(const Node* node, std::string_view path,
+                                        HttpMethod method, Params* params) {
+    if (path.empty()) {
+        if (auto slt = node->handlers.get(method)) {
+            return slt;
+        }
+    } else {
+        auto pos = node->indices.find(path[0]);
+        if (pos != std::string::npos) {
+            const Node* child = node->children[pos].get();
+            if (path.substr(0, child->prefix.size()) == child->prefix) {
+                if (auto slt = Match(child, path.substr(child->prefix.size()),
+                                     method, params)) {
+                    return slt;
+                }
+            }
+        }
+        if (const Node* child = node->paramChild.get()) {
+            size_t end = std::min(path.find('/'), path.size());
+            if (end > 0) {
+                if (params) {
+                    params->emplace_back(child->param, path.substr(0, end));
+                }
+                if (auto slt = Match(child, path.substr(end), method, params)) {
+                    return slt;
+                }
+                if (params) {
+                    params->pop_back();
+                }
+            }
+        }
+    }
+    if (auto slt = node->wildcard.get(method)) {
+        if (params) {
+            params->emplace_back(node->wildcardName, path);
+        }
+        return slt;
+    }
+    return nullptr;
+}
+
+}  // namespace flexy::http
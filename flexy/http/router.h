@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "http.h"
+
+namespace flexy::http {
+
+class Servlet;
+
+// 压缩前缀树(radix tree)路由表, 构建完成后只读, 可以被多个线程同时查找
+// 路由语法:
+//   /user/list          静态路径
+//   /user/:id/profile   ":name" 匹配一段非空路径(不含 '/'), 必须位于段首
+//   /static/*path       结尾的 "*" 或 "*name" 匹配剩余部分(可以为空), 名字缺省为 "*"
+// 匹配优先级: 静态 > 参数 > 通配, 失败时回溯; 同一路由中指定方法的优先于不区分方法的
+class Router {
+public:
+    using ptr = std::shared_ptr<const Router>;
+    using ServletPtr = std::shared_ptr<Servlet>;
+    // 匹配到的参数, 名字引用路由表, 值引用被匹配的路径
+    using Params = std::vector<std::pair<std::string_view, std::string_view>>;
+
+    Router();
+    ~Router();
+    Router(const Router&) = delete;
+    Router& operator=(const Router&) = delete;
+
+    // 添加不区分方法的路由, 相同的路由覆盖, 参数名冲突时返回 false
+    bool add(std::string_view pattern, const ServletPtr& slt);
+    // 添加只匹配 method 的路由
+    bool add(HttpMethod method, std::string_view pattern, const ServletPtr& slt);
+    // 添加以 prefix 开头的全部路径的路由, prefix 中的 ':' 和 '*' 不作为语法,
+    // 剩余部分的参数名为 "*"
+    bool addPrefix(std::string_view prefix, const ServletPtr& slt);
+    // 查找 path, 不存在返回 nullptr; params 不为空时追加匹配到的参数
+    const ServletPtr* find(HttpMethod method, std::string_view path,
+                           Params* params = nullptr) const;
+    // 路由数量
+    size_t size() const { return size_; }
+
+private:
+    struct Node;
+    struct Handlers;
+    // 插入 pattern, 返回路由的处理函数集合, 参数名冲突返回 nullptr
+    Handlers* insert(std::string_view pattern);
+    // 静态部分插入 node 的子树, 按公共前缀分裂节点, 返回 text 结束处的节点
+    static Node* InsertStatic(Node* node, std::string_view text);
+    static const ServletPtr* Match(const Node* node, std::string_view path,
+                                   HttpMethod method, Params* params);
+
+private:
+    std::unique_ptr<Node> root_;
+    size_t size_ = 0;
+};
+
+}  // namespace flexy::http
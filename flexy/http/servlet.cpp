@@ -1,5 +1,6 @@
 #include "servlet.h"
 #include <fnmatch.h>
+#include <utility>
 
 namespace flexy::http {
 
@@ -19,30 +20,66 @@ int32_t FuncionServlet::handle(const HttpRequest::ptr& request,
 
 ServletDispatch::ServletDispatch()
     : Servlet("ServletDispatch"),
-      default_(std::make_shared<NotFoundServlet>()) {}
+      default_(std::make_shared<NotFoundServlet>()) {
+    WRITELOCK(mutex_);
+    rebuild();
+}
 
 int32_t ServletDispatch::handle(const HttpRequest::ptr& request,
                                 const HttpResponse::ptr& response,
                                 const SockStream::ptr& session) {
-    auto&& slt = getMatchedServlet(request->getPath());
+    auto&& slt = getMatchedServlet(request->getMehod(), request->getPath(),
+                                   request.get());
     if (slt) {
         slt->handle(request, response, session);
     }
     return 0;
 }
 
-void ServletDispatch::addServlet(const std::string& uri, const Servlet::ptr& slt) {
+// 把 slt 放入 routes[key] 并重建快照, 失败时恢复原来的路由
+template <typename Map, typename Key, typename Rebuild>
+static bool Replace(Map& routes, const Key& key, const Servlet::ptr& slt,
+                    Rebuild&& rebuild) {
+    auto [it, inserted] = routes.try_emplace(key, slt);
+    Servlet::ptr old;
+    if (!inserted) {
+        old = std::exchange(it->second, slt);
+    }
+    if (rebuild()) {
+        return true;
+    }
+    if (inserted) {
+        routes.erase(it);
+    } else {
+        it->second = std::move(old);
+    }
+    return false;
+}
+
+bool ServletDispatch::addServlet(const std::string& uri, const Servlet::ptr& slt) {
     WRITELOCK(mutex_);
-    datas_[uri] = slt;
+    return Replace(datas_, uri, slt, [this]() { return rebuild(); });
+}
+
+bool ServletDispatch::addServlet(const std::string& uri, FuncionServlet::callback&& cb) {
+    return addServlet(uri, std::make_shared<FuncionServlet>(std::move(cb)));
 }
 
-void ServletDispatch::addServlet(const std::string& uri, FuncionServlet::callback&& cb) {
+bool ServletDispatch::addServlet(HttpMethod method, const std::string& uri,
+                                 const Servlet::ptr& slt) {
     WRITELOCK(mutex_);
-    datas_[uri] = std::make_shared<FuncionServlet>(cb);
+    return Replace(methods_, std::make_pair(method, uri), slt,
+                   [this]() { return rebuild(); });
+}
+
+bool ServletDispatch::addServlet(HttpMethod method, const std::string& uri,
+                                 FuncionServlet::callback&& cb) {
+    return addServlet(method, uri, std::make_shared<FuncionServlet>(std::move(cb)));
 }
 
-void ServletDispatch::addGlobServlet(const std::string& uri, const Servlet::ptr& slt) {
+bool ServletDispatch::addGlobServlet(const std::string& uri, const Servlet::ptr& slt) {
     WRITELOCK(mutex_);
+    auto old = globs_;
     for (auto it = globs_.begin(); it != globs_.end(); ++it) {
         if (it->first == uri) {
             globs_.erase(it);
@@ -50,23 +87,28 @@ void ServletDispatch::addGlobServlet(const std::string& uri, const Servlet::ptr&
         }
     }
     globs_.emplace_back(uri, slt);
+    if (!rebuild()) {
+        globs_.swap(old);
+        return false;
+    }
+    return true;
 }
 
 
-void ServletDispatch::addGlobServlet(const std::string& uri, FuncionServlet::callback&& cb) {
-    WRITELOCK(mutex_);
-    for (auto it = globs_.begin(); it != globs_.end(); ++it) {
-        if (it->first == uri) {
-            globs_.erase(it);
-            break;
-        }
-    }
-    globs_.emplace_back(uri, std::make_shared<FuncionServlet>(cb));
+bool ServletDispatch::addGlobServlet(const std::string& uri, FuncionServlet::callback&& cb) {
+    return addGlobServlet(uri, std::make_shared<FuncionServlet>(std::move(cb)));
 }
 
 void ServletDispatch::delServlet(const std::string& uri) {
     WRITELOCK(mutex_);
     datas_.erase(uri);
+    rebuild();
+}
+
+void ServletDispatch::delServlet(HttpMethod method, const std::string& uri) {
+    WRITELOCK(mutex_);
+    methods_.erase({method, uri});
+    rebuild();
 }
 
 void ServletDispatch::delGlobServlet(const std::string& uri) {
@@ -77,8 +119,49 @@ void ServletDispatch::delGlobServlet(const std::string& uri) {
             break;
         }
     }
+    rebuild();
 }
 
+void ServletDispatch::setDefault(Servlet::ptr&& v) {
+    WRITELOCK(mutex_);
+    default_ = std::move(v);
+    rebuild();
+}
+
+// 只有结尾一个 '*' 的 glob 等价于前缀通配
+static bool IsPrefixGlob(const std::string& uri) {
+    auto pos = uri.find_first_of("*?[\\");
+    return pos == uri.size() - 1 && uri[pos] == '*';
+}
+
+bool ServletDispatch::rebuild() {
+    auto snapshot = std::make_unique<Snapshot>();
+    // 前缀 glob 先加入, 同一位置的通配路由覆盖它, 与原来精确匹配优先一致
+    for (auto it = globs_.rbegin(); it != globs_.rend(); ++it) {
+        if (IsPrefixGlob(it->first)) {
+            snapshot->router.addPrefix(it->first.substr(0, it->first.size() - 1),
+                                       it->second);
+        }
+    }
+    for (auto& [uri, slt] : globs_) {
+        if (!IsPrefixGlob(uri)) {
+            snapshot->globs.emplace_back(uri, slt);
+        }
+    }
+    for (auto& [uri, slt] : datas_) {
+        if (!snapshot->router.add(uri, slt)) {
+            return false;
+        }
+    }
+    for (auto& [key, slt] : methods_) {
+        if (!snapshot->router.add(key.first, key.second, slt)) {
+            return false;
+        }
+    }
+    snapshot->defaultServlet = default_;
+    snapshot_.store(std::move(snapshot));
+    return true;
+}
 
 Servlet::ptr ServletDispatch::getServlet(const std::string& uri) const {
     READLOCK(mutex_);
@@ -97,17 +180,30 @@ Servlet::ptr ServletDispatch::getGlobServlet(const std::string& uri) const {
 }
 
 Servlet::ptr ServletDispatch::getMatchedServlet(const std::string& uri) const {
-    READLOCK(mutex_);
-    auto it = datas_.find(uri);
-    if (it != datas_.end()) {
-        return it->second;
+    return getMatchedServlet(HttpMethod::GET, uri);
+}
+
+Servlet::ptr ServletDispatch::getMatchedServlet(HttpMethod method,
+                                                std::string_view uri,
+                                                HttpRequest* request) const {
+    rcu::ReadGuard guard;
+    auto snapshot = snapshot_.load();
+    Router::Params params;
+    if (auto slt = snapshot->router.find(method, uri, request ? &params : nullptr)) {
+        for (auto& [name, value] : params) {
+            request->setParam(std::string(name), std::string(value));
+        }
+        return *slt;
     }
-    for (const auto& [x, y] : globs_) {
-        if (!fnmatch(x.c_str(), uri.c_str(), 0)) {
-            return y;
+    if (!snapshot->globs.empty()) {
+        std::string path(uri);
+        for (const auto& [x, y] : snapshot->globs) {
+            if (!fnmatch(x.c_str(), path.c_str(), 0)) {
+                return y;
+            }
         }
     }
-    return default_;
+    return snapshot->defaultServlet;
 }
 
 NotFoundServlet::NotFoundServlet() : Servlet("NotFoundServlet") {
@@ -125,7 +221,7 @@ int32_t NotFoundServlet::handle(const HttpRequest::ptr& request,
     static const std::string BODY2 = " was not found on this server.</p>\n"
                                      "</body></html>";
 
-    std::string RSP_BODY = BODY1 + request->getPath() + BODY2;
+    std::string RSP_BODY = BODY1 + std::string(request->getPath()) + BODY2;
     response->setStatus(HttpStatus::NOT_FOUND);
     response->setHeader("Server", "flexy/1.0.0");
     response->setHeader("Content-type", "text/html");
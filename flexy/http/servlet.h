@@ -2,7 +2,9 @@
 #include <string_view>
 #include <functional>
 #include "http_session.h"
-#include "flexy/thread/mutex.h"
+#include "router.h"
+#include "flexy/fiber/mutex.h"
+#include "flexy/thread/rcu.h"
 
 namespace flexy::http {
 
@@ -15,9 +17,13 @@ public:
                            const HttpResponse::ptr& response,
                            const SockStream::ptr& sesion) = 0;
     auto& getName() const { return name_; }
+    // 为 true 时不预先读取请求消息体, 通过 request->getBodyStream() 增量读取
+    bool isStreamBody() const { return streamBody_; }
+    void setStreamBody(bool v) { streamBody_ = v; }
 
 protected:
     std::string name_;
+    bool streamBody_ = false;
 };
 
 class FuncionServlet : public Servlet {
@@ -35,33 +41,63 @@ private:
     callback cb_;
 };
 
+// 路由表修改时重建为 Router 并整体替换(copy-on-write), 通过 RCU 发布,
+// 请求路径上的查找只进入 RCU 读端临界区, 不加锁
+// 路由语法见 Router; addGlobServlet 的 fnmatch 模式中, 只在结尾有 '*' 的
+// 模式转为前缀通配加入 Router, 其余的在 Router 匹配失败后按加入顺序逐个 fnmatch,
+// 因此非前缀的 glob 总是输给同样能匹配的前缀 glob, 即使前缀 glob 加入得更晚
+// addServlet 的 uri 按 Router 语法解析, 段首的 ':' 和结尾的 '*' 不再按字面匹配;
+// 需要字面匹配这样的路径时用 addGlobServlet 并以 '\\' 转义, 如 "/a/\\*"
 class ServletDispatch : public Servlet {
 public:
     using ptr = std::shared_ptr<ServletDispatch>;
     ServletDispatch();
+    // 匹配到的路径参数写入 request 的参数(getParam)
     int32_t handle(const HttpRequest::ptr& request,
                    const HttpResponse::ptr& response,
                    const SockStream::ptr& session) override;
-    void addServlet(const std::string& uri, const Servlet::ptr& slt);
-    void addServlet(const std::string& uri, FuncionServlet::callback&& cb);
-    void addGlobServlet(const std::string& uri, const Servlet::ptr& slt);
-    void addGlobServlet(const std::string& uri, FuncionServlet::callback&& slt);
+    // 添加路由, 与已有路由的参数名冲突(如 /a/:id 和 /a/:name/x)时不添加, 返回 false
+    bool addServlet(const std::string& uri, const Servlet::ptr& slt);
+    bool addServlet(const std::string& uri, FuncionServlet::callback&& cb);
+    // 只匹配 method 的路由, 优先于不区分方法的同一路由
+    bool addServlet(HttpMethod method, const std::string& uri,
+                    const Servlet::ptr& slt);
+    bool addServlet(HttpMethod method, const std::string& uri,
+                    FuncionServlet::callback&& cb);
+    bool addGlobServlet(const std::string& uri, const Servlet::ptr& slt);
+    bool addGlobServlet(const std::string& uri, FuncionServlet::callback&& slt);
 
     void delServlet(const std::string& uri);
+    void delServlet(HttpMethod method, const std::string& uri);
     void delGlobServlet(const std::string& uri);
 
     auto& getDefault() const { return default_; }
-    void setDefault(Servlet::ptr&& v) { default_ = std::move(v); }
+    void setDefault(Servlet::ptr&& v);
 
     Servlet::ptr getServlet(const std::string& uri) const;
     Servlet::ptr getGlobServlet(const std::string& uri) const;
     Servlet::ptr getMatchedServlet(const std::string& uri) const;
+    // 按方法和路径匹配, request 不为空时写入路径参数
+    Servlet::ptr getMatchedServlet(HttpMethod method, std::string_view uri,
+                                   HttpRequest* request = nullptr) const;
 
 private:
-    mutable rw_mutex mutex_;
+    // 不可变的路由表快照
+    struct Snapshot {
+        Router router;
+        std::vector<std::pair<std::string, Servlet::ptr>> globs;  // 非前缀的 glob
+        Servlet::ptr defaultServlet;
+    };
+    // 由当前路由重建快照并发布, 路由冲突时不发布并返回 false, 需要持有写锁
+    bool rebuild();
+
+private:
+    mutable fiber::shared_mutex mutex_;    // 保护路由的修改
     std::unordered_map<std::string, Servlet::ptr> datas_;    
+    std::map<std::pair<HttpMethod, std::string>, Servlet::ptr> methods_;
     std::vector<std::pair<std::string, Servlet::ptr>> globs_;
     Servlet::ptr default_;
+    RcuPtr<const Snapshot> snapshot_;
 };
 
 class NotFoundServlet : public Servlet {
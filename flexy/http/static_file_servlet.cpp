@@ -0,0 +1,542 @@
+#include "static_file_servlet.h"
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <charconv>
+#include "flexy/util/config.h"
+#include "flexy/util/log.h"
+#include "flexy/util/util.h"
+
+namespace flexy::http {
+
+static auto g_logger = FLEXY_LOG_NAME("system");
+
+static auto g_static_file_cache_size = Config::Lookup("http.static_file.cache_size",
+    (size_t)1024, "max open files cached by StaticFileServlet");
+
+static auto g_static_file_check_interval = Config::Lookup(
+    "http.static_file.check_interval", (uint64_t)100,
+    "min interval(ms) between StaticFileServlet inotify reads");
+
+// 使缓存失效的事件, IN_ATTRIB 包含 touch 修改时间
+static constexpr uint32_t kWatchMask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+    IN_MOVE_SELF;
+
+StaticFile::~StaticFile() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+StaticFileCache::StaticFileCache()
+    : inotifyFd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+    if (inotifyFd_ < 0) {
+        FLEXY_LOG_ERROR(g_logger) << "inotify_init1 fail, errno = " << errno
+            << " errstr = " << strerror(errno) << ", static file cache disabled";
+    }
+}
+
+StaticFileCache::~StaticFileCache() {
+    if (inotifyFd_ >= 0) {
+        ::close(inotifyFd_);
+    }
+}
+
+std::shared_ptr<const StaticFile> StaticFileCache::Open(const std::string& path) {
+    auto file = std::make_shared<StaticFile>();
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return file;
+    }
+    file->exists = true;
+    file->directory = S_ISDIR(st.st_mode);
+    if (!file->directory) {
+        file->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        // 以打开的 fd 为准, 避免 stat 和 open 之间文件被替换
+        if (file->fd < 0 || fstat(file->fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            file->exists = false;
+            return file;
+        }
+    }
+    file->size = st.st_size;
+    file->mtime = st.st_mtim.tv_sec;
+    char buf[64];
+    char* p = buf;
+    *p++ = '"';
+    p = std::to_chars(p, buf + sizeof(buf),
+                      (uint64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec,
+                      16).ptr;
+    *p++ = '-';
+    p = std::to_chars(p, buf + sizeof(buf), (uint64_t)st.st_size, 16).ptr;
+    *p++ = '"';
+    file->etag.assign(buf, p);
+    file->lastModified = StaticFileServlet::FormatHttpDate(file->mtime);
+    return file;
+}
+
+static std::string DirName(const std::string& path) {
+    auto pos = path.rfind('/');
+    return pos == std::string::npos ? "." : path.substr(0, pos);
+}
+
+std::shared_ptr<const StaticFile> StaticFileCache::get(const std::string& path) {
+    size_t capacity = g_static_file_cache_size->getValue();
+    if (inotifyFd_ < 0 || capacity == 0) {
+        return Open(path);
+    }
+    uint64_t now = GetTimeMs();
+    uint64_t next = nextDrain_.load(std::memory_order_relaxed);
+    // 同一时刻只有一个查找读取事件
+    if (now >= next && nextDrain_.compare_exchange_strong(
+                           next, now + g_static_file_check_interval->getValue())) {
+        drainEvents();
+    }
+    std::string dir = DirName(path);
+    uint64_t generation;
+    {
+        LOCK_GUARD(mutex_);
+        auto it = index_.find(path);
+        if (it != index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->second;
+        }
+        // 先监听再打开, 打开之后的修改一定会产生事件
+        if (!watch(dir)) {
+            return Open(path);
+        }
+        generation = generation_;
+    }
+    auto file = Open(path);
+    // 打开期间的事件可能针对这个文件, 处理之后再插入
+    drainEvents();
+    LOCK_GUARD(mutex_);
+    auto dit = dirs_.find(dir);
+    // 其他查找读出的事件可能还未处理完, 有事件时不插入
+    if (dit == dirs_.end() || generation != generation_ || index_.count(path)) {
+        if (dit != dirs_.end() && dit->second.files == 0) {
+            unwatch(dir);
+        }
+        return file;
+    }
+    ++dit->second.files;
+    lru_.emplace_front(path, file);
+    index_.emplace(lru_.front().first, lru_.begin());
+    while (lru_.size() > capacity) {
+        index_.erase(lru_.back().first);
+        unwatch(DirName(lru_.back().first));
+        lru_.pop_back();
+    }
+    return file;
+}
+
+void StaticFileCache::clear() {
+    LOCK_GUARD(mutex_);
+    clearLocked();
+}
+
+size_t StaticFileCache::size() const {
+    LOCK_GUARD(mutex_);
+    return lru_.size();
+}
+
+bool StaticFileCache::watch(const std::string& dir) {
+    if (dirs_.count(dir)) {
+        return true;
+    }
+    int wd = inotify_add_watch(inotifyFd_, dir.c_str(), kWatchMask | IN_ONLYDIR);
+    if (wd < 0) {
+        return false;
+    }
+    // 同一个目录的不同路径(如符号链接)返回相同的 wd, 只记录第一个
+    if (watches_.emplace(wd, dir).second) {
+        dirs_.emplace(dir, Watch{wd});
+        return true;
+    }
+    return false;
+}
+
+void StaticFileCache::unwatch(const std::string& dir) {
+    auto it = dirs_.find(dir);
+    if (it == dirs_.end() || (it->second.files > 0 && --it->second.files > 0)) {
+        return;
+    }
+    // 之后收到的 IN_IGNORED 找不到 wd, 直接忽略
+    inotify_rm_watch(inotifyFd_, it->second.wd);
+    watches_.erase(it->second.wd);
+    dirs_.erase(it);
+}
+
+void StaticFileCache::clearLocked() {
+    for (auto& [wd, dir] : watches_) {
+        inotify_rm_watch(inotifyFd_, wd);
+    }
+    watches_.clear();
+    dirs_.clear();
+    index_.clear();
+    lru_.clear();
+}
+
+void StaticFileCache::drainEvents() {
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t n = ::read(inotifyFd_, buf, sizeof(buf));
+        if (n <= 0) {
+            return;
+        }
+        LOCK_GUARD(mutex_);
+        ++generation_;
+        for (char* p = buf; p < buf + n;) {
+            auto event = (const inotify_event*)p;
+            p += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                // 事件丢失, 全部失效
+                clearLocked();
+                continue;
+            }
+            auto it = watches_.find(event->wd);
+            if (it == watches_.end()) {
+                continue;
+            }
+            if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                // 目录本身被删除/移动, 全部失效
+                clearLocked();
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+            std::string dir = it->second;
+            auto entry = index_.find(dir + "/" + event->name);
+            if (entry != index_.end()) {
+                auto lit = entry->second;
+                index_.erase(entry);
+                lru_.erase(lit);
+                unwatch(dir);
+            }
+            // 子目录的变化同时使其下缓存的 index.html 等失效
+            if (event->mask & IN_ISDIR) {
+                clearLocked();
+            }
+        }
+    }
+}
+
+StaticFileServlet::StaticFileServlet(const std::string& root,
+                                     const std::string& prefix)
+    : Servlet("StaticFileServlet"), root_(root), prefix_(prefix) {
+    while (root_.size() > 1 && root_.back() == '/') {
+        root_.pop_back();
+    }
+}
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+bool StaticFileServlet::mapPath(std::string_view path, std::string& out) const {
+    if (path.substr(0, prefix_.size()) != prefix_) {
+        return false;
+    }
+    path.remove_prefix(prefix_.size());
+    std::string decoded;
+    decoded.reserve(path.size());
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (path[i] == '%') {
+            int hi = i + 2 < path.size() ? HexValue(path[i + 1]) : -1;
+            int lo = i + 2 < path.size() ? HexValue(path[i + 2]) : -1;
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            decoded.push_back((char)(hi << 4 | lo));
+            i += 2;
+        } else {
+            decoded.push_back(path[i]);
+        }
+    }
+    // 逐段检查, 忽略空段和 ".", 拒绝 ".." 和 NUL
+    out = root_;
+    std::string_view rest = decoded;
+    while (!rest.empty()) {
+        auto pos = rest.find('/');
+        auto seg = rest.substr(0, pos);
+        rest = pos == std::string_view::npos ? std::string_view()
+                                             : rest.substr(pos + 1);
+        if (seg.empty() || seg == ".") {
+            continue;
+        }
+        if (seg == ".." || seg.find('\0') != std::string_view::npos) {
+            return false;
+        }
+        out.push_back('/');
+        out.append(seg);
+    }
+    return true;
+}
+
+std::string_view StaticFileServlet::GetContentType(std::string_view path) {
+    static const std::unordered_map<std::string_view, std::string_view> s_types = {
+        {".html", "text/html; charset=utf-8"},
+        {".htm", "text/html; charset=utf-8"},
+        {".css", "text/css; charset=utf-8"},
+        {".js", "application/javascript; charset=utf-8"},
+        {".mjs", "application/javascript; charset=utf-8"},
+        {".json", "application/json"},
+        {".txt", "text/plain; charset=utf-8"},
+        {".xml", "application/xml"},
+        {".svg", "image/svg+xml"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".jpeg", "image/jpeg"},
+        {".gif", "image/gif"},
+        {".webp", "image/webp"},
+        {".ico", "image/x-icon"},
+        {".wasm", "application/wasm"},
+        {".woff", "font/woff"},
+        {".woff2", "font/woff2"},
+        {".pdf", "application/pdf"},
+        {".mp4", "video/mp4"},
+        {".mp3", "audio/mpeg"},
+    };
+    auto slash = path.rfind('/');
+    auto dot = path.rfind('.');
+    if (dot != std::string_view::npos &&
+        (slash == std::string_view::npos || dot > slash)) {
+        std::string ext(path.substr(dot));
+        for (auto& c : ext) {
+            c = tolower(c);
+        }
+        auto it = s_types.find(ext);
+        if (it != s_types.end()) {
+            return it->second;
+        }
+    }
+    return "application/octet-stream";
+}
+
+static bool ParseUint(std::string_view s, uint64_t& v) {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    return !s.empty() && ec == std::errc() && ptr == s.data() + s.size();
+}
+
+int StaticFileServlet::ParseRange(std::string_view range, uint64_t size,
+                                  uint64_t& offset, uint64_t& length) {
+    if (range.substr(0, 6) != "bytes=") {
+        return 0;
+    }
+    range.remove_prefix(6);
+    if (range.find(',') != std::string_view::npos) {
+        return 0;
+    }
+    auto dash = range.find('-');
+    if (dash == std::string_view::npos) {
+        return 0;
+    }
+    auto first = range.substr(0, dash), last = range.substr(dash + 1);
+    uint64_t a = 0, b = 0;
+    if (first.empty()) {
+        // bytes=-n, 最后 n 个字节
+        if (!ParseUint(last, b)) {
+            return 0;
+        }
+        if (b == 0 || size == 0) {
+            return -1;
+        }
+        length = std::min(b, size);
+        offset = size - length;
+        return 1;
+    }
+    if (!ParseUint(first, a) || (!last.empty() && !ParseUint(last, b))) {
+        return 0;
+    }
+    if (!last.empty() && b < a) {
+        return 0;
+    }
+    if (a >= size) {
+        return -1;
+    }
+    offset = a;
+    length = (last.empty() ? size - 1 : std::min(b, size - 1)) - a + 1;
+    return 1;
+}
+
+static bool EqualsNoCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+bool StaticFileServlet::AcceptGzip(std::string_view accept_encoding) {
+    // gzip 的 q 值, 未列出时取 "*" 的 q 值, 都未列出为 -1
+    int gzip = -1, any = -1;
+    while (!accept_encoding.empty()) {
+        auto pos = accept_encoding.find(',');
+        auto item = accept_encoding.substr(0, pos);
+        accept_encoding = pos == std::string_view::npos
+                              ? std::string_view()
+                              : accept_encoding.substr(pos + 1);
+        auto semi = item.find(';');
+        auto coding = Trim(item.substr(0, semi), " \t");
+        // 只关心 q 值是否为 0, 取最多 4 位数字
+        int q = 1;
+        while (semi != std::string_view::npos) {
+            item.remove_prefix(semi + 1);
+            semi = item.find(';');
+            auto param = Trim(item.substr(0, semi), " \t");
+            if (param.size() < 2 || (param[0] | 0x20) != 'q' || param[1] != '=') {
+                continue;
+            }
+            param.remove_prefix(2);
+            q = 0;
+            for (size_t i = 0, digits = 0; i < param.size() && digits < 4; ++i) {
+                if (param[i] == '.') {
+                    continue;
+                }
+                if (param[i] < '0' || param[i] > '9') {
+                    break;
+                }
+                q = q * 10 + param[i] - '0';
+                ++digits;
+            }
+        }
+        if (EqualsNoCase(coding, "gzip") || EqualsNoCase(coding, "x-gzip")) {
+            gzip = q;
+        } else if (coding == "*") {
+            any = q;
+        }
+    }
+    return gzip >= 0 ? gzip > 0 : any > 0;
+}
+
+std::string StaticFileServlet::FormatHttpDate(time_t t) {
+    static const char* s_days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static const char* s_months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                     "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+             s_days[tm.tm_wday], tm.tm_mday, s_months[tm.tm_mon],
+             tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    return buf;
+}
+
+time_t StaticFileServlet::ParseHttpDate(const std::string& s) {
+    struct tm tm = {};
+    const char* end = strptime(s.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (end == nullptr || *end != '\0') {
+        return -1;
+    }
+    return timegm(&tm);
+}
+
+// If-None-Match 中是否有与 etag 弱比较相同的值
+static bool MatchETag(std::string_view header, std::string_view etag) {
+    while (!header.empty()) {
+        auto pos = header.find(',');
+        auto tag = header.substr(0, pos);
+        header = pos == std::string_view::npos ? std::string_view()
+                                               : header.substr(pos + 1);
+        while (!tag.empty() && tag.front() == ' ') {
+            tag.remove_prefix(1);
+        }
+        while (!tag.empty() && tag.back() == ' ') {
+            tag.remove_suffix(1);
+        }
+        if (tag.substr(0, 2) == "W/") {
+            tag.remove_prefix(2);
+        }
+        if (tag == "*" || tag == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int32_t StaticFileServlet::handle(const HttpRequest::ptr& request,
+                                  const HttpResponse::ptr& response,
+                                  const SockStream::ptr& session) {
+    auto method = request->getMehod();
+    if (method != HttpMethod::GET && method != HttpMethod::HEAD) {
+        response->setStatus(HttpStatus::METHOD_NOT_ALLOWED);
+        response->setHeader("Allow", "GET, HEAD");
+        return 0;
+    }
+    std::string path;
+    if (!mapPath(request->getPath(), path)) {
+        response->setStatus(HttpStatus::FORBIDDEN);
+        return 0;
+    }
+    auto file = cache_.get(path);
+    if (file->directory) {
+        path.append("/index.html");
+        file = cache_.get(path);
+    }
+    if (!file->exists || file->directory) {
+        response->setStatus(HttpStatus::NOT_FOUND);
+        return 0;
+    }
+
+    response->setHeader("Content-Type", std::string(GetContentType(path)));
+    if (AcceptGzip(request->getHeader("Accept-Encoding"))) {
+        auto gz = cache_.get(path + ".gz");
+        if (gz->exists && !gz->directory) {
+            file = gz;
+            response->setHeader("Content-Encoding", "gzip");
+        }
+    }
+    // 响应可能随 Accept-Encoding 变化
+    response->setHeader("Vary", "Accept-Encoding");
+    response->setHeader("Accept-Ranges", "bytes");
+    response->setHeader("ETag", file->etag);
+    response->setHeader("Last-Modified", file->lastModified);
+
+    // If-None-Match 优先于 If-Modified-Since
+    std::string inm = request->getHeader("If-None-Match");
+    if (!inm.empty()) {
+        if (MatchETag(inm, file->etag)) {
+            response->setStatus(HttpStatus::NOT_MODIFIED);
+            return 0;
+        }
+    } else {
+        std::string ims = request->getHeader("If-Modified-Since");
+        time_t since = ims.empty() ? -1 : ParseHttpDate(ims);
+        if (since >= 0 && file->mtime <= since) {
+            response->setStatus(HttpStatus::NOT_MODIFIED);
+            return 0;
+        }
+    }
+
+    uint64_t offset = 0, length = file->size;
+    std::string range = request->getHeader("Range");
+    std::string if_range = request->getHeader("If-Range");
+    // If-Range 不匹配时忽略 Range, 发送完整的文件
+    if (!range.empty() && (if_range.empty() || if_range == file->etag ||
+                           if_range == file->lastModified)) {
+        int rt = ParseRange(range, file->size, offset, length);
+        if (rt < 0) {
+            response->setStatus(HttpStatus::RANGE_NOT_SATISFIABLE);
+            response->setHeader("Content-Range",
+                                "bytes */" + std::to_string(file->size));
+            return 0;
+        }
+        if (rt > 0) {
+            response->setStatus(HttpStatus::PARTIAL_CONTENT);
+            response->setHeader("Content-Range",
+                                "bytes " + std::to_string(offset) + "-" +
+                                    std::to_string(offset + length - 1) + "/" +
+                                    std::to_string(file->size));
+        }
+    }
+    response->setBodyFile(file, file->fd, offset, length);
+    return 0;
+}
+
+}  // namespace flexy::http
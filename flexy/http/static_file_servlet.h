@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <ctime>
+#include <list>
+#include <unordered_map>
+#include "servlet.h"
+
+namespace flexy::http {
+
+// 缓存的文件: 打开的 fd 和 stat 结果, fd 随最后一个引用关闭
+// 正在发送的响应持有引用, 缓存淘汰不影响发送
+struct StaticFile : noncopyable {
+    ~StaticFile();
+
+    int fd = -1;                // 只读打开的 fd, 目录和不存在的文件为 -1
+    bool exists = false;        // 文件是否存在
+    bool directory = false;     // 是否为目录
+    uint64_t size = 0;          // 文件大小
+    time_t mtime = 0;           // 修改时间
+    std::string etag;           // 由修改时间和大小生成的强 ETag
+    std::string lastModified;   // HTTP 日期格式的修改时间
+};
+
+// 打开的文件 fd 和 stat 结果的 LRU 缓存, 容量为 http.static_file.cache_size
+// 不存在的文件同样缓存(负缓存)
+// 文件所在目录通过 inotify 监听, 目录中文件的修改/删除/创建/移动使对应的缓存失效,
+// 目录中的文件全部移出缓存后取消监听
+// inotify fd 为非阻塞, 不注册到 IOManager, 否则常驻的读事件或定时器会使 IOManager 无法停止;
+// 查找时距上次读取事件超过 http.static_file.check_interval 毫秒才读出全部事件,
+// 读取不持有缓存的锁, 因此修改最多在该间隔之后可见
+class StaticFileCache : noncopyable {
+public:
+    using ptr = std::shared_ptr<StaticFileCache>;
+    StaticFileCache();
+    ~StaticFileCache();
+    // 返回 path 对应的文件, 不会返回 nullptr
+    std::shared_ptr<const StaticFile> get(const std::string& path);
+    // 清空缓存
+    void clear();
+    // 缓存的文件数量
+    size_t size() const;
+
+private:
+    // 打开文件并读取 stat
+    static std::shared_ptr<const StaticFile> Open(const std::string& path);
+    // 读出 inotify 的全部事件, 使对应的缓存失效, 不能持有锁
+    void drainEvents();
+    // 监听 dir, 失败返回 false, 需要持有锁
+    bool watch(const std::string& dir);
+    // 目录中缓存的文件数减一, 为 0 时取消监听, 需要持有锁
+    void unwatch(const std::string& dir);
+    // 移除缓存的文件, 需要持有锁
+    void clearLocked();
+
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const StaticFile>>;
+    struct Watch {
+        int wd;             // watch descriptor
+        size_t files = 0;   // 目录中缓存的文件数量
+    };
+
+    mutable mutex mutex_;
+    std::list<Entry> lru_;  // 头部为最近使用的文件
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+    int inotifyFd_ = -1;    // 为 -1 时不缓存
+    std::unordered_map<int, std::string> watches_;  // watch descriptor -> 目录
+    std::unordered_map<std::string, Watch> dirs_;   // 目录 -> 监听
+    uint64_t generation_ = 0;                       // 处理过的事件批次, 需要持有锁
+    std::atomic<uint64_t> nextDrain_ = {0};         // 下次读取事件的时间(ms)
+};
+
+// 静态文件 servlet, 将 prefix 之后的路径映射到 root 目录下的文件
+// 消息体通过 sendfile 发送, 支持 HEAD, 单个 Range, If-None-Match/If-Modified-Since,
+// 请求接受 gzip 且存在 .gz 文件时发送预压缩的文件
+// 目录返回其中的 index.html, 包含 ".." 的路径返回 403
+// 用法: dispatch->addGlobServlet("/static/*",
+//           std::make_shared<StaticFileServlet>("/var/www", "/static/"));
+class StaticFileServlet : public Servlet {
+public:
+    using ptr = std::shared_ptr<StaticFileServlet>;
+    StaticFileServlet(const std::string& root, const std::string& prefix = "/");
+    int32_t handle(const HttpRequest::ptr& request,
+                   const HttpResponse::ptr& response,
+                   const SockStream::ptr& session) override;
+
+    auto& getCache() { return cache_; }
+
+    // 文件扩展名(含 '.')对应的 Content-Type, 未知的扩展名返回 application/octet-stream
+    static std::string_view GetContentType(std::string_view path);
+    // 解析 Range: bytes=a-b, 只支持单个范围; 格式错误或多个范围返回 0,
+    // 范围无法满足返回 -1, 成功返回 1 并设置 [offset, offset + length)
+    static int ParseRange(std::string_view range, uint64_t size,
+                          uint64_t& offset, uint64_t& length);
+    // Accept-Encoding 是否接受 gzip, 按 q 值判断, q=0 表示不接受
+    static bool AcceptGzip(std::string_view accept_encoding);
+    // 格式化/解析 HTTP 日期(RFC 7231 IMF-fixdate), 解析失败返回 -1
+    static std::string FormatHttpDate(time_t t);
+    static time_t ParseHttpDate(const std::string& s);
+
+private:
+    // 将请求路径转换为 root 下的文件路径, 非法路径返回 false
+    bool mapPath(std::string_view path, std::string& out) const;
+
+private:
+    std::string root_;
+    std::string prefix_;
+    StaticFileCache cache_;
+};
+
+}  // namespace flexy::http
@@ -22,7 +22,7 @@ void WSServer::handleClient(const Socket::ptr& client) {
             FLEXY_LOG_DEBUG(g_logger) << "handleShake error";
             break;
         }
-        auto servlet = dispatch_->getWSServlet(header->getPath());
+        auto servlet = dispatch_->getWSServlet(std::string(header->getPath()));
         if (!servlet) {
             FLEXY_LOG_DEBUG(g_logger) << "no match WSServlet";
             break;
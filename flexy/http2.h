@@ -0,0 +1,9 @@
+#pragma once
+
+#include "http2/dynamic_table.h"
+#include "http2/frame.h"
+#include "http2/hpack.h"
+#include "http2/http2_server.h"
+#include "http2/http2_session.h"
+#include "http2/http2_stream.h"
+#include "http2/huffman.h"
@@ -1,6 +1,7 @@
 #include "dynamic_table.h"
 
 #include <array>
+#include <fmt/format.h>
 
 namespace flexy::http2 {
 
@@ -75,88 +76,186 @@ static constexpr std::array<std::pair<std::string_view, std::string_view>, 62>
 #undef XX
     }};
 
+namespace {
+
+// 静态表 name 的完美哈希: 52 个不同的 name 映射到 256 个槽, 没有冲突
+// 种子在编译期搜索; 同名字段在静态表中相邻, 槽中保存第一个的索引
+constexpr uint32_t StaticHash(std::string_view name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;  // FNV-1a
+    for (char c : name) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 16777619u;
+    }
+    return h >> 24;
+}
+
+struct StaticIndex {
+    uint32_t seed = 0;
+    std::array<uint8_t, 256> slots = {};  // 0 表示空
+};
+
+constexpr StaticIndex BuildStaticIndex() {
+    for (uint32_t seed = 0; seed < 4096; ++seed) {
+        StaticIndex index;
+        index.seed = seed;
+        bool ok = true;
+        for (size_t i = 1; i < s_static_headers.size() && ok; ++i) {
+            auto name = s_static_headers[i].first;
+            if (name == s_static_headers[i - 1].first) {
+                continue;
+            }
+            auto& slot = index.slots[StaticHash(name, seed)];
+            ok = slot == 0;
+            slot = i;
+        }
+        if (ok) {
+            return index;
+        }
+    }
+    return {};
+}
+
+constexpr StaticIndex s_static_index = BuildStaticIndex();
+static_assert(s_static_index.slots[StaticHash(":authority",
+                                              s_static_index.seed)] == 1,
+              "no perfect hash seed for the static table");
+
+}  // namespace
+
 std::pair<std::string_view, std::string_view> DynamicTable::GetStaticHeaders(
     uint32_t idx) {
     return s_static_headers[idx];
 }
 
 int32_t DynamicTable::GetStaticHeadersIndex(std::string_view name) {
-    for (size_t i = 1; i < s_static_headers.size(); ++i) {
-        if (s_static_headers[i].first == name) {
-            return i;
-        }
+    uint8_t idx = s_static_index.slots[StaticHash(name, s_static_index.seed)];
+    if (idx && s_static_headers[idx].first == name) {
+        return idx;
     }
     return -1;
 }
 
 std::pair<int32_t, bool> DynamicTable::GetStaticHeadersPair(
     std::string_view name, std::string_view val) {
-    std::pair<int32_t, bool> rt = std::make_pair(-1, false);
-    for (size_t i = 1; i < s_static_headers.size(); ++i) {
-        auto [s_name, s_val] = s_static_headers[i];
-        if (s_name == name) {
-            if (rt.first == -1) {
-                rt.first = i;
-            }
-        } else {
-            continue;
-        }
-        if (s_val == val) {
-            rt.first = i;
-            rt.second = true;
+    int32_t first = GetStaticHeadersIndex(name);
+    if (first == -1) {
+        return {-1, false};
+    }
+    for (size_t i = first;
+         i < s_static_headers.size() && s_static_headers[i].first == name; ++i) {
+        if (s_static_headers[i].second == val) {
+            return {i, true};
         }
     }
-    return rt;
+    return {first, false};
 }
 
-DynamicTable::DynamicTable() : maxDataSize_(4096), dataSize_(0) {}
+DynamicTable::DynamicTable() : maxDataSize_(4096), dataSize_(0), ring_(16) {}
+
+void DynamicTable::evict() {
+    // 字符串不释放, 调用者传入的 name/value 可能引用被淘汰的字段,
+    // 在槽位被复用前仍然有效
+    const Entry& e = at(first_);
+    dataSize_ -= EntrySize(e.name, e.value);
+    auto it = names_.find(e.name);
+    if (it != names_.end() && it->second == first_) {
+        names_.erase(it);
+    }
+    auto pit = pairs_.find({e.name, e.value});
+    if (pit != pairs_.end() && pit->second == first_) {
+        pairs_.erase(pit);
+    }
+    ++first_;
+}
+
+void DynamicTable::grow() {
+    std::vector<Entry> ring(ring_.size() * 2);
+    for (uint64_t seq = first_; seq < next_; ++seq) {
+        ring[seq & (ring.size() - 1)] = std::move(at(seq));
+    }
+    ring_.swap(ring);
+    // 短字符串移动后地址改变, 重建索引
+    names_.clear();
+    pairs_.clear();
+    for (uint64_t seq = first_; seq < next_; ++seq) {
+        addIndex(seq);
+    }
+}
+
+// 键替换为引用新字段的字符串, 旧字段被淘汰时键不会悬空
+// 已存在时取出节点修改键后重新插入, 不重新分配节点
+template <typename Map>
+static void ReplaceKey(Map& map, const typename Map::key_type& key,
+                       uint64_t seq) {
+    auto it = map.find(key);
+    if (it == map.end()) {
+        map.emplace(key, seq);
+        return;
+    }
+    auto node = map.extract(it);
+    node.key() = key;
+    node.mapped() = seq;
+    map.insert(std::move(node));
+}
+
+void DynamicTable::addIndex(uint64_t seq) {
+    const Entry& e = at(seq);
+    ReplaceKey(names_, e.name, seq);
+    ReplaceKey(pairs_, {e.name, e.value}, seq);
+}
 
 int32_t DynamicTable::update(std::string_view name, std::string_view val) {
-    int len = name.length() + val.length() + 32;  // why add 32 ?
-    int idx = 0;
-    while (dataSize_ + len > maxDataSize_ && !datas_.empty()) {
-        auto& [d_name, d_val] = datas_[0];
-        dataSize_ -= d_name.length() + d_val.length() + 32;
-        ++idx;
-    }
-    datas_.erase(datas_.begin(), datas_.begin() + idx);
+    int32_t len = EntrySize(name, val);
+    while (dataSize_ + len > maxDataSize_ && size() > 0) {
+        evict();
+    }
+    // 比整个表还大的字段只会清空表, 不会加入
+    if (len > maxDataSize_) {
+        return 0;
+    }
+    if (size() == ring_.size()) {
+        grow();
+    }
+    Entry& e = at(next_);
+    e.name.assign(name.data(), name.size());
+    e.value.assign(val.data(), val.size());
     dataSize_ += len;
-    datas_.emplace_back(name, val);
+    addIndex(next_++);
     return 0;
 }
 
+void DynamicTable::sexMaxDataSize(int32_t v) {
+    maxDataSize_ = v;
+    while (dataSize_ > maxDataSize_ && size() > 0) {
+        evict();
+    }
+}
+
 int32_t DynamicTable::findIndex(std::string_view name) const {
     int32_t idx = GetStaticHeadersIndex(name);
     if (idx == -1) {
-        size_t len = datas_.size();
-        for (size_t i = 0; i < len; ++i) {
-            if (datas_[len - i - 1].first == name) {
-                idx = i + 62;
-                break;
-            }
+        auto it = names_.find(name);
+        if (it != names_.end()) {
+            idx = toIndex(it->second);
         }
     }
     return idx;
 }
 
 std::pair<int32_t, bool> DynamicTable::findPair(std::string_view name,
-                                                std::string_view value) {
+                                                std::string_view value) const {
     auto rt = GetStaticHeadersPair(name, value);
-    if (!rt.second) {
-        size_t len = datas_.size();
-        for (size_t i = 0; i < datas_.size(); ++i) {
-            if (datas_[len - i - 1].first == name) {
-                if (rt.first == -1) {
-                    rt.first = i + 62;
-                }
-            } else {
-                continue;
-            }
-            if (datas_[len - i - 1].second == value) {
-                rt.first = i + 62;
-                rt.second = true;
-                break;
-            }
+    if (rt.second) {
+        return rt;
+    }
+    auto it = pairs_.find({name, value});
+    if (it != pairs_.end()) {
+        return {toIndex(it->second), true};
+    }
+    if (rt.first == -1) {
+        auto nit = names_.find(name);
+        if (nit != names_.end()) {
+            rt.first = toIndex(nit->second);
         }
     }
     return rt;
@@ -164,12 +263,13 @@ std::pair<int32_t, bool> DynamicTable::findPair(std::string_view name,
 
 std::pair<std::string_view, std::string_view> DynamicTable::getPair(
     uint32_t idx) const {
-    if (idx < 62) {
+    if (idx < kStaticSize) {
         return GetStaticHeaders(idx);
     }
-    idx -= 62;
-    if (idx < datas_.size()) {
-        return datas_[datas_.size() - idx - 1];
+    idx -= kStaticSize;
+    if (idx < size()) {
+        const Entry& e = at(next_ - 1 - idx);
+        return {e.name, e.value};
     }
     return {"", ""};
 }
@@ -178,4 +278,14 @@ std::string_view DynamicTable::getName(uint32_t idx) const {
     return getPair(idx).first;
 }
 
-}  // namespace flexy::http2
\ No newline at end of file
+std::string DynamicTable::toString() const {
+    auto ret = fmt::format("[DynamicTable size = {} data_size = {} max = {}]",
+                           size(), dataSize_, maxDataSize_);
+    for (uint64_t seq = next_; seq > first_; --seq) {
+        const Entry& e = at(seq - 1);
+        ret += fmt::format("\n\t{}\t{}: {}", toIndex(seq - 1), e.name, e.value);
+    }
+    return ret;
+}
+
+}  // namespace flexy::http2
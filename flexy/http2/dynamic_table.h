@@ -2,34 +2,101 @@
 
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace flexy::http2 {
 
+// HPACK 动态表 https://httpwg.org/specs/rfc7541.html#dynamic.table
+// 字段保存在容量为 2 的幂的环形缓冲区中, 新字段从尾部加入, 淘汰从头部进行,
+// 不移动其他字段; 另外维护 name 和 (name, value) 到最新字段的哈希索引,
+// 编码时查找已索引字段为 O(1)
+// 字段按加入顺序编号(seq), 索引为 62 + (最新的 seq - seq)
 class DynamicTable {
 public:
+    // 每个字段的额外开销 https://httpwg.org/specs/rfc7541.html#calculating.table.size
+    static constexpr int32_t kEntryOverhead = 32;
+    // 静态表大小(含 0 号占位), 动态表的索引从这里开始
+    static constexpr uint32_t kStaticSize = 62;
+
     DynamicTable();
+    DynamicTable(const DynamicTable&) = delete;
+    DynamicTable& operator=(const DynamicTable&) = delete;
+
     int32_t update(std::string_view name, std::string_view value);
+    // 返回 name 所在的索引(优先静态表), 不存在返回 -1
     int32_t findIndex(std::string_view name) const;
+    // 返回 (索引, value 是否也匹配), 优先完全匹配, 其次静态表中的 name,
+    // 都不存在时索引为 -1
     std::pair<int32_t, bool> findPair(std::string_view name,
-                                      std::string_view value);
+                                      std::string_view value) const;
     std::pair<std::string_view, std::string_view> getPair(uint32_t idx) const;
     std::string_view getName(uint32_t idx) const;
     std::string toString() const;
 
-    void sexMaxDataSize(int32_t v) { maxDataSize_ = v; }
+    // 修改表的最大大小, 淘汰超出的字段
+    void sexMaxDataSize(int32_t v);
+    int32_t getMaxDataSize() const { return maxDataSize_; }
+    // 当前所有字段的大小之和
+    int32_t getDataSize() const { return dataSize_; }
+    // 动态表中的字段数量
+    size_t size() const { return next_ - first_; }
+
+    // 字段的大小: name 和 value 的长度加上 32
+    static int32_t EntrySize(std::string_view name, std::string_view value) {
+        return name.size() + value.size() + kEntryOverhead;
+    }
 
 public:
     static std::pair<std::string_view, std::string_view> GetStaticHeaders(
         uint32_t idx);
+    // 静态表查找使用编译期生成的完美哈希, 不存在返回 -1
     static int32_t GetStaticHeadersIndex(std::string_view name);
     static std::pair<int32_t, bool> GetStaticHeadersPair(std::string_view name,
                                                          std::string_view val);
 
+private:
+    struct Entry {
+        std::string name;
+        std::string value;
+    };
+
+    struct PairHash {
+        size_t operator()(
+            const std::pair<std::string_view, std::string_view>& p) const {
+            size_t h = std::hash<std::string_view>()(p.first);
+            return h ^ (std::hash<std::string_view>()(p.second) + 0x9e3779b9 +
+                        (h << 6) + (h >> 2));
+        }
+    };
+
+    // seq 对应的字段
+    Entry& at(uint64_t seq) { return ring_[seq & (ring_.size() - 1)]; }
+    const Entry& at(uint64_t seq) const {
+        return ring_[seq & (ring_.size() - 1)];
+    }
+    // seq 对应的 HPACK 索引
+    int32_t toIndex(uint64_t seq) const {
+        return kStaticSize + (next_ - 1 - seq);
+    }
+    // 淘汰最旧的字段
+    void evict();
+    // 环形缓冲区已满时扩容为两倍
+    void grow();
+    // 将 seq 对应的字段加入哈希索引, 同名(同值)的旧字段被替换
+    void addIndex(uint64_t seq);
+
 private:
     int32_t maxDataSize_;
     int32_t dataSize_;
-    std::vector<std::pair<std::string, std::string>> datas_;
+    std::vector<Entry> ring_;  // 容量为 2 的幂
+    uint64_t first_ = 0;       // 最旧字段的 seq
+    uint64_t next_ = 0;        // 下一个加入的字段的 seq
+    // 键引用环形缓冲区中最新的同名(同值)字段, 值为该字段的 seq
+    std::unordered_map<std::string_view, uint64_t> names_;
+    std::unordered_map<std::pair<std::string_view, std::string_view>, uint64_t,
+                       PairHash>
+        pairs_;
 };
 
 }  // namespace flexy::http2
@@ -417,9 +417,9 @@ bool WindowUpdateFrame::readFrom(const ByteArray::ptr &ba,
     return false;
 }
 
-static constexpr std::array<std::string_view, 8> s_frame_types = {
-    "DATA",         "HEADERS", "RST_STREAM",    "SETTINGS",
-    "PUSH_PROMISE", "GOAWAY",  "WINDOW_UPDATE", "CONTINUATION"};
+static constexpr std::array<std::string_view, 10> s_frame_types = {
+    "DATA",         "HEADERS", "PRIORITY", "RST_STREAM",    "SETTINGS",
+    "PUSH_PROMISE", "PING",    "GOAWAY",   "WINDOW_UPDATE", "CONTINUATION"};
 
 std::string_view FrameTypeToString(FrameType type) {
     auto v = static_cast<uint8_t>(type);
@@ -675,7 +675,12 @@ Frame::ptr FrameCodec::parseFrom(Stream *stream) {
                 break;
             }
             case FrameType::CONTINUATION: {
-                //
+                // 与 HEADERS 帧相同, 只是没有 PADDED 和 PRIORITY 标志
+                frame->data = std::make_shared<HeadersFrame>();
+                if (!frame->data->readFrom(ba, frame->header)) {
+                    FLEXY_LOG_INFO(g_logger) << "parse ContinuationFrame fail";
+                    return nullptr;
+                }
                 break;
             }
             default: {
@@ -1,4 +1,5 @@
 #include "hpack.h"
+#include <stdexcept>
 #include "flexy/util/log.h"
 #include "huffman.h"
 
@@ -32,7 +33,8 @@ std::string HeaderField::toString() const {
         IndexTypeToSring(type), h_name, h_value, index, name, value);
 }
 
-HPack::HPack(DynamicTable &table) : table_(table) {}
+HPack::HPack(DynamicTable &table, int32_t max_table_size)
+    : table_(table), maxTableSize_(max_table_size) {}
 
 std::string HPack::ReadString(const ByteArray::ptr &ba) {
     uint8_t type = ba->readFuint8();
@@ -43,7 +45,9 @@ std::string HPack::ReadString(const ByteArray::ptr &ba) {
         ba->read(data.data(), len);
         if (type & 0x80) {  // 标志位 'H' 指示字符串的八位字节是否经过霍夫曼编码
             std::string out;
-            huffman::DecodeString(data, out);
+            if (huffman::DecodeString(data, out) < 0) {
+                throw std::invalid_argument("invalid huffman string");
+            }
             return out;
         }
     }
@@ -93,14 +97,20 @@ int HPack::parse(const ByteArray::ptr &ba, int length) {
                 header.type = idx > 0 ? IndexType::WITHOUT_INDEXING_INDEXED_NAME
                                       : IndexType::WITHOUT_INDEXING_NEW_NAME;
                 header.index = idx;
-            } else if (type & 0x10) {  // 从不索引的字面 header 字段 以 “0001” 4
-                                       // 位模式开
+            } else if ((type & 0xf0) == 0x10) {  // 从不索引的字面 header 字段 以 “0001” 4
+                                                 // 位模式开
                 uint32_t idx = ReadVarInt<4>(ba, type);
                 header.type = idx > 0 ? IndexType::NEVER_INDEXED_INDEXED_NAME
                                       : IndexType::NEVER_INDEXED_NEW_NAME;
                 header.index = idx;
-            } else {
-                return -1;
+            } else {  // 动态表大小更新 以 “001” 3 位模式开头
+                uint64_t size = ReadVarInt<5>(ba, type);
+                if (size > (uint64_t)maxTableSize_) {
+                    return -1;
+                }
+                table_.sexMaxDataSize(size);
+                parsed = ba->getPosition() - pos;
+                continue;
             }
 
             if (header.index > 0) {
@@ -111,7 +121,13 @@ int HPack::parse(const ByteArray::ptr &ba, int length) {
             }
         }
 
+        if (header.index >= 62 + table_.size()) {
+            return -1;
+        }
         if (header.type == IndexType::INDEXED) {
+            if (header.index == 0) {
+                return -1;
+            }
             auto [x, y] = table_.getPair(header.index);
             header.name = x;
             header.value = y;
@@ -151,14 +167,14 @@ int HPack::Pack(HeaderField *header, const ByteArray::ptr &ba) {
             WriteString(ba, header->value, header->h_value);
             break;
         }
-        case IndexType::WITHOUT_INDEXING_NEW_NAME: {
+        case IndexType::WITHOUT_INDEXING_INDEXED_NAME: {
             WriteVarInt<4>(ba, header->index);
             WriteString(ba, header->value, header->h_value);
             break;
         }
-        case IndexType::WITHOUT_INDEXING_INDEXED_NAME: {
-            WriteVarInt<4>(ba, header->index);
-            WriteString(ba, header->name, header->h_value);
+        case IndexType::WITHOUT_INDEXING_NEW_NAME: {
+            WriteVarInt<4>(ba, header->index);  // header->index == 0
+            WriteString(ba, header->name, header->h_name);
             WriteString(ba, header->value, header->h_value);
             break;
         }
@@ -195,6 +211,12 @@ int HPack::pack(const std::vector<std::pair<std::string, std::string>> &headers,
     return rt;
 }
 
+// 不加入动态表的字段: 凭证类字段使用从不索引, 防止通过压缩率推测内容(CRIME)
+static bool NeverIndexed(std::string_view name, std::string_view value) {
+    return name == "authorization" || name == "proxy-authorization" ||
+           (name == "cookie" && value.size() < 20);
+}
+
 int HPack::pack(const std::vector<std::pair<std::string, std::string>> &headers,
                 const ByteArray::ptr &ba) {
     int rt = 0;
@@ -204,23 +226,26 @@ int HPack::pack(const std::vector<std::pair<std::string, std::string>> &headers,
         if (ok) {
             h.type = IndexType::INDEXED;
             h.index = idx;
-        } else if (idx > 0) {
-            h.type = IndexType::WITH_INDEXING_INDEXED_NAME;
-            h.index = idx;
-            h.h_value = huffman::ShouldEncode(y);
-            h.name = x;  // headers.push_back 需要
-            h.value = y;
-            table_.update(x, y);
+            rt += pack(&h, ba);
+            continue;
+        }
+        h.index = idx > 0 ? idx : 0;
+        h.name = x;  // headers.push_back 需要
+        h.value = y;
+        h.h_name = h.index == 0 && huffman::ShouldEncode(x);
+        h.h_value = huffman::ShouldEncode(y);
+        if (NeverIndexed(x, y)) {
+            h.type = h.index ? IndexType::NEVER_INDEXED_INDEXED_NAME
+                             : IndexType::NEVER_INDEXED_NEW_NAME;
+        } else if (DynamicTable::EntrySize(x, y) > table_.getMaxDataSize()) {
+            // 比整个动态表还大, 加入只会清空动态表
+            h.type = h.index ? IndexType::WITHOUT_INDEXING_INDEXED_NAME
+                             : IndexType::WITHOUT_INDEXING_NEW_NAME;
         } else {
-            h.type = IndexType::WITH_INDEXING_NEW_NAME;
-            h.index = 0;
-            h.h_name = huffman::ShouldEncode(x);
-            h.name = x;
-            h.h_value = huffman::ShouldEncode(y);
-            h.value = y;
+            h.type = h.index ? IndexType::WITH_INDEXING_INDEXED_NAME
+                             : IndexType::WITH_INDEXING_NEW_NAME;
             table_.update(x, y);
         }
-
         rt += pack(&h, ba);
     }
     return rt;
@@ -78,7 +78,9 @@ struct HeaderField {
 class HPack {
 public:
     using ptr = std::shared_ptr<HPack>;
-    HPack(DynamicTable& table);
+    // max_table_size 为本端通过 SETTINGS_HEADER_TABLE_SIZE 允许的动态表上限,
+    // 解码时对端的动态表大小更新不能超过它
+    HPack(DynamicTable& table, int32_t max_table_size = 4096);
 
     int parse(const ByteArray::ptr& ba, int length);
     int parse(std::string& data);
@@ -111,6 +113,7 @@ public:
 private:
     std::vector<HeaderField> headers_;
     DynamicTable& table_;
+    int32_t maxTableSize_;
 };
 
 template <int32_t prefix, bool flag>
@@ -147,7 +150,7 @@ uint64_t HPack::ReadVarInt(const ByteArray::ptr& ba, uint8_t b) {
     if (b < v) {
         return b;
     }
-    return ba->readInt64() + b;
+    return ba->readUint64() + b;
 }
 
 }  // namespace flexy::http2
\ No newline at end of file
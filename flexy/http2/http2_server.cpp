@@ -0,0 +1,116 @@
+#include "http2_server.h"
+#include <algorithm>
+#include "flexy/fiber/this_fiber.h"
+#include "flexy/util/hash_util.h"
+#include "flexy/util/log.h"
+
+namespace flexy::http2 {
+
+static auto g_logger = FLEXY_LOG_NAME("system");
+
+// 读取但不消费连接开头的 len 个字节
+// 数据只到达一部分且与连接前言相同时, 等待其余数据到达, 超时时间为 socket 的读超时
+static ssize_t PeekPreface(const Socket::ptr& sock, char* buf, size_t len) {
+    ssize_t rt = sock->recv(buf, len, MSG_PEEK);
+    if (rt <= 0 || (size_t)rt == len ||
+        std::string_view(buf, rt) != Http2Session::kPreface.substr(0, rt)) {
+        return rt;
+    }
+    // MSG_PEEK 不消费数据, 可读事件会立即再次触发; 设置 SO_RCVLOWAT 使
+    // 缓冲区中不少于 len 字节(或连接关闭)时才可读
+    auto iom = IOManager::GetThis();
+    int fd = sock->getSocket();
+    int lowat = len;
+    sock->setOption(SOL_SOCKET, SO_RCVLOWAT, lowat);
+    Timer::ptr timer;
+    int64_t timeout = sock->getRecvTimeout();
+    if (timeout != -1) {
+        timer = iom->addTimer(timeout, [iom, fd]() { iom->cancelRead(fd); });
+    }
+    bool ok = iom->addEvent(fd, Event::READ);
+    if (ok) {
+        this_fiber::yield();
+    }
+    if (timer) {
+        timer->cancel();
+    }
+    lowat = 1;
+    sock->setOption(SOL_SOCKET, SO_RCVLOWAT, lowat);
+    if (!ok) {
+        return -1;
+    }
+    rt = sock->recv(buf, len, MSG_PEEK);
+    if (rt > 0 && (size_t)rt < len) {
+        // 超时后被唤醒, 数据仍不完整
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return rt;
+}
+
+Http2Server::Http2Server(bool keepalive, IOManager* worker,
+                         IOManager* io_worker, IOManager* accept_worker)
+    : HttpServer(keepalive, worker, io_worker, accept_worker) {
+    type_ = "http2";
+}
+
+void Http2Server::handleClient(const Socket::ptr& client) {
+    char buf[4];
+    ssize_t rt = PeekPreface(client, buf, sizeof(buf));
+    if (rt <= 0) {
+        client->close();
+        return;
+    }
+    if (std::string_view(buf, rt) == Http2Session::kPreface.substr(0, 4)) {
+        auto session = std::make_shared<Http2Session>(client, dispatch_);
+        session->run();
+        return;
+    }
+
+    auto session = std::make_shared<http::HttpSession>(client);
+    std::vector<http::HttpRequest::ptr> reqs;
+    if (session->recvRequests(reqs, 1) == 0) {
+        session->close();
+        return;
+    }
+    if (!upgrade(session, reqs[0])) {
+        handleSession(session, reqs);
+    }
+    session->close();
+}
+
+bool Http2Server::upgrade(const http::HttpSession::ptr& session,
+                          http::HttpRequest::ptr& req) {
+    std::string_view upgrade, settings;
+    // 消息体未读取的请求不升级, 按 HTTP/1.1 处理
+    if (req->getBodyStream() || !req->findHeader("upgrade", upgrade) ||
+        upgrade.size() != 3 || strncasecmp(upgrade.data(), "h2c", 3) ||
+        !req->findHeader("http2-settings", settings)) {
+        return false;
+    }
+    // HTTP2-Settings 为 base64url 编码, 没有填充
+    std::string encoded(settings);
+    std::replace(encoded.begin(), encoded.end(), '-', '+');
+    std::replace(encoded.begin(), encoded.end(), '_', '/');
+    encoded.append((4 - encoded.size() % 4) % 4, '=');
+
+    // 升级请求作为流 1 在 HTTP/2 连接上响应, 不再依赖 HTTP/1.1 会话的缓冲区
+    req->detach();
+    auto h2 = std::make_shared<Http2Session>(session->getSocket(), dispatch_);
+    if (!h2->upgrade(std::move(req), base64decode(encoded))) {
+        FLEXY_LOG_DEBUG(g_logger) << "invalid HTTP2-Settings: " << settings;
+        return false;
+    }
+
+    auto rsp = std::make_unique<http::HttpResponse>(0x11, false);
+    rsp->setStatus(http::HttpStatus::SWITCHING_PROTOCOLS);
+    rsp->setHeader("Connection", "Upgrade");
+    rsp->setHeader("Upgrade", "h2c");
+    if (session->sendResponse(rsp) <= 0) {
+        return true;
+    }
+    h2->run();
+    return true;
+}
+
+}  // namespace flexy::http2
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "flexy/http/http_server.h"
+#include "http2_session.h"
+
+namespace flexy::http2 {
+
+// HTTP/2 服务器, 同一端口同时支持:
+// 1. 直接发送连接前言的 h2c (prior knowledge)
+// 2. 通过 Upgrade: h2c 升级的 HTTP/1.1 连接
+// 3. 普通的 HTTP/1.1 请求, 按 HttpServer 处理
+class Http2Server : public http::HttpServer {
+public:
+    using ptr = std::shared_ptr<Http2Server>;
+    Http2Server(bool keepalive = true, IOManager* worker = IOManager::GetThis(),
+                IOManager* io_worker = IOManager::GetThis(),
+                IOManager* accept_worker = IOManager::GetThis());
+
+protected:
+    void handleClient(const Socket::ptr& client) override;
+
+private:
+    // 处理 h2c 升级请求, 返回 false 表示不是升级请求
+    bool upgrade(const http::HttpSession::ptr& session,
+                 http::HttpRequest::ptr& req);
+};
+
+}  // namespace flexy::http2
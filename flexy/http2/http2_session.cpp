@@ -0,0 +1,656 @@
+#include "http2_session.h"
+#include <algorithm>
+#include <string.h>
+#include <unistd.h>
+#include "flexy/schedule/scheduler.h"
+#include "flexy/util/config.h"
+#include "flexy/util/log.h"
+
+namespace flexy::http2 {
+
+static auto g_logger = FLEXY_LOG_NAME("system");
+
+static auto g_http2_max_concurrent_streams = Config::Lookup(
+    "http2.max_concurrent_streams", 128u, "http2 max concurrent streams per connection");
+
+static auto g_http2_initial_window_size = Config::Lookup(
+    "http2.initial_window_size", (uint32_t)(1 << 20),
+    "http2 receive window of each stream and the connection");
+
+static constexpr uint32_t kDefaultWindow = 65535;
+static constexpr uint32_t kMaxWindow = 0x7fffffff;
+static constexpr uint32_t kMaxFrameSize = 16384;     // 本端接收的最大帧, 使用默认值
+static constexpr int32_t kHeaderTableSize = 4096;    // 本端的动态表大小, 使用默认值
+
+static Frame::ptr MakeFrame(FrameType type, uint8_t flags, uint32_t id,
+                            const IFrame::ptr& data) {
+    auto frame = std::make_shared<Frame>();
+    frame->header.len_type = 0;
+    frame->header.r_id = 0;
+    frame->header.type = static_cast<uint8_t>(type);
+    frame->header.flags = flags;
+    frame->header.identifier = id;
+    frame->data = data;
+    return frame;
+}
+
+// 直接编码帧头部, 用于 DATA/HEADERS/CONTINUATION, 负载不经过 ByteArray 拷贝
+static void EncodeFrameHeader(uint8_t* p, uint32_t length, FrameType type,
+                              uint8_t flags, uint32_t id) {
+    p[0] = length >> 16;
+    p[1] = length >> 8;
+    p[2] = length;
+    p[3] = static_cast<uint8_t>(type);
+    p[4] = flags;
+    p[5] = (id >> 24) & 0x7f;
+    p[6] = id >> 16;
+    p[7] = id >> 8;
+    p[8] = id;
+}
+
+// 转发给 HTTP/2 对端时需要去掉的连接相关头部
+static bool IsConnectionHeader(std::string_view name) {
+    return name == "connection" || name == "keep-alive" ||
+           name == "proxy-connection" || name == "transfer-encoding" ||
+           name == "upgrade" || name == "content-length";
+}
+
+// 从文件 fd 的 offset 处读取 length 字节, 文件被截断或读取出错时返回 false
+static bool ReadFileFixSize(int fd, char* buf, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pread(fd, buf, length, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        length -= n;
+        offset += n;
+    }
+    return true;
+}
+
+Http2Session::Http2Session(const Socket::ptr& sock,
+                           const http::ServletDispatch::ptr& dispatch,
+                           bool owner)
+    : SockStream(sock, owner),
+      dispatch_(dispatch),
+      localWindow_(std::clamp(g_http2_initial_window_size->getValue(),
+                              kDefaultWindow, kMaxWindow)),
+      maxConcurrentStreams_(g_http2_max_concurrent_streams->getValue()) {}
+
+Http2Session::~Http2Session() {
+    FLEXY_LOG_DEBUG(g_logger) << "Http2Session::~Http2Session";
+}
+
+size_t Http2Session::getStreamCount() {
+    LOCK_GUARD(mutex_);
+    return streams_.size();
+}
+
+Http2Stream::ptr Http2Session::getStream(uint32_t id) {
+    LOCK_GUARD(mutex_);
+    auto it = streams_.find(id);
+    return it == streams_.end() ? nullptr : it->second;
+}
+
+void Http2Session::closeStream(uint32_t id) {
+    LOCK_GUARD(mutex_);
+    auto it = streams_.find(id);
+    if (it != streams_.end()) {
+        it->second->setState(StreamState::CLOSED);
+        streams_.erase(it);
+    }
+}
+
+bool Http2Session::upgrade(http::HttpRequest::ptr&& req,
+                           const std::string& settings) {
+    // HTTP2-Settings 的内容为 SETTINGS 帧的负载
+    if (settings.size() % sizeof(SettingsItem)) {
+        return false;
+    }
+    std::vector<SettingsItem> items(settings.size() / sizeof(SettingsItem));
+    auto ba = std::make_shared<ByteArray>((void*)settings.data(),
+                                          settings.size(), false);
+    for (auto& item : items) {
+        item.readFrom(ba);
+    }
+    if (!applySettings(items)) {
+        return false;
+    }
+    // 升级请求作为流 1, 已经处于 half-closed (remote) 状态
+    req->setVersion(0x20);
+    req->setStreamId(1);
+    auto stream = std::make_shared<Http2Stream>(1, initialSendWindow_);
+    stream->setState(StreamState::HALF_CLOSED_REMOTE);
+    stream->setRequest(std::move(req));
+    LOCK_GUARD(mutex_);
+    streams_[1] = stream;
+    lastStreamId_ = 1;
+    return true;
+}
+
+void Http2Session::run() {
+    std::vector<SettingsItem> items;
+    items.emplace_back(
+        (uint16_t)SettingsFrame::Settings::MAX_CONCURRENT_STREAMS,
+        maxConcurrentStreams_);
+    items.emplace_back((uint16_t)SettingsFrame::Settings::INITIAL_WINDOW_SIZE,
+                       localWindow_);
+    if (!sendSettings(items, false) ||
+        (localWindow_ > kDefaultWindow &&
+         !sendWindowUpdate(0, localWindow_ - kDefaultWindow))) {
+        close();
+        return;
+    }
+
+    char preface[kPreface.size()];
+    if (readFixSize(preface, sizeof(preface)) <= 0 ||
+        kPreface != std::string_view(preface, sizeof(preface))) {
+        FLEXY_LOG_DEBUG(g_logger) << "invalid http2 preface";
+        close();
+        return;
+    }
+    // h2c 升级的请求在收到前言后处理
+    if (auto stream = getStream(1)) {
+        dispatch(stream);
+    }
+
+    while (true) {
+        auto frame = codec_.parseFrom(this);
+        if (!frame || !handleFrame(frame)) {
+            break;
+        }
+    }
+
+    {
+        std::unique_lock<fiber::mutex> lock(mutex_);
+        closed_ = true;
+        for (auto& [_, stream] : streams_) {
+            stream->setReset();
+        }
+        streams_.clear();
+    }
+    windowCond_.notify_all();
+    // 处理请求的协程可能正在写, 关闭 fd 后编号会被新连接复用, 写入的数据会发给新连接
+    // closed_ 之后不再发送新的 DATA 帧, 等这些协程结束后再关闭
+    {
+        std::unique_lock<fiber::mutex> lock(mutex_);
+        windowCond_.wait(lock, [this]() { return handlers_ == 0; });
+    }
+    close();
+}
+
+bool Http2Session::handleFrame(const Frame::ptr& frame) {
+    auto& header = frame->header;
+    FrameType type = static_cast<FrameType>(header.type);
+    FLEXY_LOG_DEBUG(g_logger) << "recv " << frame->toString();
+    if (header.length > kMaxFrameSize) {
+        sendGoAway(Http2Error::FRAME_SIZE_ERROR);
+        return false;
+    }
+    // 头部块必须由连续的 CONTINUATION 帧组成
+    if (headerStreamId_ && type != FrameType::CONTINUATION) {
+        sendGoAway(Http2Error::PROTOCOL_ERROR);
+        return false;
+    }
+    switch (type) {
+        case FrameType::HEADERS:
+        case FrameType::CONTINUATION:
+            return handleHeaders(frame);
+        case FrameType::DATA:
+            return handleData(frame);
+        case FrameType::SETTINGS:
+            return handleSettings(frame);
+        case FrameType::WINDOW_UPDATE:
+            return handleWindowUpdate(frame);
+        case FrameType::PING: {
+            if (header.identifier != 0) {
+                sendGoAway(Http2Error::PROTOCOL_ERROR);
+                return false;
+            }
+            if (header.flags & static_cast<uint8_t>(FrameFlagPing::ACK)) {
+                return true;
+            }
+            return sendFrame(MakeFrame(FrameType::PING,
+                                       static_cast<uint8_t>(FrameFlagPing::ACK),
+                                       0, frame->data));
+        }
+        case FrameType::RST_STREAM: {
+            if (header.identifier == 0) {
+                sendGoAway(Http2Error::PROTOCOL_ERROR);
+                return false;
+            }
+            {
+                LOCK_GUARD(mutex_);
+                auto it = streams_.find(header.identifier);
+                if (it != streams_.end()) {
+                    it->second->setReset();
+                    streams_.erase(it);
+                }
+            }
+            windowCond_.notify_all();
+            return true;
+        }
+        case FrameType::GOAWAY:
+            // 继续读取, 已经打开的流仍然可以发送响应
+            goAway_ = true;
+            return true;
+        case FrameType::PUSH_PROMISE:
+            // 客户端不能推送
+            sendGoAway(Http2Error::PROTOCOL_ERROR);
+            return false;
+        default:
+            // PRIORITY 和未知类型的帧忽略
+            return true;
+    }
+}
+
+bool Http2Session::handleHeaders(const Frame::ptr& frame) {
+    auto& header = frame->header;
+    auto headers = std::static_pointer_cast<HeadersFrame>(frame->data);
+    uint32_t id = header.identifier;
+    if (static_cast<FrameType>(header.type) == FrameType::HEADERS) {
+        if (id == 0) {
+            sendGoAway(Http2Error::PROTOCOL_ERROR);
+            return false;
+        }
+        headerBlock_ = std::move(headers->data);
+        headerStreamId_ = id;
+        headerFlags_ = header.flags;
+    } else {
+        if (headerStreamId_ == 0 || id != headerStreamId_) {
+            sendGoAway(Http2Error::PROTOCOL_ERROR);
+            return false;
+        }
+        headerBlock_.append(headers->data);
+    }
+    if (!(header.flags & static_cast<uint8_t>(FrameFlagHeaders::END_HEADERS))) {
+        return true;
+    }
+    headerStreamId_ = 0;
+
+    // 即使拒绝这个流也要解码, 保持动态表同步
+    HPack hpack(recvTable_, kHeaderTableSize);
+    int rt = -1;
+    try {
+        rt = hpack.parse(headerBlock_);
+    } catch (...) {
+    }
+    if (rt < 0) {
+        sendGoAway(Http2Error::COMPRESSION_ERROR);
+        return false;
+    }
+    bool end_stream =
+        headerFlags_ & static_cast<uint8_t>(FrameFlagHeaders::END_STREAM);
+
+    auto stream = getStream(id);
+    if (stream) {
+        // 请求的 trailer, 忽略其内容
+        if (stream->getState() != StreamState::OPEN || !end_stream) {
+            sendRstStream(id, Http2Error::PROTOCOL_ERROR);
+            closeStream(id);
+            return true;
+        }
+        stream->setState(StreamState::HALF_CLOSED_REMOTE);
+        dispatch(stream);
+        return true;
+    }
+    if (id % 2 == 0 || id <= lastStreamId_) {
+        sendGoAway(Http2Error::PROTOCOL_ERROR);
+        return false;
+    }
+    lastStreamId_ = id;
+    if (goAway_) {
+        return true;
+    }
+    if (getStreamCount() >= maxConcurrentStreams_) {
+        return sendRstStream(id, Http2Error::REFUSED_STREAM);
+    }
+    {
+        LOCK_GUARD(mutex_);
+        stream = std::make_shared<Http2Stream>(id, initialSendWindow_);
+        streams_[id] = stream;
+    }
+    stream->addHeaders(hpack.getHeaders());
+    if (end_stream) {
+        stream->setState(StreamState::HALF_CLOSED_REMOTE);
+        dispatch(stream);
+    } else {
+        stream->setState(StreamState::OPEN);
+    }
+    return true;
+}
+
+bool Http2Session::handleData(const Frame::ptr& frame) {
+    auto& header = frame->header;
+    uint32_t id = header.identifier;
+    if (id == 0 || id > lastStreamId_) {
+        sendGoAway(Http2Error::PROTOCOL_ERROR);
+        return false;
+    }
+    // 流量控制按整个负载(包括填充)计算, 消费到一半时归还
+    recvConsumed_ += header.length;
+    if (recvConsumed_ >= localWindow_ / 2) {
+        if (!sendWindowUpdate(0, recvConsumed_)) {
+            return false;
+        }
+        recvConsumed_ = 0;
+    }
+
+    auto stream = getStream(id);
+    if (!stream || stream->getState() != StreamState::OPEN) {
+        return sendRstStream(id, Http2Error::STREAM_CLOSED);
+    }
+    auto data = std::static_pointer_cast<DataFrame>(frame->data);
+    stream->appendBody(data->data);
+    if (header.flags & static_cast<uint8_t>(FrameFlagData::END_STREAM)) {
+        stream->setState(StreamState::HALF_CLOSED_REMOTE);
+        dispatch(stream);
+    } else if (stream->consumeRecv(header.length) >= localWindow_ / 2) {
+        uint32_t consumed = stream->consumeRecv(0);
+        stream->resetRecvConsumed();
+        return sendWindowUpdate(id, consumed);
+    }
+    return true;
+}
+
+bool Http2Session::handleSettings(const Frame::ptr& frame) {
+    auto& header = frame->header;
+    if (header.identifier != 0) {
+        sendGoAway(Http2Error::PROTOCOL_ERROR);
+        return false;
+    }
+    if (header.flags & static_cast<uint8_t>(FrameFlagSettings::ACK)) {
+        return true;
+    }
+    if (header.length % sizeof(SettingsItem)) {
+        sendGoAway(Http2Error::FRAME_SIZE_ERROR);
+        return false;
+    }
+    auto settings = std::static_pointer_cast<SettingsFrame>(frame->data);
+    if (!applySettings(settings->items)) {
+        sendGoAway(Http2Error::PROTOCOL_ERROR);
+        return false;
+    }
+    return sendSettings({}, true);
+}
+
+bool Http2Session::applySettings(const std::vector<SettingsItem>& items) {
+    using Settings = SettingsFrame::Settings;
+    for (auto& item : items) {
+        switch (static_cast<Settings>(item.identifier)) {
+            case Settings::HEADER_TABLE_SIZE: {
+                // 编码时使用的动态表不超过默认大小, 对端要求更小时需要通知
+                LOCK_GUARD(writeMutex_);
+                if ((int32_t)std::min<uint32_t>(item.value, kHeaderTableSize) !=
+                    sendTable_.getMaxDataSize()) {
+                    sendTable_.sexMaxDataSize(
+                        std::min<uint32_t>(item.value, kHeaderTableSize));
+                    tableSizeUpdate_ = true;
+                }
+                break;
+            }
+            case Settings::ENABLE_PUSH:
+                if (item.value > 1) {
+                    return false;
+                }
+                break;
+            case Settings::INITIAL_WINDOW_SIZE: {
+                if (item.value > kMaxWindow) {
+                    return false;
+                }
+                {
+                    // 已经打开的流按差值调整发送窗口
+                    LOCK_GUARD(mutex_);
+                    int64_t delta = (int64_t)item.value - initialSendWindow_;
+                    initialSendWindow_ = item.value;
+                    for (auto& [_, stream] : streams_) {
+                        stream->updateSendWindow(delta);
+                    }
+                }
+                windowCond_.notify_all();
+                break;
+            }
+            case Settings::MAX_FRAME_SIZE: {
+                if (item.value < kMaxFrameSize || item.value > 0xffffff) {
+                    return false;
+                }
+                LOCK_GUARD(mutex_);
+                peerMaxFrameSize_ = item.value;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+bool Http2Session::handleWindowUpdate(const Frame::ptr& frame) {
+    uint32_t id = frame->header.identifier;
+    auto update = std::static_pointer_cast<WindowUpdateFrame>(frame->data);
+    uint32_t increment = update->increment;
+    if (increment == 0) {
+        if (id == 0) {
+            sendGoAway(Http2Error::PROTOCOL_ERROR);
+            return false;
+        }
+        sendRstStream(id, Http2Error::PROTOCOL_ERROR);
+        closeStream(id);
+        return true;
+    }
+    bool overflow = false;
+    {
+        // 写帧需要 writeMutex_, 持有 mutex_ 时只记录错误, 释放后再发送 GOAWAY
+        LOCK_GUARD(mutex_);
+        if (id == 0) {
+            sendWindow_ += increment;
+            overflow = sendWindow_ > kMaxWindow;
+        } else {
+            auto it = streams_.find(id);
+            if (it != streams_.end()) {
+                it->second->updateSendWindow(increment);
+            }
+        }
+    }
+    if (overflow) {
+        sendGoAway(Http2Error::FLOW_CONTROL_ERROR);
+        return false;
+    }
+    windowCond_.notify_all();
+    return true;
+}
+
+void Http2Session::dispatch(const Http2Stream::ptr& stream) {
+    {
+        LOCK_GUARD(mutex_);
+        ++handlers_;
+    }
+    go [self = shared_from_this(), stream]() {
+        self->handleStream(stream);
+        {
+            LOCK_GUARD(self->mutex_);
+            --self->handlers_;
+        }
+        self->windowCond_.notify_all();
+    };
+}
+
+void Http2Session::handleStream(const Http2Stream::ptr& stream) {
+    auto req = stream->buildRequest();
+    if (!req) {
+        sendRstStream(stream->getId(), Http2Error::PROTOCOL_ERROR);
+        closeStream(stream->getId());
+        return;
+    }
+    // 消息体已经完整接收, 流式 servlet 同样通过 getBodyStream() 读取
+    if (!req->getBody().empty()) {
+        req->setBodyStream(std::make_shared<http::HttpBodyStream>(req->getBody()));
+    }
+    auto rsp = std::make_unique<http::HttpResponse>(0x20, false);
+    dispatch_->handle(req, rsp, shared_from_this());
+    if (!sendResponse(stream, rsp)) {
+        FLEXY_LOG_DEBUG(g_logger) << "send http2 response fail, stream = "
+                                  << stream->getId();
+    }
+    closeStream(stream->getId());
+}
+
+size_t Http2Session::waitSendWindow(const Http2Stream::ptr& stream,
+                                    size_t length) {
+    std::unique_lock<fiber::mutex> lock(mutex_);
+    windowCond_.wait(lock, [this, &stream]() {
+        return closed_ || stream->isReset() ||
+               (sendWindow_ > 0 && stream->getSendWindow() > 0);
+    });
+    if (closed_ || stream->isReset()) {
+        return 0;
+    }
+    size_t n = std::min({length, (size_t)sendWindow_,
+                         (size_t)stream->getSendWindow(),
+                         (size_t)peerMaxFrameSize_});
+    sendWindow_ -= n;
+    stream->updateSendWindow(-(int64_t)n);
+    return n;
+}
+
+bool Http2Session::sendResponse(const Http2Stream::ptr& stream,
+                                const http::HttpResponse::ptr& rsp) {
+    auto body = rsp->getBody();
+    // DATA 帧受流控约束需要分帧发送, 文件消息体在发送每一帧前按窗口大小读取
+    auto file = rsp->getBodyFile();
+    uint64_t length = file ? file->length : body.size();
+    std::vector<std::pair<std::string, std::string>> headers;
+    headers.emplace_back(":status", std::to_string((int)rsp->getStatus()));
+    for (auto& [name, value] : rsp->getHeaders()) {
+        std::string key = name;
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+        if (!IsConnectionHeader(key)) {
+            headers.emplace_back(std::move(key), value);
+        }
+    }
+    headers.emplace_back("content-length", std::to_string(length));
+
+    uint32_t id = stream->getId();
+    // 持有 writeMutex_ 时不能再获取 mutex_, 先读出对端的最大帧大小
+    uint32_t max_frame_size;
+    {
+        LOCK_GUARD(mutex_);
+        max_frame_size = peerMaxFrameSize_;
+    }
+    {
+        LOCK_GUARD(writeMutex_);
+        if (stream->isReset()) {
+            return false;
+        }
+        // 头部块的编码顺序必须与发送顺序一致
+        auto ba = std::make_shared<ByteArray>();
+        if (tableSizeUpdate_) {
+            HPack::WriteVarInt<5, true>(ba, sendTable_.getMaxDataSize());
+            tableSizeUpdate_ = false;
+        }
+        HPack hpack(sendTable_);
+        hpack.pack(headers, ba);
+        ba->setPosition(0);
+        std::string block = ba->toString();
+
+        size_t offset = 0;
+        do {
+            size_t n = std::min<size_t>(block.size() - offset, max_frame_size);
+            bool first = offset == 0;
+            uint8_t flags = 0;
+            if (offset + n == block.size()) {
+                flags |= static_cast<uint8_t>(FrameFlagHeaders::END_HEADERS);
+            }
+            if (first && length == 0) {
+                flags |= static_cast<uint8_t>(FrameFlagHeaders::END_STREAM);
+            }
+            uint8_t head[FrameHeader::SIZE];
+            EncodeFrameHeader(head, n,
+                              first ? FrameType::HEADERS : FrameType::CONTINUATION,
+                              flags, id);
+            iovec iov[2] = {{head, sizeof(head)}, {block.data() + offset, n}};
+            if (writevFixSize(iov, 2) <= 0) {
+                return false;
+            }
+            offset += n;
+        } while (offset < block.size());
+    }
+
+    std::string chunk;
+    uint64_t offset = 0;
+    while (offset < length) {
+        size_t n = waitSendWindow(stream, length - offset);
+        if (n == 0) {
+            return false;
+        }
+        const char* data = body.data() + offset;
+        if (file) {
+            chunk.resize(n);
+            if (!ReadFileFixSize(file->fd, chunk.data(), n, file->offset + offset)) {
+                // 头部已经声明了 content-length, 文件读不全时只能重置流
+                FLEXY_LOG_ERROR(g_logger) << "read http2 response file fail, fd = "
+                    << file->fd << " errno = " << errno << " errstr = " << strerror(errno);
+                sendRstStream(id, Http2Error::INTERNAL_ERROR);
+                return false;
+            }
+            data = chunk.data();
+        }
+        if (!sendData(id, data, n, offset + n == length)) {
+            return false;
+        }
+        offset += n;
+    }
+    return true;
+}
+
+bool Http2Session::sendData(uint32_t id, const char* data, size_t length,
+                            bool end_stream) {
+    uint8_t head[FrameHeader::SIZE];
+    EncodeFrameHeader(
+        head, length, FrameType::DATA,
+        end_stream ? static_cast<uint8_t>(FrameFlagData::END_STREAM) : 0, id);
+    iovec iov[2] = {{head, sizeof(head)}, {(void*)data, length}};
+    LOCK_GUARD(writeMutex_);
+    return writevFixSize(iov, length ? 2 : 1) > 0;
+}
+
+bool Http2Session::sendFrame(const Frame::ptr& frame) {
+    LOCK_GUARD(writeMutex_);
+    return (ssize_t)codec_.serializeTo(this, frame) > 0;
+}
+
+bool Http2Session::sendSettings(const std::vector<SettingsItem>& items,
+                                bool ack) {
+    auto settings = std::make_shared<SettingsFrame>();
+    settings->items = items;
+    return sendFrame(MakeFrame(
+        FrameType::SETTINGS,
+        ack ? static_cast<uint8_t>(FrameFlagSettings::ACK) : 0, 0, settings));
+}
+
+bool Http2Session::sendWindowUpdate(uint32_t id, uint32_t increment) {
+    auto update = std::make_shared<WindowUpdateFrame>();
+    update->increment = increment;
+    return sendFrame(MakeFrame(FrameType::WINDOW_UPDATE, 0, id, update));
+}
+
+bool Http2Session::sendRstStream(uint32_t id, Http2Error error) {
+    auto rst = std::make_shared<RstStreamFrame>();
+    rst->error_code = static_cast<uint32_t>(error);
+    return sendFrame(MakeFrame(FrameType::RST_STREAM, 0, id, rst));
+}
+
+bool Http2Session::sendGoAway(Http2Error error) {
+    auto goaway = std::make_shared<GoAwayFrame>();
+    goaway->r_last_stream_id = 0;
+    goaway->last_stream_id = lastStreamId_;
+    goaway->error_code = static_cast<uint32_t>(error);
+    FLEXY_LOG_DEBUG(g_logger) << "send " << goaway->toString();
+    return sendFrame(MakeFrame(FrameType::GOAWAY, 0, 0, goaway));
+}
+
+}  // namespace flexy::http2
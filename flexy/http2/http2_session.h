@@ -0,0 +1,94 @@
+#pragma once
+
+#include <unordered_map>
+#include "flexy/fiber/condition_variable.h"
+#include "flexy/http/servlet.h"
+#include "flexy/stream/socket_stream.h"
+#include "frame.h"
+#include "http2_stream.h"
+
+namespace flexy::http2 {
+
+// 服务端的 HTTP/2 连接
+// 读协程(调用 run 的协程)按顺序读取并处理所有帧, 包括 HPACK 解码;
+// 每个接收完毕的请求在单独的协程中交给 ServletDispatch 处理并发送响应,
+// 响应按对端的流量控制窗口分帧发送, 写操作由 writeMutex_ 串行化
+class Http2Session : public SockStream,
+                     public std::enable_shared_from_this<Http2Session> {
+public:
+    using ptr = std::shared_ptr<Http2Session>;
+    // 客户端连接前言
+    static constexpr std::string_view kPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+    Http2Session(const Socket::ptr& sock,
+                 const http::ServletDispatch::ptr& dispatch, bool owner = true);
+    ~Http2Session();
+
+    // 读取连接前言后处理帧, 直到连接关闭或出错; 等处理请求的协程全部结束后关闭连接
+    void run();
+    // h2c 升级, req 为升级请求(流 1), settings 为 HTTP2-Settings 头部解码后的内容
+    // 发送 101 响应后调用, 之后调用 run
+    bool upgrade(http::HttpRequest::ptr&& req, const std::string& settings);
+
+    // 当前打开的流的数量
+    size_t getStreamCount();
+
+private:
+    // 处理一个帧, 连接错误时返回 false
+    bool handleFrame(const Frame::ptr& frame);
+    bool handleHeaders(const Frame::ptr& frame);
+    bool handleData(const Frame::ptr& frame);
+    bool handleSettings(const Frame::ptr& frame);
+    bool handleWindowUpdate(const Frame::ptr& frame);
+    // 应用对端的设置项
+    bool applySettings(const std::vector<SettingsItem>& items);
+    // 请求接收完毕, 在新协程中处理
+    void dispatch(const Http2Stream::ptr& stream);
+    // 处理请求并发送响应
+    void handleStream(const Http2Stream::ptr& stream);
+    // 发送响应头部和消息体
+    bool sendResponse(const Http2Stream::ptr& stream,
+                      const http::HttpResponse::ptr& rsp);
+    // 等待流量控制窗口, 返回本次可以发送的长度, 0 表示流已关闭
+    size_t waitSendWindow(const Http2Stream::ptr& stream, size_t length);
+    // 流结束, 从流表中删除
+    void closeStream(uint32_t id);
+
+    Http2Stream::ptr getStream(uint32_t id);
+    bool sendFrame(const Frame::ptr& frame);
+    bool sendData(uint32_t id, const char* data, size_t length, bool end_stream);
+    bool sendSettings(const std::vector<SettingsItem>& items, bool ack);
+    bool sendWindowUpdate(uint32_t id, uint32_t increment);
+    bool sendRstStream(uint32_t id, Http2Error error);
+    bool sendGoAway(Http2Error error);
+
+private:
+    http::ServletDispatch::ptr dispatch_;
+    FrameCodec codec_;
+
+    DynamicTable recvTable_;            // 解码对端头部, 只在读协程中使用
+    DynamicTable sendTable_;            // 编码响应头部, 由 writeMutex_ 保护
+    bool tableSizeUpdate_ = false;      // 需要在下一个头部块开头发送动态表大小更新
+    fiber::mutex writeMutex_;           // 串行化写操作
+
+    fiber::mutex mutex_;                // 保护流表和发送窗口, 持有时不能再获取 writeMutex_
+    fiber::condition_variable windowCond_;  // 发送窗口变化, 连接关闭, 请求处理结束
+    std::unordered_map<uint32_t, Http2Stream::ptr> streams_;
+    int64_t sendWindow_ = 65535;        // 连接级发送窗口
+    int64_t initialSendWindow_ = 65535; // 对端的 SETTINGS_INITIAL_WINDOW_SIZE
+    uint32_t peerMaxFrameSize_ = 16384; // 对端的 SETTINGS_MAX_FRAME_SIZE
+    bool closed_ = false;
+    size_t handlers_ = 0;               // 正在处理请求的协程数量, run 结束前等待归零
+
+    std::string headerBlock_;           // 正在接收的头部块
+    uint32_t headerStreamId_ = 0;       // 头部块所属的流, 0 表示没有未结束的头部块
+    uint8_t headerFlags_ = 0;           // 头部块第一个 HEADERS 帧的标志
+
+    uint32_t lastStreamId_ = 0;         // 对端打开的最大流 id
+    uint32_t recvConsumed_ = 0;         // 连接级未归还的接收窗口
+    uint32_t localWindow_;              // 本端的接收窗口(连接级和流级相同)
+    uint32_t maxConcurrentStreams_;     // 本端允许的最大并发流数
+    bool goAway_ = false;               // 对端已发送 GOAWAY
+};
+
+}  // namespace flexy::http2
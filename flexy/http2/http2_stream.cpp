@@ -0,0 +1,60 @@
+#include "http2_stream.h"
+
+namespace flexy::http2 {
+
+static constexpr std::array<std::string_view, 4> s_stream_state_strings = {
+    "IDLE", "OPEN", "HALF_CLOSED_REMOTE", "CLOSED"};
+
+std::string_view StreamStateToString(StreamState state) {
+    auto v = static_cast<uint8_t>(state);
+    if (v < s_stream_state_strings.size()) {
+        return s_stream_state_strings[v];
+    }
+    return "UNKNOWN";
+}
+
+void Http2Stream::addHeaders(std::vector<HeaderField>& headers) {
+    for (auto& header : headers) {
+        headers_.emplace_back(std::move(header.name), std::move(header.value));
+    }
+}
+
+http::HttpRequest::ptr Http2Stream::buildRequest() {
+    if (request_) {
+        return std::move(request_);
+    }
+    auto req = std::make_unique<http::HttpRequest>(0x20, false);
+    req->setStreamId(id_);
+    bool has_method = false, has_path = false;
+    for (auto& [name, value] : headers_) {
+        if (name.empty()) {
+            return nullptr;
+        }
+        if (name[0] != ':') {
+            req->setHeader(name, value);
+        } else if (name == ":method") {
+            auto method = http::StringToHttpMethod(value);
+            if (method == http::HttpMethod::INVALID_METHOD) {
+                return nullptr;
+            }
+            req->setMethod(method);
+            has_method = true;
+        } else if (name == ":path") {
+            req->setUri(value);
+            has_path = true;
+        } else if (name == ":authority") {
+            req->setHeader("host", value);
+        } else if (name != ":scheme") {
+            return nullptr;
+        }
+    }
+    if (!has_method || !has_path) {
+        return nullptr;
+    }
+    headers_.clear();
+    req->setBody(std::move(body_));
+    req->init();
+    return req;
+}
+
+}  // namespace flexy::http2
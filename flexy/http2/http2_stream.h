@@ -0,0 +1,77 @@
+#pragma once
+
+#include "flexy/http/http.h"
+#include "hpack.h"
+
+namespace flexy::http2 {
+
+// https://httpwg.org/specs/rfc7540.html#StreamStates
+// 服务端只会收到对端打开的流, 不使用 reserved 状态
+enum class StreamState {
+    IDLE,
+    OPEN,
+    HALF_CLOSED_REMOTE,  // 请求接收完毕, 正在处理或发送响应
+    CLOSED,
+};
+
+std::string_view StreamStateToString(StreamState state);
+
+// 错误码 https://httpwg.org/specs/rfc7540.html#ErrorCodes
+enum class Http2Error : uint32_t {
+    NO_ERROR = 0x0,
+    PROTOCOL_ERROR = 0x1,
+    INTERNAL_ERROR = 0x2,
+    FLOW_CONTROL_ERROR = 0x3,
+    SETTINGS_TIMEOUT = 0x4,
+    STREAM_CLOSED = 0x5,
+    FRAME_SIZE_ERROR = 0x6,
+    REFUSED_STREAM = 0x7,
+    CANCEL = 0x8,
+    COMPRESSION_ERROR = 0x9,
+    CONNECT_ERROR = 0xa,
+    ENHANCE_YOUR_CALM = 0xb,
+    INADEQUATE_SECURITY = 0xc,
+    HTTP_1_1_REQUIRED = 0xd,
+};
+
+// 一个 HTTP/2 流, 对应一个请求和它的响应
+// 请求部分由连接的读协程填充, 响应由处理该流的协程发送
+// 窗口和状态由 Http2Session 的锁保护
+class Http2Stream {
+public:
+    using ptr = std::shared_ptr<Http2Stream>;
+    Http2Stream(uint32_t id, int64_t send_window)
+        : id_(id), sendWindow_(send_window) {}
+
+    uint32_t getId() const { return id_; }
+    StreamState getState() const { return state_; }
+    void setState(StreamState v) { state_ = v; }
+    bool isReset() const { return reset_; }
+    void setReset() { reset_ = true; }
+
+    int64_t getSendWindow() const { return sendWindow_; }
+    void updateSendWindow(int64_t v) { sendWindow_ += v; }
+    // 累计已接收但尚未通过 WINDOW_UPDATE 归还的数据量, 返回累计值
+    uint32_t consumeRecv(uint32_t v) { return recvConsumed_ += v; }
+    void resetRecvConsumed() { recvConsumed_ = 0; }
+
+    // 解码后的头部, 伪头部(:method 等)和普通头部
+    void addHeaders(std::vector<HeaderField>& headers);
+    void appendBody(const std::string& data) { body_.append(data); }
+    // 由伪头部和普通头部构造 HttpRequest, 失败返回 nullptr
+    http::HttpRequest::ptr buildRequest();
+    // h2c 升级时, 升级请求即为流 1 的请求
+    void setRequest(http::HttpRequest::ptr&& req) { request_ = std::move(req); }
+
+private:
+    uint32_t id_;
+    StreamState state_ = StreamState::IDLE;
+    bool reset_ = false;                // 收到 RST_STREAM 或连接关闭
+    int64_t sendWindow_;                // 发送窗口, 可能因 SETTINGS 变为负数
+    uint32_t recvConsumed_ = 0;         // 未归还的接收窗口
+    std::vector<std::pair<std::string, std::string>> headers_;
+    std::string body_;
+    http::HttpRequest::ptr request_;    // h2c 升级请求
+};
+
+}  // namespace flexy::http2
@@ -1,331 +1,194 @@
 #include "huffman.h"
 #include "huffman_table.h"
 
-#include <cstdlib>
+#include <array>
 #include <cstring>
 #include <string>
+#include "flexy/net/edian.h"
 
-using namespace flexy::http2;
+namespace flexy::http2::huffman {
 
-#define HEX_TO_HF_CODE(hex) huffman_codes[hex]
-#define HEX_TO_HF_CODE_LEN(hex) huffman_code_len[hex]
-#define FLEXY_MAX_HUFFMAN_BUFF_LEN(l) (l * 8 + 1)
+namespace {
 
-extern "C" {
-int printf(const char *fmt, ...);
-}
+// https://httpwg.org/specs/rfc7541.html#huffman.code
+// 解码使用按半字节(4 bit)转移的状态机, 状态为霍夫曼树的内部节点,
+// 转移表在编译期由 huffman_codes/huffman_code_len 生成
+// 257 个叶子(含 EOS)的霍夫曼树恰好有 256 个内部节点, 状态用一个字节表示
+// 最短的编码为 5 bit, 因此每个半字节最多输出一个字符
 
-namespace flexy::http2::huffman {
+constexpr size_t kStates = 256;
+constexpr uint16_t kLeaf = 0x8000;  // 子节点为叶子, 低位为字符
+constexpr uint16_t kEos = 256;
 
-enum HM_RETURN {
-    HM_RETURN_SUCCESS = 0,
-    HM_RETURN_UNIMPLEMENT = -100,
+enum DecodeFlag : uint8_t {
+    kEmit = 0x1,    // 输出 sym
+    kAccept = 0x2,  // 可以在此结束: 当前位置之后的比特都是 EOS 的前缀(全 1)且不足 8 bit
+    kFail = 0x4,    // 非法编码(遇到 EOS)
 };
 
-struct node {
-    struct node *children[256];
-    unsigned char sym;
-    unsigned int code;
-    int code_len;
-    int size;
+struct DecodeEntry {
+    uint8_t state;
+    uint8_t flags;
+    uint8_t sym;
 };
 
-typedef struct node NODE;
-extern NODE *ROOT;
-
-int hf_init(NODE **h_node);
-void hf_finish(NODE *h_node);
-int hf_byte_encode(unsigned char ch, int remain, unsigned char *buff);
-int hf_integer_encode(unsigned int enc_binary, int nprefix,
-                      unsigned char *buff);
-int hf_integer_decode(const char *enc_buff, int nprefix, char *dec_buff);
-int hf_string_encode(const char *buff_in, int size, int prefix,
-                     unsigned char *buff_out, int *size_out);
-int hf_string_decode(NODE *h_node, unsigned char *enc, int enc_sz,
-                     char *out_buff, int out_sz);
-void hf_print_hex(unsigned char *buff, int size);
-int hf_string_encode_len(unsigned char *enc, int enc_sz);
-
-static NODE *node_create() {
-    NODE *nnode = (NODE *)malloc(1 * sizeof(NODE));
-    memset(nnode, 0, sizeof(NODE));
-    return nnode;
-}
-
-static int _hf_add_node(NODE *h_node, unsigned char sym, int code,
-                        int code_len) {
-    NODE *cur = h_node;
-    unsigned char i = 0;
-    int j = 0;
-    int shift = 0;
-    int start = 0;
-    int end = 0;
-
-    for (; code_len > 8;) {
-        code_len -= 8;
-        i = (unsigned char)(code >> code_len);
-        if (cur->children[i] == NULL) {
-            cur->children[i] = node_create();
-        }
-        cur = cur->children[i];
-    }
-
-    shift = (8 - code_len);
-    start = (unsigned char)(code << shift);
-    end = (1 << shift);
+struct HuffmanTree {
+    uint16_t child[kStates][2] = {};  // 0 表示不存在, 根节点不会是其他节点的子节点
+    uint8_t depth[kStates] = {};      // 从根到该节点的比特数
+    bool ones[kStates] = {};          // 从根到该节点的比特是否全为 1
+};
 
-    for (j = start; j < start + end; j++) {
-        if (cur->children[j] == NULL) {
-            cur->children[j] = node_create();
+constexpr HuffmanTree BuildTree() {
+    HuffmanTree tree;
+    tree.ones[0] = true;
+    uint16_t nodes = 1;
+    for (uint16_t sym = 0; sym <= kEos; ++sym) {
+        uint32_t code = sym == kEos ? huffman_eos_code : huffman_codes[sym];
+        int len = sym == kEos ? huffman_eos_code_len : huffman_code_len[sym];
+        uint16_t cur = 0;
+        for (int i = len - 1; i > 0; --i) {
+            int bit = (code >> i) & 1;
+            if (tree.child[cur][bit] == 0) {
+                uint16_t next = nodes++;
+                tree.child[cur][bit] = next;
+                tree.depth[next] = tree.depth[cur] + 1;
+                tree.ones[next] = tree.ones[cur] && bit;
+            }
+            cur = tree.child[cur][bit];
         }
-        cur->children[j]->code = code;
-        cur->children[j]->sym = sym;
-        cur->children[j]->code_len = code_len;
-        cur->size++;
+        tree.child[cur][code & 1] = kLeaf | sym;
     }
-
-    return 0;
-}
-
-static int _hf_del_node(NODE *h_node) {
-    if (h_node) {
-        for (int i = 0; i < 256; i++) {
-            if (h_node->children[i]) {
-                _hf_del_node(h_node->children[i]);
+    return tree;
+}
+
+constexpr auto BuildDecodeTable() {
+    constexpr HuffmanTree tree = BuildTree();
+    std::array<std::array<DecodeEntry, 16>, kStates> table = {};
+    for (size_t state = 0; state < kStates; ++state) {
+        for (uint8_t nibble = 0; nibble < 16; ++nibble) {
+            DecodeEntry entry = {};
+            uint16_t cur = state;
+            for (int i = 3; i >= 0; --i) {
+                uint16_t next = tree.child[cur][(nibble >> i) & 1];
+                if (next & kLeaf) {
+                    if ((next & ~kLeaf) == kEos) {
+                        entry.flags |= kFail;
+                        break;
+                    }
+                    entry.flags |= kEmit;
+                    entry.sym = next & 0xff;
+                    cur = 0;
+                } else {
+                    cur = next;
+                }
             }
+            entry.state = cur;
+            if (cur == 0 || (tree.ones[cur] && tree.depth[cur] < 8)) {
+                entry.flags |= kAccept;
+            }
+            table[state][nibble] = entry;
         }
-        free(h_node);
     }
-    return 0;
+    return table;
 }
 
-int hf_init(NODE **h_node) {
-    int i = 0;
-    *h_node = node_create();
-    for (i = 0; i < 256; i++) {
-        _hf_add_node(*h_node, i, huffman_codes[i], huffman_code_len[i]);
-    }
-    return 0;
-}
+constexpr auto kDecodeTable = BuildDecodeTable();
 
-void hf_finish(NODE *h_node) {
-    int i = 0;
-    for (i = 0; i < 256; i++) {
-        _hf_del_node(h_node->children[i]);
+uint64_t EncodeBits(const char* in, int in_len) {
+    uint64_t bits = 0;
+    for (int i = 0; i < in_len; ++i) {
+        bits += huffman_code_len[(uint8_t)in[i]];
     }
-
-    free(h_node);
-}
-
-int hf_byte_encode(unsigned char ch, int remain, unsigned char *buff) {
-    unsigned char t = 0;
-    int i = 0;
-    int codes = HEX_TO_HF_CODE(ch);
-    int nbits = HEX_TO_HF_CODE_LEN(ch);
-    // printf("'%c'|codes(%d)|len(%d)\n", ch, codes, nbits );
-    for (;;) {
-        if (remain > nbits) {
-            t = (unsigned char)(codes << (remain - nbits));
-            buff[i++] |= t;
-            return remain - nbits;
-        } else {
-            t = (unsigned char)(codes >> (nbits - remain));
-            buff[i++] |= t;
-            nbits -= remain;
-            remain = 8;
+    return bits;
+}
+
+}  // namespace
+
+// 编码累积在 64 bit 的寄存器中, 每满 64 bit 整体写出
+int EncodeString(const char* in, int in_len, std::string& out, int prefix) {
+    // 前 prefix 个比特保留为 0, 由调用者填充
+    out.resize((EncodeBits(in, in_len) + prefix + 7) / 8);
+    char* p = out.data();
+    uint64_t bits = 0;
+    int nbits = prefix;
+    for (int i = 0; i < in_len; ++i) {
+        uint8_t c = in[i];
+        uint64_t code = huffman_codes[c];
+        int len = huffman_code_len[c];
+        if (nbits + len < 64) {
+            bits = (bits << len) | code;
+            nbits += len;
+            continue;
         }
-        buff[i] = 0;
-        if (nbits == 0)
-            return remain;
+        // 寄存器放不下时先填满剩余的 room 个比特写出, 编码的低位留在寄存器中
+        // 编码最长 30 bit, 此时 nbits > 33, room 不会为 64
+        int room = 64 - nbits;
+        nbits = len - room;
+        uint64_t v = byteswap((bits << room) | (code >> nbits));
+        memcpy(p, &v, sizeof(v));
+        p += sizeof(v);
+        bits = code & ((1ull << nbits) - 1);
     }
-}
-
-int hf_string_encode(const char *buff_in, int size, int prefix,
-                     unsigned char *buff_out, int *size_out) {
-    int i = 0;
-    int remain = (8 - prefix);
-    int j = 0;  // j is instead currently index of buff_out and it is size of
-                // buff_out after it has been done.
-    int nbytes = 0;
-
-    for (i = 0; i < size; i++) {
-        if (remain > HEX_TO_HF_CODE_LEN((uint8_t)buff_in[i])) {
-            nbytes = (remain - HEX_TO_HF_CODE_LEN((uint8_t)buff_in[i])) / 8;
-        } else {
-            nbytes =
-                ((HEX_TO_HF_CODE_LEN((uint8_t)buff_in[i]) - remain) / 8) + 1;
-        }
-        remain = hf_byte_encode(buff_in[i], remain, &buff_out[j]);
-        j += nbytes;
+    while (nbits >= 8) {
+        nbits -= 8;
+        *p++ = static_cast<char>(bits >> nbits);
     }
-
-    // Special EOS sybol
-    if (remain < 8) {
-        unsigned int codes = 0x3fffffff;
-        int nbits = (char)30;
-        buff_out[j++] |= (unsigned char)(codes >> (nbits - remain));
+    if (nbits > 0) {
+        // 用 EOS 的高位(全 1)填充到字节边界
+        int pad = 8 - nbits;
+        *p++ = static_cast<char>((bits << pad) | ((1u << pad) - 1));
     }
-
-    *size_out = j;
     return 0;
 }
 
-int hf_string_decode(NODE *h_node, unsigned char *enc, int enc_sz,
-                     char *out_buff, int out_sz) {
-    NODE *n = h_node;
-    unsigned int cur = 0;
-    int nbits = 0;
-    int i = 0;
-    int idx = 0;
-    int at = 0;
-    for (i = 0; i < enc_sz; i++) {
-        cur = (cur << 8) | enc[i];
-        nbits += 8;
-        for (; nbits >= 8;) {
-            idx = (unsigned char)(cur >> (nbits - 8));
-            n = n->children[idx];
-            if (n == NULL) {
-                printf("invalid huffmand code\n");
-                return -1;  // invalid huffmand code
-            }
-            // printf("n->sym : %c , n->size = %d\n", n->sym, n->size);
-            // if( n->children == NULL){
-            if (n->size == 0) {
-                if (out_sz > 0 && at > out_sz) {
-                    printf("out of length\n");
-                    return -2;  // lenght out of bound
-                }
-                out_buff[at++] = (char)n->sym;
-                nbits -= n->code_len;
-                n = h_node;
-            } else {
-                nbits -= 8;
-            }
-        }
-    }
-
-    for (; nbits > 0;) {
-        n = n->children[(unsigned char)(cur << (8 - nbits))];
-        if (n->size != 0 || n->code_len > nbits) {
-            break;
-        }
-
-        out_buff[at++] = (char)n->sym;
-        nbits -= n->code_len;
-        n = h_node;
-    }
-
-    return at;
-}
-
-int hf_integer_encode(unsigned int enc_binary, int nprefix,
-                      unsigned char *buff) {
-    int i = 0;
-    unsigned int ch = enc_binary;
-    unsigned int ch2 = 0;
-    unsigned int prefix = (1 << nprefix) - 1;
-
-    if (ch < prefix && (ch < 0xff)) {
-        buff[i++] = ch & prefix;
-    } else {
-        buff[i++] = prefix;
-        ch -= prefix;
-        while (ch > 128) {
-            ch2 = (ch % 128);
-            ch2 += 128;
-            buff[i++] = ch2;
-            ch = ch / 128;
-        }
-        buff[i++] = ch;
-    }
-    return i;
-}
-
-int hf_integer_decode(const char *enc_buff, int nprefix, char *dec_buff) {
-    int i = 0;
-    int j = 0;
-    unsigned int M = 0;
-    unsigned int B = 0;
-    unsigned int ch = enc_buff[i++];
-    unsigned int prefix = (1 << nprefix) - 1;
-
-    if (ch < prefix) {
-        dec_buff[j++] = ch;
-    } else {
-        M = 0;
-        do {
-            B = enc_buff[i++];
-            ch = ch + ((B & 127) * (1 << M));
-            M = M + 7;
-        } while (B & 128);
-        dec_buff[j] = ch;
-    }
-    return i;
+int EncodeString(std::string_view in, std::string& out, int prefix) {
+    return EncodeString(in.data(), in.size(), out, prefix);
 }
 
-int hf_string_encode_len(unsigned char *enc, int enc_sz) {
-    int i = 0;
-    int len = 0;
-    for (i = 0; i < enc_sz; i++) {
-        len += huffman_code_len[(int)enc[i]];
+int DecodeString(const char* in, int in_len, std::string& out) {
+    // 最短编码 5 bit, 多留一个字节给不输出时的写入
+    out.resize(in_len * 8 / 5 + 1);
+    char* p = out.data();
+    uint8_t state = 0;
+    uint8_t flags = kAccept;
+    uint8_t fail = 0;
+    // 每个字节两次查表, 字符总是写入, 只在 kEmit 时前移, 循环中没有分支
+    for (int i = 0; i < in_len; ++i) {
+        uint8_t c = in[i];
+        const DecodeEntry& hi = kDecodeTable[state][c >> 4];
+        *p = hi.sym;
+        p += hi.flags & kEmit;
+        const DecodeEntry& lo = kDecodeTable[hi.state][c & 0xf];
+        *p = lo.sym;
+        p += lo.flags & kEmit;
+        state = lo.state;
+        flags = lo.flags;
+        fail |= hi.flags | lo.flags;
     }
-
-    return (len + 7) / 8;
-}
-
-void hf_print_hex(unsigned char *buff, int size) {
-    static char hex[] = {'0', '1', '2', '3', '4', '5', '6', '7',
-                         '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
-    int i = 0;
-    for (i = 0; i < size; i++) {
-        unsigned char ch = buff[i];
-        printf("(%u)%c", ch, hex[(ch >> 4)]);
-        printf("%c ", hex[(ch & 0x0f)]);
+    if ((fail & kFail) || !(flags & kAccept)) {
+        out.clear();
+        return -1;
     }
-    printf("\n");
-}
-
-int EncodeString(const char *in, int in_len, std::string &out, int prefix) {
-    int len = FLEXY_MAX_HUFFMAN_BUFF_LEN(in_len);
-    out.resize(len);
-    int rt =
-        hf_string_encode(in, in_len, prefix, (unsigned char *)out.data(), &len);
-    out.resize(len);
-    return rt;
-}
-
-int EncodeString(std::string_view in, std::string &out, int prefix) {
-    return EncodeString(in.data(), in.size(), out, prefix);
-}
-
-int DecodeString(const char *in, int in_len, std::string &out) {
-    NODE *h_node;
-    hf_init(&h_node);
-    int len = FLEXY_MAX_HUFFMAN_BUFF_LEN(in_len);
-    out.resize(len);
-    int rt =
-        hf_string_decode(h_node, (unsigned char *)in, in_len, out.data(), len);
-    hf_finish(h_node);
-    out.resize(rt);
-    return rt;
+    out.resize(p - out.data());
+    return out.size();
 }
 
-int DecodeString(std::string_view in, std::string &out) {
+int DecodeString(std::string_view in, std::string& out) {
     return DecodeString(in.data(), in.size(), out);
 }
 
 int EncodeLen(std::string_view in) { return EncodeLen(in.data(), in.size()); }
 
-int EncodeLen(const char *in, int in_len) {
-    return hf_string_encode_len((unsigned char *)in, in_len);
+int EncodeLen(const char* in, int in_len) {
+    return (EncodeBits(in, in_len) + 7) / 8;
 }
 
 bool ShouldEncode(std::string_view in) {
     return ShouldEncode(in.data(), in.size());
 }
 
-bool ShouldEncode(const char *in, int in_len) {
+bool ShouldEncode(const char* in, int in_len) {
     return EncodeLen(in, in_len) < in_len;
 }
 
-}  // namespace flexy::http2::huffman
\ No newline at end of file
+}  // namespace flexy::http2::huffman
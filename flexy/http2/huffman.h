@@ -1,13 +1,17 @@
 #pragma once
 
+#include <string>
 #include <string_view>
 
 namespace flexy::http2::huffman {
 
+// 霍夫曼编码, out 的前 prefix 个比特保留为 0, 末尾以 EOS 的前缀填充
 int EncodeString(const char* in, int in_len, std::string& out, int prefix);
 int EncodeString(std::string_view in, std::string& out, int prefix);
+// 霍夫曼解码, 返回解码后的长度, 编码非法(包含 EOS 或填充不正确)返回 -1
 int DecodeString(const char* in, int in_len, std::string& out);
 int DecodeString(std::string_view in, std::string& out);
+// 编码后的字节数
 int EncodeLen(std::string_view in);
 int EncodeLen(const char* in, int in_len);
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 /*
                                                         code
                           code as bits                 as hex   len
@@ -266,7 +268,11 @@
 
 namespace flexy::http2 {
 
-static unsigned int huffman_codes[256] = {
+// EOS 只用于填充, 不会出现在编码后的字符串中
+inline constexpr uint32_t huffman_eos_code = 0x3fffffff;
+inline constexpr uint8_t huffman_eos_code_len = 30;
+
+inline constexpr uint32_t huffman_codes[256] = {
     0x1ff8,    0x7fffd8,   0xfffffe2, 0xfffffe3, 0xfffffe4,  0xfffffe5,
     0xfffffe6, 0xfffffe7,  0xfffffe8, 0xffffea,  0x3ffffffc, 0xfffffe9,
     0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec, 0xfffffed,  0xfffffee,
@@ -311,7 +317,7 @@ static unsigned int huffman_codes[256] = {
     0x7ffffe9, 0x7ffffea,  0x7ffffeb, 0xffffffe, 0x7ffffec,  0x7ffffed,
     0x7ffffee, 0x7ffffef,  0x7fffff0, 0x3ffffee};
 
-static int huffman_code_len[256] = {
+inline constexpr uint8_t huffman_code_len[256] = {
     13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28, 28, 28, 28,
     28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28, 6,  10, 10, 12, 13, 6,
     8,  11, 10, 10, 8,  11, 8,  6,  6,  6,  5,  5,  5,  6,  6,  6,  6,  6,  6,
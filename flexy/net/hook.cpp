@@ -4,7 +4,12 @@
 #include "flexy/util/config.h"
 
 #include <dlfcn.h>
+#include <linux/io_uring.h>
+#include <sys/sendfile.h>
 #include <stdarg.h>
+#include <string.h>
+#include <atomic>
+#include <set>
 
 static auto g_logger = FLEXY_LOG_NAME("system");
 
@@ -30,6 +35,7 @@ static auto g_tcp_connect_timeout = Config::Lookup("tcp.connect.timeout", 5000,
     XX(send)                \
     XX(sendto)              \
     XX(sendmsg)             \
+    XX(sendfile)            \
     XX(close)               \
     XX(fcntl)               \
     XX(ioctl)               \
@@ -69,6 +75,74 @@ void set_hook_enable(bool flag) {
     t_hook_enable = flag; 
 }
 
+#ifdef FLEXY_SYSCALL_STATS
+
+namespace {
+
+// 线程私有的系统调用计数, 只有所属线程写入, 避免计数时的缓存行争用
+struct SyscallCounter {
+    SyscallCounter();
+    ~SyscallCounter();
+    std::atomic<uint64_t> count{0};
+};
+
+struct SyscallCounters {
+    mutex mutex_;
+    std::set<SyscallCounter*> counters;     // 存活线程的计数
+    uint64_t exited = 0;                    // 已退出线程的计数
+};
+
+SyscallCounters& GetSyscallCounters() {
+    static SyscallCounters s_counters;
+    return s_counters;
+}
+
+// 线程退出时计数已析构, 之后的系统调用不再计数
+thread_local bool t_syscall_counter_destroyed = false;
+
+SyscallCounter::SyscallCounter() {
+    auto& counters = GetSyscallCounters();
+    LOCK_GUARD(counters.mutex_);
+    counters.counters.insert(this);
+}
+
+SyscallCounter::~SyscallCounter() {
+    auto& counters = GetSyscallCounters();
+    LOCK_GUARD(counters.mutex_);
+    counters.counters.erase(this);
+    counters.exited += count;
+    t_syscall_counter_destroyed = true;
+}
+
+}  // namespace
+
+void count_syscall() {
+    if (FLEXY_UNLIKELY(t_syscall_counter_destroyed)) {
+        return;
+    }
+    static thread_local SyscallCounter s_counter;
+    s_counter.count.store(s_counter.count.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+}
+
+uint64_t syscall_count() {
+    auto& counters = GetSyscallCounters();
+    LOCK_GUARD(counters.mutex_);
+    uint64_t total = counters.exited;
+    for (auto counter : counters.counters) {
+        total += counter->count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+#else
+
+uint64_t syscall_count() {
+    return 0;
+}
+
+#endif  // FLEXY_SYSCALL_STATS
+
 } // namespace flexy
 
 
@@ -76,9 +150,32 @@ struct timer_info {
     int cacelled = 0;
 };
 
-template <typename OriginFun, typename... Args>
+// io_uring 模式下直接提交请求, 由 prep 填写 sqe 的操作码和参数
+// 返回 false 表示提交失败, 需要回退到 epoll
+template <typename Prep>
+static bool do_uring_io(flexy::IOManager* iom, int fd, Prep&& prep,
+                        uint64_t timeout, ssize_t& n) {
+    io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.fd = fd;
+    prep(sqe);
+    int res = 0;
+    if (!iom->submitIO(sqe, timeout, res)) {
+        return false;
+    }
+    if (res < 0) {
+        // 超时为 -ETIMEDOUT, fd 被关闭时请求被取消
+        errno = res == -ECANCELED ? EBADF : -res;
+        n = -1;
+    } else {
+        n = res;
+    }
+    return true;
+}
+
+template <typename OriginFun, typename Prep, typename... Args>
 static ssize_t do_io(int fd, OriginFun&& func, const char* hook_fun_name, uint32_t event,
-                     int timeout_type, Args&&... args) {
+                     int timeout_type, Prep&& prep, Args&&... args) {
     if (!flexy::t_hook_enable) {
         if (!func) {
             flexy::hook_init();
@@ -98,10 +195,19 @@ static ssize_t do_io(int fd, OriginFun&& func, const char* hook_fun_name, uint32
     }
 
     uint64_t timeout = ctx->getTimeout(timeout_type);
+    if constexpr (!std::is_null_pointer_v<std::decay_t<Prep>>) {
+        auto iom = flexy::IOManager::GetThis();
+        ssize_t n = -1;
+        if (iom && iom->isUring() && do_uring_io(iom, fd, prep, timeout, n)) {
+            return n;
+        }
+    }
     auto tinfo = std::make_shared<timer_info>();
 retry:
+    flexy::count_syscall();
     ssize_t n = func(fd, std::forward<Args>(args)...);
     while (n == -1 && errno == EINTR) {
+        flexy::count_syscall();
         n = func(fd, std::forward<Args>(args)...);
     }
     if (n == -1 && errno == EAGAIN) {
@@ -230,6 +336,24 @@ int connect_with_timeout(int sockfd, const struct sockaddr* addr, socklen_t addr
     if (ctx->getUserNonblock()) {
         return connect_f(sockfd, addr, addrlen);
     }
+    auto iom = flexy::IOManager::GetThis();
+    if (iom && iom->isUring()) {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_CONNECT;
+        sqe.fd = sockfd;
+        sqe.addr = (uint64_t)addr;
+        sqe.off = addrlen;
+        int res = 0;
+        if (iom->submitIO(sqe, timeout_ms, res)) {
+            if (res < 0) {
+                errno = res == -ECANCELED ? EBADF : -res;
+                return -1;
+            }
+            return 0;
+        }
+    }
+    flexy::count_syscall();
     int n = connect_f(sockfd, addr, addrlen);
     if (n == 0) {
         return 0;
@@ -237,7 +361,6 @@ int connect_with_timeout(int sockfd, const struct sockaddr* addr, socklen_t addr
         return n;
     }
 
-    auto iom = flexy::IOManager::GetThis();
     flexy::Timer::ptr timer;    
     auto tinfo = std::make_shared<timer_info>();
     std::weak_ptr<timer_info> winfo(tinfo);
@@ -287,7 +410,12 @@ int connect(int sockfd, const struct sockaddr* addr, socklen_t addrlen) {
 }
 
 int accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen) {
-    int fd = do_io(sockfd, accept_f, "accept", flexy::READ, SO_RCVTIMEO, addr, addrlen);
+    int fd = do_io(sockfd, accept_f, "accept", flexy::READ, SO_RCVTIMEO,
+        [=](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_ACCEPT;
+            sqe.addr = (uint64_t)addr;
+            sqe.addr2 = (uint64_t)addrlen;
+        }, addr, addrlen);
     if (fd >= 0) {
         flexy::FdMsg::GetInstance().get(fd, true);
     }
@@ -295,43 +423,115 @@ int accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen) {
 }
 
 ssize_t read(int fd, void* buf, size_t count) {
-    return do_io(fd, read_f, "read", flexy::READ, SO_RCVTIMEO, buf, count);
+    return do_io(fd, read_f, "read", flexy::READ, SO_RCVTIMEO,
+        [=](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_RECV;
+            sqe.addr = (uint64_t)buf;
+            sqe.len = count;
+        }, buf, count);
 }
 
 ssize_t readv(int fd, const struct iovec* iov, int iovcnt) {
-    return do_io(fd, readv_f, "readv", flexy::READ, SO_RCVTIMEO, iov, iovcnt);
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (iovec*)iov;
+    msg.msg_iovlen = iovcnt;
+    return do_io(fd, readv_f, "readv", flexy::READ, SO_RCVTIMEO,
+        [&msg](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_RECVMSG;
+            sqe.addr = (uint64_t)&msg;
+            sqe.len = 1;
+        }, iov, iovcnt);
 }
 
 ssize_t recv(int sockfd, void* buf, size_t len, int flags) {
-    return do_io(sockfd, recv_f, "recv", flexy::READ, SO_RCVTIMEO, buf, len, flags);
+    return do_io(sockfd, recv_f, "recv", flexy::READ, SO_RCVTIMEO,
+        [=](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_RECV;
+            sqe.addr = (uint64_t)buf;
+            sqe.len = len;
+            sqe.msg_flags = flags;
+        }, buf, len, flags);
 }
 
 ssize_t recvfrom(int sockfd, void* buf, size_t len, int flags, struct sockaddr* src_addr, socklen_t* addrlen) {
-    return do_io(sockfd, recvfrom_f, "recvfrom", flexy::READ, SO_RCVTIMEO, buf, len, flags, src_addr, addrlen);
+    // 需要回填 addrlen, 仍走 epoll
+    return do_io(sockfd, recvfrom_f, "recvfrom", flexy::READ, SO_RCVTIMEO, nullptr, buf, len, flags, src_addr, addrlen);
 }
 
 ssize_t recvmsg(int sockfd, struct msghdr* msg, int flags) {
-    return do_io(sockfd, recvmsg_f, "recvmsg", flexy::READ, SO_RCVTIMEO, msg, flags);
+    return do_io(sockfd, recvmsg_f, "recvmsg", flexy::READ, SO_RCVTIMEO,
+        [=](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_RECVMSG;
+            sqe.addr = (uint64_t)msg;
+            sqe.len = 1;
+            sqe.msg_flags = flags;
+        }, msg, flags);
 }
 
 ssize_t write(int fd, const void* buf, size_t count) {
-    return do_io(fd, write_f, "write", flexy::WRITE, SO_SNDTIMEO, buf, count);
+    return do_io(fd, write_f, "write", flexy::WRITE, SO_SNDTIMEO,
+        [=](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_SEND;
+            sqe.addr = (uint64_t)buf;
+            sqe.len = count;
+        }, buf, count);
 }
 
 ssize_t writev(int fd, const struct iovec* iov, int iovcnt) {
-    return do_io(fd, writev_f, "writev", flexy::WRITE, SO_SNDTIMEO, iov, iovcnt);
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (iovec*)iov;
+    msg.msg_iovlen = iovcnt;
+    return do_io(fd, writev_f, "writev", flexy::WRITE, SO_SNDTIMEO,
+        [&msg](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_SENDMSG;
+            sqe.addr = (uint64_t)&msg;
+            sqe.len = 1;
+        }, iov, iovcnt);
 }
 
 ssize_t send(int sockfd, const void* buf, size_t len, int flags) {
-    return do_io(sockfd, send_f, "send", flexy::WRITE, SO_SNDTIMEO, buf, len, flags);
+    return do_io(sockfd, send_f, "send", flexy::WRITE, SO_SNDTIMEO,
+        [=](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_SEND;
+            sqe.addr = (uint64_t)buf;
+            sqe.len = len;
+            sqe.msg_flags = flags;
+        }, buf, len, flags);
 }
 
 ssize_t sendto(int sockfd, const void* buf, size_t len, int flags, const struct sockaddr* dest_addr, socklen_t addrlen) {
-    return do_io(sockfd, sendto_f, "sendto", flexy::WRITE, SO_SNDTIMEO, buf, len, flags, dest_addr, addrlen);
+    iovec iov{(void*)buf, len};
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = (void*)dest_addr;
+    msg.msg_namelen = addrlen;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    return do_io(sockfd, sendto_f, "sendto", flexy::WRITE, SO_SNDTIMEO,
+        [&msg, flags](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_SENDMSG;
+            sqe.addr = (uint64_t)&msg;
+            sqe.len = 1;
+            sqe.msg_flags = flags;
+        }, buf, len, flags, dest_addr, addrlen);
 }
 
 ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags) {
-    return do_io(sockfd, sendmsg_f, "sendmsg", flexy::WRITE, SO_SNDTIMEO, msg, flags);
+    return do_io(sockfd, sendmsg_f, "sendmsg", flexy::WRITE, SO_SNDTIMEO,
+        [=](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_SENDMSG;
+            sqe.addr = (uint64_t)msg;
+            sqe.len = 1;
+            sqe.msg_flags = flags;
+        }, msg, flags);
+}
+
+// io_uring 没有对应的操作, 总是使用 epoll 等待可写
+ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count) {
+    return do_io(out_fd, sendfile_f, "sendfile", flexy::WRITE, SO_SNDTIMEO,
+        nullptr, in_fd, offset, count);
 }
 
 int close(int fd) {
@@ -346,9 +546,11 @@ int close(int fd) {
         auto iom = flexy::IOManager::GetThis();
         if (iom) {
             iom->cancelAll(fd);
+            iom->cancelIO(fd);
         }
         flexy::FdMsg::GetInstance().del(fd);
     }
+    flexy::count_syscall();
     return close_f(fd);
 }
 
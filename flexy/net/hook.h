@@ -9,9 +9,20 @@
 #include <sys/ioctl.h>
 
 
+#include <cstdint>
+
 namespace flexy {
     bool is_hook_enable();
     void set_hook_enable(bool flag);
+#ifdef FLEXY_SYSCALL_STATS
+    // 记录一次系统调用 (hook 层和 IOManager 内部使用)
+    void count_syscall();
+#else
+    // 未开启 FLEXY_SYSCALL_STATS 时不计数, 热路径上没有额外开销
+    inline void count_syscall() {}
+#endif
+    // 所有线程累计的系统调用次数, 用于压测统计; 未开启 FLEXY_SYSCALL_STATS 时恒为 0
+    uint64_t syscall_count();
 } // namespace flexy
 
 extern "C" {
@@ -70,6 +81,9 @@ extern sendto_fun sendto_f;
 typedef ssize_t (*sendmsg_fun)(int sockfd, const struct msghdr* msg, int flags);
 extern sendmsg_fun sendmsg_f;
 
+typedef ssize_t (*sendfile_fun)(int out_fd, int in_fd, off_t* offset, size_t count);
+extern sendfile_fun sendfile_f;
+
 // socket op
 typedef int(*close_fun)(int fd);
 extern close_fun close_f;
@@ -6,6 +6,7 @@
 
 #include <string>
 #include <netinet/tcp.h>
+#include <sys/sendfile.h>
 
 namespace flexy {
 
@@ -119,6 +120,46 @@ Socket::ptr Socket::accept() {
     return nullptr;
 }
 
+Socket::ptr Socket::tryAccept() {
+    auto ctx = FdMsg::GetInstance().get(sock_);
+    if (!ctx || !ctx->getSysNonblock()) {      // 阻塞的 socket 会挂起线程
+        return nullptr;
+    }
+    count_syscall();
+    int newsock = ::accept4(sock_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (newsock == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            FLEXY_LOG_ERROR(g_logger) << "accept4(" << sock_ << ") errno = " << errno
+            << " errstr = " << strerror(errno);
+        }
+        return nullptr;
+    }
+    FdMsg::GetInstance().get(newsock, true);
+    auto sock = std::make_shared<Socket>(family_, type_, protocol_);
+    if (sock->init(newsock)) {
+        return sock;
+    }
+    ::close(newsock);
+    return nullptr;
+}
+
+bool Socket::setReusePort(int incoming_cpu) {
+    if (sock_ == -1) {
+        newSock();
+        if (FLEXY_UNLIKELY(sock_ == -1)) {
+            return false;
+        }
+    }
+    int val = 1;
+    if (!setOption(SOL_SOCKET, SO_REUSEPORT, val)) {
+        return false;
+    }
+    if (incoming_cpu >= 0) {
+        setOption(SOL_SOCKET, SO_INCOMING_CPU, incoming_cpu);
+    }
+    return true;
+}
+
 bool Socket::bind(const Address::ptr& addr) {
     if (sock_ == -1) {
         newSock();
@@ -238,6 +279,13 @@ ssize_t Socket::send(const iovec* buffer, size_t length, int flags) {
     return -1;
 }
 
+ssize_t Socket::sendFile(int fd, off_t* offset, size_t length) {
+    if (isConnected_) {
+        return ::sendfile(sock_, fd, offset, length);
+    }
+    return -1;
+}
+
 ssize_t Socket::sendTo(const void* buffer, size_t length,
                        const Address::ptr& to, int flags) {
     if (isConnected_) {
@@ -56,6 +56,12 @@ public:
     }
 
     Socket::ptr accept();
+    // 非阻塞地接受一个连接 (accept4), 没有待接受的连接时返回 nullptr, 不挂起协程
+    // 只对 hook 管理的非阻塞监听 socket 有效
+    Socket::ptr tryAccept();
+    // 设置 SO_REUSEPORT, 需在 bind 之前调用
+    // incoming_cpu >= 0 时同时设置 SO_INCOMING_CPU, 让内核优先把该 cpu 上收到的连接分给此 socket
+    bool setReusePort(int incoming_cpu = -1);
 
     bool bind(const Address::ptr& addr);
     bool connect(const Address::ptr& addr, uint64_t timeout_ms = -1);
@@ -66,6 +72,8 @@ public:
     ssize_t send(const void* buffer, size_t length, int flags = 0);
     ssize_t send(std::string_view s, int flags = 0);
     ssize_t send(const iovec* buffer, size_t length, int flags = 0);
+    // 用 sendfile 发送文件 fd 从 offset 开始的 length 字节, 成功时 offset 前移
+    ssize_t sendFile(int fd, off_t* offset, size_t length);
     ssize_t sendTo(const void* buffer, size_t length, const Address::ptr& to,
                    int flags = 0);
     ssize_t sendTo(std::string_view s, const Address::ptr& to, int flags = 0);
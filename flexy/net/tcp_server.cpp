@@ -2,6 +2,8 @@
 #include "flexy/util/log.h"
 #include "flexy/util/config.h"
 
+#include <unistd.h>
+
 namespace flexy {
 
 static auto g_logger = FLEXY_LOG_NAME("system");
@@ -9,6 +11,12 @@ static auto g_logger = FLEXY_LOG_NAME("system");
 static auto g_tcp_server_read_timeout = Config::Lookup("tcp_server.read_timeout", 
     (uint64_t)(60 * 1000 * 2), "tcp server read timeout");
 
+static auto g_tcp_server_accept_batch = Config::Lookup("tcp_server.accept_batch", 
+    16u, "max connections accepted at once by a reactor");
+
+static auto g_tcp_server_incoming_cpu = Config::Lookup("tcp_server.incoming_cpu", 
+    0, "set SO_INCOMING_CPU on reactor listeners, 0: off, 1: reactor i -> cpu i % nprocs");
+
 [[deprecated]]
 static void handleClientCb(const TcpServer::ptr& self, const Socket::ptr& client) {
     FLEXY_LOG_INFO(g_logger) << *client;
@@ -39,23 +47,41 @@ bool TcpServer::bind(const Address::ptr& addr) {
 }
 
 bool TcpServer::bind(const std::vector<Address::ptr>& addrs, std::vector<Address::ptr>& fails) {
+    // 多 reactor 模式下每个地址为每个 reactor 各绑定一个 socket
+    size_t count = reactors_.empty() ? 1 : reactors_.size();
+    long nprocs = sysconf(_SC_NPROCESSORS_ONLN);
     for (auto& addr : addrs) {
-        auto sock = Socket::CreateTCP(addr->getFamily());
-        if (!sock->bind(addr)) {
-            FLEXY_LOG_ERROR(g_logger) << "bind fail errno = " << errno
-            << " errstr = " << strerror(errno) << " addr = [" << *addr
-            << "]";
-            fails.push_back(addr);
-            continue;
-        }
-        if (!sock->listen()) {
-            FLEXY_LOG_ERROR(g_logger) << "listen fail errno = " << errno
-            << "errstr = " << strerror(errno) << " addr = [" << *addr 
-            << "]";
-            fails.push_back(addr);
-            continue; 
+        // 端口为 0 时由第一个 socket 决定端口, 其余 socket 绑定到同一个端口
+        auto bind_addr = addr;
+        for (size_t i = 0; i < count; ++i) {
+            auto sock = Socket::CreateTCP(addr->getFamily());
+            if (!reactors_.empty()) {
+                int cpu = g_tcp_server_incoming_cpu->getValue() ? i % nprocs : -1;
+                if (!sock->setReusePort(cpu)) {
+                    FLEXY_LOG_ERROR(g_logger) << "set SO_REUSEPORT fail errno = " << errno
+                    << " errstr = " << strerror(errno) << " addr = [" << *addr
+                    << "]";
+                    fails.push_back(addr);
+                    break;
+                }
+            }
+            if (!sock->bind(bind_addr)) {
+                FLEXY_LOG_ERROR(g_logger) << "bind fail errno = " << errno
+                << " errstr = " << strerror(errno) << " addr = [" << *addr
+                << "]";
+                fails.push_back(addr);
+                break;
+            }
+            bind_addr = sock->getLocalAddress();
+            if (!sock->listen()) {
+                FLEXY_LOG_ERROR(g_logger) << "listen fail errno = " << errno
+                << "errstr = " << strerror(errno) << " addr = [" << *addr 
+                << "]";
+                fails.push_back(addr);
+                break; 
+            }
+            socks_.push_back(sock);
         }
-        socks_.push_back(sock);
     }
     if (!fails.empty()) {
         socks_.clear();
@@ -81,19 +107,56 @@ void TcpServer::startAccept(const Socket::ptr& sock) {
     }
 }
 
+void TcpServer::startReactorAccept(const Socket::ptr& sock) {
+    auto reactor = IOManager::GetThis();
+    while (!isStop_) {
+        // 挂起直到有连接, 之后不再挂起, 把已经排队的连接一次取完
+        auto client = sock->accept();
+        if (!client) {
+            if (!isStop_) {
+                FLEXY_LOG_ERROR(g_logger) << "accept errno = " << errno << "," 
+                << " errstr = " << strerror(errno);
+            }
+            continue;
+        }
+        uint32_t batch = g_tcp_server_accept_batch->getValue();
+        for (uint32_t i = 0; client && i < batch; ++i) {
+            client->setRecvTimeout(recvTimeout_);
+            reactor->async(&TcpServer::handleClient, shared_from_this(), client);
+            client = i + 1 < batch ? sock->tryAccept() : nullptr;
+        }
+    }
+}
+
 bool TcpServer::start() {
     if(!isStop_) {
         return true;
     }
     isStop_ = false;
-    for (auto& sock : socks_) {
-        ioWorker_->async(&TcpServer::startAccept, shared_from_this(), sock);
+    for (size_t i = 0; i < socks_.size(); ++i) {
+        if (reactors_.empty()) {
+            ioWorker_->async(&TcpServer::startAccept, shared_from_this(), socks_[i]);
+        } else {
+            reactors_[i % reactors_.size()]->async(&TcpServer::startReactorAccept,
+                shared_from_this(), socks_[i]);
+        }
     }
     return true;
 }
 
 void TcpServer::stop() {
     isStop_ = true;
+    if (!reactors_.empty()) {
+        // 监听 socket 上的事件注册在各自的 reactor 中, 需在对应的 reactor 中取消
+        for (size_t i = 0; i < socks_.size(); ++i) {
+            reactors_[i % reactors_.size()]->async([](const Socket::ptr& sock) {
+                sock->cancelAll();
+                sock->close();
+            }, socks_[i]);
+        }
+        socks_.clear();
+        return;
+    }
     acceptWorker_->async([](const TcpServer::ptr& slef){
         for (auto& sock : slef->socks_) {
             sock->cancelAll();
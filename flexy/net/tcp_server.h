@@ -31,6 +31,11 @@ public:
     void setName(std::string_view name) { name_ = name; }
     IOManager* getWorker() const { return worker_; }
     bool isStop() const { return isStop_; }
+    // 多 reactor 模式, 需在 bind 之前设置
+    // 每个 reactor (一般为单线程的 IOManager) 绑定各自的 SO_REUSEPORT 监听 socket,
+    // 由内核分发连接, 在本 reactor 内 accept 并处理, 连接不跨线程
+    void setReactors(const std::vector<IOManager*>& reactors) { reactors_ = reactors; }
+    auto& getReactors() const { return reactors_; }
 
     [[deprecated]]
     void onHandleClient(TcpCallBack&& cb) { handleClient_ = std::move(cb); }
@@ -39,8 +44,11 @@ public:
 protected:
     virtual void handleClient(const Socket::ptr& client); 
     void startAccept(const Socket::ptr& sock);
+    // 多 reactor 模式的 accept 循环, 连接在当前 reactor 中处理
+    void startReactorAccept(const Socket::ptr& sock);
 protected:
     std::vector<Socket::ptr> socks_;
+    std::vector<IOManager*> reactors_;      // 多 reactor 模式下 socks_[i] 由 reactors_[i % size] 处理
     IOManager* worker_;
     IOManager* ioWorker_;
     IOManager* acceptWorker_;
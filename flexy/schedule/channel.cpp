@@ -1,4 +1,5 @@
 #include "channel.h"
+#include "flexy/net/hook.h"
 #include "flexy/util/macro.h"
 
 #include <sys/epoll.h>
@@ -113,6 +114,7 @@ bool Channel::enableEvents(Event events, bool enable) {
         epoll_event ev;
         ev.events = EPOLLET | events_ | events;
         ev.data.ptr = this;
+        count_syscall();
         int rt = epoll_ctl(epfd_, op, fd_, &ev);
         if (rt) {
             FLEXY_LOG_FMT_ERROR(g_logger, "epoll_ctl({}, {}, {}) : {} ({}) ({})", 
@@ -128,6 +130,7 @@ bool Channel::enableEvents(Event events, bool enable) {
         epoll_event ev;
         ev.events = EPOLLET | new_events;
         ev.data.ptr = this;
+        count_syscall();
         int rt = epoll_ctl(epfd_, op, fd_, &ev);
         if (rt) {
             FLEXY_LOG_FMT_ERROR(g_logger, "epoll_ctl({}, {}, {}) : {} ({}) ({})", 
@@ -1,47 +1,70 @@
 #include "iomanager.h"
+#include "uring.h"
+#include "flexy/net/hook.h"
 #include "flexy/util/macro.h"
 #include "flexy/util/config.h"
 
 #include <sys/epoll.h>
-#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <algorithm>
 
 namespace flexy {
 
 static auto g_logger = FLEXY_LOG_NAME("system");
-static auto g_channel_init_size = Config::Lookup("channel.init.size", 64, "channel vector init size");
-static auto g_channel_resize_times = Config::Lookup("channel.resize.times", 2.0f, "channel vector resize times");
+static auto g_channel_init_size = Config::Lookup("channel.init.size", 64, "channel table init size");
+static auto g_iomanager_io_uring = Config::Lookup("iomanager.io_uring", 0,
+    "submit hooked socket io through io_uring, 0: epoll, 1: io_uring (fall back to epoll if unsupported)");
+static auto g_iomanager_io_uring_entries = Config::Lookup("iomanager.io_uring.entries", 4096u,
+    "io_uring submission queue entries");
+
+// 一个等待完成的 io_uring 请求, 位于发起请求的协程栈上
+struct UringRequest {
+    Scheduler* scheduler = nullptr;             // 唤醒协程的调度器
+    Fiber::ptr fiber;                           // 等待的协程
+    int res = 0;                                // 完成结果
+    std::atomic<int> pending{1};                // 未收到的完成事件数, 链接超时请求时为 2
+    bool timedout = false;                      // 链接的超时请求已触发
+};
 
 IOManager::IOManager(size_t threads, bool use_caller, std::string_view name) 
             : Scheduler(threads, use_caller, name) {
     epfd_ = epoll_create(5);
     FLEXY_ASSERT(epfd_ > 0);
 
-    int rt = pipe(tickleFds_);
-    FLEXY_ASSERT(!rt);
-    
-    // epoll_event ev;
-    // memset(&ev, 0, sizeof(ev));
-    // ev.events = EPOLLET | EPOLLIN;
-    // ev.data.fd = tickleFds_[0];
-
-    rt = fcntl(tickleFds_[0], F_SETFL, O_NONBLOCK);
-    FLEXY_ASSERT(!rt);
+    tickleFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    FLEXY_ASSERT(tickleFd_ >= 0);
 
-    // rt = epoll_ctl(epfd_, EPOLL_CTL_ADD, tickleFds_[0], &ev);
-    // FLEXY_ASSERT(!rt);
+    // 目录按进程可打开的最大 fd 数量分配, 至少覆盖 2^20, 最多 2^24
+    rlimit limit;
+    rlim_t max_fds = 1 << 20;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_max > max_fds) {
+        max_fds = std::min<rlim_t>(limit.rlim_max, 1 << 24);
+    }
+    channelPageCount_ = (max_fds + kChannelPageSize - 1) / kChannelPageSize;
+    channelPages_.reset(new std::atomic<Channel**>[channelPageCount_]);
+    for (size_t i = 0; i < channelPageCount_; ++i) {
+        channelPages_[i] = nullptr;
+    }
+    for (int fd = 0; fd < g_channel_init_size->getValue(); fd += kChannelPageSize) {
+        getChannel(fd, true);
+    }
 
-    channelResize(g_channel_init_size->getValue() * 1);
+    getChannel(tickleFd_, true)->enableRead();
 
-    channels_[tickleFds_[0]]->enableRead();
+    if (g_iomanager_io_uring->getValue()) {
+        uring_ = std::make_unique<IOUring>(g_iomanager_io_uring_entries->getValue());
+        // 关闭 fd 时依赖按 fd 取消全部请求来唤醒等待的协程, 内核不支持时不能使用 io_uring
+        if (uring_->isValid() && uring_->probeCancelFd()) {
+            getChannel(uring_->eventFd(), true)->enableRead();
+        } else {
+            FLEXY_LOG_WARN(g_logger) << "io_uring not supported, fall back to epoll";
+            uring_.reset();
+        }
+    }
 
     idle_ = [this]() { idleFiber(); };
-    tickle_ = [this]() {
-        if (!hasIdleThreads()) {
-            return;
-        }
-        int rt = write(tickleFds_[1], "", 1);
-        FLEXY_ASSERT(rt == 1);
-    };
+    tickle_ = [this]() { wakeup(); };
     refreshNearest_ = [this]() { tickle_(); };
 
     start();
@@ -50,23 +73,26 @@ IOManager::IOManager(size_t threads, bool use_caller, std::string_view name)
 IOManager::~IOManager() {
     stop();
     close(epfd_);
-    close(tickleFds_[0]);
-    close(tickleFds_[1]);
+    close(tickleFd_);
+    uring_.reset();
 
-    for (size_t i = 0; i < channels_.size(); ++i) {
-        delete channels_[i];
+    for (size_t i = 0; i < channelPageCount_; ++i) {
+        Channel** page = channelPages_[i];
+        if (!page) {
+            continue;
+        }
+        for (size_t j = 0; j < kChannelPageSize; ++j) {
+            delete page[j];
+        }
+        delete[] page;
     }
 }
 
 
 bool IOManager::delEvent(int fd, Event event) {
-    Channel* ch = nullptr;
-    {
-        LOCK_GUARD(mutex_);
-        if ((int)channels_.size() <= fd) {
-            return false;
-        }
-        ch = channels_[fd];
+    Channel* ch = getChannel(fd, false);
+    if (!ch) {
+        return false;
     }
 
     LOCK_GUARD(ch->mutex_);
@@ -88,13 +114,9 @@ bool IOManager::delEvent(int fd, Event event) {
 }
 
 bool IOManager::cancelEvent(int fd, Event event) {
-    Channel* ch = nullptr;
-    {
-        LOCK_GUARD(mutex_);
-        if ((int)channels_.size() <= fd) {
-            return false;
-        }
-        ch = channels_[fd];
+    Channel* ch = getChannel(fd, false);
+    if (!ch) {
+        return false;
     }
 
     LOCK_GUARD(ch->mutex_);
@@ -111,13 +133,9 @@ bool IOManager::cancelEvent(int fd, Event event) {
 }
 
 bool IOManager::cancelAll(int fd) {
-    Channel* ch = nullptr;
-    {
-        LOCK_GUARD(mutex_);
-        if ((int)channels_.size() <= fd) {
-            return false;
-        }
-        ch = channels_[fd];
+    Channel* ch = getChannel(fd, false);
+    if (!ch) {
+        return false;
     }
 
     LOCK_GUARD(ch->mutex_);
@@ -150,13 +168,10 @@ bool IOManager::cancelAll(int fd) {
 }
 
 bool IOManager::onEvent(int fd, Event event, detail::__task&& cb) {
-    Channel* ch = nullptr;
-    {
-        LOCK_GUARD(mutex_);
-        if ((int)channels_.size() <= fd) {
-            channelResize(g_channel_resize_times->getValue() * fd);
-        }
-        ch = channels_[fd];
+    Channel* ch = getChannel(fd, true);
+    if (FLEXY_UNLIKELY(!ch)) {
+        FLEXY_LOG_ERROR(g_logger) << "onEvent fd = " << fd << " out of channel table";
+        return false;
     }
 
     LOCK_GUARD(ch->mutex_);
@@ -188,25 +203,145 @@ bool IOManager::onEvent(int fd, Event event, detail::__task&& cb) {
     return true;
 }
 
+bool IOManager::submitIO(io_uring_sqe& sqe, uint64_t timeout, int& res) {
+    FLEXY_ASSERT(uring_);
+    UringRequest req;
+    req.scheduler = this;
+    req.fiber = Fiber::GetThis();
+
+    io_uring_sqe sqes[2];
+    unsigned n = 1;
+    sqe.user_data = (uint64_t)&req;
+    __kernel_timespec ts;
+    if (timeout != ~0ull) {
+        // 链接一个超时请求, 超时后内核取消前一个请求
+        sqe.flags |= IOSQE_IO_LINK;
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = timeout % 1000 * 1000000;
+        memset(&sqes[1], 0, sizeof(io_uring_sqe));
+        sqes[1].opcode = IORING_OP_LINK_TIMEOUT;
+        sqes[1].fd = -1;
+        sqes[1].addr = (uint64_t)&ts;
+        sqes[1].len = 1;
+        // 低位标记超时请求, 完成时记录在 req 上, 不必事后通过 fd 判断取消原因
+        sqes[1].user_data = (uint64_t)&req | 1;
+        n = 2;
+    }
+    sqes[0] = sqe;
+    // 两个完成事件都收到后才唤醒协程, 之后 req 不再被访问
+    req.pending.store(n, std::memory_order_relaxed);
+
+    ++pendingEventCount_;
+    count_syscall();
+    int rt = uring_->submit(sqes, n);
+    if (rt <= 0) {
+        --pendingEventCount_;
+        FLEXY_LOG_ERROR(g_logger) << "io_uring submit opcode = " << (int)sqe.opcode
+            << " fd = " << sqe.fd << " rt = " << rt;
+        return false;
+    }
+    if (FLEXY_UNLIKELY(rt < (int)n) &&
+        req.pending.fetch_sub(n - rt, std::memory_order_acq_rel) == (int)n - rt) {
+        // 超时请求未被接收, 请求已经完成, 不会再被唤醒
+        --pendingEventCount_;
+        res = req.res;
+        return true;
+    }
+    // 请求可能在提交时就已完成, 直接处理, 不必等 epoll 通知
+    reapIO();
+    Fiber::Yield();
+    res = req.res == -ECANCELED && req.timedout ? -ETIMEDOUT : req.res;
+    return true;
+}
+
+void IOManager::cancelIO(int fd) {
+    if (!uring_) {
+        return;
+    }
+    io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_ASYNC_CANCEL;
+    sqe.fd = fd;
+    sqe.cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe.user_data = 0;
+    count_syscall();
+    int rt = uring_->submit(&sqe, 1);
+    if (rt <= 0) {
+        FLEXY_LOG_ERROR(g_logger) << "io_uring cancel fd = " << fd << " rt = " << rt;
+    }
+}
+
+void IOManager::reapIO() {
+    uring_->reap([this](uint64_t user_data, int res) {
+        if (!user_data) {           // cancelIO 的完成事件
+            return;
+        }
+        auto req = (UringRequest*)(user_data & ~1ull);
+        if (user_data & 1) {        // 链接的超时请求, -ETIME 表示超时已触发
+            req->timedout = res == -ETIME;
+        } else {
+            req->res = res;
+        }
+        if (req->pending.fetch_sub(1, std::memory_order_acq_rel) > 1) {
+            return;
+        }
+        // 协程被唤醒后请求对象随即失效, 先取出需要的成员
+        auto scheduler = req->scheduler;
+        auto fiber = std::move(req->fiber);
+        scheduler->async(std::move(fiber));
+        --pendingEventCount_;
+    });
+}
+
 IOManager* IOManager::GetThis() {
     return dynamic_cast<IOManager*>(Scheduler::GetThis());
 }
 
-void IOManager::channelResize(size_t size) {
-    channels_.resize(size);
-    for (size_t i = 0; i < channels_.size(); ++i) {
-        if (!channels_[i]) {
-            channels_[i] = new Channel(epfd_, i);
+Channel* IOManager::getChannel(int fd, bool auto_create) {
+    size_t index = (size_t)fd >> kChannelPageBits;
+    if (FLEXY_UNLIKELY(fd < 0 || index >= channelPageCount_)) {
+        return nullptr;
+    }
+    Channel** page = channelPages_[index].load(std::memory_order_acquire);
+    if (FLEXY_UNLIKELY(!page)) {
+        if (!auto_create) {
+            return nullptr;
+        }
+        LOCK_GUARD(mutex_);
+        page = channelPages_[index].load(std::memory_order_relaxed);
+        if (!page) {
+            page = new Channel*[kChannelPageSize];
+            int base = index << kChannelPageBits;
+            for (size_t i = 0; i < kChannelPageSize; ++i) {
+                page[i] = new Channel(epfd_, base + i);
+            }
+            channelPages_[index].store(page, std::memory_order_release);
         }
     }
+    return page[fd & (kChannelPageSize - 1)];
 }
 
-void IOManager::tickle() {
-    if (!hasIdleThreads()) {
+// 多个线程阻塞在同一个 epoll 上时, 一次 eventfd 事件只会唤醒其中一个线程
+// 被唤醒的线程处理完 eventfd 后才清除 tickled_, 期间的 tickle 都合并到这一次
+void IOManager::wakeup() {
+    if (sleepingThreadCount_ == 0) {
+        // 没有线程在 epoll_wait 中, 正在运行的线程进入 epoll_wait 前会检查任务
+        ++tickleSkipped_;
+        return;
+    }
+    if (tickled_.exchange(true)) {
+        ++tickleCoalesced_;
         return;
     }
-    int rt = write(tickleFds_[1], "", 1);
-    FLEXY_ASSERT(rt == 1);
+    ++tickleSent_;
+    count_syscall();
+    uint64_t one = 1;
+    int rt = write(tickleFd_, &one, sizeof(one));
+    FLEXY_ASSERT(rt == sizeof(one));
+}
+
+void IOManager::tickle() {
+    wakeup();
 }
 
 bool IOManager::stopping(uint64_t& timeout) {
@@ -224,12 +359,20 @@ void IOManager::idleFiber() {
     // epoll_event* evs = new 
     std::unique_ptr<epoll_event[]> events(new epoll_event[256]);
     while (true) {
+        // 先登记再检查任务和定时器, 与 wakeup() 中先入队再检查 sleepingThreadCount_ 配合,
+        // 保证新任务要么在这里被看到, 要么能唤醒本线程
+        ++sleepingThreadCount_;
         uint64_t next_timeout = 0;
         if (FLEXY_UNLIKELY(stopping(next_timeout))) {
+            --sleepingThreadCount_;
             FLEXY_LOG_FMT_INFO(g_logger, "IOManager name = {} idle stopping exit", Scheduler::getName());
+            // 每次只唤醒一个线程, 由退出的线程依次唤醒其余线程
+            wakeup();
             break;
         }
-
+        if (hasPendingTasks()) {
+            next_timeout = 0;
+        }
         int rt = 0;
         do {
             static const int MAX_TIMEOUT = 3000;
@@ -238,12 +381,14 @@ void IOManager::idleFiber() {
             } else {
                 next_timeout = MAX_TIMEOUT;
             }
+            count_syscall();
             rt = epoll_wait(epfd_, events.get(), 256, next_timeout);
             if (rt < 0 && errno == EINTR) {
             } else {
                 break;
             }
         } while(true);
+        --sleepingThreadCount_;
 
         auto cbs = listExpiriedTimer();
         if (!cbs.empty()) {
@@ -254,9 +399,20 @@ void IOManager::idleFiber() {
         for (int i = 0; i < rt; ++i) {
             epoll_event& ev = events[i];
             Channel* ch = (Channel*)ev.data.ptr;
-            if (ch->fd() == tickleFds_[0]) {
-                uint8_t dummy[256];
-                while (read(tickleFds_[0], &dummy, sizeof(dummy)) > 0);
+            if (ch->fd() == tickleFd_) {
+                uint64_t dummy;
+                count_syscall();
+                (void)!read(tickleFd_, &dummy, sizeof(dummy));
+                tickled_ = false;
+                continue;
+            }
+            if (uring_ && ch->fd() == uring_->eventFd()) {
+                uint64_t dummy;
+                count_syscall();
+                while (read(uring_->eventFd(), &dummy, sizeof(dummy)) > 0) {
+                    count_syscall();
+                }
+                reapIO();
                 continue;
             }
             LOCK_GUARD(ch->mutex_);
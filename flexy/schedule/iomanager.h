@@ -3,10 +3,20 @@
 #include "channel.h"
 #include "timer.h"
 
+struct io_uring_sqe;
+
 namespace flexy {
 
+class IOUring;
+
 class IOManager : public Scheduler, public TimerManager {
 public:
+    // tickle 统计
+    struct TickleStats {
+        uint64_t sent;          // 实际写 eventfd 的次数
+        uint64_t coalesced;     // 已有未处理的唤醒而合并的次数
+        uint64_t skipped;       // 没有线程阻塞在 epoll_wait 而省略的次数
+    };
     IOManager(size_t thread = 1, bool use_caller = true, std::string_view name = "");
     ~IOManager();
     // 添加事件及其回调函数
@@ -43,6 +53,19 @@ public:
         return onEvent(fd, Event::WRITE,
                        detail::__task(std::forward<Args>(args)...));
     }
+    // 是否使用 io_uring 提交读写请求
+    bool isUring() const { return uring_ != nullptr; }
+    // 提交一个 io_uring 请求并挂起当前协程直到完成, 只能在协程中调用
+    // timeout 为超时时间(ms), ~0ull 表示不超时, 超时后请求被取消, res 为 -ETIMEDOUT
+    // 被 cancelIO 取消时 res 为 -ECANCELED
+    // 提交失败返回 false, 成功时 res 为请求的返回值 (失败时为 -errno)
+    bool submitIO(io_uring_sqe& sqe, uint64_t timeout, int& res);
+    // 取消 fd 上所有未完成的 io_uring 请求
+    void cancelIO(int fd);
+    // 返回 tickle 统计
+    TickleStats getTickleStats() const {
+        return {tickleSent_, tickleCoalesced_, tickleSkipped_};
+    }
     // 返回当前的IOManager
     static IOManager* GetThis();
 protected:
@@ -53,14 +76,30 @@ protected:
     [[deprecated]] void onTimerInsertedAtFront() override;
     // 判断是否可以停止
     bool stopping(uint64_t& timeout);
-    // 对 Channel 集合容器扩容
-    void channelResize(size_t size);
+    // 返回 fd 对应的 Channel, 不加锁; auto_create 为 false 且所在页未分配时返回 nullptr
+    // fd 超出上限时返回 nullptr
+    Channel* getChannel(int fd, bool auto_create);
+    // 处理 io_uring 完成事件, 唤醒等待的协程
+    void reapIO();
+    // 唤醒一个阻塞在 epoll_wait 中的线程
+    void wakeup();
 private:
     int epfd_;                                                  // epoll文件描述符
-    int tickleFds_[2];                                          // 管道 用作tickle
+    int tickleFd_;                                              // eventfd 用作tickle
+    std::atomic<size_t> sleepingThreadCount_ = {0};             // 阻塞在 epoll_wait 中的线程数量
+    std::atomic<bool> tickled_ = {false};                       // 是否有已发出但未被处理的唤醒
+    std::atomic<uint64_t> tickleSent_ = {0};
+    std::atomic<uint64_t> tickleCoalesced_ = {0};
+    std::atomic<uint64_t> tickleSkipped_ = {0};
     std::atomic<size_t> pendingEventCount_ = {0};               // 当前等待执行的事件数量
-    mutable mutex mutex_;                                       //  锁 
-    std::vector<Channel*> channels_;                            // Channel集合
+    mutable mutex mutex_;                                       // 锁, 只在分配 Channel 页时使用
+    // fd -> Channel 的两级表, 每页 kChannelPageSize 个 Channel
+    // 页只增不减, 读取时不加锁, 直到析构才释放
+    static constexpr int kChannelPageBits = 10;
+    static constexpr size_t kChannelPageSize = 1 << kChannelPageBits;
+    size_t channelPageCount_;                                   // 页目录大小
+    std::unique_ptr<std::atomic<Channel**>[]> channelPages_;    // 页目录
+    std::unique_ptr<IOUring> uring_;                            // io_uring, 为空时只使用 epoll
 };
 
 } // namespace flexy
\ No newline at end of file
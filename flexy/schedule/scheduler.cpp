@@ -1,15 +1,88 @@
 #include "scheduler.h"
 #include "flexy/util/macro.h"
+#include "flexy/util/config.h"
 #include "flexy/net/hook.h"
 
+#include <thread>
+
 namespace flexy {
 
 static auto g_logger = FLEXY_LOG_NAME("system");
+static auto g_scheduler_work_stealing = Config::Lookup("scheduler.work_stealing", 0,
+    "scheduler work stealing mode, 0: global queue, 1: per-thread work stealing queue");
+static auto g_scheduler_local_queue_size = Config::Lookup("scheduler.local_queue.size", 256,
+    "scheduler per-thread work stealing queue init size");
+
 static thread_local Scheduler* t_scheduler = nullptr;  // 线程所属的协程调度器
+static thread_local void* t_local_queue = nullptr;     // 工作线程的本地任务队列
+static thread_local uint32_t t_schedule_tick = 0;      // 工作线程取任务的次数
+
+// 每取 kGlobalQueueInterval 次任务优先检查一次全局队列, 防止全局队列中的任务饿死
+static constexpr uint32_t kGlobalQueueInterval = 61;
+// 每个线程最多缓存的空闲任务节点数
+static constexpr size_t kMaxCachedTasks = 1024;
+// 取到仍在执行的协程时, 自旋 2^n 次的最大 n, 超过后让出 CPU
+static constexpr uint32_t kExecSpinShift = 6;
+
+namespace {
+
+// 线程私有的空闲任务节点缓存, 节点内的 Task 已经析构
+struct TaskCache {
+    ~TaskCache();
+    std::vector<void*> nodes;
+};
+
+}  // namespace
+
+// 线程退出时缓存已经析构, 之后直接释放节点
+static thread_local bool t_task_cache_destroyed = false;
+
+static TaskCache* GetTaskCache() {
+    if (FLEXY_UNLIKELY(t_task_cache_destroyed)) {
+        return nullptr;
+    }
+    static thread_local TaskCache s_cache;
+    return &s_cache;
+}
+
+TaskCache::~TaskCache() {
+    for (auto node : nodes) {
+        ::operator delete(node);
+    }
+    t_task_cache_destroyed = true;
+}
+
+static inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// 协程正在其他线程上切换出去, 很快就能恢复, 按连续遇到的次数退避
+static void BackoffExec(uint32_t count) {
+    if (count <= kExecSpinShift) {
+        for (uint32_t i = 0; i < (1u << count); ++i) {
+            CpuRelax();
+        }
+    } else {
+        std::this_thread::yield();
+    }
+}
 
 Scheduler::Scheduler(size_t threads, bool use_caller, std::string_view name) : name_(name) {
     FLEXY_ASSERT(threads > 0);
 
+    workStealing_ = g_scheduler_work_stealing->getValue() != 0;
+    if (workStealing_) {
+        queues_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            queues_.emplace_back(std::make_unique<TaskQueue>(
+                g_scheduler_local_queue_size->getValue()));
+        }
+    }
+
     if (use_caller) {
         Fiber::GetThis();
         --threads;
@@ -103,6 +176,13 @@ void Scheduler::run() {
     if (GetThreadId() != rootThreadId_) {                   // 非主线程
         Fiber::GetThis();
     }
+    TaskQueue* local = nullptr;
+    if (workStealing_) {
+        size_t index = nextQueue_++;
+        FLEXY_ASSERT(index < queues_.size());
+        local = queues_[index].get();
+        t_local_queue = local;
+    }
     auto idle_fiber(fiber_make_shared([this]() { idle_(); }));
     // auto idle_fiber(std::make_shared<Fiber>(std::bind(&Scheduler::idle, this)));
     Fiber::ptr cb_fiber;
@@ -111,8 +191,11 @@ void Scheduler::run() {
     while (true) {
         // tk.reset();
         bool tickle_me = false;
-        // get task from deque
-        {
+        if (local) {
+            // 本地队列还有任务, 唤醒空闲线程来窃取
+            tickle_me = takeTask(local, tk) && !local->empty();
+        } else {
+            // get task from deque
             LOCK_GUARD(mutex_);
             if (!tasks_.empty()) {
                 tk = std::move(tasks_.front());
@@ -160,10 +243,129 @@ void Scheduler::run() {
             --idleThreadCount_;
         }
     }
+    t_local_queue = nullptr;
+}
+
+void* Scheduler::AllocTask() {
+    auto cache = GetTaskCache();
+    if (cache && !cache->nodes.empty()) {
+        void* node = cache->nodes.back();
+        cache->nodes.pop_back();
+        return node;
+    }
+    return ::operator new(sizeof(Task));
+}
+
+void Scheduler::FreeTask(Task* task) {
+    task->~Task();
+    auto cache = GetTaskCache();
+    if (cache && cache->nodes.size() < kMaxCachedTasks) {
+        cache->nodes.push_back(task);
+    } else {
+        ::operator delete(task);
+    }
+}
+
+Scheduler::TaskQueue* Scheduler::getLocalQueue() const {
+    return t_scheduler == this ? static_cast<TaskQueue*>(t_local_queue) : nullptr;
+}
+
+void Scheduler::pushLocal(TaskQueue* local, Task* task) {
+    bool need_tickle = local->empty();
+    ++localTaskCount_;                  // 先计数, 防止 stopping() 误判队列已空
+    local->push(task);
+    if (need_tickle) {
+        tickle_();
+    }
+}
+
+// 从队列头部取出一个任务(FIFO), 只在队列为空时失败
+template <typename T>
+static bool PopFront(WorkStealingQueue<T>* queue, T& item) {
+    while (!queue->empty()) {
+        if (queue->steal(item)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Scheduler::popGlobal(TaskQueue* local, Task& tk) {
+    LOCK_GUARD(mutex_);
+    while (!tasks_.empty()) {
+        tk = std::move(tasks_.front());
+        tasks_.pop_front();
+        if (!tk) {
+            continue;
+        }
+        if (tk.fiber && FLEXY_UNLIKELY(tk.fiber->getState() == Fiber::EXEC)) {
+            // 协程还未让出执行权, 放入本地队列稍后再试
+            ++localTaskCount_;
+            local->push(NewTask(std::move(tk)));
+            tk.reset();
+            return false;
+        }
+        ++activeThreadCount_;
+        return true;
+    }
+    return false;
+}
+
+bool Scheduler::takeTask(TaskQueue* local, Task& tk) {
+    uint32_t busy = 0;      // 连续取到仍在执行的协程的次数
+    while (true) {
+        if (++t_schedule_tick % kGlobalQueueInterval == 0 && popGlobal(local, tk)) {
+            return true;
+        }
+
+        Task* task = nullptr;
+        // 本地队列从头部取, 保证协程重新调度自己时不会饿死队列中的其他任务
+        bool found = PopFront(local, task);
+        if (!found) {
+            size_t n = queues_.size();
+            size_t start = t_schedule_tick % n;
+            for (size_t i = 0; i < n && !found; ++i) {
+                auto victim = queues_[(start + i) % n].get();
+                if (victim != local) {
+                    found = PopFront(victim, task);
+                }
+            }
+        }
+        if (!found) {
+            if (popGlobal(local, tk)) {
+                return true;
+            }
+            if (local->empty()) {
+                return false;
+            }
+            continue;
+        }
+
+        if (task->fiber &&
+            FLEXY_UNLIKELY(task->fiber->getState() == Fiber::EXEC)) {
+            // 放回队列先执行其他任务, 队列中只有它时退避, 避免反复取出空转
+            local->push(task);
+            if (local->size() == 1) {
+                BackoffExec(++busy);
+            }
+            continue;
+        }
+        ++activeThreadCount_;
+        --localTaskCount_;
+        tk = std::move(*task);
+        FreeTask(task);
+        return true;
+    }
 }
 
 Scheduler::~Scheduler() {
     FLEXY_ASSERT(stopping_);
+    for (auto& queue : queues_) {
+        Task* task = nullptr;
+        while (queue->pop(task)) {
+            FreeTask(task);
+        }
+    }
     if (GetThis() == this) {
         t_scheduler = nullptr;
     }
@@ -175,7 +377,13 @@ void Scheduler::tickle() {
 
 bool Scheduler::stopping() {
     LOCK_GUARD(mutex_);
-    return stopping_ && tasks_.empty() && activeThreadCount_ == 0;
+    return stopping_ && tasks_.empty() && localTaskCount_ == 0 &&
+           activeThreadCount_ == 0;
+}
+
+bool Scheduler::hasPendingTasks() const {
+    LOCK_GUARD(mutex_);
+    return !tasks_.empty() || localTaskCount_ > 0;
 }
 
 void Scheduler::idle() {
@@ -189,6 +397,7 @@ std::ostream& Scheduler::dump(std::ostream& os) {
     os << "[Scheduler name = " << name_ << " size = " << threadCount_
        << " active_count = " << activeThreadCount_
        << " idle_count = " << idleThreadCount_ << " stopping = " << stopping_
+       << " work_stealing = " << workStealing_
        << " ]" << std::endl
        << "    ";
     for (size_t i = 0; i < threadIds_.size(); ++i) {
@@ -3,9 +3,11 @@
 #include "flexy/fiber/fiber.h"
 #include "flexy/thread/mutex.h"
 #include "flexy/thread/thread.h"
+#include "work_stealing_queue.h"
 
 #include <string_view>
 #include <deque>
+#include <new>
 
 namespace flexy {
 
@@ -32,6 +34,10 @@ public:
               typename = std::enable_if_t<std::is_invocable_v<_Args&&...>>>
     void async(_Args&&... __args) {
         static_assert(sizeof...(__args) > 0);
+        if (auto local = getLocalQueue()) {
+            pushLocal(local, NewTask(std::forward<_Args>(__args)...));
+            return;
+        }
         bool need_tickle = false;
         {
             LOCK_GUARD(mutex_);
@@ -46,6 +52,10 @@ public:
     template <typename _Fiber,
               typename = std::enable_if_t<is_fiber_ptr_v<_Fiber>>>
     void async(_Fiber&& fiber) {
+        if (auto local = getLocalQueue()) {
+            pushLocal(local, NewTask(std::forward<_Fiber>(fiber)));
+            return;
+        }
         bool need_tickle = false;
         {
             LOCK_GUARD(mutex_);
@@ -73,6 +83,13 @@ public:
     // 将 [begin, end)里的任务加入到协程调度器中运行
     template <typename Iterator>
     void async(Iterator begin, Iterator end) {
+        if (auto local = getLocalQueue()) {
+            while (begin != end) {
+                pushLocal(local, NewTask(std::move(*begin)));
+                ++begin;
+            }
+            return;
+        }
         bool need_tikle = false;
         {
             LOCK_GUARD(mutex_);
@@ -99,6 +116,9 @@ public:
     template <typename... Args>
     void onTickle(Args&&... args) { tickle_ = __task(std::forward<Args>(args)...); }
 
+    // 是否为工作窃取模式
+    bool isWorkStealing() const { return workStealing_; }
+
     std::ostream& dump(std::ostream& os);
 
 private:
@@ -123,6 +143,23 @@ private:
         }
         operator bool() { return fiber != nullptr || cb; }
     };
+    // 工作线程的本地任务队列
+    using TaskQueue = WorkStealingQueue<Task*>;
+    // 本地队列的任务节点从线程私有的缓存中分配, 由取走任务的线程回收
+    template <typename... _Args>
+    static Task* NewTask(_Args&&... __args) {
+        return new (AllocTask()) Task(std::forward<_Args>(__args)...);
+    }
+    static void* AllocTask();
+    static void FreeTask(Task* task);
+    // 当前线程是本调度器的工作线程则返回其本地队列, 否则返回nullptr
+    TaskQueue* getLocalQueue() const;
+    // 将任务压入本地队列
+    void pushLocal(TaskQueue* local, Task* task);
+    // 从全局队列取任务
+    bool popGlobal(TaskQueue* local, Task& tk);
+    // 工作窃取模式下取任务: 本地队列 -> 其他线程的队列 -> 全局队列
+    bool takeTask(TaskQueue* local, Task& tk);
 
 protected:
     // 通知调度器有任务了
@@ -137,11 +174,17 @@ protected:
     void setThis();
     // 是否有空闲线程
     bool hasIdleThreads() const { return idleThreadCount_ > 0; }
+    // 是否有等待执行的任务
+    bool hasPendingTasks() const;
 private:    
     mutable mutex mutex_;                                                      // Mutex       
     std::vector<Thread::ptr> threads_;                                         // 线程池
     std::deque<Task> tasks_;  // 待执行的任务队列
     std::string name_;                                                         // 调度器名称        
+    bool workStealing_ = false;                                                // 是否为工作窃取模式
+    std::vector<std::unique_ptr<TaskQueue>> queues_;                           // 工作线程本地队列
+    std::atomic<size_t> nextQueue_ = {0};                                      // 下一个分配的本地队列
+    std::atomic<size_t> localTaskCount_ = {0};                                 // 本地队列中的任务数量
 protected:
     std::vector<int> threadIds_;                                               // 线程id数组
     size_t threadCount_                    = 0;                                // 线程数量
@@ -1,8 +1,13 @@
 #include "timer.h"
+#include "timer_wheel.h"
+#include "flexy/util/config.h"
 #include "flexy/util/util.h"
 
 namespace flexy {
 
+static auto g_timer_wheel = Config::Lookup("timer.wheel", 0,
+    "timer container, 0: std::set, 1: hierarchical timing wheel");
+
 bool Timer::Comparator::operator()(const Timer::ptr& lhs, const Timer::ptr& rhs) const {
     if (!lhs && !rhs) {
         return false;
@@ -21,8 +26,15 @@ bool Timer::Comparator::operator()(const Timer::ptr& lhs, const Timer::ptr& rhs)
 
 Timer::Timer(uint64_t ms, detail::__task&& cb, bool recurring,
              TimerManager* manager)
-    : recurring_(recurring), ms_(ms), cb_(std::move(cb)), manager_(manager) {
+    : recurring_(recurring), ms_(ms), manager_(manager) {
     next_ = GetTimeMs() + ms_;
+    if (recurring_) {
+        // 任务只能移动, 循环定时器每次到期时执行同一个回调
+        recurringCb_ = std::make_shared<detail::__task>(std::move(cb));
+        cb_ = [cb = recurringCb_]() { (*cb)(); };
+    } else {
+        cb_ = std::move(cb);
+    }
 }
 
 Timer::Timer(uint64_t next) : next_(next) { }
@@ -31,8 +43,8 @@ bool Timer::cancel() {
     LOCK_GUARD(manager_->mutex_);
     if (cb_) {
         cb_ = nullptr;
-        auto it = manager_->timers_.find(shared_from_this());
-        manager_->timers_.erase(it);
+        recurringCb_.reset();
+        manager_->eraseTimer(shared_from_this());
         return true;
     }
     return false;
@@ -43,13 +55,11 @@ bool Timer::refresh() {
     if (!cb_) {
         return false;
     }
-    auto it = manager_->timers_.find(shared_from_this());
-    if (it == manager_->timers_.end()) {
+    if (!manager_->eraseTimer(shared_from_this())) {
         return false;
     }
-    manager_->timers_.erase(it);
     next_ = GetTimeMs() + ms_;
-    manager_->timers_.insert(shared_from_this());
+    manager_->insertTimer(shared_from_this());
     return true;
 }
 
@@ -61,11 +71,9 @@ bool Timer::reset(uint64_t ms, bool from_now) {
     if (!cb_) {
         return false;
     }
-    auto it = manager_->timers_.find(shared_from_this());
-    if (it == manager_->timers_.end()) {
+    if (!manager_->eraseTimer(shared_from_this())) {
         return false;
     }
-    manager_->timers_.erase(it);
     uint64_t start = from_now ? GetTimeMs() : next_ - ms_;
     ms_ = ms;
     next_ = ms_ + start;
@@ -75,6 +83,31 @@ bool Timer::reset(uint64_t ms, bool from_now) {
 
 TimerManager::TimerManager() {
     previouseTime_ = GetTimeMs();
+    if (g_timer_wheel->getValue()) {
+        wheel_ = std::make_unique<TimerWheel>(previouseTime_);
+    }
+}
+
+TimerManager::~TimerManager() {}
+
+bool TimerManager::insertTimer(const Timer::ptr& timer) {
+    if (wheel_) {
+        wheel_->insert(timer);
+        return timer->next_ < nextWakeup_;
+    }
+    return timers_.insert(timer).first == timers_.begin();
+}
+
+bool TimerManager::eraseTimer(const Timer::ptr& timer) {
+    if (wheel_) {
+        return wheel_->erase(timer.get()) != nullptr;
+    }
+    auto it = timers_.find(timer);
+    if (it == timers_.end()) {
+        return false;
+    }
+    timers_.erase(it);
+    return true;
 }
 
 void TimerManager::addTimer(Timer::ptr& val, unique_lock<mutex>& lock) {
@@ -82,8 +115,7 @@ void TimerManager::addTimer(Timer::ptr& val, unique_lock<mutex>& lock) {
 }
 
 void TimerManager::addTimer(Timer::ptr&& val, unique_lock<mutex>& lock) {
-    auto it = timers_.insert(val).first;
-    bool at_front = (it == timers_.begin() && !tickled_);           // 防止调用getNextTimer前多次调用onTimerInsetedAtFront
+    bool at_front = (insertTimer(val) && !tickled_);           // 防止调用getNextTimer前多次调用onTimerInsetedAtFront
     if (at_front) {
         tickled_ = true;
     }
@@ -113,21 +145,28 @@ bool TimerManager::detectClockRollover(uint64_t now_ms) {
 
 bool TimerManager::hasTimer() const {
     LOCK_GUARD(mutex_);
-    return !timers_.empty();
+    return wheel_ ? !wheel_->empty() : !timers_.empty();
 }
 
 uint64_t TimerManager::getNextTimer() {
     LOCK_GUARD(mutex_);
     tickled_ = false;
-    if (timers_.empty()) {
+    uint64_t next_ms = 0;
+    if (wheel_) {
+        next_ms = nextWakeup_ = wheel_->nextExpire();
+    } else if (!timers_.empty()) {
+        next_ms = (*timers_.begin())->next_;
+    } else {
+        next_ms = ~0ull;
+    }
+    if (next_ms == ~0ull) {
         return ~0ull;
     }
-    auto& next = *timers_.begin();
     uint64_t now_ms = GetTimeMs();
-    if (now_ms >= next->next_) {
+    if (now_ms >= next_ms) {
         return 0;
     } else {
-        return next->next_ - now_ms;
+        return next_ms - now_ms;
     }
 }
 
@@ -136,24 +175,37 @@ std::vector<detail::__task> TimerManager::listExpiriedTimer() {
     std::vector<Timer::ptr> expired;
     uint64_t now_ms = GetTimeMs();
     LOCK_GUARD(mutex_);
-    if (timers_.empty()) {
-        return cbs;
-    }
-    bool roller = detectClockRollover(now_ms);
-    if (!roller && ((*timers_.begin())->next_ > now_ms)) {
-        return cbs;
-    }
+    if (wheel_) {
+        if (wheel_->empty()) {
+            return cbs;
+        }
+        // 时间轮按槽批量取出到期定时器
+        if (detectClockRollover(now_ms)) {
+            wheel_->clear(now_ms, expired);
+        } else {
+            wheel_->advance(now_ms, expired);
+        }
+    } else {
+        if (timers_.empty()) {
+            return cbs;
+        }
+        bool roller = detectClockRollover(now_ms);
+        if (!roller && ((*timers_.begin())->next_ > now_ms)) {
+            return cbs;
+        }
 
-    Timer::ptr now_timer(new Timer(now_ms));
-    auto it = roller ? timers_.end() : timers_.upper_bound(now_timer);
-    expired.insert(expired.begin(), timers_.begin(), it);
-    timers_.erase(timers_.begin(), it);
+        Timer::ptr now_timer(new Timer(now_ms));
+        auto it = roller ? timers_.end() : timers_.upper_bound(now_timer);
+        expired.insert(expired.begin(), timers_.begin(), it);
+        timers_.erase(timers_.begin(), it);
+    }
 
+    cbs.reserve(expired.size());
     for (auto& timer : expired) {
         if (timer->recurring_) {
-            cbs.push_back(timer->cb_);
+            cbs.emplace_back([cb = timer->recurringCb_]() { (*cb)(); });
             timer->next_ = timer->ms_ + now_ms;
-            timers_.insert(timer);
+            insertTimer(timer);
         } else {
             cbs.push_back(std::move(timer->cb_));
         }
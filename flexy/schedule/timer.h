@@ -6,8 +6,10 @@
 namespace flexy {
 
 class TimerManager;
+class TimerWheel;
 class Timer : public std::enable_shared_from_this<Timer> {
 friend class TimerManager;
+friend class TimerWheel;
 public:
     using ptr = std::shared_ptr<Timer>;
     // 取消定时器
@@ -25,7 +27,12 @@ private:
     uint64_t ms_;                                   // 执行周期
     uint64_t next_;                                 // 精确的执行时间
     detail::__task cb_;                             // 回调函数
+    std::shared_ptr<detail::__task> recurringCb_;   // 循环定时器的回调, 到期时共享给执行者
     TimerManager* manager_ = nullptr;               // 定时器所属定时器管理者
+    Timer* wheelPrev_ = nullptr;                    // 时间轮槽链表前驱
+    Timer* wheelNext_ = nullptr;                    // 时间轮槽链表后继
+    int32_t wheelSlot_ = -1;                        // 所在时间轮槽位, -1 表示不在时间轮中
+    Timer::ptr wheelSelf_;                          // 在时间轮中时持有自身的引用
 private:
     struct Comparator {
         bool operator()(const Timer::ptr& lhs, const Timer::ptr& rhs) const;
@@ -36,7 +43,7 @@ class TimerManager {
 friend class Timer;
 public:
     TimerManager();
-    virtual ~TimerManager() { }
+    virtual ~TimerManager();
     // 添加定时器
     template <typename... Args>
     Timer::ptr addTimer(uint64_t ms, Args&&... args) {
@@ -87,11 +94,18 @@ protected:
     void addTimer(Timer::ptr&& val, unique_lock<mutex>& lock);
     // 检测服务器时间是否被调后了
     bool detectClockRollover(uint64_t now_ms);
+private:
+    // 将定时器插入容器, 返回是否早于当前最近的唤醒时间
+    bool insertTimer(const Timer::ptr& timer);
+    // 将定时器从容器中删除, 返回定时器是否在容器中
+    bool eraseTimer(const Timer::ptr& timer);
 private:
     mutable mutex mutex_;                                       // 锁
     std::set<Timer::ptr, Timer::Comparator> timers_;            // 定时器集合
+    std::unique_ptr<TimerWheel> wheel_;                         // 时间轮, 非空时代替timers_
     bool tickled_ = false;                                      // 是否触发onTimerInsertedAtFront
     uint64_t previouseTime_;                                    // 上次执行时间
+    uint64_t nextWakeup_ = ~0ull;                               // 时间轮上次计算的唤醒时间
 protected:
     detail::__task
         refreshNearest_;  // 当有新的定时器插入到定时器的首部,执行该函数
@@ -0,0 +1,164 @@
+#include "timer_wheel.h"
+#include "flexy/util/macro.h"
+
+namespace flexy {
+
+TimerWheel::TimerWheel(uint64_t now_ms) : current_(now_ms) {}
+
+TimerWheel::~TimerWheel() {
+    // 断开定时器对自身的引用
+    std::vector<Timer::ptr> timers;
+    clear(current_, timers);
+}
+
+void TimerWheel::insert(const Timer::ptr& timer) {
+    FLEXY_ASSERT(timer->wheelSlot_ < 0);
+    timer->wheelSelf_ = timer;
+    ++size_;
+    // current_ 对应的槽已经处理过了
+    place(timer.get(), current_ + 1);
+}
+
+Timer::ptr TimerWheel::erase(Timer* timer) {
+    if (timer->wheelSlot_ < 0) {
+        return nullptr;
+    }
+    --size_;
+    return unlink(timer);
+}
+
+void TimerWheel::place(Timer* timer, uint64_t min_tick) {
+    uint64_t expire = timer->next_ < min_tick ? min_tick : timer->next_;
+    uint64_t delta = expire - current_;
+    int level = 0;
+    size_t slot = expire & (kRootSize - 1);
+    if (delta >= kRootSize) {
+        if (delta >= (1ull << LevelShift(kLevels))) {
+            expire = current_ + (1ull << LevelShift(kLevels)) - 1;
+            delta = expire - current_;
+        }
+        for (level = 1; delta >= (1ull << LevelShift(level + 1)); ++level)
+            ;
+        slot = LevelBase(level) +
+               ((expire >> LevelShift(level)) & (kLevelSize - 1));
+    }
+
+    timer->wheelSlot_ = slot;
+    timer->wheelPrev_ = nullptr;
+    timer->wheelNext_ = slots_[slot];
+    if (slots_[slot]) {
+        slots_[slot]->wheelPrev_ = timer;
+    }
+    slots_[slot] = timer;
+    ++levelCount_[level];
+}
+
+Timer::ptr TimerWheel::unlink(Timer* timer) {
+    size_t slot = timer->wheelSlot_;
+    if (timer->wheelPrev_) {
+        timer->wheelPrev_->wheelNext_ = timer->wheelNext_;
+    } else {
+        slots_[slot] = timer->wheelNext_;
+    }
+    if (timer->wheelNext_) {
+        timer->wheelNext_->wheelPrev_ = timer->wheelPrev_;
+    }
+    timer->wheelPrev_ = timer->wheelNext_ = nullptr;
+    timer->wheelSlot_ = -1;
+    --levelCount_[slot < kRootSize ? 0
+                                   : 1 + (slot - kRootSize) / kLevelSize];
+    return std::move(timer->wheelSelf_);
+}
+
+void TimerWheel::cascade(int level, size_t index) {
+    size_t slot = LevelBase(level) + index;
+    Timer* timer = slots_[slot];
+    slots_[slot] = nullptr;
+    while (timer) {
+        Timer* next = timer->wheelNext_;
+        --levelCount_[level];
+        // 恰好在 current_ 到期的定时器放回第 0 层, 本轮即可取出
+        place(timer, current_);
+        timer = next;
+    }
+}
+
+void TimerWheel::take(size_t slot, std::vector<Timer::ptr>& expired) {
+    while (slots_[slot]) {
+        --size_;
+        expired.push_back(unlink(slots_[slot]));
+    }
+}
+
+uint64_t TimerWheel::nextExpire() const {
+    if (size_ == 0) {
+        return ~0ull;
+    }
+    uint64_t next = ~0ull;
+    // 第 0 层中的定时器到期时间都在 (current_, current_ + kRootSize) 内
+    if (levelCount_[0]) {
+        for (size_t i = 1; i < kRootSize; ++i) {
+            if (slots_[(current_ + i) & (kRootSize - 1)]) {
+                next = current_ + i;
+                break;
+            }
+        }
+    }
+    // 高层的槽在级联时处理, 取最近一次需要级联的时间点
+    for (int level = 1; level < kLevels; ++level) {
+        if (!levelCount_[level]) {
+            continue;
+        }
+        int shift = LevelShift(level);
+        for (size_t i = 1; i <= kLevelSize; ++i) {
+            uint64_t tick = ((current_ >> shift) + i) << shift;
+            if (tick >= next) {
+                break;
+            }
+            if (slots_[LevelBase(level) + ((tick >> shift) & (kLevelSize - 1))]) {
+                next = tick;
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+void TimerWheel::advance(uint64_t now_ms, std::vector<Timer::ptr>& expired) {
+    while (current_ < now_ms) {
+        if (size_ == 0) {
+            current_ = now_ms;
+            break;
+        }
+        if (levelCount_[0] == 0) {
+            // 第 0 层为空, 直接跳到下一次级联前
+            uint64_t tick = current_ | (kRootSize - 1);
+            if (tick >= now_ms) {
+                current_ = now_ms;
+                break;
+            }
+            current_ = tick;
+        }
+        ++current_;
+        size_t index = current_ & (kRootSize - 1);
+        if (index == 0) {
+            for (int level = 1; level < kLevels; ++level) {
+                size_t i = (current_ >> LevelShift(level)) & (kLevelSize - 1);
+                cascade(level, i);
+                if (i != 0) {
+                    break;
+                }
+            }
+        }
+        take(index, expired);
+    }
+}
+
+void TimerWheel::clear(uint64_t now_ms, std::vector<Timer::ptr>& expired) {
+    for (size_t slot = 0; slot < kSlots; ++slot) {
+        take(slot, expired);
+    }
+    current_ = now_ms;
+}
+
+}  // namespace flexy
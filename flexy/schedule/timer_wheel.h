@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include "flexy/util/noncopyable.h"
+#include "timer.h"
+
+namespace flexy {
+
+// 分层时间轮, 精度 1ms
+// 第 0 层 256 个槽, 每槽 1ms; 第 1~4 层各 64 个槽, 每层槽跨度是上一层的总跨度
+// 共覆盖 2^32 ms (约 49 天), 更远的定时器先放在最高层, 级联时重新计算位置
+// 定时器以侵入式双向链表挂在槽上, 插入删除都是 O(1)
+// 非线程安全, 由 TimerManager 加锁保护
+class TimerWheel : noncopyable {
+public:
+    explicit TimerWheel(uint64_t now_ms);
+    ~TimerWheel();
+
+    // 插入定时器, 时间轮持有定时器的引用直到到期或被删除
+    void insert(const Timer::ptr& timer);
+    // 删除定时器, 返回时间轮持有的引用, 定时器不在时间轮中时返回 nullptr
+    Timer::ptr erase(Timer* timer);
+    // 是否没有定时器
+    bool empty() const { return size_ == 0; }
+    // 定时器数量
+    size_t size() const { return size_; }
+    // 下一次需要处理的时间点, 不会晚于最早的到期时间, 没有定时器返回 ~0ull
+    uint64_t nextExpire() const;
+    // 时间推进到 now_ms, 到期的定时器按到期时间顺序追加到 expired
+    void advance(uint64_t now_ms, std::vector<Timer::ptr>& expired);
+    // 取出所有定时器并把当前时间重置为 now_ms (时钟被调后时使用)
+    void clear(uint64_t now_ms, std::vector<Timer::ptr>& expired);
+private:
+    // 按到期时间计算槽位并挂上, 到期时间早于 min_tick 的按 min_tick 处理
+    void place(Timer* timer, uint64_t min_tick);
+    // 把第 level 层的第 index 个槽中的定时器重新放置到低层
+    void cascade(int level, size_t index);
+    // 取出槽中的所有定时器
+    void take(size_t slot, std::vector<Timer::ptr>& expired);
+    Timer::ptr unlink(Timer* timer);
+    // 第 level 层 (level >= 1) 的槽位下标偏移和时间位移
+    static size_t LevelBase(int level) {
+        return kRootSize + (level - 1) * kLevelSize;
+    }
+    static int LevelShift(int level) {
+        return kRootBits + (level - 1) * kLevelBits;
+    }
+private:
+    static constexpr int kLevels = 5;
+    static constexpr int kRootBits = 8;
+    static constexpr int kLevelBits = 6;
+    static constexpr size_t kRootSize = 1 << kRootBits;
+    static constexpr size_t kLevelSize = 1 << kLevelBits;
+    static constexpr size_t kSlots = kRootSize + (kLevels - 1) * kLevelSize;
+
+    Timer* slots_[kSlots] = {};        // 各槽链表头
+    size_t levelCount_[kLevels] = {};  // 各层定时器数量
+    size_t size_ = 0;                  // 定时器总数
+    uint64_t current_;                 // 已处理到的时间点
+};
+
+}  // namespace flexy
@@ -0,0 +1,168 @@
+#include "uring.h"
+#include <string.h>
+#include <algorithm>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "flexy/util/macro.h"
+
+namespace flexy {
+
+static auto g_logger = FLEXY_LOG_NAME("system");
+
+static int io_uring_setup(unsigned entries, io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                          unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                        flags, nullptr, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, const void* arg,
+                             unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+IOUring::IOUring(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = io_uring_setup(entries, &params);
+    if (fd < 0) {
+        FLEXY_LOG_WARN(g_logger) << "io_uring_setup entries = " << entries
+                                 << " errno = " << errno
+                                 << " errstr = " << strerror(errno);
+        return;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        sqRing_ = nullptr;
+    } else if (single_mmap) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            cqRing_ = nullptr;
+        }
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    sqes_ = sqes == MAP_FAILED ? nullptr : (io_uring_sqe*)sqes;
+    eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (!sqRing_ || !cqRing_ || !sqes_ || eventFd_ < 0 ||
+        io_uring_register(fd, IORING_REGISTER_EVENTFD, &eventFd_, 1) < 0) {
+        FLEXY_LOG_WARN(g_logger) << "io_uring init fail errno = " << errno
+                                 << " errstr = " << strerror(errno);
+        close(fd);
+        release();
+        return;
+    }
+    ringFd_ = fd;
+
+    char* sq = (char*)sqRing_;
+    sqHead_ = (unsigned*)(sq + params.sq_off.head);
+    sqTail_ = (unsigned*)(sq + params.sq_off.tail);
+    sqMask_ = *(unsigned*)(sq + params.sq_off.ring_mask);
+    sqEntries_ = *(unsigned*)(sq + params.sq_off.ring_entries);
+    sqArray_ = (unsigned*)(sq + params.sq_off.array);
+
+    char* cq = (char*)cqRing_;
+    cqHead_ = (unsigned*)(cq + params.cq_off.head);
+    cqTail_ = (unsigned*)(cq + params.cq_off.tail);
+    cqMask_ = *(unsigned*)(cq + params.cq_off.ring_mask);
+    cqes_ = (io_uring_cqe*)(cq + params.cq_off.cqes);
+}
+
+bool IOUring::probeCancelFd() {
+    // 对没有请求的 eventfd 发起取消, 支持时返回 -ENOENT, 不支持时返回 -EINVAL
+    io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_ASYNC_CANCEL;
+    sqe.fd = eventFd_;
+    sqe.cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe.user_data = 0;
+    if (submit(&sqe, 1) != 1) {
+        return false;
+    }
+    int rt = io_uring_enter(ringFd_, 0, 1, IORING_ENTER_GETEVENTS);
+    while (rt < 0 && errno == EINTR) {
+        rt = io_uring_enter(ringFd_, 0, 1, IORING_ENTER_GETEVENTS);
+    }
+    int res = -EINVAL;
+    reap([&res](uint64_t, int r) { res = r; });
+    // 探测请求的完成通知不需要交给 IOManager 处理
+    uint64_t dummy;
+    while (read(eventFd_, &dummy, sizeof(dummy)) > 0);
+    return rt >= 0 && res != -EINVAL;
+}
+
+IOUring::~IOUring() {
+    if (ringFd_ >= 0) {
+        close(ringFd_);
+        ringFd_ = -1;
+    }
+    release();
+}
+
+void IOUring::release() {
+    if (sqes_) {
+        munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ && cqRing_ != sqRing_) {
+        munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_) {
+        munmap(sqRing_, sqRingSize_);
+    }
+    if (eventFd_ >= 0) {
+        close(eventFd_);
+    }
+    sqes_ = nullptr;
+    sqRing_ = cqRing_ = nullptr;
+    eventFd_ = -1;
+}
+
+int IOUring::submit(const io_uring_sqe* sqes, unsigned n) {
+    LOCK_GUARD(sqMutex_);
+    unsigned tail = *sqTail_;
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    // 每次都立即提交, 内核在 io_uring_enter 返回前就消费了提交队列
+    if (FLEXY_UNLIKELY(sqEntries_ - (tail - head) < n)) {
+        return -EBUSY;
+    }
+    for (unsigned i = 0; i < n; ++i, ++tail) {
+        unsigned index = tail & sqMask_;
+        sqes_[index] = sqes[i];
+        sqArray_[index] = index;
+    }
+    __atomic_store_n(sqTail_, tail, __ATOMIC_RELEASE);
+
+    int rt = io_uring_enter(ringFd_, n, 0, 0);
+    while (rt < 0 && errno == EINTR) {
+        rt = io_uring_enter(ringFd_, n, 0, 0);
+    }
+    if (FLEXY_UNLIKELY(rt < 0)) {
+        rt = -errno;
+    }
+    if (FLEXY_UNLIKELY(rt < (int)n)) {
+        // 未被内核接收的请求撤回, 否则会在下一次提交时被误提交
+        __atomic_store_n(sqTail_, tail - (n - std::max(rt, 0)),
+                         __ATOMIC_RELEASE);
+    }
+    return rt;
+}
+
+}  // namespace flexy
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <atomic>
+#include <cstdint>
+#include "flexy/thread/mutex.h"
+#include "flexy/util/noncopyable.h"
+
+namespace flexy {
+
+// io_uring 的最小封装, 直接使用系统调用, 不依赖 liburing
+// 提交队列和完成队列各由一把锁保护, 可以被多个线程同时使用
+// 完成事件通过注册的 eventfd 通知, 由 IOManager 放到 epoll 中监听
+class IOUring : noncopyable {
+public:
+    // entries 为提交队列大小, 创建失败时 isValid() 返回 false
+    explicit IOUring(unsigned entries);
+    ~IOUring();
+
+    // 是否创建成功
+    bool isValid() const { return ringFd_ >= 0; }
+    // 完成事件通知用的 eventfd
+    int eventFd() const { return eventFd_; }
+    // 提交 n 个请求, 返回内核接收的请求数量, 失败返回 -errno
+    int submit(const io_uring_sqe* sqes, unsigned n);
+    // 内核是否支持按 fd 取消全部请求 (IORING_ASYNC_CANCEL_FD/ALL, Linux 5.19)
+    // 同步提交一个探测请求并等待结果, 只能在使用前调用
+    bool probeCancelFd();
+    // 取出所有完成事件, 对每个事件调用 cb(user_data, res), 返回事件数量
+    template <typename Callback>
+    size_t reap(Callback&& cb) {
+        LOCK_GUARD(cqMutex_);
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        size_t count = tail - head;
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cqMask_];
+            cb(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        return count;
+    }
+private:
+    // 解除映射并关闭 eventfd
+    void release();
+private:
+    int ringFd_ = -1;            // io_uring 文件描述符
+    int eventFd_ = -1;           // 完成事件通知
+    void* sqRing_ = nullptr;     // 提交队列映射
+    size_t sqRingSize_ = 0;      // 提交队列映射大小
+    void* cqRing_ = nullptr;     // 完成队列映射 (可能与提交队列相同)
+    size_t cqRingSize_ = 0;      // 完成队列映射大小
+    io_uring_sqe* sqes_ = nullptr;  // 提交队列项数组
+    size_t sqesSize_ = 0;        // 提交队列项数组大小
+
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned* sqArray_ = nullptr;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    mutex sqMutex_;              // 提交队列锁
+    mutex cqMutex_;              // 完成队列锁
+};
+
+}  // namespace flexy
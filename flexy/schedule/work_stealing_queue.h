@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "flexy/util/noncopyable.h"
+
+namespace flexy {
+
+// Chase-Lev 无锁工作窃取双端队列
+// (Lê, Pop, Cohen, Nardelli. "Correct and Efficient Work-Stealing for Weak
+// Memory Models", PPoPP 2013)
+// 只有所属线程可以调用 push / pop, 任意线程都可以调用 steal
+// 元素按值拷贝, 要求 T 可平凡拷贝 (一般存指针)
+template <typename T>
+class WorkStealingQueue : noncopyable {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "WorkStealingQueue element must be trivially copyable");
+
+    // 环形数组, 容量为 2 的幂
+    struct Array {
+        explicit Array(int64_t c)
+            : capacity(c), mask(c - 1), buffer(new std::atomic<T>[c]) {}
+
+        void put(int64_t i, T v) {
+            buffer[i & mask].store(v, std::memory_order_relaxed);
+        }
+        T get(int64_t i) const {
+            return buffer[i & mask].load(std::memory_order_relaxed);
+        }
+        Array* resize(int64_t bottom, int64_t top) const {
+            auto array = new Array(capacity * 2);
+            for (int64_t i = top; i != bottom; ++i) {
+                array->put(i, get(i));
+            }
+            return array;
+        }
+
+        int64_t capacity;
+        int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> buffer;
+    };
+
+public:
+    explicit WorkStealingQueue(int64_t capacity = 256)
+        : top_(0), bottom_(0), array_(new Array(RoundUp(capacity))) {}
+
+    ~WorkStealingQueue() {
+        for (auto array : garbage_) {
+            delete array;
+        }
+        delete array_.load(std::memory_order_relaxed);
+    }
+
+    // 队列是否为空 (并发时只是一个近似值)
+    bool empty() const { return size() == 0; }
+    // 队列元素数量 (并发时只是一个近似值)
+    size_t size() const {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+
+    // 从底部压入元素, 只能由所属线程调用
+    void push(T item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Array* a = array_.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) {
+            // 旧数组可能仍被窃取线程读取, 延迟到析构时释放
+            garbage_.push_back(a);
+            a = a->resize(b, t);
+            array_.store(a, std::memory_order_release);
+        }
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // 从底部弹出元素(LIFO), 只能由所属线程调用
+    bool pop(T& item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        bool res = false;
+        if (t <= b) {
+            item = a->get(b);
+            res = true;
+            if (t == b) {  // 最后一个元素, 与窃取线程竞争
+                if (!top_.compare_exchange_strong(t, t + 1,
+                                                  std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed)) {
+                    res = false;
+                }
+                bottom_.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return res;
+    }
+
+    // 从顶部窃取元素(FIFO), 任意线程都可调用
+    // 返回 false 表示队列为空或与其他线程竞争失败
+    bool steal(T& item) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+
+        if (t < b) {
+            Array* a = array_.load(std::memory_order_acquire);
+            T tmp = a->get(t);
+            if (!top_.compare_exchange_strong(t, t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                return false;
+            }
+            item = tmp;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    static int64_t RoundUp(int64_t capacity) {
+        int64_t c = 2;
+        while (c < capacity) {
+            c <<= 1;
+        }
+        return c;
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> top_;     // 窃取端
+    alignas(64) std::atomic<int64_t> bottom_;  // 所属线程端
+    alignas(64) std::atomic<Array*> array_;    // 当前环形数组
+    std::vector<Array*> garbage_;              // 扩容后废弃的数组
+};
+
+}  // namespace flexy
@@ -5,6 +5,7 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include "flexy/fiber/mutex.h"
 #include "flexy/net/socket.h"
 #include "flexy/schedule/iomanager.h"
 #include "flexy/schedule/semaphore.h"
@@ -126,9 +127,9 @@ protected:
 protected:
     fiber::Semaphore sem_;
     fiber::Semaphore waitSem_;
-    rw_mutex queueMutex_;
+    fiber::mutex queueMutex_;
     std::deque<SendCtx::ptr> queue_;
-    rw_mutex mutex_;
+    fiber::shared_mutex mutex_;
     std::unordered_map<uint32_t, Ctx::ptr> ctxs_;
 
     uint32_t sn_;
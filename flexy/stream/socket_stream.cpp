@@ -1,4 +1,5 @@
 #include "socket_stream.h"
+#include <limits.h>
 #include "flexy/util/log.h"
 
 namespace flexy {
@@ -63,6 +64,60 @@ ssize_t SockStream::write(const ByteArray::ptr& ba, size_t length) {
     return rt;
 }
 
+ssize_t SockStream::writevFixSize(iovec* iov, size_t iovcnt, int flags) {
+    if (!isConnected()) {
+        return -1;
+    }
+    size_t length = 0;
+    for (size_t i = 0; i < iovcnt; ++i) {
+        length += iov[i].iov_len;
+    }
+    size_t left = length;
+    while (left > 0) {
+        // sendmsg 一次最多接受 IOV_MAX 个 iovec, 超出的部分留到下一轮
+        ssize_t len = sock_->send(iov, std::min(iovcnt, (size_t)IOV_MAX), flags);
+        if (len <= 0) {
+            FLEXY_LOG_FMT_ERROR(
+                g_logger,
+                "writevFixSize fail length = {} len = {} errno = {} errstr = {}",
+                length, len, errno, strerror(errno));
+            return len;
+        }
+        left -= len;
+        // 跳过已经发送完的部分
+        while (iovcnt > 0 && (size_t)len >= iov->iov_len) {
+            len -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + len;
+            iov->iov_len -= len;
+        }
+    }
+    return length;
+}
+
+ssize_t SockStream::sendFileFixSize(int fd, uint64_t offset, uint64_t length) {
+    if (!isConnected()) {
+        return -1;
+    }
+    off_t off = offset;
+    uint64_t left = length;
+    while (left > 0) {
+        ssize_t len = sock_->sendFile(fd, &off, left);
+        if (len <= 0) {
+            FLEXY_LOG_FMT_ERROR(
+                g_logger,
+                "sendFileFixSize fail length = {} len = {} errno = {} errstr = {}",
+                length, len, errno, strerror(errno));
+            return len;
+        }
+        left -= len;
+    }
+    return length;
+}
+
 void SockStream::close() {
     if (sock_) {
         sock_->close();
@@ -13,6 +13,12 @@ public:
     ssize_t read(const ByteArray::ptr& ba, size_t length) override;
     /*virtual*/ ssize_t write(const void* buffer, size_t length) override;
     ssize_t write(const ByteArray::ptr& ba, size_t length) override;
+    // 发送 iov 中的全部数据, 会修改 iov, 成功返回总长度; iovcnt 可以超过 IOV_MAX
+    // flags 传给 sendmsg, 如 MSG_MORE 表示之后还有数据, 内核暂不发出不满的报文
+    ssize_t writevFixSize(iovec* iov, size_t iovcnt, int flags = 0);
+    // 用 sendfile 发送文件 fd 从 offset 开始的 length 字节, 数据不经过用户空间
+    // 成功返回 length, 文件被截断时返回 0
+    ssize_t sendFileFixSize(int fd, uint64_t offset, uint64_t length);
     virtual void close() override;
 
     auto& getSocket() const { return sock_; }
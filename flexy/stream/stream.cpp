@@ -60,7 +60,7 @@ ssize_t Stream::writeFixSize(const void* buffer, size_t length) {
 ssize_t Stream::writeFixSize(const ByteArray::ptr& ba, size_t length) {
     size_t left = length;
     while (left > 0) {
-        ssize_t len = read(ba, left);
+        ssize_t len = write(ba, left);
         if (len <= 0) {
             FLEXY_LOG_FMT_ERROR(
                 g_logger,
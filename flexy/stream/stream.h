@@ -6,6 +6,7 @@ namespace flexy {
 
 class Stream {
 public:
+    using ptr = std::shared_ptr<Stream>;
     virtual ~Stream() = default;
     virtual ssize_t read(void* buffer, size_t length) = 0;
     virtual ssize_t read(const ByteArray::ptr& ba, size_t length) = 0;
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "flexy/util/noncopyable.h"
+
+namespace flexy {
+
+// Vyukov 有界多生产者多消费者无锁队列
+// (Dmitry Vyukov, "Bounded MPMC queue", 1024cores.net)
+// 每个槽位带一个序号, 生产者/消费者各用一个位置计数器, CAS 抢占位置后
+// 独占槽位读写, 再通过序号发布; 入队和出队各只有一次 CAS, 不分配内存
+// 元素按移动存入槽位, 容量向上取整为 2 的幂
+template <typename T>
+class MPMCQueue : noncopyable {
+    struct Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+public:
+    explicit MPMCQueue(size_t capacity)
+        : mask_(RoundUp(capacity) - 1), cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos_.store(0, std::memory_order_relaxed);
+        dequeuePos_.store(0, std::memory_order_relaxed);
+    }
+
+    ~MPMCQueue() {
+        size_t end = enqueuePos_.load(std::memory_order_relaxed);
+        for (size_t pos = dequeuePos_.load(std::memory_order_relaxed); pos != end;
+             ++pos) {
+            cells_[pos & mask_].value()->~T();
+        }
+    }
+
+    // 队列已满返回 false, 此时 value 不变
+    template <typename U>
+    bool tryPush(U&& value) {
+        Cell* cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // 槽位中还是上一轮的元素
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->storage) T(std::forward<U>(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 队列为空返回 false
+    bool tryPop(T& value) {
+        Cell* cell;
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // 槽位还没有被写入
+                return false;
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        T* p = cell->value();
+        value = std::move(*p);
+        p->~T();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 容量
+    size_t capacity() const { return mask_ + 1; }
+    // 元素数量 (并发时只是一个近似值, 包含已抢占位置但还没有发布的元素)
+    size_t size() const {
+        size_t d = dequeuePos_.load(std::memory_order_acquire);
+        size_t e = enqueuePos_.load(std::memory_order_acquire);
+        return e > d ? e - d : 0;
+    }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= capacity(); }
+
+private:
+    static size_t RoundUp(size_t capacity) {
+        size_t c = 2;
+        while (c < capacity) {
+            c <<= 1;
+        }
+        return c;
+    }
+
+private:
+    const size_t mask_;
+    const std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> enqueuePos_;
+    alignas(64) std::atomic<size_t> dequeuePos_;
+};
+
+}  // namespace flexy
@@ -0,0 +1,161 @@
+#include "flexy/thread/rcu.h"
+#include <limits>
+#include <thread>
+#include <vector>
+#include "flexy/schedule/scheduler.h"
+#include "flexy/thread/mutex.h"
+#include "flexy/util/macro.h"
+
+namespace flexy::rcu {
+
+namespace {
+
+// 每个线程一个记录, 线程退出后记录留给之后的线程复用, 不释放
+struct ThreadRecord {
+    alignas(64) std::atomic<uint64_t> epoch{0};  // 0 表示不在读端临界区
+    std::atomic<bool> inUse{true};
+    ThreadRecord* next = nullptr;
+    uint32_t nesting = 0;                        // 只由所属线程访问
+};
+
+struct Retired {
+    void* ptr;
+    void (*deleter)(void*);
+    uint64_t epoch;
+};
+
+std::atomic<uint64_t> s_epoch{1};
+std::atomic<ThreadRecord*> s_records{nullptr};
+
+struct RetiredList {
+    flexy::mutex mutex;
+    std::vector<Retired> items;
+};
+
+RetiredList& GetRetired() {
+    static RetiredList* s_retired = new RetiredList;  // 不析构, 线程退出时仍可使用
+    return *s_retired;
+}
+
+ThreadRecord* AcquireRecord() {
+    for (auto rec = s_records.load(std::memory_order_acquire); rec;
+         rec = rec->next) {
+        bool expected = false;
+        if (!rec->inUse.load(std::memory_order_relaxed) &&
+            rec->inUse.compare_exchange_strong(expected, true,
+                                               std::memory_order_acquire)) {
+            return rec;
+        }
+    }
+    auto rec = new ThreadRecord;
+    rec->next = s_records.load(std::memory_order_relaxed);
+    while (!s_records.compare_exchange_weak(rec->next, rec,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+    }
+    return rec;
+}
+
+struct ThreadHandle {
+    ThreadRecord* record = AcquireRecord();
+    ~ThreadHandle() {
+        record->epoch.store(0, std::memory_order_release);
+        record->nesting = 0;
+        record->inUse.store(false, std::memory_order_release);
+    }
+};
+
+ThreadRecord* GetRecord() {
+    static thread_local ThreadHandle t_handle;
+    return t_handle.record;
+}
+
+// 所有读者中最早的 epoch, 没有读者时返回最大值
+uint64_t MinActiveEpoch() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t min = std::numeric_limits<uint64_t>::max();
+    for (auto rec = s_records.load(std::memory_order_acquire); rec;
+         rec = rec->next) {
+        uint64_t e = rec->epoch.load(std::memory_order_acquire);
+        if (e && e < min) {
+            min = e;
+        }
+    }
+    return min;
+}
+
+}  // namespace
+
+void ReadLock() {
+    ThreadRecord* rec = GetRecord();
+    if (rec->nesting++ == 0) {
+        rec->epoch.store(s_epoch.load(std::memory_order_acquire),
+                         std::memory_order_relaxed);
+        // 登记 epoch 之后才能读取受保护的指针, 与回收时的扫描配对
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void ReadUnlock() {
+    ThreadRecord* rec = GetRecord();
+    FLEXY_ASSERT(rec->nesting > 0);
+    if (--rec->nesting == 0) {
+        rec->epoch.store(0, std::memory_order_release);
+    }
+}
+
+bool InReadSection() { return GetRecord()->nesting > 0; }
+
+void Synchronize() {
+    FLEXY_ASSERT2(!InReadSection(), "rcu::Synchronize in read section");
+    uint64_t epoch = s_epoch.fetch_add(1, std::memory_order_seq_cst);
+    while (MinActiveEpoch() <= epoch) {
+        if (Scheduler::GetThis() && Fiber::GetFiberId() != 0) {
+            Scheduler::GetThis()->async(Fiber::GetThis());
+            Fiber::Yield();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    Reclaim();
+}
+
+void Retire(void* p, void (*deleter)(void*)) {
+    // 旧指针已经被替换, 之后登记的读者不会再看到它
+    uint64_t epoch = s_epoch.fetch_add(1, std::memory_order_seq_cst);
+    {
+        auto& retired = GetRetired();
+        LOCK_GUARD(retired.mutex);
+        retired.items.push_back({p, deleter, epoch});
+    }
+    Reclaim();
+}
+
+size_t Reclaim() {
+    std::vector<Retired> frees;
+    size_t remain = 0;
+    {
+        auto& retired = GetRetired();
+        LOCK_GUARD(retired.mutex);
+        if (retired.items.empty()) {
+            return 0;
+        }
+        uint64_t min = MinActiveEpoch();
+        auto it = retired.items.begin();
+        for (auto& item : retired.items) {
+            if (item.epoch < min) {
+                frees.push_back(item);
+            } else {
+                *it++ = item;
+            }
+        }
+        retired.items.erase(it, retired.items.end());
+        remain = retired.items.size();
+    }
+    for (auto& item : frees) {
+        item.deleter(item.ptr);
+    }
+    return remain;
+}
+
+}  // namespace flexy::rcu
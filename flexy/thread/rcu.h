@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "flexy/util/noncopyable.h"
+
+namespace flexy::rcu {
+
+// 基于 epoch 的 RCU (read-copy-update)
+// 读者进入临界区时在线程记录中登记当前的全局 epoch, 离开时清零, 不加锁也不写共享数据;
+// 写者复制并修改数据后原子地替换指针, 旧数据交给 Retire, 在所有可能看到它的读者
+// 离开临界区后才释放
+// 读端临界区可以嵌套, 但不能在其中让出协程: 协程可能在其他线程上恢复执行
+
+void ReadLock();
+void ReadUnlock();
+// 当前线程是否在读端临界区中
+bool InReadSection();
+
+// 等待调用之前开始的全部读端临界区结束, 不能在读端临界区中调用
+// 在协程中等待时让出协程, 否则让出线程
+void Synchronize();
+
+// 在所有当前的读者离开后调用 deleter(p)
+void Retire(void* p, void (*deleter)(void*));
+template <typename T>
+void Retire(T* p) {
+    Retire(const_cast<void*>(static_cast<const void*>(p)),
+           [](void* v) { delete static_cast<T*>(v); });
+}
+
+// 立即释放已经没有读者的对象, 返回还在等待的数量; Retire 时也会顺带调用
+size_t Reclaim();
+
+// 读端临界区
+class ReadGuard : noncopyable {
+public:
+    ReadGuard() { ReadLock(); }
+    ~ReadGuard() { ReadUnlock(); }
+};
+
+}  // namespace flexy::rcu
+
+namespace flexy {
+
+// RCU 保护的指针, 读多写少的数据整体替换
+// 读者在 rcu::ReadGuard 内 load, 得到的指针在临界区结束前有效;
+// 写者之间需要自己互斥, 替换后旧对象通过 rcu::Retire 延迟释放
+template <typename T>
+class RcuPtr : noncopyable {
+public:
+    explicit RcuPtr(std::unique_ptr<T> value = nullptr)
+        : ptr_(value.release()) {}
+    // 销毁时不能再有读者
+    ~RcuPtr() { delete ptr_.load(std::memory_order_relaxed); }
+
+    T* load() const { return ptr_.load(std::memory_order_acquire); }
+    void store(std::unique_ptr<T> value) {
+        T* old = ptr_.exchange(value.release(), std::memory_order_acq_rel);
+        if (old) {
+            rcu::Retire(old);
+        }
+    }
+
+private:
+    std::atomic<T*> ptr_;
+};
+
+}  // namespace flexy
@@ -0,0 +1,283 @@
+#include "binlog.h"
+#include <fmt/args.h>
+#include <vector>
+#include "flexy/thread/mutex.h"
+#include "util.h"
+
+namespace flexy::binlog {
+
+namespace {
+
+// 全局的定义表, 只增不减
+struct Registry {
+    mutex mtx;
+    std::vector<std::string> definitions;               // 编码好的 'S' 'N' 帧
+    std::unordered_map<std::string, uint32_t> names;    // 名称 -> id
+    uint32_t sites = 0;                                 // 调用点个数
+};
+
+Registry& GetRegistry() {
+    static Registry s_registry;
+    return s_registry;
+}
+
+void BeginFrame(std::string& out, FrameKind kind) {
+    Put<uint8_t>(out, kind);
+    Put<uint32_t>(out, 0);
+}
+
+// 按顺序读取帧内容
+class Cursor {
+public:
+    explicit Cursor(std::string_view data) : data_(data) {}
+    template <typename T>
+    bool get(T& value) {
+        if (data_.size() < sizeof(T)) {
+            return false;
+        }
+        memcpy(&value, data_.data(), sizeof(T));
+        data_.remove_prefix(sizeof(T));
+        return true;
+    }
+    bool getString(std::string_view& str) {
+        uint32_t len = 0;
+        if (!get(len) || data_.size() < len) {
+            return false;
+        }
+        str = data_.substr(0, len);
+        data_.remove_prefix(len);
+        return true;
+    }
+private:
+    std::string_view data_;
+};
+
+}  // namespace
+
+uint32_t RegisterSite(const char* file, const char* func, int line, fmt::string_view fmt) {
+    auto& registry = GetRegistry();
+    LOCK_GUARD(registry.mtx);
+    uint32_t id = ++registry.sites;
+    std::string frame;
+    BeginFrame(frame, kSite);
+    Put<uint32_t>(frame, id);
+    Put<int32_t>(frame, line);
+    PutString(frame, file);
+    PutString(frame, func);
+    PutString(frame, {fmt.data(), fmt.size()});
+    EndRecord(frame);
+    registry.definitions.push_back(std::move(frame));
+    return id;
+}
+
+uint32_t RegisterName(std::string_view name) {
+    auto& registry = GetRegistry();
+    LOCK_GUARD(registry.mtx);
+    auto [it, inserted] = registry.names.emplace(name, registry.names.size() + 1);
+    if (inserted) {
+        std::string frame;
+        BeginFrame(frame, kName);
+        Put<uint32_t>(frame, it->second);
+        PutString(frame, name);
+        EndRecord(frame);
+        registry.definitions.push_back(std::move(frame));
+    }
+    return it->second;
+}
+
+uint32_t CurrentThreadNameId() {
+    static thread_local std::string t_name;
+    static thread_local uint32_t t_id = 0;
+    auto& name = GetThreadName();
+    if (t_id == 0 || name != t_name) {
+        t_name = name;
+        t_id = RegisterName(name);
+    }
+    return t_id;
+}
+
+size_t DumpDefinitions(size_t from, std::string& out) {
+    auto& registry = GetRegistry();
+    LOCK_GUARD(registry.mtx);
+    for (size_t i = from; i < registry.definitions.size(); ++i) {
+        out.append(registry.definitions[i]);
+    }
+    return registry.definitions.size();
+}
+
+std::string& BeginRecord(const RecordHeader& header) {
+    static thread_local std::string t_record;
+    t_record.clear();
+    BeginFrame(t_record, kRecord);
+    Put(t_record, header.site);
+    Put(t_record, header.level);
+    Put(t_record, header.time);
+    Put(t_record, header.elapse);
+    Put(t_record, header.threadId);
+    Put(t_record, header.fiberId);
+    Put(t_record, header.threadName);
+    Put(t_record, header.loggerName);
+    Put(t_record, header.argc);
+    return t_record;
+}
+
+/****************************** Reader ************************************/
+
+bool Reader::next(Record& record) {
+    while (true) {
+        char head[kFrameHeadSize];
+        in_.read(head, sizeof(head));
+        if (in_.gcount() == 0) {
+            return false;
+        }
+        uint32_t len = 0;
+        memcpy(&len, head + 1, sizeof(len));
+        // 截断的帧(进程在写入时退出)或者损坏的长度
+        if (in_.gcount() != sizeof(head) || len > (64u << 20)) {
+            error_ = true;
+            return false;
+        }
+        frame_.resize(len);
+        in_.read(frame_.data(), len);
+        if (static_cast<uint32_t>(in_.gcount()) != len) {
+            error_ = true;
+            return false;
+        }
+
+        auto kind = static_cast<uint8_t>(head[0]);
+        if (kind == kHeader) {
+            if (frame_ != kMagic) {
+                error_ = true;
+                return false;
+            }
+            header_ = true;
+            sites_.clear();
+            names_.clear();
+            continue;
+        }
+        if (!header_) {
+            error_ = true;
+            return false;
+        }
+
+        Cursor cursor(frame_);
+        if (kind == kSite) {
+            uint32_t id = 0;
+            Site site;
+            std::string_view file, func, fmt;
+            if (!cursor.get(id) || !cursor.get(site.line) || !cursor.getString(file) ||
+                !cursor.getString(func) || !cursor.getString(fmt)) {
+                error_ = true;
+                return false;
+            }
+            site.file = file;
+            site.func = func;
+            site.fmt = fmt;
+            sites_[id] = std::move(site);
+        } else if (kind == kName) {
+            uint32_t id = 0;
+            std::string_view name;
+            if (!cursor.get(id) || !cursor.getString(name)) {
+                error_ = true;
+                return false;
+            }
+            names_[id] = name;
+        } else if (kind == kRecord) {
+            if (!decode(frame_, record)) {
+                error_ = true;
+                return false;
+            }
+            return true;
+        }
+        // 不认识的帧直接跳过
+    }
+}
+
+bool Reader::decode(std::string_view data, Record& record) {
+    Cursor cursor(data);
+    uint32_t site = 0, threadName = 0, loggerName = 0;
+    uint8_t argc = 0;
+    if (!cursor.get(site) || !cursor.get(record.level) || !cursor.get(record.time) ||
+        !cursor.get(record.elapse) || !cursor.get(record.threadId) ||
+        !cursor.get(record.fiberId) || !cursor.get(threadName) ||
+        !cursor.get(loggerName) || !cursor.get(argc)) {
+        return false;
+    }
+    auto it = sites_.find(site);
+    if (it == sites_.end()) {
+        return false;
+    }
+    record.site = &it->second;
+    auto name = names_.find(threadName);
+    record.threadName = name == names_.end() ? std::string_view() : name->second;
+    name = names_.find(loggerName);
+    record.loggerName = name == names_.end() ? std::string_view() : name->second;
+
+    fmt::dynamic_format_arg_store<fmt::format_context> args;
+    for (uint8_t i = 0; i < argc; ++i) {
+        uint8_t type = 0;
+        if (!cursor.get(type)) {
+            return false;
+        }
+        bool ok = true;
+        switch (type) {
+            case kInt: {
+                int64_t v = 0;
+                ok = cursor.get(v);
+                args.push_back(v);
+                break;
+            }
+            case kUint: {
+                uint64_t v = 0;
+                ok = cursor.get(v);
+                args.push_back(v);
+                break;
+            }
+            case kDouble: {
+                double v = 0;
+                ok = cursor.get(v);
+                args.push_back(v);
+                break;
+            }
+            case kBool: {
+                uint8_t v = 0;
+                ok = cursor.get(v);
+                args.push_back(v != 0);
+                break;
+            }
+            case kChar: {
+                char v = 0;
+                ok = cursor.get(v);
+                args.push_back(v);
+                break;
+            }
+            case kString: {
+                // 指向 frame_, 格式化完成前有效
+                std::string_view v;
+                ok = cursor.getString(v);
+                args.push_back(fmt::string_view(v.data(), v.size()));
+                break;
+            }
+            case kPointer: {
+                uint64_t v = 0;
+                ok = cursor.get(v);
+                args.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(v)));
+                break;
+            }
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    try {
+        record.message = fmt::vformat(record.site->fmt, args);
+    } catch (const fmt::format_error& e) {
+        record.message = record.site->fmt + " <<binlog format error: " + e.what() + ">>";
+    }
+    return true;
+}
+
+}  // namespace flexy::binlog
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+namespace flexy::binlog {
+
+// 二进制日志
+// 每个 FLEXY_LOG_FMT_* 调用点第一次执行时登记文件名、函数名、行号和格式串, 得到调用点id;
+// 之后每条日志只记录调用点id、上下文字段和参数的原始字节, 不做文本格式化.
+// 调用点、日志器名称和线程名称的定义由输出线程在写入引用它们的记录之前写入文件,
+// 解码时按格式串重新格式化参数, 得到与文本日志相同的内容
+//
+// 文件由帧组成, 帧 = kind(u8) + 长度(u32) + 内容, 整数按本机字节序:
+//   'H' 文件头 "FLXBLOG1", 之后的 id 重新编号 (同一文件可以被多个进程先后追加)
+//   'S' 调用点: id(u32) 行号(i32) 文件名 函数名 格式串
+//   'N' 名称:   id(u32) 名称
+//   'R' 日志:   调用点id(u32) 级别(u8) 时间(u64) 启动时间(u32) 线程id(u32) 协程id(u32)
+//              线程名称id(u32) 日志器名称id(u32) 参数个数(u8) 参数...
+// 字符串 = 长度(u32) + 字节, 参数 = 类型(u8) + 值
+
+enum FrameKind : uint8_t {
+    kHeader = 'H',
+    kSite   = 'S',
+    kName   = 'N',
+    kRecord = 'R',
+};
+
+enum ArgType : uint8_t {
+    kInt,           // int64_t
+    kUint,          // uint64_t
+    kDouble,        // double
+    kBool,          // u8
+    kChar,          // u8
+    kString,        // 字符串
+    kPointer,       // uint64_t
+};
+
+constexpr std::string_view kMagic = "FLXBLOG1";
+constexpr size_t kFrameHeadSize = 5;
+
+// 登记调用点, 返回调用点id
+uint32_t RegisterSite(const char* file, const char* func, int line, fmt::string_view fmt);
+// 登记名称(日志器名称, 线程名称), 相同名称返回相同id
+uint32_t RegisterName(std::string_view name);
+// 当前线程名称的id
+uint32_t CurrentThreadNameId();
+// 把第 from 个之后的定义帧追加到 out, 返回定义的总数
+size_t DumpDefinitions(size_t from, std::string& out);
+
+template <typename T>
+inline void Put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void PutString(std::string& out, std::string_view str) {
+    Put<uint32_t>(out, str.size());
+    out.append(str);
+}
+
+struct RecordHeader {
+    uint32_t site;
+    uint8_t level;
+    uint64_t time;
+    uint32_t elapse;
+    uint32_t threadId;
+    uint32_t fiberId;
+    uint32_t threadName;
+    uint32_t loggerName;
+    uint8_t argc;
+};
+
+// 开始一条日志记录, 返回当前线程的记录缓冲区, 参数由 Encode 追加
+std::string& BeginRecord(const RecordHeader& header);
+// 补上帧长度
+inline void EndRecord(std::string& record) {
+    uint32_t len = record.size() - kFrameHeadSize;
+    memcpy(&record[1], &len, sizeof(len));
+}
+
+// 编码一个参数; 没有对应类型的参数按 "{}" 格式化成字符串记录
+template <typename T>
+void Encode(std::string& out, const T& value) {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, bool>) {
+        Put<uint8_t>(out, kBool);
+        Put<uint8_t>(out, value);
+    } else if constexpr (std::is_same_v<U, char>) {
+        Put<uint8_t>(out, kChar);
+        Put<char>(out, value);
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        Put<uint8_t>(out, kInt);
+        Put<int64_t>(out, value);
+    } else if constexpr (std::is_integral_v<U>) {
+        Put<uint8_t>(out, kUint);
+        Put<uint64_t>(out, value);
+    } else if constexpr (std::is_floating_point_v<U>) {
+        Put<uint8_t>(out, kDouble);
+        Put<double>(out, value);
+    } else if constexpr (std::is_convertible_v<const U&, std::string_view>) {
+        Put<uint8_t>(out, kString);
+        PutString(out, std::string_view(value));
+    } else if constexpr (std::is_pointer_v<U>) {
+        Put<uint8_t>(out, kPointer);
+        Put<uint64_t>(out, reinterpret_cast<uintptr_t>(value));
+    } else {
+        Put<uint8_t>(out, kString);
+        PutString(out, fmt::format("{}", value));
+    }
+}
+
+// 调用点
+struct Site {
+    std::string file;
+    std::string func;
+    std::string fmt;
+    int32_t line = 0;
+};
+
+// 解码后的一条日志
+struct Record {
+    const Site* site = nullptr;
+    uint8_t level = 0;
+    uint64_t time = 0;
+    uint32_t elapse = 0;
+    uint32_t threadId = 0;
+    uint32_t fiberId = 0;
+    std::string_view threadName;
+    std::string_view loggerName;
+    std::string message;            // 按格式串格式化后的内容
+};
+
+// 读取二进制日志文件
+class Reader {
+public:
+    explicit Reader(std::istream& in) : in_(in) {}
+    // 读取下一条日志, 文件结束或数据损坏时返回 false
+    bool next(Record& record);
+    // 是否因为数据损坏而停止
+    bool isError() const { return error_; }
+private:
+    bool decode(std::string_view data, Record& record);
+private:
+    std::istream& in_;
+    std::string frame_;
+    bool header_ = false;                               // 是否读到过文件头
+    bool error_ = false;
+    std::unordered_map<uint32_t, Site> sites_;          // 调用点
+    std::unordered_map<uint32_t, std::string> names_;   // 名称
+};
+
+}  // namespace flexy::binlog
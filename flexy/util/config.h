@@ -3,12 +3,15 @@
 #include "flexy/thread/mutex.h"
 #include "log.h"
 #include "lexical.h"
+#include "likely.h"
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <stdexcept>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace flexy {
 
@@ -16,7 +19,7 @@ class ConfigVarBase {
 public:
     using ptr = std::shared_ptr<ConfigVarBase>;
     ConfigVarBase(std::string_view name, const std::string_view description) : 
-        name_(name), description_(description) {}
+        name_(name), description_(description), slot_(s_slots.fetch_add(1)) {}
     virtual ~ConfigVarBase() {}
     auto& getName() const { return name_; }
     auto& getDescription() const { return description_; }
@@ -25,9 +28,33 @@ public:
     virtual bool fromString(const std::string& val) = 0;
     virtual std::string getTypeName() const = 0;
 
+    // 全局配置版本号, 任意配置项的值改变时加一
+    static uint64_t GetVersion() { return s_version.load(std::memory_order_acquire); }
+
+protected:
+    // 线程缓存的配置快照
+    struct CacheEntry {
+        uint64_t version = 0;                   // 读取快照时的全局版本号, 0表示没有读过
+        std::shared_ptr<const void> value;      // 当前快照
+        std::shared_ptr<const void> prev;       // 上一个快照, 让刚返回的引用多活一代
+    };
+    // 当前线程中该配置项的缓存
+    CacheEntry& getCache() const {
+        static thread_local std::vector<CacheEntry> t_caches;
+        if (FLEXY_UNLIKELY(slot_ >= t_caches.size())) {
+            t_caches.resize(slot_ + 1);
+        }
+        return t_caches[slot_];
+    }
+    static void IncVersion() { s_version.fetch_add(1, std::memory_order_release); }
+
 protected:
     std::string name_;
     std::string description_;
+    size_t slot_;                                   // 线程缓存中的下标
+
+    static inline std::atomic<uint64_t> s_version{1};
+    static inline std::atomic<size_t> s_slots{0};
 };
 
 
@@ -36,12 +63,11 @@ class ConfigVar : public ConfigVarBase {
 public: 
     using on_change_cb = std::function<void(const T& old_value, const T& new_value)>;
     ConfigVar(std::string_view name, const T& default_val, std::string_view description = "")
-        : ConfigVarBase(name, description), val_(default_val) { }
+        : ConfigVarBase(name, description), val_(std::make_shared<const T>(default_val)) { }
 
     std::string toString() override {
         try {
-            READLOCK(mutex_);
-            return ToStr()(val_);
+            return ToStr()(*getSnapshot());
         } catch (std::exception& e) {
             FLEXY_LOG_ERROR(FLEXY_LOG_ROOT())
                 << "ConfigVar::toString exception " << e.what()
@@ -65,23 +91,56 @@ public:
 
     std::string getTypeName() const override { return typeid(T).name(); }
 
+    // 读取当前值, 不加锁
+    // 每个线程缓存一份不可变快照, 只在全局配置版本号变化后重新读取.
+    // 返回的引用在本线程下一次配置变化后的第二次 getValue 之前有效,
+    // 需要长期持有时使用 getSnapshot
     const T& getValue() const {
-        READLOCK(mutex_);
+        auto& cache = getCache();
+        auto version = GetVersion();
+        if (FLEXY_UNLIKELY(cache.version != version)) {
+            cache.prev = std::move(cache.value);
+            cache.value = getSnapshot();
+            cache.version = version;
+        }
+        return *static_cast<const T*>(cache.value.get());
+    }
+
+    // 当前值的快照, 持有期间不会改变
+    std::shared_ptr<const T> getSnapshot() const {
+        LOCK_GUARD(valMutex_);
         return val_;
     }
 
+    // 发布新的快照后在调用线程中通知监听者, 读取方不会执行回调
+    // 回调时不持有锁, 监听者可以再次 setValue (如把值限制在范围内)
     void setValue(const T& value) {
+        std::shared_ptr<const T> old_value, new_value;
         {
-            READLOCK(mutex_);
-            if (value == val_) {
+            LOCK_GUARD(setMutex_);
+            old_value = getSnapshot();
+            if (value == *old_value) {
                 return;
             }
+            new_value = std::make_shared<const T>(value);
+            {
+                LOCK_GUARD(valMutex_);
+                val_ = new_value;
+            }
+            IncVersion();
+        }
+
+        std::vector<on_change_cb> cbs;
+        {
+            READLOCK(mutex_);
+            cbs.reserve(cbs_.size());
             for (auto& [key, cb] : cbs_) {
-                cb(val_, value);
+                cbs.push_back(cb);
             }
         }
-        WRITELOCK(mutex_);
-        val_ = value;
+        for (auto& cb : cbs) {
+            cb(*old_value, *new_value);
+        }
     }
 
     uint64_t addListener(on_change_cb cb) {
@@ -108,9 +167,11 @@ public:
         cbs_.clear();
     }
 private:
-    T val_;
+    std::shared_ptr<const T> val_;                  // 当前快照, 发布后不再修改
     std::unordered_map<uint64_t, on_change_cb> cbs_;
-    mutable rw_mutex mutex_;
+    mutable rw_mutex mutex_;                        // 保护 cbs_
+    mutable Spinlock valMutex_;                     // 保护 val_ 指针
+    mutex setMutex_;                                // 串行化 setValue
 };
 
 
@@ -2,9 +2,20 @@
 #include "config.h"
 #include "file.h"
 #include "flexy/net/address.h"
+#include "flexy/net/hook.h"
 #include "flexy/net/socket.h"
+#include "flexy/thread/thread.h"
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <thread>
 #include <iostream>
 #include <functional>
+#include <map>
+#include <tuple>
 
 namespace flexy {
 
@@ -30,131 +41,44 @@ LogLevel::Level LogLevel::FromString(std::string_view s) {
     return it == mp.end() ? TRACE : it->second;
 }
 
-/******************** LogFormatter::FormatItem *********************/
-class MessageFormatItem : public LogFormatter::FormatItem {
-public:
-    MessageFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << context->getCountent();
-    }
-};
-
-class LevelFormatItem : public LogFormatter::FormatItem {
-public:
-    LevelFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << LogLevel::ToString(context->getLevel());
-    }
-};
-
-class ElapseFormatItem : public LogFormatter::FormatItem {
-public:
-    ElapseFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << context->getElapse();
-    }
-};
+/******************** LogFormatter 指令 *********************/
 
-class ThreadIdFormatItem : public LogFormatter::FormatItem {
-public:
-    ThreadIdFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << context->getThreadId();
-    }
-};
+namespace {
 
-class FiberIdFormatItem : public LogFormatter::FormatItem {
-public:
-    FiberIdFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << context->getFiberId();
-    }
-};
+// 当前线程格式化日志用的缓冲区, 只增不减
+LogBuffer& GetLineBuffer() {
+    static thread_local LogBuffer t_buffer;
+    t_buffer.clear();
+    return t_buffer;
+}
 
-class ThreadNameFormatItem : public LogFormatter::FormatItem {
-public:
-    ThreadNameFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << context->getThreadName();
-    }
-};
+template <typename Int>
+inline void AppendInt(LogBuffer& out, Int value) {
+    fmt::format_int str(value);
+    out.append(str.data(), str.data() + str.size());
+}
 
-class NameFormatItem : public LogFormatter::FormatItem {
-public:
-    NameFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << context->getLogger()->getName();
-    }
-};
+inline void AppendString(LogBuffer& out, std::string_view str) {
+    out.append(str.data(), str.data() + str.size());
+}
 
-class DateTimeFormatItem : public LogFormatter::FormatItem {
-public:
-    DateTimeFormatItem(std::string_view format = "%Y-%m-%d %H:%M:%S") : m_format(format) {
-        if (m_format.empty()) {
-            m_format = "%Y-%m-%d %H:%M:%S";
-        }
-    }
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
+// 同一秒内的时间只格式化一次
+void AppendDateTime(LogBuffer& out, const std::string& format, time_t time) {
+    static thread_local time_t t_time = -1;
+    static thread_local std::string t_format;
+    static thread_local char t_buf[64];
+    static thread_local size_t t_len = 0;
+    if (time != t_time || format != t_format) {
         struct tm tm;
-        time_t time = context->getTime();
         localtime_r(&time, &tm);
-        char buf[64];
-        strftime(buf, sizeof(buf), m_format.c_str(), &tm);
-        os << buf;
-    }
-private:
-    std::string m_format;
-};
-
-class FilenameFormatItem : public LogFormatter::FormatItem {
-public:
-    FilenameFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << context->getFile();
-    }
-};
-
-class FuncnameFormatItem : public LogFormatter::FormatItem {
-public:
-    FuncnameFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << context->getFunc();
-    }
-};
-
-class LineFormatItem : public LogFormatter::FormatItem {
-public:
-    LineFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << context->getLine();
-    }
-};
-
-class NewLineFormatItem : public LogFormatter::FormatItem {
-public:
-    NewLineFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << std::endl;
-    }
-};
-
-class StringFormatItem : public LogFormatter::FormatItem {
-public:
-    StringFormatItem(const std::string& str) : m_string(str) {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << m_string;
+        t_len = strftime(t_buf, sizeof(t_buf), format.c_str(), &tm);
+        t_time = time;
+        t_format = format;
     }
-private:
-    std::string m_string;
-};
+    out.append(t_buf, t_buf + t_len);
+}
 
-class TabFormatItem : public LogFormatter::FormatItem {
-public:
-    TabFormatItem(std::string_view str = "") {}
-    void format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) override {
-        os << "\t";
-    }
-};
+}  // namespace
 
 Logger::Logger(std::string_view name) : name_(name), formatter_(std::make_shared<LogFormatter>(
     "%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T%F%T[%p]%T[%c]%T<%f:%l>%T%m%n"
@@ -177,6 +101,33 @@ void Logger::log(LogContext::ptr& contex) {
     }
 }
 
+void Logger::logBinary(LogLevel::Level level, std::string_view record) {
+    if (level >= level_) {
+        if (!appenders_.empty()) {
+            LOCK_GUARD(mutex_);
+            for (auto& i : appenders_) {
+                // Appender 可能刚被替换成文本的
+                if (i->isBinary() && level >= i->getLevel()) {
+                    i->write(record);
+                }
+            }
+        } else {
+            if (root_) {
+                root_->logBinary(level, record);
+            }
+        }
+    }
+}
+
+uint32_t Logger::getBinaryNameId() {
+    auto id = binaryNameId_.load(std::memory_order_relaxed);
+    if (id == 0) {
+        id = binlog::RegisterName(name_);
+        binaryNameId_.store(id, std::memory_order_relaxed);
+    }
+    return id;
+}
+
 void Logger::addAppender(const LogAppender::ptr& appender) {
     LOCK_GUARD(mutex_);
     if (!appender->getFormatter()) {
@@ -184,11 +135,17 @@ void Logger::addAppender(const LogAppender::ptr& appender) {
         appender->formatter_ = formatter_;
     }
     appenders_.insert(appender);
+    hasAppenders_ = true;
+    binary_ = std::all_of(appenders_.begin(), appenders_.end(),
+                          [](auto& i) { return i->isBinary(); });
 }
 
-inline void Logger::delAppender(const LogAppender::ptr& appender) {
+void Logger::delAppender(const LogAppender::ptr& appender) {
     LOCK_GUARD(mutex_);
     appenders_.erase(appender);
+    hasAppenders_ = !appenders_.empty();
+    binary_ = hasAppenders_ && std::all_of(appenders_.begin(), appenders_.end(),
+                                           [](auto& i) { return i->isBinary(); });
 }
 
 void Logger::setFormatter(const LogFormatter::ptr& val) {
@@ -266,11 +223,20 @@ std::string Logger::toJsonString() const {
 void StdoutLogAppender::log(Logger::ptr& logger, LogContext::ptr& contex) {
     auto level = contex->getLevel();
     if (level >= level_) {
+        auto& buffer = GetLineBuffer();
         LOCK_GUARD(mutex_);
-        formatter_->format(std::cout, logger, contex);
+        formatter_->format(buffer, logger, contex);
+        std::cout.write(buffer.data(), buffer.size());
+        std::cout.flush();
     }
 }
 
+void StdoutLogAppender::write(std::string_view data) {
+    LOCK_GUARD(mutex_);
+    std::cout.write(data.data(), data.size());
+    std::cout.flush();
+}
+
 std::string StdoutLogAppender::toYamlString() const {
     LOCK_GUARD(mutex_);
     YAML::Node node;
@@ -297,15 +263,293 @@ std::string StdoutLogAppender::toJsonString() const {
     return ss.str();
 }
 
-FileLogAppender::FileLogAppender(std::string_view filename) : filename_(filename) {
+/********************* 日志文件轮转 ************************************/
+
+LogRotation::Interval LogRotation::IntervalFromString(std::string_view str) {
+    if (str == "hourly") {
+        return kHourly;
+    } else if (str == "daily") {
+        return kDaily;
+    }
+    return kNone;
+}
+
+const char* LogRotation::ToString(Interval interval) {
+    switch (interval) {
+        case kHourly:
+            return "hourly";
+        case kDaily:
+            return "daily";
+        default:
+            return "none";
+    }
+}
+
+namespace {
+
+// 日志文件轮转和压缩的后台线程, 所有 FileLogAppender 共用
+// 这里出错时输出到标准输出, 写日志可能又回到正在轮转的Appender
+class LogRotator {
+public:
+    static LogRotator& GetInstance() {
+        static LogRotator s_rotator;
+        return s_rotator;
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            LOCK_GUARD(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        cond_.notify_one();
+    }
+
+    // 退出前完成已经提交的任务
+    ~LogRotator() {
+        {
+            LOCK_GUARD(mutex_);
+            stopping_ = true;
+        }
+        cond_.notify_one();
+        thread_->join();
+    }
+private:
+    LogRotator() {
+        thread_ = std::make_shared<Thread>("log_rotate", &LogRotator::run, this);
+    }
+
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                unique_lock<mutex> lock(mutex_);
+                cond_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+private:
+    mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::shared_ptr<Thread> thread_;
+};
+
+// 下一个整点或零点
+time_t NextRotateTime(LogRotation::Interval interval, time_t now) {
+    if (interval == LogRotation::kNone) {
+        return 0;
+    }
+    struct tm tm;
+    localtime_r(&now, &tm);
+    tm.tm_sec = 0;
+    tm.tm_min = 0;
+    if (interval == LogRotation::kHourly) {
+        tm.tm_hour += 1;
+    } else {
+        tm.tm_hour = 0;
+        tm.tm_mday += 1;
+    }
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
+
+// 轮转后的文件名 filename.YYYYmmdd-HHMMSS, 同一秒内多次轮转时加上 -N
+std::string RotatedName(const std::string& filename, time_t now) {
+    std::string name = filename + "." + TimeToStr(now, "%Y%m%d-%H%M%S");
+    std::error_code ec;
+    std::string target = name;
+    for (int i = 1; std::filesystem::exists(target, ec) ||
+                    std::filesystem::exists(target + ".gz", ec); ++i) {
+        target = name + "-" + std::to_string(i);
+    }
+    return target;
+}
+
+// suffix 是否为 RotatedName 生成的后缀 YYYYmmdd-HHMMSS[-N][.gz]
+bool IsRotatedSuffix(std::string_view suffix) {
+    if (suffix.size() >= 3 && suffix.substr(suffix.size() - 3) == ".gz") {
+        suffix.remove_suffix(3);
+    }
+    if (suffix.size() < 15) {
+        return false;
+    }
+    for (size_t i = 0; i < suffix.size(); ++i) {
+        bool dash = i == 8 || i == 15;
+        if (dash ? suffix[i] != '-' : !isdigit(suffix[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 用 gzip 压缩 file, 成功后删除原文件
+void CompressFile(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        std::cout << "log rotate: open " << file << " failed" << std::endl;
+        return;
+    }
+    auto target = file + ".gz";
+    gzFile out = gzopen(target.c_str(), "wb");
+    if (!out) {
+        std::cout << "log rotate: open " << target << " failed" << std::endl;
+        return;
+    }
+    char buf[64 * 1024];
+    bool ok = true;
+    while (ok && in) {
+        in.read(buf, sizeof(buf));
+        auto n = in.gcount();
+        ok = n == 0 || gzwrite(out, buf, n) == n;
+    }
+    ok = gzclose(out) == Z_OK && ok && in.eof();
+    if (ok) {
+        unlink(file.c_str());
+    } else {
+        std::cout << "log rotate: compress " << file << " failed" << std::endl;
+        unlink(target.c_str());
+    }
+}
+
+// 只保留最新的 maxFiles 个轮转文件
+// 轮转和压缩都在同一个后台线程中依次进行, 按修改时间排序就是轮转的顺序;
+// 同一秒内的 -N 后缀在旧文件删除后会被重用, 不能按文件名排序
+void RemoveOldFiles(const std::string& filename, int maxFiles) {
+    std::filesystem::path path(filename);
+    auto dir = path.parent_path();
+    if (dir.empty()) {
+        dir = ".";
+    }
+    auto prefix = path.filename().string() + ".";
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+    std::error_code ec;
+    for (auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        auto name = entry.path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) == 0 &&
+            IsRotatedSuffix(std::string_view(name).substr(prefix.size()))) {
+            files.emplace_back(entry.last_write_time(ec), entry.path());
+        }
+    }
+    if (files.size() <= static_cast<size_t>(maxFiles)) {
+        return;
+    }
+    std::sort(files.begin(), files.end());
+    for (size_t i = 0; i < files.size() - maxFiles; ++i) {
+        std::filesystem::remove(files[i].second, ec);
+    }
+}
+
+}  // namespace
+
+FileLogAppender::FileLogAppender(std::string_view filename, const LogRotation& rotation) 
+    : filename_(filename), rotation_(rotation) {
     reopen();
 }
 
+FileLogAppender::~FileLogAppender() {
+    // 等待后台线程换完文件, 之后的压缩和清理不再使用这个Appender
+    unique_lock<Spinlock> lock(mutex_);
+    rotateCond_.wait(lock, [this]() {
+        return !rotating_.load(std::memory_order_relaxed);
+    });
+}
+
 void FileLogAppender::log(Logger::ptr& logger, LogContext::ptr& contex) {
     auto level = contex->getLevel();
     if (level >= level_) {
+        auto& buffer = GetLineBuffer();
+        bool rotate = false;
+        {
+            LOCK_GUARD(mutex_);
+            formatter_->format(buffer, logger, contex);
+            filestream_.write(buffer.data(), buffer.size());
+            filestream_.flush();
+            rotate = written(buffer.size());
+        }
+        if (rotate) {
+            submitRotate();
+        }
+    }
+}
+
+void FileLogAppender::write(std::string_view data) {
+    bool rotate = false;
+    {
+        LOCK_GUARD(mutex_);
+        filestream_.write(data.data(), data.size());
+        filestream_.flush();
+        rotate = written(data.size());
+    }
+    if (rotate) {
+        submitRotate();
+    }
+}
+
+bool FileLogAppender::written(size_t n) {
+    size_ += n;
+    if (!rotation_.enabled() || rotating_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    if ((rotation_.maxSize > 0 && size_ >= rotation_.maxSize) ||
+        (nextRotate_ > 0 && time(nullptr) >= nextRotate_)) {
+        rotating_.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void FileLogAppender::submitRotate() {
+    LogRotator::GetInstance().submit([this]() { rotate(); });
+}
+
+void FileLogAppender::rotate() {
+    time_t now = time(nullptr);
+    std::string filename;
+    LogRotation rotation;
+    {
+        LOCK_GUARD(mutex_);
+        filename = filename_;
+        rotation = rotation_;
+    }
+    // 重命名后写日志的线程继续写入原来的文件, 直到换成新文件
+    auto target = RotatedName(filename, now);
+    bool renamed = ::rename(filename.c_str(), target.c_str()) == 0;
+    std::ofstream stream;
+    if (!renamed) {
+        std::cout << "log rotate: rename " << filename << " to " << target 
+                  << " failed: " << strerror(errno) << std::endl;
+    } else if (!FS::OpenForWrite(stream, filename, std::ios::app)) {
+        std::cout << "log rotate: open " << filename << " failed" << std::endl;
+    }
+    {
         LOCK_GUARD(mutex_);
-        formatter_->format(filestream_, logger, contex);
+        if (stream.is_open()) {
+            filestream_.swap(stream);
+        }
+        // 失败时也重新计数, 避免每次写入都触发轮转
+        size_ = 0;
+        nextRotate_ = NextRotateTime(rotation_.interval, now);
+        // 持有锁通知, 析构函数返回后不再访问 rotateCond_
+        rotating_.store(false, std::memory_order_relaxed);
+        rotateCond_.notify_all();
+    }
+    stream.close();
+
+    if (!renamed) {
+        return;
+    }
+    if (rotation.compress) {
+        CompressFile(target);
+    }
+    if (rotation.maxFiles > 0) {
+        RemoveOldFiles(filename, rotation.maxFiles);
     }
 }
 
@@ -314,7 +558,12 @@ bool FileLogAppender::reopen() {
     if (filestream_) {
         filestream_.close();
     }
-    return FS::OpenForWrite(filestream_, filename_, std::ios::app);
+    bool ok = FS::OpenForWrite(filestream_, filename_, std::ios::app);
+    std::error_code ec;
+    auto size = std::filesystem::file_size(filename_, ec);
+    size_ = ec ? 0 : size;
+    nextRotate_ = NextRotateTime(rotation_.interval, time(nullptr));
+    return ok;
 }
 
 std::string FileLogAppender::toYamlString() const {
@@ -326,6 +575,18 @@ std::string FileLogAppender::toYamlString() const {
     if (hasFormatter_ && formatter_) {
         node["formatter"] = formatter_->getPattern();
     }
+    if (rotation_.maxSize > 0) {
+        node["max_size"] = rotation_.maxSize;
+    }
+    if (rotation_.interval != LogRotation::kNone) {
+        node["rotate"] = LogRotation::ToString(rotation_.interval);
+    }
+    if (rotation_.maxFiles > 0) {
+        node["max_files"] = rotation_.maxFiles;
+    }
+    if (rotation_.compress) {
+        node["compress"] = true;
+    }
     std::stringstream ss;
     ss << node;
     return ss.str();
@@ -340,6 +601,18 @@ std::string FileLogAppender::toJsonString() const {
     if (hasFormatter_ && formatter_) {
         node["formatter"] = formatter_->getPattern();
     }
+    if (rotation_.maxSize > 0) {
+        node["max_size"] = Json::UInt64(rotation_.maxSize);
+    }
+    if (rotation_.interval != LogRotation::kNone) {
+        node["rotate"] = LogRotation::ToString(rotation_.interval);
+    }
+    if (rotation_.maxFiles > 0) {
+        node["max_files"] = rotation_.maxFiles;
+    }
+    if (rotation_.compress) {
+        node["compress"] = true;
+    }
     std::stringstream ss;
     ss << node;
     return ss.str();
@@ -360,8 +633,27 @@ void ServerLogAppender::log(Logger::ptr& logger, LogContext::ptr& context) {
     }
     auto level = context->getLevel();
     if (level >= level_) {
-        LOCK_GUARD(mutex_);
-        sock_->send(formatter_->format(logger, context));
+        // send 在协程中可能让出执行权, 不能使用线程共享的缓冲区
+        LogBuffer buffer;
+        {
+            LOCK_GUARD(mutex_);
+            formatter_->format(buffer, logger, context);
+        }
+        write({buffer.data(), buffer.size()});
+    }
+}
+
+void ServerLogAppender::write(std::string_view data) {
+    if (!sock_->isConnected()) {
+        sock_->connect(addr_);
+    }
+    LOCK_GUARD(mutex_);
+    while (!data.empty()) {
+        auto n = sock_->send(data);
+        if (n <= 0) {
+            break;
+        }
+        data.remove_prefix(n);
     }
 }
 
@@ -393,6 +685,379 @@ std::string ServerLogAppender::toJsonString() const {
     return ss.str();
 }
 
+/********************* AsyncLogAppender ************************************/
+
+static auto g_log_async_buffer_size = Config::Lookup("log.async.buffer_size", 
+    256 * 1024, "async log appender per-thread buffer size in bytes");
+static auto g_log_async_flush_interval = Config::Lookup("log.async.flush_interval", 
+    100, "async log appender flush interval in ms");
+
+// 单生产者单消费者的字节环形缓冲区, 生产者是所属线程, 消费者是后台线程
+struct AsyncLogBuffer {
+    explicit AsyncLogBuffer(size_t size) : capacity(size), data(new char[size]) {}
+
+    // 写入 s, 空间不足时返回 false; half 返回本次写入后是否刚好超过一半容量
+    bool tryWrite(std::string_view s, bool& half) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t used = h - tail.load(std::memory_order_acquire);
+        if (s.size() > capacity - used) {
+            return false;
+        }
+        size_t pos = h % capacity;
+        size_t n = std::min(s.size(), capacity - pos);
+        memcpy(data.get() + pos, s.data(), n);
+        memcpy(data.get(), s.data() + n, s.size() - n);
+        head.store(h + s.size(), std::memory_order_release);
+        half = used < capacity / 2 && used + s.size() >= capacity / 2;
+        return true;
+    }
+
+    // 取出全部数据追加到 out
+    void readAll(std::string& out) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        size_t len = h - t;
+        if (len == 0) {
+            return;
+        }
+        size_t pos = t % capacity;
+        size_t n = std::min(len, capacity - pos);
+        out.append(data.get() + pos, n);
+        out.append(data.get(), len - n);
+        tail.store(h, std::memory_order_release);
+    }
+
+    const size_t capacity;
+    std::unique_ptr<char[]> data;
+    alignas(64) std::atomic<uint64_t> head = {0};   // 生产者写入位置
+    alignas(64) std::atomic<uint64_t> tail = {0};   // 消费者读取位置
+    std::atomic<bool> closed = {false};             // 所属线程已退出或Appender已销毁
+};
+
+namespace {
+
+// 线程在各个AsyncLogAppender中的缓冲区
+struct ThreadAsyncBuffers {
+    std::vector<std::pair<uint64_t, std::shared_ptr<AsyncLogBuffer>>> buffers;
+    ~ThreadAsyncBuffers();
+};
+
+thread_local ThreadAsyncBuffers t_async_buffers;
+thread_local bool t_async_buffers_exited = false;   // 线程退出时缓冲区已经析构
+thread_local bool t_async_log_thread = false;       // 是否为异步日志的后台线程
+std::atomic<uint64_t> s_async_appender_id = {0};
+
+ThreadAsyncBuffers::~ThreadAsyncBuffers() {
+    t_async_buffers_exited = true;
+    for (auto& [_, buffer] : buffers) {
+        buffer->closed.store(true, std::memory_order_release);
+    }
+}
+
+}  // namespace
+
+AsyncLogAppender::AsyncLogAppender(const LogAppender::ptr& sink, Policy policy)
+    : sink_(sink), policy_(policy), id_(++s_async_appender_id) {
+    bufferSize_ = std::max(g_log_async_buffer_size->getValue(), 4096);
+    flushInterval_ = std::max(g_log_async_flush_interval->getValue(), 1);
+    thread_ = std::make_shared<Thread>("log_async", &AsyncLogAppender::run, this);
+}
+
+AsyncLogAppender::~AsyncLogAppender() {
+    {
+        LOCK_GUARD(waitMutex_);
+        stopping_ = true;
+    }
+    cond_.notify_one();
+    thread_->join();
+    LOCK_GUARD(buffersMutex_);
+    for (auto& buffer : buffers_) {
+        buffer->closed.store(true, std::memory_order_release);
+    }
+}
+
+AsyncLogBuffer* AsyncLogAppender::getBuffer() {
+    if (t_async_buffers_exited) {
+        return nullptr;
+    }
+    auto& buffers = t_async_buffers.buffers;
+    for (auto& [id, buffer] : buffers) {
+        if (id == id_) {
+            return buffer.get();
+        }
+    }
+    // 顺便清理已经销毁的Appender留下的缓冲区
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](auto& item) {
+        return item.second->closed.load(std::memory_order_relaxed);
+    }), buffers.end());
+    auto buffer = std::make_shared<AsyncLogBuffer>(bufferSize_);
+    {
+        LOCK_GUARD(buffersMutex_);
+        buffers_.push_back(buffer);
+    }
+    buffers.emplace_back(id_, buffer);
+    return buffer.get();
+}
+
+void AsyncLogAppender::log(Logger::ptr& logger, LogContext::ptr& contex) {
+    auto level = contex->getLevel();
+    if (level >= level_) {
+        LogFormatter::ptr formatter;
+        {
+            LOCK_GUARD(mutex_);
+            formatter = formatter_;
+        }
+        auto& buffer = GetLineBuffer();
+        formatter->format(buffer, logger, contex);
+        write({buffer.data(), buffer.size()});
+    }
+}
+
+void AsyncLogAppender::write(std::string_view data) {
+    auto buffer = getBuffer();
+    if (!buffer) {                      // 线程正在退出, 直接写
+        sink_->write(data);
+        return;
+    }
+    bool half = false;
+    std::string hold;
+    while (!buffer->tryWrite(data, half)) {
+        // 后台线程自己的日志不能等待自己
+        if (policy_ == kDrop || t_async_log_thread || data.size() > buffer->capacity) {
+            ++droppedCount_;
+            droppedBytes_ += data.size();
+            return;
+        }
+        if (hold.empty()) {
+            // 等待期间同一线程的其他协程可能复用 data 所在的缓冲区
+            hold.assign(data);
+            data = hold;
+        }
+        cond_.notify_one();
+        usleep(1000);                   // 协程中由 hook 转为定时器, 不阻塞线程
+        // 协程可能被调度到其他线程, 必须写入当前线程的缓冲区, 否则同一缓冲区会有两个生产者
+        buffer = getBuffer();
+        if (!buffer) {
+            sink_->write(data);
+            return;
+        }
+    }
+    if (half) {
+        cond_.notify_one();
+    }
+}
+
+void AsyncLogAppender::flush() {
+    if (t_async_log_thread) {
+        return;
+    }
+    unique_lock<mutex> lock(waitMutex_);
+    uint64_t request = ++flushRequest_;
+    cond_.notify_one();
+    if (!is_hook_enable()) {
+        flushCond_.wait(lock, [this, request]() { return flushDone_ >= request; });
+        return;
+    }
+    // 协程中不能阻塞线程, 让出执行权轮询
+    while (flushDone_ < request) {
+        lock.unlock();
+        usleep(1000);
+        lock.lock();
+    }
+}
+
+AsyncLogAppender::Stats AsyncLogAppender::getStats() const {
+    Stats stats;
+    stats.flushedBytes = flushedBytes_;
+    stats.droppedBytes = droppedBytes_;
+    stats.droppedCount = droppedCount_;
+    stats.writes = writes_;
+    return stats;
+}
+
+void AsyncLogAppender::drain(std::string& batch) {
+    LOCK_GUARD(buffersMutex_);
+    for (auto it = buffers_.begin(); it != buffers_.end();) {
+        // 先读 closed 再取数据, 保证线程退出前写入的日志都被取出
+        bool closed = (*it)->closed.load(std::memory_order_acquire);
+        (*it)->readAll(batch);
+        if (closed) {
+            it = buffers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void AsyncLogAppender::run() {
+    t_async_log_thread = true;
+    std::string batch;
+    while (true) {
+        uint64_t request = 0;
+        bool stop = false;
+        {
+            unique_lock<mutex> lock(waitMutex_);
+            if (!stopping_ && flushRequest_ == flushDone_) {
+                cond_.wait_for(lock, std::chrono::milliseconds(flushInterval_));
+            }
+            request = flushRequest_;
+            stop = stopping_;
+        }
+        drain(batch);
+        if (!batch.empty()) {
+            sink_->write(batch);
+            flushedBytes_ += batch.size();
+            ++writes_;
+            batch.clear();
+        }
+        {
+            LOCK_GUARD(waitMutex_);
+            flushDone_ = request;
+        }
+        flushCond_.notify_all();
+        if (stop) {
+            break;
+        }
+    }
+}
+
+std::string AsyncLogAppender::toYamlString() const {
+    YAML::Node node = YAML::Load(sink_->toYamlString());
+    LOCK_GUARD(mutex_);
+    node["level"] = LogLevel::ToString(level_);
+    node["async"] = true;
+    node["async_policy"] = policy_ == kBlock ? "block" : "drop";
+    if (hasFormatter_ && formatter_) {
+        node["formatter"] = formatter_->getPattern();
+    }
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+std::string AsyncLogAppender::toJsonString() const {
+    Json::Value node;
+    Json::Reader r;
+    r.parse(sink_->toJsonString(), node);
+    LOCK_GUARD(mutex_);
+    node["level"] = LogLevel::ToString(level_);
+    node["async"] = true;
+    node["async_policy"] = policy_ == kBlock ? "block" : "drop";
+    if (hasFormatter_ && formatter_) {
+        node["formatter"] = formatter_->getPattern();
+    }
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+/********************* BinaryLogAppender ************************************/
+
+namespace {
+
+// BinaryLogAppender 的输出地, 只在后台线程(或退出中的线程)调用 write
+// 每批记录之前先写入它们可能用到的新定义
+class BinaryLogFile : public LogAppender {
+public:
+    BinaryLogFile(std::string_view filename) : filename_(filename) {
+        binary_ = true;
+        reopen();
+    }
+    void log(Logger::ptr& logger, LogContext::ptr& contex) override {}
+    void write(std::string_view data) override {
+        LOCK_GUARD(mutex_);
+        defined_ = binlog::DumpDefinitions(defined_, pending_);
+        pending_.append(data);
+        filestream_.write(pending_.data(), pending_.size());
+        filestream_.flush();
+        pending_.clear();
+    }
+    // 每次打开都写入文件头, 之后重新写入全部定义
+    bool reopen() {
+        LOCK_GUARD(mutex_);
+        if (filestream_) {
+            filestream_.close();
+        }
+        if (!FS::OpenForWrite(filestream_, filename_, std::ios::app | std::ios::binary)) {
+            return false;
+        }
+        pending_.clear();
+        binlog::Put<uint8_t>(pending_, binlog::kHeader);
+        binlog::PutString(pending_, binlog::kMagic);
+        defined_ = 0;
+        return true;
+    }
+    std::string toYamlString() const override { return ""; }
+    std::string toJsonString() const override { return ""; }
+    const auto& getFilename() const { return filename_; }
+private:
+    std::string filename_;
+    std::ofstream filestream_;
+    std::string pending_;           // 尚未写入文件的文件头和定义
+    size_t defined_ = 0;            // 已经写入文件的定义个数
+};
+
+// 流式日志在二进制日志中的调用点, 格式串为 "{}"
+// 以 __FILE__ __func__ 的地址和行号区分调用点
+uint32_t TextSiteId(const char* file, const char* func, int line) {
+    static mutex s_mutex;
+    static std::map<std::tuple<const char*, const char*, int>, uint32_t> s_sites;
+    LOCK_GUARD(s_mutex);
+    auto [it, inserted] = s_sites.emplace(std::make_tuple(file, func, line), 0);
+    if (inserted) {
+        it->second = binlog::RegisterSite(file, func, line, "{}");
+    }
+    return it->second;
+}
+
+}  // namespace
+
+BinaryLogAppender::BinaryLogAppender(std::string_view filename, Policy policy)
+    : AsyncLogAppender(std::make_shared<BinaryLogFile>(filename), policy) {
+    binary_ = true;
+}
+
+void BinaryLogAppender::log(Logger::ptr& logger, LogContext::ptr& contex) {
+    auto level = contex->getLevel();
+    if (level >= level_) {
+        auto& record = binlog::BeginRecord(
+            {TextSiteId(contex->getFile(), contex->getFunc(), contex->getLine()),
+             static_cast<uint8_t>(level), contex->getTime(), contex->getElapse(),
+             contex->getThreadId(), contex->getFiberId(),
+             binlog::CurrentThreadNameId(),
+             logger->getBinaryNameId(), 1});
+        binlog::Encode(record, contex->getContentView());
+        binlog::EndRecord(record);
+        write(record);
+    }
+}
+
+std::string BinaryLogAppender::toYamlString() const {
+    auto& sink = static_cast<const BinaryLogFile&>(*getSink());
+    LOCK_GUARD(mutex_);
+    YAML::Node node;
+    node["type"] = "BinaryLogAppender";
+    node["file"] = sink.getFilename();
+    node["level"] = LogLevel::ToString(level_);
+    node["async_policy"] = getPolicy() == kBlock ? "block" : "drop";
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+std::string BinaryLogAppender::toJsonString() const {
+    auto& sink = static_cast<const BinaryLogFile&>(*getSink());
+    LOCK_GUARD(mutex_);
+    Json::Value node;
+    node["type"] = "BinaryLogAppender";
+    node["file"] = sink.getFilename();
+    node["level"] = LogLevel::ToString(level_);
+    node["async_policy"] = getPolicy() == kBlock ? "block" : "drop";
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
 /*********************** LogFormatter *******************/
 
 LogFormatter::LogFormatter(std::string_view pattern) : pattern_(pattern) {
@@ -457,59 +1122,102 @@ void LogFormatter::init() {
     if (!nstr.empty()) {
         vec.emplace_back(nstr, "", 0);
     }
-    static std::unordered_map<std::string,
-                              std::function<FormatItem::ptr(std::string_view)>>
-        s_format_items = {
-#define XX(str, C)                                                          \
-    {                                                                       \
-#str, [](std::string_view fmt) { return std::make_shared<C>(fmt); } \
-    }
-            XX(m, MessageFormatItem),     // %m 消息体
-            XX(p, LevelFormatItem),       // %p level
-            XX(r, ElapseFormatItem),      // %r 启动后的时间
-            XX(c, NameFormatItem),        // %c:日志名称
-            XX(t, ThreadIdFormatItem),    // %t 线程id
-            XX(n, NewLineFormatItem),     // %n 回车换行
-            XX(d, DateTimeFormatItem),    // %d 时间
-            XX(f, FilenameFormatItem),    // %f 文件名
-            XX(l, LineFormatItem),        // %l 行号
-            XX(u, FuncnameFormatItem),    // %u 函数名
-            XX(T, TabFormatItem),         // %T tab
-            XX(F, FiberIdFormatItem),     // %F 协程id
-            XX(N, ThreadNameFormatItem),  // %N 线程名称
-#undef XX
-        };
-
+    static const std::unordered_map<std::string, Op::Type> s_ops = {
+        {"m", Op::kMessage},      // %m 消息体
+        {"p", Op::kLevel},        // %p level
+        {"r", Op::kElapse},       // %r 启动后的时间
+        {"c", Op::kName},         // %c:日志名称
+        {"t", Op::kThreadId},     // %t 线程id
+        {"d", Op::kDateTime},     // %d 时间
+        {"f", Op::kFilename},     // %f 文件名
+        {"l", Op::kLine},         // %l 行号
+        {"u", Op::kFuncname},     // %u 函数名
+        {"F", Op::kFiberId},      // %F 协程id
+        {"N", Op::kThreadName},   // %N 线程名称
+    };
 
     for (auto& [str, format, type] : vec) {
         if (type == 0) {
-            items_.push_back(std::make_shared<StringFormatItem>(str));
+            addString(str);
+        } else if (str == "n") {            // %n 回车换行
+            addString("\n");
+        } else if (str == "T") {            // %T tab
+            addString("\t");
         } else {
-            auto it = s_format_items.find(str);
-            if (it == s_format_items.end()) {
-                items_.push_back(std::make_shared<StringFormatItem>(
-                    "<<error_format % " + str + ">>"));
+            auto it = s_ops.find(str);
+            if (it == s_ops.end()) {
+                addString("<<error_format % " + str + ">>");
                 error_ = true;
+            } else if (it->second == Op::kDateTime) {
+                ops_.push_back({Op::kDateTime, format.empty() ? "%Y-%m-%d %H:%M:%S" : format});
             } else {
-                items_.push_back(it->second(format));
+                ops_.push_back({it->second, ""});
             }
         }
     }
 }
 
-std::string LogFormatter::format(Logger::ptr& logger, LogContext::ptr& context) {
-    std::stringstream ss;
-    for (auto& item : items_) {
-        item->format(ss, logger, context);
+void LogFormatter::addString(std::string_view str) {
+    if (!ops_.empty() && ops_.back().type == Op::kString) {
+        ops_.back().arg.append(str);
+    } else {
+        ops_.push_back({Op::kString, std::string(str)});
     }
-    return ss.str();
 }
 
-std::ostream& LogFormatter::format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) {
-    for (auto& item : items_) {
-        item->format(os, logger, context);
+void LogFormatter::format(LogBuffer& out, Logger::ptr& logger, LogContext::ptr& context) {
+    for (auto& op : ops_) {
+        switch (op.type) {
+            case Op::kString:
+                AppendString(out, op.arg);
+                break;
+            case Op::kMessage:
+                AppendString(out, context->getContentView());
+                break;
+            case Op::kLevel:
+                AppendString(out, LogLevel::ToString(context->getLevel()));
+                break;
+            case Op::kElapse:
+                AppendInt(out, context->getElapse());
+                break;
+            case Op::kName:
+                AppendString(out, context->getLogger()->getName());
+                break;
+            case Op::kThreadId:
+                AppendInt(out, context->getThreadId());
+                break;
+            case Op::kDateTime:
+                AppendDateTime(out, op.arg, context->getTime());
+                break;
+            case Op::kFilename:
+                AppendString(out, context->getFile());
+                break;
+            case Op::kLine:
+                AppendInt(out, context->getLine());
+                break;
+            case Op::kFuncname:
+                AppendString(out, context->getFunc());
+                break;
+            case Op::kFiberId:
+                AppendInt(out, context->getFiberId());
+                break;
+            case Op::kThreadName:
+                AppendString(out, context->getThreadName());
+                break;
+        }
     }
-    return os;
+}
+
+std::string LogFormatter::format(Logger::ptr& logger, LogContext::ptr& context) {
+    LogBuffer buffer;
+    format(buffer, logger, context);
+    return fmt::to_string(buffer);
+}
+
+std::ostream& LogFormatter::format(std::ostream& os, Logger::ptr& logger, LogContext::ptr& context) {
+    auto& buffer = GetLineBuffer();
+    format(buffer, logger, context);
+    return os.write(buffer.data(), buffer.size());
 }
 
 /************************* LogManager  ************************************/
@@ -557,17 +1265,43 @@ std::string LoggerManager::toJsonString() {
 /*************************** Log Config  ***********************************/
 
 struct LogAppenderDefine {
-    int type = 0;               // 1 file 2 stdout 3 server
+    int type = 0;               // 1 file 2 stdout 3 server 4 binary
     LogLevel::Level level = LogLevel::Level::TRACE;
     std::string formatter;
-    std::string fist;           // 1: filename or 3: hostname + port
+    std::string fist;           // 1, 4: filename or 3: hostname + port
+    bool async = false;         // 是否异步输出
+    int asyncPolicy = AsyncLogAppender::kDrop;
+    LogRotation rotation;       // 1: 文件轮转方式
 
     bool operator==(const LogAppenderDefine& other) const {
         return type == other.type && level == other.level 
-        && formatter == other.formatter && fist == other.fist;
+        && formatter == other.formatter && fist == other.fist
+        && async == other.async && asyncPolicy == other.asyncPolicy
+        && rotation == other.rotation;
     }
 };
 
+// 文件大小, 可以带单位 K M G, 如 "64M"
+static uint64_t ParseSize(const std::string& str) {
+    size_t pos = 0;
+    uint64_t size = 0;
+    try {
+        size = std::stoull(str, &pos);
+    } catch (...) {
+        std::cout << "log config error: invalid size " << str << std::endl;
+        return 0;
+    }
+    if (pos < str.size()) {
+        switch (toupper(str[pos])) {
+            case 'K': size <<= 10; break;
+            case 'M': size <<= 20; break;
+            case 'G': size <<= 30; break;
+            default: break;
+        }
+    }
+    return size;
+}
+
 struct LogDefine {
     std::string name;
     LogLevel::Level level = LogLevel::Level::TRACE;
@@ -620,6 +1354,19 @@ struct LexicalCastYaml<std::string, LogDefine> {
                         continue;
                     }
                     lad.fist = a["file"].as<std::string>();
+                    if (a["max_size"].IsDefined()) {
+                        lad.rotation.maxSize = ParseSize(a["max_size"].as<std::string>());
+                    }
+                    if (a["rotate"].IsDefined()) {
+                        lad.rotation.interval = LogRotation::IntervalFromString(
+                            a["rotate"].as<std::string>());
+                    }
+                    if (a["max_files"].IsDefined()) {
+                        lad.rotation.maxFiles = a["max_files"].as<int>();
+                    }
+                    if (a["compress"].IsDefined()) {
+                        lad.rotation.compress = a["compress"].as<bool>();
+                    }
                 } else if (type == "StdoutLogAppender") {
                     lad.type = 2;
                 } else if (type == "ServerLogAppender") {
@@ -629,6 +1376,13 @@ struct LexicalCastYaml<std::string, LogDefine> {
                         continue;
                     }
                     lad.fist = a["host"].as<std::string>();
+                } else if (type == "BinaryLogAppender") {
+                    lad.type = 4;
+                    if (!a["file"].IsDefined()) {
+                        std::cout << "log config error: binaryappender file is null, " << a << std::endl;
+                        continue;
+                    }
+                    lad.fist = a["file"].as<std::string>();
                 } else {
                     std::cout << "log config error: appender type is invalid, " << a << std::endl;
                     continue;
@@ -637,6 +1391,13 @@ struct LexicalCastYaml<std::string, LogDefine> {
                 if (a["formatter"].IsDefined()) {
                     lad.formatter = a["formatter"].as<std::string>();
                 }
+                if (a["async"].IsDefined()) {
+                    lad.async = a["async"].as<bool>();
+                }
+                if (a["async_policy"].IsDefined() && 
+                    a["async_policy"].as<std::string>() == "block") {
+                    lad.asyncPolicy = AsyncLogAppender::kBlock;
+                }
 
                 l.appenders.push_back(lad);
             }
@@ -662,6 +1423,19 @@ struct LexicalCastYaml<LogDefine, std::string> {
                 case 1 : {
                     na["type"] = "FileLogAppender";
                     na["file"] = appender.fist;
+                    const auto& rotation = appender.rotation;
+                    if (rotation.maxSize > 0) {
+                        na["max_size"] = rotation.maxSize;
+                    }
+                    if (rotation.interval != LogRotation::kNone) {
+                        na["rotate"] = LogRotation::ToString(rotation.interval);
+                    }
+                    if (rotation.maxFiles > 0) {
+                        na["max_files"] = rotation.maxFiles;
+                    }
+                    if (rotation.compress) {
+                        na["compress"] = true;
+                    }
                     break;
                 }
                 case 2 : {
@@ -673,6 +1447,11 @@ struct LexicalCastYaml<LogDefine, std::string> {
                     na["host"] = appender.fist;
                     break;
                 }
+                case 4 : {
+                    na["type"] = "BinaryLogAppender";
+                    na["file"] = appender.fist;
+                    break;
+                }
                 default:
                     break;
             }
@@ -683,6 +1462,13 @@ struct LexicalCastYaml<LogDefine, std::string> {
             if (!appender.formatter.empty()) {
                 na["formatter"] = appender.formatter;
             }
+            if (appender.async) {
+                na["async"] = true;
+            }
+            if (appender.async || appender.type == 4) {
+                na["async_policy"] = appender.asyncPolicy == AsyncLogAppender::kBlock 
+                                     ? "block" : "drop";
+            }
 
             node["appenders"].push_back(na);
         }
@@ -733,6 +1519,20 @@ struct LexicalCastJson<std::string, LogDefine> {
                         continue;
                     }
                     lad.fist = a["file"].asString();
+                    if (a.isMember("max_size")) {
+                        lad.rotation.maxSize = a["max_size"].isString() 
+                            ? ParseSize(a["max_size"].asString()) : a["max_size"].asUInt64();
+                    }
+                    if (a.isMember("rotate")) {
+                        lad.rotation.interval = LogRotation::IntervalFromString(
+                            a["rotate"].asString());
+                    }
+                    if (a.isMember("max_files")) {
+                        lad.rotation.maxFiles = a["max_files"].asInt();
+                    }
+                    if (a.isMember("compress")) {
+                        lad.rotation.compress = a["compress"].asBool();
+                    }
                 } else if (type == "StdoutLogAppender") {
                     lad.type = 2;
                 } else if (type == "ServerLogAppender") {
@@ -742,6 +1542,13 @@ struct LexicalCastJson<std::string, LogDefine> {
                         continue;
                     }
                     lad.fist = a["host"].asString();
+                } else if (type == "BinaryLogAppender") {
+                    lad.type = 4;
+                    if (!a.isMember("file")) {
+                        std::cout << "log config error: binaryappender file is null, " << a << std::endl;
+                        continue;
+                    }
+                    lad.fist = a["file"].asString();
                 } else {
                     std::cout << "log config error: appender type is invalid, " << a << std::endl;
                     continue;
@@ -750,6 +1557,13 @@ struct LexicalCastJson<std::string, LogDefine> {
                 if (a.isMember("formatter")) {
                     lad.formatter = a["formatter"].asString();
                 }
+                if (a.isMember("async")) {
+                    lad.async = a["async"].asBool();
+                }
+                if (a.isMember("async_policy") && 
+                    a["async_policy"].asString() == "block") {
+                    lad.asyncPolicy = AsyncLogAppender::kBlock;
+                }
 
                 l.appenders.push_back(lad);
             }
@@ -776,6 +1590,19 @@ struct LexicalCastJson<LogDefine, std::string> {
                 case 1 : {
                     na["type"] = "FileLogAppender";
                     na["file"] = appender.fist;
+                    const auto& rotation = appender.rotation;
+                    if (rotation.maxSize > 0) {
+                        na["max_size"] = Json::UInt64(rotation.maxSize);
+                    }
+                    if (rotation.interval != LogRotation::kNone) {
+                        na["rotate"] = LogRotation::ToString(rotation.interval);
+                    }
+                    if (rotation.maxFiles > 0) {
+                        na["max_files"] = rotation.maxFiles;
+                    }
+                    if (rotation.compress) {
+                        na["compress"] = true;
+                    }
                     break;
                 }
                 case 2 : {
@@ -787,6 +1614,11 @@ struct LexicalCastJson<LogDefine, std::string> {
                     na["host"] = appender.fist;
                     break;
                 }
+                case 4 : {
+                    na["type"] = "BinaryLogAppender";
+                    na["file"] = appender.fist;
+                    break;
+                }
                 default:
                     break;
             }
@@ -797,6 +1629,13 @@ struct LexicalCastJson<LogDefine, std::string> {
             if (!appender.formatter.empty()) {
                 na["formatter"] = appender.formatter;
             }
+            if (appender.async) {
+                na["async"] = true;
+            }
+            if (appender.async || appender.type == 4) {
+                na["async_policy"] = appender.asyncPolicy == AsyncLogAppender::kBlock 
+                                     ? "block" : "drop";
+            }
 
             node["appenders"].append(na);
         }
@@ -836,7 +1675,7 @@ struct LogIniter {
                 LogAppender::ptr ap;
                 switch (a.type) {
                     case 1 :
-                        ap = std::make_shared<FileLogAppender>(a.fist);
+                        ap = std::make_shared<FileLogAppender>(a.fist, a.rotation);
                         break;
                     case 2 :
                         ap = std::make_shared<StdoutLogAppender>();
@@ -844,9 +1683,18 @@ struct LogIniter {
                     case 3 :
                         ap = std::make_shared<ServerLogAppender>(a.fist);
                         break;
+                    case 4 :
+                        ap = std::make_shared<BinaryLogAppender>(a.fist, 
+                            static_cast<AsyncLogAppender::Policy>(a.asyncPolicy));
+                        break;
                     default:
                         break;
                 }
+                // BinaryLogAppender 本身就是异步的
+                if (a.async && a.type != 4) {
+                    ap = std::make_shared<AsyncLogAppender>(ap, 
+                        static_cast<AsyncLogAppender::Policy>(a.asyncPolicy));
+                }
                 ap->setLevel(a.level);
                 if (!a.formatter.empty()) {
                     auto fmt = std::make_shared<LogFormatter>(a.formatter);
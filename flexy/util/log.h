@@ -1,16 +1,17 @@
 #pragma once
 
 #include "flexy/thread/mutex.h"
+#include "binlog.h"
+#include "noncopyable.h"
 #include "singleton.h"
 #include "util.h"
 #include <sstream>
 
-#if __cplusplus > 201703L && __has_include(<format>)
-#include <format>
-#else
 #include <fmt/format.h>
-#endif
 
+#include <atomic>
+#include <condition_variable>
+#include <optional>
 #include <unordered_set>
 #include <unordered_map>
 #include <vector>
@@ -24,6 +25,8 @@ class LogAppender;
 class LogFormatter;
 class Socket;
 class IPAddress;
+class Thread;
+struct AsyncLogBuffer;
 
 
 /********************************** 日志级别 *****************************************/
@@ -48,9 +51,13 @@ inline std::ostream& operator<<(std::ostream& os, LogLevel::Level level) {
 
 /**************************** 日志上下文 *************************************/
 
-class LogContext {
+// 日志内容缓冲区, 较短的日志不分配内存
+using LogBuffer = fmt::basic_memory_buffer<char, 256>;
+
+class LogContext : noncopyable {
 public:
-    using ptr = std::unique_ptr<LogContext>;
+    // 日志上下文在调用日志宏的栈上构造, 只在一次日志调用中有效
+    using ptr = LogContext*;
     LogContext(std::shared_ptr<Logger>& logger, LogLevel::Level level, const char* flle, 
                const char* func, int32_t line, uint32_t elapse, uint32_t threadId, 
                uint32_t fiberId, uint64_t time, std::string_view thread_name) :
@@ -66,19 +73,39 @@ public:
     auto getTime() const { return time_; }
     decltype(auto) getLogger() const { return logger_; }
     auto getLevel() const { return level_; }
-    auto getCountent() const { return ss_.str(); }
-    auto& getSS() { return ss_; }
-    const auto& getThreadName() const { return thread_name_; }
+    auto getCountent() const { return std::string(content_.data(), content_.size()); }
+    std::string_view getContentView() const { return {content_.data(), content_.size()}; }
+    // 流式写入日志内容, 第一次调用时才构造 ostream
+    std::ostream& getSS() {
+        if (!ss_) {
+            ss_.emplace(&streambuf_);
+        }
+        return *ss_;
+    }
+    auto getThreadName() const { return thread_name_; }
 
     template <typename... Args>
     void format(fmt::format_string<Args...> fmt, Args&&... args) {
-#if __cplusplus > 201703L && __has_include(<format>)
-        ss_ << std::format(fmt, std::forward<Args>(args)...);
-#else
-        ss_ << fmt::format(fmt, std::forward<Args>(args)...);
-#endif
+        fmt::format_to(std::back_inserter(content_), fmt, std::forward<Args>(args)...);
     }
 
+private:
+    // 把 ostream 的输出追加到 content_
+    struct Streambuf : std::streambuf {
+        explicit Streambuf(LogBuffer& buffer) : buffer(buffer) {}
+        int overflow(int c) override {
+            if (c != EOF) {
+                buffer.push_back(static_cast<char>(c));
+            }
+            return c;
+        }
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            buffer.append(s, s + n);
+            return n;
+        }
+        LogBuffer& buffer;
+    };
+
 private:
     const char* filename_ = nullptr;                // 文件名
     const char* funcname_ = nullptr;                // 函数名
@@ -87,14 +114,17 @@ private:
     uint32_t threadId_ = 0;                         // 线程ID
     uint32_t fiberId_ = 0;                          // 协程ID
     uint64_t time_;                                 // 打印日志的时间
-    std::string thread_name_;                       // 线程名称
-    std::stringstream ss_;                          // 日志内容流
+    std::string_view thread_name_;                  // 线程名称
+    LogBuffer content_;                             // 日志内容
+    Streambuf streambuf_{content_};                 // 流式写入 content_
+    std::optional<std::ostream> ss_;                // 日志内容流
     std::shared_ptr<Logger>& logger_;               // 日志器 引用形式
     LogLevel::Level level_;                         // 日志等级
 };
 
 
 /********************** 日志格式器 **************************************/
+// 日志格式在构造时编译成一组指令, 格式化时依次把字段追加到缓冲区
 class LogFormatter {
 public:
     using ptr = std::shared_ptr<LogFormatter>;
@@ -102,20 +132,36 @@ public:
     std::string format(std::shared_ptr<Logger>& logger, LogContext::ptr& context);
     std::ostream& format(std::ostream& os, std::shared_ptr<Logger>& logger, 
                         LogContext::ptr& context);
+    // 追加到 out
+    void format(LogBuffer& out, std::shared_ptr<Logger>& logger, LogContext::ptr& context);
     bool isError() const { return error_; }
     const auto& getPattern() const { return pattern_; }
 
-    struct FormatItem {
-    public:
-        using ptr = std::shared_ptr<FormatItem>;
-        virtual ~FormatItem() = default;
-        virtual void format(std::ostream& os, std::shared_ptr<Logger>& logger, 
-                            LogContext::ptr& context) = 0;
-    };
 private:
+    // 指令
+    struct Op {
+        enum Type : uint8_t {
+            kString,        // 字面字符串, 包括 %T %n
+            kMessage,       // %m 消息体
+            kLevel,         // %p level
+            kElapse,        // %r 启动后的时间
+            kName,          // %c 日志名称
+            kThreadId,      // %t 线程id
+            kDateTime,      // %d 时间
+            kFilename,      // %f 文件名
+            kLine,          // %l 行号
+            kFuncname,      // %u 函数名
+            kFiberId,       // %F 协程id
+            kThreadName,    // %N 线程名称
+        };
+        Type type;
+        std::string arg;    // kString 的内容或 kDateTime 的时间格式
+    };
     void init();
+    // 添加字面字符串, 与前一条字面字符串合并
+    void addString(std::string_view str);
 private:
-    std::vector<FormatItem::ptr> items_;        // FormatItem集合
+    std::vector<Op> ops_;                       // 编译后的指令
     std::string pattern_;                       // 日志格式
     bool error_ = false;                        // 日志格式有无错误
 };
@@ -126,11 +172,32 @@ class Logger : public std::enable_shared_from_this<Logger> {
 friend class LoggerManager;
 public:
     using ptr = std::shared_ptr<Logger>;
-    void log(std::unique_ptr<LogContext>& contex);
+    void log(LogContext::ptr& contex);
+    // 输出一条二进制日志记录, 只交给二进制的Appender
+    void logBinary(LogLevel::Level level, std::string_view record);
+    // 该级别的日志是否会被输出, 没有Appender时由主日志器决定
+    bool isEnabled(LogLevel::Level level) const {
+        return level >= level_ &&
+               (hasAppenders_.load(std::memory_order_relaxed) ||
+                (root_ && root_->isEnabled(level)));
+    }
+    // 是否以二进制记录 FLEXY_LOG_FMT_* 日志, 即所有Appender都是二进制的
+    bool isBinary() const {
+        return hasAppenders_.load(std::memory_order_relaxed)
+                   ? binary_.load(std::memory_order_relaxed)
+                   : (root_ && root_->isBinary());
+    }
+    // 日志器名称在二进制日志中的id
+    uint32_t getBinaryNameId();
 
     void addAppender(const std::shared_ptr<LogAppender>&);
     void delAppender(const std::shared_ptr<LogAppender>&);
-    void clearAppender() { LOCK_GUARD(mutex_);  appenders_.clear(); }
+    void clearAppender() {
+        LOCK_GUARD(mutex_);
+        appenders_.clear();
+        hasAppenders_ = false;
+        binary_ = false;
+    }
     auto getLevel() const { return level_; }
     void setLevel(LogLevel::Level level) { level_ = level; }
     void setFormatter(const std::shared_ptr<LogFormatter>& val);
@@ -145,6 +212,9 @@ private:
     std::string name_;                                                      // 日志名称
     LogLevel::Level level_ = LogLevel::DEBUG;                               // 日志等级
     std::unordered_set<std::shared_ptr<LogAppender>> appenders_;            // 日志输出地集合
+    std::atomic<bool> hasAppenders_ = {false};                              // appenders_ 是否非空
+    std::atomic<bool> binary_ = {false};                                    // appenders_ 是否都是二进制的
+    std::atomic<uint32_t> binaryNameId_ = {0};                              // 二进制日志中的名称id
     LogFormatter::ptr formatter_;                                           // 日志格式
     Logger::ptr root_;                                                      // 主日志器
     mutable Spinlock mutex_;                                                // 自旋锁
@@ -159,16 +229,21 @@ public:
     using ptr = std::shared_ptr<LogAppender>;
     virtual ~LogAppender() = default;
     virtual void log(Logger::ptr& logger, LogContext::ptr& contex) = 0;
+    // 直接输出已经格式化好的日志
+    virtual void write(std::string_view data) = 0;
     virtual std::string toYamlString() const = 0;
     virtual std::string toJsonString() const = 0;
     void setFormatter(const LogFormatter::ptr& val);
     auto& getFormatter() const { LOCK_GUARD(mutex_); return formatter_; }
     auto getLevel() const { return level_; }
     void setLevel(LogLevel::Level level) { level_ = level; }
+    // write 接受的是否为二进制日志记录
+    bool isBinary() const { return binary_; }
 protected:
     LogLevel::Level level_ = LogLevel::DEBUG;       // 日志级别
     LogFormatter::ptr formatter_;                   // 日志格式
     bool hasFormatter_ = false;                     // 是否有自己的日志格式
+    bool binary_ = false;                           // 是否为二进制Appender
     mutable Spinlock mutex_;                        // 自旋锁
 };
 
@@ -176,22 +251,63 @@ protected:
 class StdoutLogAppender : public LogAppender {
 public:
     void log(Logger::ptr& logger, LogContext::ptr& contex) override;
+    void write(std::string_view data) override;
     std::string toYamlString() const override;
     std::string toJsonString() const override;
 };
 
+// 日志文件的轮转方式
+struct LogRotation {
+    enum Interval {
+        kNone,      // 不按时间轮转
+        kHourly,    // 每小时
+        kDaily,     // 每天
+    };
+    static Interval IntervalFromString(std::string_view str);
+    static const char* ToString(Interval interval);
+
+    uint64_t maxSize = 0;           // 文件达到该大小(字节)时轮转, 0 不按大小轮转
+    Interval interval = kNone;      // 按时间轮转
+    int maxFiles = 0;               // 保留的轮转文件个数, 0 全部保留
+    bool compress = false;          // 是否用 gzip 压缩轮转后的文件
+
+    bool enabled() const { return maxSize > 0 || interval != kNone; }
+    bool operator==(const LogRotation& other) const {
+        return maxSize == other.maxSize && interval == other.interval &&
+               maxFiles == other.maxFiles && compress == other.compress;
+    }
+};
+
 // 输出到文件的Appender
+// 设置了轮转时, 文件达到大小或到了时间点后由后台线程把它重命名为
+// filename.YYYYmmdd-HHMMSS 并打开新文件, 然后压缩并清理多余的轮转文件,
+// 写日志的线程只累计大小和检查时间, 不等待重命名和压缩
 class FileLogAppender : public LogAppender {
 public:
-    FileLogAppender(std::string_view filename);
+    FileLogAppender(std::string_view filename, const LogRotation& rotation = LogRotation());
+    ~FileLogAppender();
     void log(Logger::ptr& logger, LogContext::ptr& contex) override;
+    void write(std::string_view data) override;
     std::string toYamlString() const override;
     std::string toJsonString() const override;
     //重新打开文件，文件打开成功返回true
     bool reopen();
+    const auto& getRotation() const { return rotation_; }
+private:
+    // 写入 n 字节后是否需要轮转, 调用时持有 mutex_
+    bool written(size_t n);
+    // 把轮转交给后台线程
+    void submitRotate();
+    // 在后台线程中轮转
+    void rotate();
 private:
     std::string filename_;
     std::ofstream filestream_;
+    LogRotation rotation_;                      // 轮转方式
+    uint64_t size_ = 0;                         // 当前文件大小
+    time_t nextRotate_ = 0;                     // 下次按时间轮转的时间
+    std::atomic<bool> rotating_ = {false};      // 是否有轮转在进行
+    std::condition_variable_any rotateCond_;    // 通知轮转换完文件
 };
 
 // 输出到服务器的Appender
@@ -199,6 +315,7 @@ class ServerLogAppender : public LogAppender {
 public:
     ServerLogAppender(std::string_view host);
     void log(Logger::ptr& logger, LogContext::ptr& contex) override;
+    void write(std::string_view data) override;
     std::string toYamlString() const override;
     std::string toJsonString() const override;
 private:
@@ -206,19 +323,105 @@ private:
     std::shared_ptr<IPAddress> addr_;
 };
 
+// 异步输出的Appender
+// 调用线程把日志格式化后写入线程自己的环形缓冲区(单生产者单消费者, 无锁),
+// 后台线程定期或在缓冲区过半时取出所有线程的日志, 合并后一次写入 sink
+// 每个线程的缓冲区大小由 log.async.buffer_size 决定, 缓冲区满时按策略丢弃或等待
+class AsyncLogAppender : public LogAppender {
+public:
+    using ptr = std::shared_ptr<AsyncLogAppender>;
+    // 缓冲区满时的策略
+    enum Policy {
+        kDrop,      // 丢弃这条日志
+        kBlock,     // 等待后台线程写出, 协程中让出执行权
+    };
+    struct Stats {
+        uint64_t flushedBytes = 0;      // 已写入 sink 的字节数
+        uint64_t droppedBytes = 0;      // 丢弃的字节数
+        uint64_t droppedCount = 0;      // 丢弃的日志条数
+        uint64_t writes = 0;            // 写入 sink 的次数
+    };
+
+    AsyncLogAppender(const LogAppender::ptr& sink, Policy policy = kDrop);
+    ~AsyncLogAppender();
+    void log(Logger::ptr& logger, LogContext::ptr& contex) override;
+    void write(std::string_view data) override;
+    std::string toYamlString() const override;
+    std::string toJsonString() const override;
+    // 等待当前线程之前的日志全部写入 sink, 协程中轮询等待, 不阻塞线程
+    void flush();
+    const auto& getSink() const { return sink_; }
+    auto getPolicy() const { return policy_; }
+    Stats getStats() const;
+private:
+    // 当前线程在本Appender中的缓冲区
+    AsyncLogBuffer* getBuffer();
+    // 后台线程
+    void run();
+    // 取出所有缓冲区中的日志追加到 batch, 并清理已退出线程的空缓冲区
+    void drain(std::string& batch);
+private:
+    LogAppender::ptr sink_;                                     // 实际输出地
+    Policy policy_;                                             // 缓冲区满时的策略
+    uint64_t id_;                                               // 线程本地缓存使用的唯一标识
+    size_t bufferSize_;                                         // 每个线程的缓冲区大小
+    uint64_t flushInterval_;                                    // 后台线程写出的间隔(毫秒)
+    mutable mutex buffersMutex_;                                // 保护 buffers_
+    std::vector<std::shared_ptr<AsyncLogBuffer>> buffers_;      // 所有线程的缓冲区
+    mutex waitMutex_;                                           // 后台线程等待用
+    std::condition_variable cond_;                              // 唤醒后台线程
+    std::condition_variable flushCond_;                         // 通知 flush 完成
+    uint64_t flushRequest_ = 0;                                 // flush 请求序号
+    uint64_t flushDone_ = 0;                                    // 已完成的 flush 序号
+    bool stopping_ = false;                                     // 是否正在停止
+    std::atomic<uint64_t> flushedBytes_ = {0};
+    std::atomic<uint64_t> droppedBytes_ = {0};
+    std::atomic<uint64_t> droppedCount_ = {0};
+    std::atomic<uint64_t> writes_ = {0};
+    std::shared_ptr<Thread> thread_;                            // 后台线程
+};
+
+// 输出二进制日志文件的Appender, 文件格式见 binlog.h, 用 flexy_binlog 解码
+// 记录写入调用线程自己的环形缓冲区, 由后台线程写入文件, 与 AsyncLogAppender 相同;
+// 日志器的Appender都是二进制的时 FLEXY_LOG_FMT_* 不做格式化, 直接记录参数,
+// 流式日志(FLEXY_LOG_*)的消息作为 "{}" 的字符串参数记录
+class BinaryLogAppender : public AsyncLogAppender {
+public:
+    using ptr = std::shared_ptr<BinaryLogAppender>;
+    BinaryLogAppender(std::string_view filename, Policy policy = kDrop);
+    void log(Logger::ptr& logger, LogContext::ptr& contex) override;
+    std::string toYamlString() const override;
+    std::string toJsonString() const override;
+};
+
 /****************************** 日志上下文包装器 *****************************/
 
-class LogContextWrap {
+class LogContextWrap : noncopyable {
 public:
-    using ptr = std::unique_ptr<LogContext>;
-    LogContextWrap(std::unique_ptr<LogContext>&& e) : contex_(std::move(e)) { }
-    ~LogContextWrap() { contex_->getLogger()->log(contex_); }
-    auto& getSS() { return contex_->getSS(); }
-    auto& getContex() { return contex_; }
+    template <typename... Args>
+    LogContextWrap(Args&&... args) : contex_(std::forward<Args>(args)...) {}
+    ~LogContextWrap() { contex_.getLogger()->log(ptr_); }
+    auto& getSS() { return contex_.getSS(); }
+    auto& getContex() { return ptr_; }
 private:
-    ptr contex_;
+    LogContext contex_;
+    LogContext::ptr ptr_ = &contex_;
 };
 
+// 以二进制记录一条 FLEXY_LOG_FMT_* 日志
+template <typename... Args>
+void LogBinary(Logger::ptr& logger, LogLevel::Level level, uint32_t site,
+               fmt::format_string<Args...>, Args&&... args) {
+    auto& record = binlog::BeginRecord(
+        {site, static_cast<uint8_t>(level), GetTimeMs() / 1000, GetThreadElapse(),
+         static_cast<uint32_t>(GetThreadId()), GetFiberId(),
+         binlog::CurrentThreadNameId(), logger->getBinaryNameId(),
+         static_cast<uint8_t>(sizeof...(Args))});
+    (binlog::Encode(record, args), ...);
+    binlog::EndRecord(record);
+    logger->logBinary(level, record);
+}
+
 /*******************************  日志器管理类 ********************************/
 
 class LoggerManager {
@@ -241,10 +444,10 @@ using LoggerMgr = Singleton<LoggerManager>;
 /***************************  日志宏  **************************************/
 
 #define FLEXY_LOG_LEVEL(logger, level) \
-    if (logger->getLevel() <= level) \
-        flexy::LogContextWrap(std::make_unique<flexy::LogContext>(logger, level, \
+    if (logger->isEnabled(level)) \
+        flexy::LogContextWrap(logger, level, \
         __FILE__, __func__, __LINE__, flexy::GetThreadElapse(), flexy::GetThreadId(), \
-        flexy::GetFiberId(), flexy::GetTimeMs() / 1000, flexy::GetThreadName())).getSS()
+        flexy::GetFiberId(), flexy::GetTimeMs() / 1000, flexy::GetThreadName()).getSS()
 
 #define FLEXY_LOG_TRACE(logger)   FLEXY_LOG_LEVEL(logger, flexy::LogLevel::TRACE)
 #define FLEXY_LOG_DEBUG(logger)   FLEXY_LOG_LEVEL(logger, flexy::LogLevel::DEBUG)
@@ -254,10 +457,15 @@ using LoggerMgr = Singleton<LoggerManager>;
 #define FLEXY_LOG_FATAL(logger)   FLEXY_LOG_LEVEL(logger, flexy::LogLevel::FATAL)
 
 #define FLEXY_LOG_FMT_LEVEL(logger, level, fmt, args...) \
-    if (logger->getLevel() <= level) \
-        flexy::LogContextWrap(std::make_unique<flexy::LogContext>(logger, level, \
+    if (!logger->isEnabled(level)) {} \
+    else if (logger->isBinary()) { \
+        static const uint32_t flexy_binlog_site = \
+            flexy::binlog::RegisterSite(__FILE__, __func__, __LINE__, fmt); \
+        flexy::LogBinary(logger, level, flexy_binlog_site, fmt, ##args); \
+    } else \
+        flexy::LogContextWrap(logger, level, \
         __FILE__, __func__, __LINE__, flexy::GetThreadElapse(), flexy::GetThreadId(), \
-        flexy::GetFiberId(), flexy::GetTimeMs() / 1000, flexy::GetThreadName())).getContex()->format(fmt, ##args)
+        flexy::GetFiberId(), flexy::GetTimeMs() / 1000, flexy::GetThreadName()).getContex()->format(fmt, ##args)
 
 #define FLEXY_LOG_FMT_TRACE(logger, fmt, args...)   FLEXY_LOG_FMT_LEVEL(logger, flexy::LogLevel::TRACE, fmt, ##args)
 #define FLEXY_LOG_FMT_DEBUG(logger, fmt, args...)   FLEXY_LOG_FMT_LEVEL(logger, flexy::LogLevel::DEBUG, fmt, ##args)
@@ -1,15 +1,23 @@
 #pragma once
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include "function.h"
 
+// 任务内联存储的字节数, 不超过该大小的可调用对象不分配内存
+#ifndef FLEXY_TASK_INLINE_SIZE
+#define FLEXY_TASK_INLINE_SIZE 64
+#endif
+
 namespace flexy::detail {
 
 class __task_function;
 class __task_virtual;
 class __task_template;
 class __task_Function;
+template <size_t _InlineSize>
+class __task_small;
 
 template <class T, typename = void>
 struct is_task {
@@ -36,6 +44,11 @@ struct is_task<__task_Function> {
     static constexpr bool value = true;
 };
 
+template <size_t _InlineSize>
+struct is_task<__task_small<_InlineSize>> {
+    static constexpr bool value = true;
+};
+
 template <class _Tp>
 constexpr bool is_task_v = is_task<std::decay_t<_Tp>>::value;
 
@@ -216,11 +229,135 @@ public:
     __task_Function(std::nullptr_t = nullptr) noexcept : callback_t() {}
 };
 
+// 小对象优化的任务, 只能移动
+// 可调用对象(连同绑定的参数)不超过 _InlineSize 字节且可以 noexcept 移动时直接
+// 构造在对象内部, 构造、移动和析构都不分配内存; 否则在堆上分配一次
+template <size_t _InlineSize>
+class __task_small {
+public:
+    template <typename _Callable>
+    static constexpr bool is_inline_v =
+        sizeof(_Callable) <= _InlineSize &&
+        alignof(_Callable) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<_Callable>;
+
+    template <
+        typename _Fn, typename... _Args,
+        typename = std::enable_if_t<std::is_invocable_v<_Fn&&, _Args&&...>>>
+    __task_small(_Fn&& func, _Args&&... args) {
+        using Wrapper = Call_wrapper<_Fn, _Args...>;
+        _M_emplace<Wrapper>(
+            Wrapper{{std::forward<_Fn>(func), std::forward<_Args>(args)...}});
+    }
+
+    template <typename _Fn, typename = std::enable_if_t<
+                                std::is_invocable_v<_Fn&&> && !is_task_v<_Fn>>>
+    __task_small(_Fn&& func) {
+        _M_emplace<std::decay_t<_Fn>>(std::forward<_Fn>(func));
+    }
+
+    __task_small(std::nullptr_t = nullptr) noexcept {}
+
+    __task_small(__task_small&& other) noexcept : _M_ops(other._M_ops) {
+        if (_M_ops) {
+            _M_ops->_M_relocate(&_M_storage, &other._M_storage);
+            other._M_ops = nullptr;
+        }
+    }
+
+    __task_small& operator=(__task_small&& other) noexcept {
+        if (this != &other) {
+            _M_reset();
+            if (other._M_ops) {
+                other._M_ops->_M_relocate(&_M_storage, &other._M_storage);
+                _M_ops = std::exchange(other._M_ops, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    __task_small& operator=(std::nullptr_t) noexcept {
+        _M_reset();
+        return *this;
+    }
+
+    __task_small(const __task_small&) = delete;
+    __task_small& operator=(const __task_small&) = delete;
+
+    ~__task_small() { _M_reset(); }
+
+    void operator()() const { _M_ops->_M_invoke(&_M_storage); }
+    explicit operator bool() const { return _M_ops != nullptr; }
+
+    void swap(__task_small& rhs) noexcept {
+        __task_small tmp(std::move(rhs));
+        rhs = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+private:
+    struct _Ops {
+        void (*_M_invoke)(void*);
+        void (*_M_relocate)(void* to, void* from) noexcept;
+        void (*_M_destroy)(void*) noexcept;
+    };
+
+    template <typename _Callable>
+    struct _Local {
+        static void _S_invoke(void* p) { (*static_cast<_Callable*>(p))(); }
+        static void _S_relocate(void* to, void* from) noexcept {
+            auto src = static_cast<_Callable*>(from);
+            ::new (to) _Callable(std::move(*src));
+            src->~_Callable();
+        }
+        static void _S_destroy(void* p) noexcept {
+            static_cast<_Callable*>(p)->~_Callable();
+        }
+        static constexpr _Ops _S_ops = {_S_invoke, _S_relocate, _S_destroy};
+    };
+
+    template <typename _Callable>
+    struct _Heap {
+        static _Callable*& _S_get(void* p) {
+            return *static_cast<_Callable**>(p);
+        }
+        static void _S_invoke(void* p) { (*_S_get(p))(); }
+        static void _S_relocate(void* to, void* from) noexcept {
+            ::new (to) _Callable*(_S_get(from));
+        }
+        static void _S_destroy(void* p) noexcept { delete _S_get(p); }
+        static constexpr _Ops _S_ops = {_S_invoke, _S_relocate, _S_destroy};
+    };
+
+    template <typename _Callable, typename _Arg>
+    void _M_emplace(_Arg&& arg) {
+        if constexpr (is_inline_v<_Callable>) {
+            ::new (&_M_storage) _Callable(std::forward<_Arg>(arg));
+            _M_ops = &_Local<_Callable>::_S_ops;
+        } else {
+            ::new (&_M_storage) _Callable*(new _Callable(std::forward<_Arg>(arg)));
+            _M_ops = &_Heap<_Callable>::_S_ops;
+        }
+    }
+
+    void _M_reset() noexcept {
+        if (auto ops = std::exchange(_M_ops, nullptr)) {
+            ops->_M_destroy(&_M_storage);
+        }
+    }
+
+private:
+    static_assert(_InlineSize >= sizeof(void*));
+    alignas(std::max_align_t) mutable unsigned char _M_storage[_InlineSize];
+    const _Ops* _M_ops = nullptr;
+};
+
 // using __task = __task_function;          // 缺点是 std::function must be
 // CopyConstructible
 // using __task = __task_virtual;              // 缺点是
 // 使用了虚函数,可能会性能会稍微下降
-using __task = __task_template;
+// using __task = __task_template;            // 缺点是每个任务需要多次分配内存
 // using __task = __task_Function;          // 没有提供拷贝构造和拷贝赋值
+using __task = __task_small<FLEXY_TASK_INLINE_SIZE>;  // 只能移动
 
 }  // namespace flexy::detail
@@ -0,0 +1,113 @@
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "flexy/net/tcp_server.h"
+#include "flexy/util/log.h"
+#include "test_helper.h"
+
+// 建连速率压测: 比较单个 accept 协程和多 reactor SO_REUSEPORT 两种模式
+// 用法: bench_accept [线程数] [客户端协程数] [每个协程的连接数]
+
+using namespace flexy;
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+// 读到对端关闭后就关闭连接
+class CloseServer : public TestServerT<TcpServer> {
+public:
+    using TestServerT::TestServerT;
+    void handleClient(const Socket::ptr& client) override {
+        char buf[64];
+        while (client->recv(buf, sizeof(buf)) > 0)
+            ;
+        client->close();
+    }
+};
+
+// 连接后立即以 RST 关闭, 避免客户端端口堆积在 TIME_WAIT
+static void connect_loop(const Address::ptr& addr, int count,
+                         std::atomic<uint64_t>& done) {
+    for (int i = 0; i < count; ++i) {
+        auto sock = Socket::CreateTCP(addr->getFamily());
+        if (!sock->connect(addr)) {
+            continue;
+        }
+        linger lg{1, 0};
+        sock->setOption(SOL_SOCKET, SO_LINGER, lg);
+        sock->close();
+        ++done;
+    }
+}
+
+static double run(bool reactor, int threads, int clients, int count) {
+    std::vector<std::unique_ptr<IOManager>> reactors;
+    std::unique_ptr<IOManager> worker;
+    std::vector<IOManager*> ptrs;
+    if (reactor) {
+        for (int i = 0; i < threads; ++i) {
+            reactors.emplace_back(new IOManager(1, false, "reactor"));
+            ptrs.push_back(reactors.back().get());
+        }
+    } else {
+        worker.reset(new IOManager(threads, false, "worker"));
+        ptrs.push_back(worker.get());
+    }
+
+    // 监听 socket 需要在 hook 开启的线程中创建
+    std::atomic<CloseServer*> server = nullptr;
+    std::shared_ptr<CloseServer> holder;
+    ptrs[0]->async([&]() {
+        auto s = std::make_shared<CloseServer>(ptrs[0], ptrs[0], ptrs[0]);
+        if (reactor) {
+            s->setReactors(ptrs);
+        }
+        if (!s->bind(IPv4Address::Create("127.0.0.1"))) {
+            FLEXY_LOG_ERROR(g_logger) << "bind fail";
+            exit(1);
+        }
+        holder = s;
+        server = s.get();
+    });
+    while (!server) {
+        std::this_thread::yield();
+    }
+    server.load()->start();
+
+    std::atomic<uint64_t> done = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        IOManager client(2, false, "client");
+        for (int i = 0; i < clients; ++i) {
+            client.async(connect_loop, holder->getAddress(), count,
+                         std::ref(done));
+        }
+        client.stop();
+    }
+    std::chrono::duration<double> used =
+        std::chrono::steady_clock::now() - start;
+
+    holder->stop();
+    holder.reset();
+    if (worker) {
+        worker->stop();
+    }
+    for (auto& r : reactors) {
+        r->stop();
+    }
+    return done / used.count();
+}
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    int clients = argc > 2 ? atoi(argv[2]) : 64;
+    int count = argc > 3 ? atoi(argv[3]) : 200;
+    FLEXY_LOG_NAME("system")->setLevel(LogLevel::INFO);
+    double single = run(false, threads, clients, count);
+    double multi = run(true, threads, clients, count);
+    FLEXY_LOG_INFO(g_logger) << "threads = " << threads << " clients = " << clients
+                             << " conns = " << clients * count
+                             << " single accept: " << (uint64_t)single << " conns/s"
+                             << " reactor: " << (uint64_t)multi << " conns/s";
+    return 0;
+}
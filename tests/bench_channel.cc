@@ -0,0 +1,93 @@
+#include <atomic>
+#include <chrono>
+#include "flexy/fiber/channel.h"
+#include "flexy/schedule/iomanager.h"
+#include "flexy/thread/blocking_queue.h"
+#include "flexy/util/log.h"
+
+// 协程间传递消息的压测: 比较 BlockingQueue (deque<shared_ptr> + 自旋锁 + 信号量)
+// 和基于无锁环形队列的 fiber::Channel
+// 用法: bench_channel [每个生产者的消息数] [生产者/消费者协程数] [线程数]
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+struct Message {
+    uint64_t id = 0;
+    uint64_t payload[3] = {};
+};
+
+template <typename F>
+static double Measure(int threads, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    {
+        flexy::IOManager iom(threads, false, "bench");
+        f(iom);
+        iom.stop();
+    }
+    std::chrono::duration<double> used =
+        std::chrono::steady_clock::now() - start;
+    return used.count();
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 200000;
+    int fibers = argc > 2 ? atoi(argv[2]) : 4;
+    int threads = argc > 3 ? atoi(argv[3]) : 2;
+    FLEXY_LOG_NAME("system")->setLevel(flexy::LogLevel::INFO);
+    uint64_t total = (uint64_t)count * fibers;
+    std::atomic<uint64_t> sum = 0;
+
+    double queue_s = Measure(threads, [&](flexy::IOManager& iom) {
+        // BlockingQueue 没有关闭, 每个消费者收固定数量
+        auto q = std::make_shared<flexy::BlockingQueue<Message>>();
+        for (int i = 0; i < fibers; ++i) {
+            iom.async([q, count]() {
+                for (int j = 0; j < count; ++j) {
+                    auto m = std::make_shared<Message>();
+                    m->id = j;
+                    q->push(m);
+                }
+            });
+            iom.async([q, count, &sum]() {
+                uint64_t local = 0;
+                for (int j = 0; j < count; ++j) {
+                    local += q->pop()->id;
+                }
+                sum += local;
+            });
+        }
+    });
+
+    double channel_s = Measure(threads, [&](flexy::IOManager& iom) {
+        auto ch = std::make_shared<flexy::fiber::Channel<Message>>(1024);
+        auto producers = std::make_shared<std::atomic<int>>(fibers);
+        for (int i = 0; i < fibers; ++i) {
+            iom.async([ch, producers, count]() {
+                for (int j = 0; j < count; ++j) {
+                    Message m;
+                    m.id = j;
+                    ch->send(m);
+                }
+                if (--*producers == 0) {
+                    ch->close();
+                }
+            });
+            iom.async([ch, &sum]() {
+                uint64_t local = 0;
+                Message m;
+                while (ch->recv(m)) {
+                    local += m.id;
+                }
+                sum += local;
+            });
+        }
+    });
+
+    FLEXY_LOG_INFO(g_logger) << total << " messages, " << fibers
+                             << " producers/consumers, " << threads
+                             << " threads, sum = " << sum;
+    FLEXY_LOG_INFO(g_logger) << "BlockingQueue " << total / queue_s
+                             << " msg/s, Channel " << total / channel_s
+                             << " msg/s";
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include "flexy/fiber/mutex.h"
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/config.h"
+#include "flexy/util/log.h"
+
+// 短临界区的协程锁压测: 比较旧的实现(自旋锁保护的 deque, 竞争时总是挂起),
+// 只挂起(fiber.mutex.spin_count = 0)和先自旋后挂起, 以及两种公平策略
+// 用法: bench_fiber_mutex [每个协程的加锁次数] [协程数] [线程数]
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+// 旧实现
+class LegacyMutex {
+public:
+    void lock() {
+        {
+            LOCK_GUARD(mutex_);
+            if (!locked_) {
+                locked_ = true;
+                return;
+            }
+            waiters_.emplace_back(flexy::Scheduler::GetThis(),
+                                  flexy::Fiber::GetThis());
+        }
+        flexy::Fiber::Yield();
+    }
+    void unlock() {
+        std::pair<flexy::Scheduler*, flexy::Fiber::ptr> waiter;
+        {
+            LOCK_GUARD(mutex_);
+            if (waiters_.empty()) {
+                locked_ = false;
+                return;
+            }
+            waiter = std::move(waiters_.front());
+            waiters_.pop_front();
+        }
+        waiter.first->async(std::move(waiter.second));
+    }
+
+private:
+    bool locked_ = false;
+    flexy::Spinlock mutex_;
+    std::deque<std::pair<flexy::Scheduler*, flexy::Fiber::ptr>> waiters_;
+};
+
+template <typename Mutex>
+static double Run(Mutex& mtx, int rounds, int fibers, int threads) {
+    uint64_t counter = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        flexy::IOManager iom(threads, false, "bench");
+        for (int i = 0; i < fibers; ++i) {
+            iom.async([&]() {
+                for (int j = 0; j < rounds; ++j) {
+                    std::lock_guard lock(mtx);
+                    ++counter;
+                }
+            });
+        }
+        iom.stop();
+    }
+    std::chrono::duration<double, std::nano> used =
+        std::chrono::steady_clock::now() - start;
+    return used.count() / counter;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 200000;
+    int fibers = argc > 2 ? atoi(argv[2]) : 8;
+    int threads = argc > 3 ? atoi(argv[3]) : 4;
+    FLEXY_LOG_NAME("system")->setLevel(flexy::LogLevel::INFO);
+    auto spin = flexy::Config::LookupBase("fiber.mutex.spin_count");
+    auto spin_default = spin->toString();
+
+    LegacyMutex legacy;
+    FLEXY_LOG_FMT_INFO(g_logger, "legacy {:.1f} ns/lock",
+                       Run(legacy, rounds, fibers, threads));
+
+    for (auto fairness :
+         {flexy::fiber::mutex::kBarging, flexy::fiber::mutex::kHandoff}) {
+        for (auto spin_count : {std::string("0"), spin_default}) {
+            spin->fromString(spin_count);
+            flexy::fiber::mutex mtx(fairness);
+            double ns = Run(mtx, rounds, fibers, threads);
+            auto stats = mtx.getStats();
+            FLEXY_LOG_FMT_INFO(
+                g_logger,
+                "{} spin_count={:<4} {:.1f} ns/lock contended={} spinned={} "
+                "parked={} handoffs={} wait={}us",
+                fairness == flexy::fiber::mutex::kBarging ? "barging" : "handoff",
+                spin_count, ns, stats.contended, stats.spinned, stats.parked,
+                stats.handoffs, stats.waitUs);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include "flexy/http2/hpack.h"
+#include "flexy/util/log.h"
+
+// HPACK 动态表压测: 比较旧的 vector 线性查找/头部删除淘汰的实现和
+// 环形缓冲区 + 哈希索引的实现
+// 模拟 gRPC 风格的请求头部: 大部分字段重复, 少数字段(请求 id 等)每次变化,
+// 按 HPack::pack 的方式对每个字段 findPair, 未完全匹配时 update
+// 用法: bench_hpack [请求数]
+
+using namespace flexy;
+using namespace flexy::http2;
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+// ---- 旧实现 ----
+class LegacyTable {
+public:
+    void update(std::string_view name, std::string_view val) {
+        int len = name.length() + val.length() + 32;
+        size_t idx = 0;
+        while (dataSize_ + len > maxDataSize_ && idx < datas_.size()) {
+            auto& [d_name, d_val] = datas_[idx];
+            dataSize_ -= d_name.length() + d_val.length() + 32;
+            ++idx;
+        }
+        datas_.erase(datas_.begin(), datas_.begin() + idx);
+        if (len > maxDataSize_) {
+            return;
+        }
+        dataSize_ += len;
+        datas_.emplace_back(name, val);
+    }
+
+    std::pair<int32_t, bool> findPair(std::string_view name,
+                                      std::string_view value) {
+        auto rt = StaticPair(name, value);
+        if (!rt.second) {
+            size_t len = datas_.size();
+            for (size_t i = 0; i < datas_.size(); ++i) {
+                if (datas_[len - i - 1].first == name) {
+                    if (rt.first == -1) {
+                        rt.first = i + 62;
+                    }
+                } else {
+                    continue;
+                }
+                if (datas_[len - i - 1].second == value) {
+                    rt.first = i + 62;
+                    rt.second = true;
+                    break;
+                }
+            }
+        }
+        return rt;
+    }
+
+private:
+    static std::pair<int32_t, bool> StaticPair(std::string_view name,
+                                               std::string_view val) {
+        std::pair<int32_t, bool> rt = std::make_pair(-1, false);
+        for (uint32_t i = 1; i < DynamicTable::kStaticSize; ++i) {
+            auto [s_name, s_val] = DynamicTable::GetStaticHeaders(i);
+            if (s_name == name) {
+                if (rt.first == -1) {
+                    rt.first = i;
+                }
+            } else {
+                continue;
+            }
+            if (s_val == val) {
+                rt.first = i;
+                rt.second = true;
+            }
+        }
+        return rt;
+    }
+
+    int maxDataSize_ = 4096;
+    int dataSize_ = 0;
+    std::vector<std::pair<std::string, std::string>> datas_;
+};
+
+using Headers = std::vector<std::pair<std::string, std::string>>;
+
+static Headers MakeRequest(int i) {
+    return {
+        {":method", "POST"},
+        {":scheme", "http"},
+        {":path", "/helloworld.Greeter/SayHello" + std::to_string(i % 8)},
+        {":authority", "greeter.internal.example.com:50051"},
+        {"content-type", "application/grpc"},
+        {"te", "trailers"},
+        {"grpc-accept-encoding", "identity,deflate,gzip"},
+        {"grpc-timeout", std::to_string(i % 100) + "m"},
+        {"user-agent", "grpc-c++/1.60.0 grpc-c/37.0.0 (linux; chttp2)"},
+        {"x-request-id", "7f3a9c2e-" + std::to_string(i)},
+        {"x-b3-traceid", "80f198ee56343ba864fe8b2a57d3eff7"},
+        {"x-b3-spanid", std::to_string(1000000 + i)},
+        {"x-tenant", "tenant-" + std::to_string(i % 16)},
+        {"x-region", "ap-east-1"},
+        {"accept-encoding", "gzip, deflate"},
+    };
+}
+
+template <typename Table>
+static double Run(const std::vector<Headers>& requests, size_t& sink) {
+    Table table;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& headers : requests) {
+        for (auto& [name, value] : headers) {
+            auto [idx, ok] = table.findPair(name, value);
+            sink += idx;
+            if (!ok) {
+                table.update(name, value);
+            }
+        }
+    }
+    std::chrono::duration<double> used = std::chrono::steady_clock::now() - start;
+    return used.count();
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 200000;
+    std::vector<Headers> requests;
+    size_t fields = 0;
+    for (int i = 0; i < count; ++i) {
+        requests.push_back(MakeRequest(i));
+        fields += requests.back().size();
+    }
+    size_t sink = 0;
+    double legacy = Run<LegacyTable>(requests, sink);
+    double ring = Run<DynamicTable>(requests, sink);
+
+    FLEXY_LOG_INFO(g_logger) << count << " requests, " << fields
+                             << " fields, sink = " << sink;
+    FLEXY_LOG_INFO(g_logger)
+        << "legacy " << legacy * 1e9 / fields << " ns/field, ring + hash "
+        << ring * 1e9 / fields << " ns/field";
+
+    // 完整编码吞吐
+    DynamicTable table;
+    std::string out;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& headers : requests) {
+        HPack(table).pack(headers, out);
+        sink += out.size();
+    }
+    std::chrono::duration<double> used = std::chrono::steady_clock::now() - start;
+    FLEXY_LOG_INFO(g_logger) << "HPack::pack " << used.count() * 1e9 / count
+                             << " ns/request, sink = " << sink;
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <atomic>
+#include <chrono>
+#include "flexy/http/http_session.h"
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/log.h"
+
+// 响应发送压测: 比较 stringstream 序列化后整体发送和头部序列化 + writev 两种方式
+// 用法: bench_http_response [1KB 响应数] [1MB 响应数]
+
+using namespace flexy;
+using namespace flexy::http;
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+// 旧的发送方式
+static int SendByStream(HttpSession& session, const HttpResponse::ptr& rsp) {
+    std::stringstream ss;
+    ss << *rsp;
+    std::string data = ss.str();
+    return session.writeFixSize(data.c_str(), data.size());
+}
+
+static double run(bool writev, size_t body_size, int count) {
+    std::string body(body_size, 'x');
+    std::chrono::duration<double> used{};
+    IOManager iom(1, false, "bench");
+    iom.async([&]() {
+        auto listen_sock = Socket::CreateTCPSocket();
+        listen_sock->bind(IPv4Address::Create("127.0.0.1"));
+        listen_sock->listen();
+        auto addr = listen_sock->getLocalAddress();
+
+        go [listen_sock, &body, &used, writev, count]() {
+            HttpSession session(listen_sock->accept());
+            auto rsp = std::make_unique<HttpResponse>(0x11, false);
+            rsp->setHeader("content-type", "text/plain");
+            rsp->setHeader("server", "flexy");
+            rsp->setBodyRef(body);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < count; ++i) {
+                ssize_t rt = writev ? session.sendResponse(rsp)
+                                : SendByStream(session, rsp);
+                if (rt <= 0) {
+                    FLEXY_LOG_ERROR(g_logger) << "send fail rt = " << rt;
+                    break;
+                }
+            }
+            used = std::chrono::steady_clock::now() - start;
+        };
+
+        auto sock = Socket::CreateTCP(addr->getFamily());
+        sock->connect(addr);
+        std::unique_ptr<char[]> buf(new char[256 * 1024]);
+        while (sock->recv(buf.get(), 256 * 1024) > 0)
+            ;
+        sock->close();
+    });
+    iom.stop();
+    return count / used.count();
+}
+
+int main(int argc, char** argv) {
+    int small = argc > 1 ? atoi(argv[1]) : 100000;
+    int large = argc > 2 ? atoi(argv[2]) : 1000;
+    FLEXY_LOG_NAME("system")->setLevel(LogLevel::INFO);
+    FLEXY_LOG_INFO(g_logger) << "1KB x " << small
+                             << " stringstream: " << (uint64_t)run(false, 1024, small)
+                             << " rsp/s writev: " << (uint64_t)run(true, 1024, small)
+                             << " rsp/s";
+    FLEXY_LOG_INFO(g_logger) << "1MB x " << large
+                             << " stringstream: " << (uint64_t)run(false, 1 << 20, large)
+                             << " rsp/s writev: " << (uint64_t)run(true, 1 << 20, large)
+                             << " rsp/s";
+    return 0;
+}
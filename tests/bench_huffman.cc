@@ -0,0 +1,261 @@
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include "flexy/http2/huffman.h"
+#include "flexy/http2/huffman_table.h"
+#include "flexy/util/log.h"
+
+// HPACK 霍夫曼编解码压测: 比较旧的逐字节查字典树/逐段拼接的实现和
+// 编译期生成转移表的半字节状态机/64 bit 累积编码
+// 语料为常见的请求和响应头部值, 吞吐按原始(未编码)字节数计算
+// 用法: bench_huffman [轮数]
+
+using namespace flexy;
+using namespace flexy::http2;
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+static const std::vector<std::string> s_corpus = {
+    "GET",
+    "POST",
+    "https",
+    "/",
+    "/index.html",
+    "/api/v1/users/1024/orders?page=2&size=50&sort=created_at",
+    "/static/js/app.3f9a1c2e.min.js",
+    "www.example.com",
+    "api.internal.example.com:8443",
+    "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like "
+    "Gecko) Chrome/120.0.0.0 Safari/537.36",
+    "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15 "
+    "(KHTML, like Gecko) Version/17.1 Safari/605.1.15",
+    "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/"
+    "webp,*/*;q=0.8",
+    "application/json",
+    "gzip, deflate, br",
+    "en-US,en;q=0.9,zh-CN;q=0.8,zh;q=0.7",
+    "no-cache",
+    "max-age=0, private, must-revalidate",
+    "session_id=3f2a9c8b7d6e5f4a3b2c1d0e; theme=dark; lang=en-US; "
+    "_ga=GA1.2.1234567890.1700000000",
+    "Bearer eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9.eyJzdWIiOiIxMjM0NTY3ODkwIn0."
+    "dozjgNryP4J3jVmNHl0w5N_XgL0n3I9PlFUP0THsR8U",
+    "https://www.example.com/search?q=http2+hpack+huffman",
+    "Sat, 17 Oct 2026 14:20:57 GMT",
+    "text/plain; charset=utf-8",
+    "\"33a64df551425fcc55e4d42a148795d9f25f89d4\"",
+    "1024",
+    "flexy/1.0.0",
+    "keep-alive",
+    "nosniff",
+    "SAMEORIGIN",
+    "max-age=31536000; includeSubDomains",
+};
+
+// ---- 旧实现: 每次解码构造 256 叉字典树, 逐字节查找; 编码逐字符拼接 ----
+
+struct LegacyNode {
+    LegacyNode* children[256];
+    unsigned char sym;
+    int code_len;
+    int size;
+};
+
+static LegacyNode* LegacyCreate() {
+    auto node = (LegacyNode*)malloc(sizeof(LegacyNode));
+    memset(node, 0, sizeof(LegacyNode));
+    return node;
+}
+
+static void LegacyAdd(LegacyNode* cur, unsigned char sym, int code,
+                      int code_len) {
+    for (; code_len > 8;) {
+        code_len -= 8;
+        unsigned char i = (unsigned char)(code >> code_len);
+        if (cur->children[i] == NULL) {
+            cur->children[i] = LegacyCreate();
+        }
+        cur = cur->children[i];
+    }
+    int shift = 8 - code_len;
+    int start = (unsigned char)(code << shift);
+    for (int j = start; j < start + (1 << shift); j++) {
+        if (cur->children[j] == NULL) {
+            cur->children[j] = LegacyCreate();
+        }
+        cur->children[j]->sym = sym;
+        cur->children[j]->code_len = code_len;
+        cur->size++;
+    }
+}
+
+static void LegacyDel(LegacyNode* node) {
+    if (node) {
+        for (int i = 0; i < 256; i++) {
+            LegacyDel(node->children[i]);
+        }
+        free(node);
+    }
+}
+
+static LegacyNode* LegacyBuild() {
+    LegacyNode* root = LegacyCreate();
+    for (int i = 0; i < 256; i++) {
+        LegacyAdd(root, i, huffman_codes[i], huffman_code_len[i]);
+    }
+    return root;
+}
+
+static int LegacyDecode(LegacyNode* root, const char* in, int in_len,
+                        std::string& out) {
+    out.resize(in_len * 8 + 1);
+    LegacyNode* n = root;
+    unsigned int cur = 0;
+    int nbits = 0, at = 0;
+    auto enc = (const unsigned char*)in;
+    for (int i = 0; i < in_len; i++) {
+        cur = (cur << 8) | enc[i];
+        nbits += 8;
+        for (; nbits >= 8;) {
+            n = n->children[(unsigned char)(cur >> (nbits - 8))];
+            if (n == NULL) {
+                return -1;
+            }
+            if (n->size == 0) {
+                out[at++] = (char)n->sym;
+                nbits -= n->code_len;
+                n = root;
+            } else {
+                nbits -= 8;
+            }
+        }
+    }
+    for (; nbits > 0;) {
+        n = n->children[(unsigned char)(cur << (8 - nbits))];
+        if (n->size != 0 || n->code_len > nbits) {
+            break;
+        }
+        out[at++] = (char)n->sym;
+        nbits -= n->code_len;
+        n = root;
+    }
+    out.resize(at);
+    return at;
+}
+
+static int LegacyByteEncode(unsigned char ch, int remain, unsigned char* buff) {
+    int i = 0;
+    int codes = huffman_codes[ch];
+    int nbits = huffman_code_len[ch];
+    for (;;) {
+        if (remain > nbits) {
+            buff[i++] |= (unsigned char)(codes << (remain - nbits));
+            return remain - nbits;
+        }
+        buff[i++] |= (unsigned char)(codes >> (nbits - remain));
+        nbits -= remain;
+        remain = 8;
+        buff[i] = 0;
+        if (nbits == 0) {
+            return remain;
+        }
+    }
+}
+
+static int LegacyEncode(const char* in, int in_len, std::string& out) {
+    out.assign(in_len * 8 + 1, 0);
+    auto buff = (unsigned char*)out.data();
+    int remain = 8, j = 0;
+    for (int i = 0; i < in_len; i++) {
+        int len = huffman_code_len[(uint8_t)in[i]];
+        int nbytes = remain > len ? (remain - len) / 8 : (len - remain) / 8 + 1;
+        remain = LegacyByteEncode(in[i], remain, &buff[j]);
+        j += nbytes;
+    }
+    if (remain < 8) {
+        buff[j++] |= (unsigned char)(0x3fffffff >> (30 - remain));
+    }
+    out.resize(j);
+    return 0;
+}
+
+// ---- 压测 ----
+
+template <typename F>
+static double Measure(int rounds, size_t bytes, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        f();
+    }
+    std::chrono::duration<double> used = std::chrono::steady_clock::now() - start;
+    return bytes * (double)rounds / used.count() / (1024 * 1024);
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    std::vector<std::string> encoded;
+    size_t raw_bytes = 0, encoded_bytes = 0;
+    for (auto& s : s_corpus) {
+        std::string out;
+        huffman::EncodeString(s, out, 0);
+        std::string legacy;
+        LegacyEncode(s.data(), s.size(), legacy);
+        std::string decoded;
+        if (out != legacy || huffman::DecodeString(out, decoded) < 0 ||
+            decoded != s) {
+            FLEXY_LOG_ERROR(g_logger) << "mismatch: " << s;
+            return 1;
+        }
+        raw_bytes += s.size();
+        encoded_bytes += out.size();
+        encoded.push_back(std::move(out));
+    }
+
+    std::string out;
+    size_t sink = 0;
+    // 旧的 DecodeString 每次调用都要构造字典树, 轮数减少到 1/100
+    double legacy_decode = Measure(std::max(rounds / 100, 1), raw_bytes, [&]() {
+        for (auto& s : encoded) {
+            LegacyNode* root = LegacyBuild();
+            sink += LegacyDecode(root, s.data(), s.size(), out);
+            LegacyDel(root);
+        }
+    });
+    // 只比较查找本身, 字典树预先构造
+    LegacyNode* root = LegacyBuild();
+    double trie_decode = Measure(rounds, raw_bytes, [&]() {
+        for (auto& s : encoded) {
+            sink += LegacyDecode(root, s.data(), s.size(), out);
+        }
+    });
+    LegacyDel(root);
+    double table_decode = Measure(rounds, raw_bytes, [&]() {
+        for (auto& s : encoded) {
+            sink += huffman::DecodeString(s, out);
+        }
+    });
+    double legacy_encode = Measure(rounds, raw_bytes, [&]() {
+        for (auto& s : s_corpus) {
+            LegacyEncode(s.data(), s.size(), out);
+            sink += out.size();
+        }
+    });
+    double table_encode = Measure(rounds, raw_bytes, [&]() {
+        for (auto& s : s_corpus) {
+            huffman::EncodeString(s, out, 0);
+            sink += out.size();
+        }
+    });
+
+    FLEXY_LOG_INFO(g_logger)
+        << "corpus " << s_corpus.size() << " strings, " << raw_bytes
+        << " bytes, huffman " << encoded_bytes << " bytes, sink = " << sink;
+    FLEXY_LOG_INFO(g_logger) << "decode legacy " << legacy_decode
+                             << " MB/s, legacy with cached trie " << trie_decode
+                             << " MB/s, state machine " << table_decode
+                             << " MB/s";
+    FLEXY_LOG_INFO(g_logger) << "encode legacy " << legacy_encode
+                             << " MB/s, 64-bit packing " << table_encode
+                             << " MB/s";
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <ostream>
+#include "flexy/util/log.h"
+
+// 日志压测, 每行日志的平均耗时
+// disabled: 日志级别关闭; null: 格式化但不输出; file: 同步写文件; async: 异步写文件;
+// binary: 二进制日志
+// 用法: bench_log [日志条数] [文件路径]
+
+using namespace flexy;
+
+// 只格式化不输出
+class NullLogAppender : public LogAppender {
+public:
+    void log(Logger::ptr& logger, LogContext::ptr& context) override {
+        if (context->getLevel() >= level_) {
+            formatter_->format(null_, logger, context);
+        }
+    }
+    void write(std::string_view data) override {}
+    std::string toYamlString() const override { return ""; }
+    std::string toJsonString() const override { return ""; }
+
+private:
+    struct NullBuf : std::streambuf {
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override {
+            return n;
+        }
+    } buf_;
+    std::ostream null_{&buf_};
+};
+
+template <typename Fn>
+static double Run(int count, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        fn(i);
+    }
+    std::chrono::duration<double, std::nano> used =
+        std::chrono::steady_clock::now() - start;
+    return used.count() / count;
+}
+
+static void Bench(const char* name, Logger::ptr& logger, int count) {
+    double fmt = Run(count, [&](int i) {
+        FLEXY_LOG_FMT_DEBUG(logger, "request {} from {} took {}us", i,
+                            "127.0.0.1:8080", 42.5);
+    });
+    double stream = Run(count, [&](int i) {
+        FLEXY_LOG_DEBUG(logger) << "request " << i << " from "
+                                << "127.0.0.1:8080 took " << 42.5 << "us";
+    });
+    FLEXY_LOG_FMT_INFO(FLEXY_LOG_ROOT(), "{:<8} fmt {:.1f} ns/line, stream {:.1f} ns/line",
+                       name, fmt, stream);
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 200000;
+    std::string file = argc > 2 ? argv[2] : "/tmp/flexy_bench_log.txt";
+
+    auto logger = FLEXY_LOG_NAME("bench");
+    logger->setLevel(LogLevel::INFO);
+    logger->addAppender(std::make_shared<NullLogAppender>());
+    Bench("disabled", logger, count);
+
+    logger->setLevel(LogLevel::DEBUG);
+    Bench("null", logger, count);
+
+    logger->clearAppender();
+    logger->addAppender(std::make_shared<FileLogAppender>(file));
+    Bench("file", logger, count);
+
+    logger->clearAppender();
+    auto async = std::make_shared<AsyncLogAppender>(
+        std::make_shared<FileLogAppender>(file), AsyncLogAppender::kBlock);
+    logger->addAppender(async);
+    Bench("async", logger, count);
+    async->flush();
+    logger->clearAppender();
+
+    auto binary = std::make_shared<BinaryLogAppender>(file + ".bin",
+                                                      AsyncLogAppender::kBlock);
+    logger->addAppender(binary);
+    Bench("binary", logger, count);
+    binary->flush();
+    logger->clearAppender();
+    return 0;
+}
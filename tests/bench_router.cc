@@ -0,0 +1,128 @@
+#include <fnmatch.h>
+#include <chrono>
+#include <shared_mutex>
+#include <thread>
+#include "flexy/http/servlet.h"
+#include "flexy/util/log.h"
+
+// 路由查找压测: 比较旧的 unordered_map 精确查找 + 逐个 fnmatch 的 glob 列表
+// (读锁保护)和 radix tree 快照的 ServletDispatch
+// 路由为 200 个精确路由和 100 个前缀 glob, 请求各占一半, 命中 glob 的请求
+// 均匀分布在列表中
+// 用法: bench_router [每个线程的查找次数] [线程数]
+
+using namespace flexy;
+using namespace flexy::http;
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+class NamedServlet : public Servlet {
+public:
+    explicit NamedServlet(std::string_view name) : Servlet(name) {}
+    int32_t handle(const HttpRequest::ptr&, const HttpResponse::ptr&,
+                   const SockStream::ptr&) override {
+        return 0;
+    }
+};
+
+// 旧实现
+class LegacyDispatch {
+public:
+    void addServlet(const std::string& uri, const Servlet::ptr& slt) {
+        std::unique_lock lock(mutex_);
+        datas_[uri] = slt;
+    }
+    void addGlobServlet(const std::string& uri, const Servlet::ptr& slt) {
+        std::unique_lock lock(mutex_);
+        globs_.emplace_back(uri, slt);
+    }
+    Servlet::ptr getMatchedServlet(const std::string& uri) const {
+        std::shared_lock lock(mutex_);
+        auto it = datas_.find(uri);
+        if (it != datas_.end()) {
+            return it->second;
+        }
+        for (const auto& [x, y] : globs_) {
+            if (!fnmatch(x.c_str(), uri.c_str(), 0)) {
+                return y;
+            }
+        }
+        return default_;
+    }
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, Servlet::ptr> datas_;
+    std::vector<std::pair<std::string, Servlet::ptr>> globs_;
+    Servlet::ptr default_ = std::make_shared<NamedServlet>("default");
+};
+
+template <typename F>
+static double Measure(int threads, int rounds, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> ts;
+    for (int i = 0; i < threads; ++i) {
+        ts.emplace_back([&f, rounds, i]() { f(i, rounds); });
+    }
+    for (auto& t : ts) {
+        t.join();
+    }
+    std::chrono::duration<double, std::nano> used =
+        std::chrono::steady_clock::now() - start;
+    // 每个线程平均每次查找的耗时
+    return used.count() / rounds;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 1000000;
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+
+    LegacyDispatch legacy;
+    auto dispatch = std::make_shared<ServletDispatch>();
+    std::vector<std::string> paths;
+    for (int i = 0; i < 200; ++i) {
+        std::string uri = "/api/v1/service" + std::to_string(i) + "/status";
+        auto slt = std::make_shared<NamedServlet>(uri);
+        legacy.addServlet(uri, slt);
+        dispatch->addServlet(uri, slt);
+        paths.push_back(uri);
+    }
+    for (int i = 0; i < 100; ++i) {
+        std::string uri = "/assets/module" + std::to_string(i) + "/*";
+        auto slt = std::make_shared<NamedServlet>(uri);
+        legacy.addGlobServlet(uri, slt);
+        dispatch->addGlobServlet(uri, slt);
+        paths.push_back("/assets/module" + std::to_string(i) + "/js/app.min.js");
+    }
+    for (auto& p : paths) {
+        if (legacy.getMatchedServlet(p) != dispatch->getMatchedServlet(p)) {
+            FLEXY_LOG_ERROR(g_logger) << "mismatch: " << p;
+            return 1;
+        }
+    }
+
+    std::atomic<size_t> sink{0};
+    double legacy_ns = Measure(threads, rounds, [&](int id, int n) {
+        size_t local = 0;
+        for (int i = 0; i < n; ++i) {
+            local += legacy.getMatchedServlet(paths[(i + id) % paths.size()])
+                         ->getName().size();
+        }
+        sink += local;
+    });
+    double radix_ns = Measure(threads, rounds, [&](int id, int n) {
+        size_t local = 0;
+        for (int i = 0; i < n; ++i) {
+            local += dispatch->getMatchedServlet(paths[(i + id) % paths.size()])
+                         ->getName().size();
+        }
+        sink += local;
+    });
+
+    FLEXY_LOG_INFO(g_logger) << paths.size() << " routes, " << threads
+                             << " threads, sink = " << sink;
+    FLEXY_LOG_INFO(g_logger) << "legacy map + fnmatch " << legacy_ns
+                             << " ns/lookup, radix tree " << radix_ns
+                             << " ns/lookup";
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/config.h"
+#include "flexy/util/log.h"
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+static std::atomic<int> s_count = 0;
+
+// 每个任务再派生两个子任务, 形成一棵满二叉树
+static void spawn(int depth) {
+    ++s_count;
+    if (depth > 0) {
+        go std::bind(spawn, depth - 1);
+        go std::bind(spawn, depth - 1);
+    }
+}
+
+static double run(int threads, int depth) {
+    s_count = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        flexy::IOManager iom(threads, false, "bench");
+        for (int i = 0; i < threads; ++i) {
+            iom.async(spawn, depth);
+        }
+        iom.stop();
+    }
+    std::chrono::duration<double> used =
+        std::chrono::steady_clock::now() - start;
+    return s_count / used.count();
+}
+
+int main(int argc, char** argv) {
+    int depth = argc > 1 ? atoi(argv[1]) : 18;
+    FLEXY_LOG_NAME("system")->setLevel(flexy::LogLevel::INFO);
+    auto ws = flexy::Config::LookupBase("scheduler.work_stealing");
+    for (int threads : {1, 2, 4, 8, 16}) {
+        ws->fromString("0");
+        double global = run(threads, depth);
+        ws->fromString("1");
+        double stealing = run(threads, depth);
+        FLEXY_LOG_FMT_INFO(g_logger,
+                           "threads={:<2} global={:.0f} tasks/s "
+                           "work_stealing={:.0f} tasks/s ({:.2f}x)",
+                           threads, global, stealing, stealing / global);
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <array>
+#include <chrono>
+#include <deque>
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/log.h"
+#include "flexy/util/macro.h"
+#include "flexy/util/task.h"
+
+// 任务类型压测
+// 1. 构造任务 -> 放入队列 -> 取出 -> 执行, 比较旧的 __task_template 和小对象优化的 __task
+// 2. 调度器 async 并执行一个任务的平均耗时
+// 用法: bench_task [任务数]
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+using namespace flexy::detail;
+
+template <typename Task, typename Capture>
+static double RunQueue(int count) {
+    std::deque<Task> queue;
+    uint64_t sum = 0;
+    Capture capture{};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        capture[0] = i;
+        queue.emplace_back([capture, &sum]() { sum += capture[0]; });
+        Task task = std::move(queue.front());
+        queue.pop_front();
+        task();
+    }
+    std::chrono::duration<double, std::nano> used =
+        std::chrono::steady_clock::now() - start;
+    FLEXY_ASSERT(sum == (uint64_t)count * (count - 1) / 2);
+    return used.count() / count;
+}
+
+template <typename Capture>
+static double RunScheduler(int count) {
+    uint64_t sum = 0;
+    Capture capture{};
+    auto start = std::chrono::steady_clock::now();
+    {
+        flexy::IOManager iom(1, false, "bench");
+        iom.async([&]() {
+            auto iom = flexy::IOManager::GetThis();
+            for (int i = 0; i < count; ++i) {
+                capture[0] = i;
+                iom->async([capture, &sum]() { sum += capture[0]; });
+                if (i % 64 == 63) {
+                    // 让出执行权, 让调度器执行已经提交的任务
+                    iom->async(flexy::Fiber::GetThis());
+                    flexy::Fiber::Yield();
+                }
+            }
+        });
+        iom.stop();
+    }
+    std::chrono::duration<double, std::nano> used =
+        std::chrono::steady_clock::now() - start;
+    FLEXY_ASSERT(sum == (uint64_t)count * (count - 1) / 2);
+    return used.count() / count;
+}
+
+template <size_t N>
+static void Bench(int count) {
+    using Capture = std::array<uint64_t, N>;
+    FLEXY_LOG_FMT_INFO(
+        g_logger,
+        "capture={:<3} bytes queue: template {:.1f} ns, small {:.1f} ns; "
+        "scheduler {:.1f} ns/task",
+        sizeof(Capture) + sizeof(void*),
+        RunQueue<__task_template, Capture>(count),
+        RunQueue<__task, Capture>(count), RunScheduler<Capture>(count));
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    FLEXY_LOG_NAME("system")->setLevel(flexy::LogLevel::INFO);
+    Bench<1>(count);
+    Bench<3>(count);
+    Bench<7>(count);
+    Bench<16>(count);
+    return 0;
+}
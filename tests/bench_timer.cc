@@ -0,0 +1,87 @@
+#include <unistd.h>
+#include <chrono>
+#include <random>
+#include "flexy/schedule/timer.h"
+#include "flexy/util/config.h"
+#include "flexy/util/log.h"
+#include "flexy/util/util.h"
+
+static auto&& g_logger = FLEXY_LOG_ROOT();
+
+class BenchTimerManager : public flexy::TimerManager {
+public:
+    BenchTimerManager() {
+        onRefreshNearest([]() {});
+    }
+    void onTimerInsertedAtFront() override {}
+};
+
+static double Now() {
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// 模拟 do_io: 大量长连接各挂一个超时定时器, 大部分在超时前被取消
+static void BenchAddCancel(bool wheel, int n) {
+    flexy::Config::LookupBase("timer.wheel")->fromString(wheel ? "1" : "0");
+    BenchTimerManager tm;
+
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> dist(1000, 120000);
+    std::vector<flexy::Timer::ptr> timers(n);
+    for (int i = 0; i < n; ++i) {  // 已有的长连接超时定时器
+        timers[i] = tm.addTimer(dist(rng), []() {});
+    }
+
+    double start = Now();
+    for (int i = 0; i < n; ++i) {
+        auto timer = tm.addTimer(dist(rng), []() {});
+        timer->cancel();
+    }
+    double used = Now() - start;
+    FLEXY_LOG_FMT_INFO(g_logger, "{:<5} add+cancel with {} timers: {:.1f} ns/op",
+                       wheel ? "wheel" : "set", n, used * 1e9 / n);
+
+    for (auto& timer : timers) {
+        timer->cancel();
+    }
+}
+
+// 大量定时器在短时间内到期
+static void BenchExpire(bool wheel, int n) {
+    flexy::Config::LookupBase("timer.wheel")->fromString(wheel ? "1" : "0");
+    BenchTimerManager tm;
+
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> dist(0, 200);
+    for (int i = 0; i < n; ++i) {
+        tm.addTimer(dist(rng), []() {});
+    }
+
+    double used = 0;
+    size_t fired = 0;
+    while (tm.hasTimer()) {
+        uint64_t next = tm.getNextTimer();
+        if (next) {
+            usleep(next * 1000);
+        }
+        double start = Now();
+        fired += tm.listExpiriedTimer().size();
+        used += Now() - start;
+    }
+    FLEXY_LOG_FMT_INFO(g_logger, "{:<5} expire {} timers: {:.1f} ns/timer",
+                       wheel ? "wheel" : "set", fired, used * 1e9 / fired);
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    for (bool wheel : {false, true}) {
+        BenchAddCancel(wheel, n);
+    }
+    for (bool wheel : {false, true}) {
+        BenchExpire(wheel, n);
+    }
+    flexy::Config::LookupBase("timer.wheel")->fromString("0");
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/config.h"
+#include "flexy/util/log.h"
+
+using namespace flexy;
+
+// 记录写入内容的 sink, 可以模拟慢速输出
+class MemoryAppender : public LogAppender {
+public:
+    void log(Logger::ptr& logger, LogContext::ptr& context) override {}
+    void write(std::string_view data) override {
+        if (delayMs) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        }
+        LOCK_GUARD(mutex_);
+        content.append(data);
+        ++writes;
+    }
+    std::string toYamlString() const override { return "type: MemoryAppender"; }
+    std::string toJsonString() const override {
+        return "{\"type\": \"MemoryAppender\"}";
+    }
+
+    std::string content;
+    int writes = 0;
+    int delayMs = 0;
+};
+
+// 每个线程的日志按顺序到达, 不同线程之间可以交错
+static void CheckOrder(const std::string& content, int threads, int count) {
+    std::vector<int> next(threads, 0);
+    std::stringstream ss(content);
+    std::string line;
+    while (std::getline(ss, line)) {
+        int t = 0, i = 0;
+        ASSERT_EQ(sscanf(line.c_str(), "%d %d", &t, &i), 2);
+        ASSERT_EQ(i, next[t]++);
+    }
+    for (int t = 0; t < threads; ++t) {
+        ASSERT_EQ(next[t], count);
+    }
+}
+
+// 返回写入的总字节数
+static uint64_t Produce(AsyncLogAppender& appender, int threads, int count) {
+    std::atomic<uint64_t> bytes = 0;
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; ++t) {
+        ts.emplace_back([&appender, &bytes, t, count]() {
+            for (int i = 0; i < count; ++i) {
+                auto line = std::to_string(t) + " " + std::to_string(i) + "\n";
+                appender.write(line);
+                bytes += line.size();
+            }
+            appender.flush();
+        });
+    }
+    for (auto& t : ts) {
+        t.join();
+    }
+    return bytes;
+}
+
+TEST(AsyncLogAppender, Batched) {
+    auto sink = std::make_shared<MemoryAppender>();
+    {
+        AsyncLogAppender appender(sink);
+        Produce(appender, 4, 10000);
+        auto stats = appender.getStats();
+        EXPECT_EQ(stats.droppedCount, 0u);
+        EXPECT_EQ(stats.flushedBytes, sink->content.size());
+        // 合并写入, 写入次数远小于日志条数
+        EXPECT_LT(sink->writes, 4 * 10000 / 10);
+    }
+    CheckOrder(sink->content, 4, 10000);
+}
+
+TEST(AsyncLogAppender, Policy) {
+    auto size = Config::LookupBase("log.async.buffer_size");
+    auto old_size = size->toString();
+    size->fromString("4096");
+
+    auto slow = std::make_shared<MemoryAppender>();
+    slow->delayMs = 5;
+    {
+        // 缓冲区很小且 sink 很慢, 丢弃策略下会丢日志但不等待
+        AsyncLogAppender appender(slow, AsyncLogAppender::kDrop);
+        uint64_t bytes = Produce(appender, 2, 5000);
+        auto stats = appender.getStats();
+        EXPECT_GT(stats.droppedCount, 0u);
+        EXPECT_EQ(stats.flushedBytes, slow->content.size());
+        EXPECT_EQ(stats.flushedBytes + stats.droppedBytes, bytes);
+    }
+
+    auto blocking = std::make_shared<MemoryAppender>();
+    blocking->delayMs = 1;
+    {
+        // 等待策略不丢日志
+        AsyncLogAppender appender(blocking, AsyncLogAppender::kBlock);
+        Produce(appender, 2, 5000);
+        EXPECT_EQ(appender.getStats().droppedCount, 0u);
+    }
+    CheckOrder(blocking->content, 2, 5000);
+    size->fromString(old_size);
+}
+
+TEST(AsyncLogAppender, BlockInFibers) {
+    auto size = Config::LookupBase("log.async.buffer_size");
+    auto old_size = size->toString();
+    size->fromString("4096");
+
+    constexpr int kFibers = 16, kCount = 2000;
+    auto sink = std::make_shared<MemoryAppender>();
+    sink->delayMs = 1;
+    {
+        // 等待时协程可能换到其他线程, 每次都写入当前线程的缓冲区
+        AsyncLogAppender appender(sink, AsyncLogAppender::kBlock);
+        IOManager iom(4, false, "async_log");
+        for (int t = 0; t < kFibers; ++t) {
+            iom.async([&appender, t]() {
+                for (int i = 0; i < kCount; ++i) {
+                    appender.write(std::to_string(t) + " " + std::to_string(i) + "\n");
+                }
+                appender.flush();
+            });
+        }
+        iom.stop();
+        EXPECT_EQ(appender.getStats().droppedCount, 0u);
+    }
+    // 换线程前后的日志在不同缓冲区, 只检查每条都完整到达
+    std::vector<std::vector<bool>> seen(kFibers, std::vector<bool>(kCount));
+    std::stringstream ss(sink->content);
+    std::string line;
+    int lines = 0;
+    while (std::getline(ss, line)) {
+        int t = -1, i = -1;
+        ASSERT_EQ(sscanf(line.c_str(), "%d %d", &t, &i), 2) << line;
+        ASSERT_TRUE(t >= 0 && t < kFibers && i >= 0 && i < kCount) << line;
+        EXPECT_FALSE(seen[t][i]);
+        seen[t][i] = true;
+        ++lines;
+    }
+    EXPECT_EQ(lines, kFibers * kCount);
+    size->fromString(old_size);
+}
+
+TEST(AsyncLogAppender, Logger) {
+    auto sink = std::make_shared<MemoryAppender>();
+    auto appender = std::make_shared<AsyncLogAppender>(sink);
+    appender->setFormatter(std::make_shared<LogFormatter>("%p %m%n"));
+    auto logger = FLEXY_LOG_NAME("async");
+    logger->addAppender(appender);
+    FLEXY_LOG_INFO(logger) << "hello";
+    FLEXY_LOG_FMT_WARN(logger, "async {}", 1);
+    appender->flush();
+    EXPECT_EQ(sink->content, "INFO hello\nWARN async 1\n");
+    logger->clearAppender();
+
+    // 配置中的 async 字段
+    auto yaml = YAML::Load(appender->toYamlString());
+    EXPECT_TRUE(yaml["async"].as<bool>());
+    EXPECT_EQ(yaml["type"].as<std::string>(), "MemoryAppender");
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "flexy/util/binlog.h"
+#include "flexy/util/config.h"
+#include "flexy/util/log.h"
+
+using namespace flexy;
+
+static std::string TempFile(const char* name) {
+    auto path = std::string("/tmp/flexy_test_binlog_") + name + "_" +
+                std::to_string(getpid()) + ".bin";
+    unlink(path.c_str());
+    return path;
+}
+
+// Record 引用 Reader 中的定义, 复制出来
+struct Line {
+    binlog::Site site;
+    uint8_t level;
+    uint32_t threadId;
+    std::string threadName;
+    std::string loggerName;
+    std::string message;
+};
+
+static std::vector<Line> ReadAll(const std::string& path, bool* error = nullptr) {
+    std::ifstream in(path, std::ios::binary);
+    binlog::Reader reader(in);
+    std::vector<Line> records;
+    binlog::Record r;
+    while (reader.next(r)) {
+        records.push_back({*r.site, r.level, r.threadId, std::string(r.threadName),
+                           std::string(r.loggerName), r.message});
+    }
+    if (error) {
+        *error = reader.isError();
+    }
+    return records;
+}
+
+struct Point {
+    int x, y;
+};
+
+template <>
+struct fmt::formatter<Point> : fmt::formatter<std::string_view> {
+    auto format(const Point& p, fmt::format_context& ctx) const {
+        return fmt::format_to(ctx.out(), "({}, {})", p.x, p.y);
+    }
+};
+
+TEST(BinLog, RoundTrip) {
+    auto path = TempFile("round_trip");
+    auto logger = FLEXY_LOG_NAME("test_binlog");
+    logger->clearAppender();
+    logger->setLevel(LogLevel::DEBUG);
+    auto appender = std::make_shared<BinaryLogAppender>(path, AsyncLogAppender::kBlock);
+    logger->addAppender(appender);
+    EXPECT_TRUE(logger->isBinary());
+
+    std::string str = "world";
+    int line = __LINE__ + 1;
+    FLEXY_LOG_FMT_INFO(logger, "hello {} {:>5} {:.2f} {:#x}", str, -42, 3.14159, 255u);
+    FLEXY_LOG_FMT_WARN(logger, "{} {} {} {}", true, 'c', Point{1, 2}, "literal");
+    FLEXY_LOG_FMT_DEBUG(logger, "no args");
+    FLEXY_LOG_ERROR(logger) << "stream " << 7;
+    logger->setLevel(LogLevel::INFO);
+    FLEXY_LOG_FMT_DEBUG(logger, "filtered {}", 1);
+    appender->flush();
+    logger->clearAppender();
+
+    auto records = ReadAll(path);
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(records[0].message, "hello world   -42 3.14 0xff");
+    EXPECT_EQ(records[0].level, LogLevel::INFO);
+    EXPECT_EQ(records[0].site.line, line);
+    EXPECT_EQ(records[0].site.fmt, "hello {} {:>5} {:.2f} {:#x}");
+    EXPECT_EQ(records[0].loggerName, "test_binlog");
+    EXPECT_EQ(records[0].threadName, GetThreadName());
+    EXPECT_EQ(records[0].threadId, static_cast<uint32_t>(GetThreadId()));
+    EXPECT_EQ(records[1].message, "true c (1, 2) literal");
+    EXPECT_EQ(records[1].level, LogLevel::WARN);
+    EXPECT_EQ(records[2].message, "no args");
+    EXPECT_EQ(records[3].message, "stream 7");
+    EXPECT_EQ(records[3].level, LogLevel::ERROR);
+    EXPECT_EQ(records[3].site.fmt, "{}");
+    unlink(path.c_str());
+}
+
+TEST(BinLog, Threads) {
+    auto path = TempFile("threads");
+    auto logger = FLEXY_LOG_NAME("test_binlog_threads");
+    logger->clearAppender();
+    logger->setLevel(LogLevel::DEBUG);
+    auto appender = std::make_shared<BinaryLogAppender>(path, AsyncLogAppender::kBlock);
+    logger->addAppender(appender);
+
+    constexpr int kThreads = 4, kCount = 2000;
+    std::vector<std::thread> ts;
+    for (int t = 0; t < kThreads; ++t) {
+        ts.emplace_back([&logger, &appender, t]() {
+            for (int i = 0; i < kCount; ++i) {
+                FLEXY_LOG_FMT_INFO(logger, "{} {}", t, i);
+            }
+            appender->flush();
+        });
+    }
+    for (auto& t : ts) {
+        t.join();
+    }
+    logger->clearAppender();
+
+    std::vector<int> next(kThreads, 0);
+    bool error = true;
+    auto records = ReadAll(path, &error);
+    EXPECT_FALSE(error);
+    ASSERT_EQ(records.size(), static_cast<size_t>(kThreads * kCount));
+    for (auto& r : records) {
+        int t = 0, i = 0;
+        ASSERT_EQ(sscanf(r.message.c_str(), "%d %d", &t, &i), 2);
+        ASSERT_EQ(i, next[t]++);
+    }
+    unlink(path.c_str());
+}
+
+// 同一文件被先后打开两次, 第二次的定义重新编号
+TEST(BinLog, Reopen) {
+    auto path = TempFile("reopen");
+    auto logger = FLEXY_LOG_NAME("test_binlog_reopen");
+    logger->setLevel(LogLevel::DEBUG);
+    for (int round = 0; round < 2; ++round) {
+        logger->clearAppender();
+        auto appender = std::make_shared<BinaryLogAppender>(path, AsyncLogAppender::kBlock);
+        logger->addAppender(appender);
+        FLEXY_LOG_FMT_INFO(logger, "round {}", round);
+        appender->flush();
+    }
+    logger->clearAppender();
+
+    auto records = ReadAll(path);
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].message, "round 0");
+    EXPECT_EQ(records[1].message, "round 1");
+
+    // 截断的文件读到最后一条完整的记录
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(data.data(), data.size() - 3);
+    bool error = false;
+    records = ReadAll(path, &error);
+    EXPECT_TRUE(error);
+    EXPECT_EQ(records.size(), 1u);
+    unlink(path.c_str());
+}
+
+// 有文本Appender时 FLEXY_LOG_FMT_* 照常格式化
+TEST(BinLog, MixedAppenders) {
+    auto path = TempFile("mixed");
+    auto logger = FLEXY_LOG_NAME("test_binlog_mixed");
+    logger->clearAppender();
+    logger->setLevel(LogLevel::DEBUG);
+    auto appender = std::make_shared<BinaryLogAppender>(path, AsyncLogAppender::kBlock);
+    logger->addAppender(appender);
+    auto textPath = TempFile("mixed_text");
+    auto text = std::make_shared<FileLogAppender>(textPath);
+    logger->addAppender(text);
+    EXPECT_FALSE(logger->isBinary());
+    FLEXY_LOG_FMT_INFO(logger, "value {}", 1);
+    logger->delAppender(text);
+    EXPECT_TRUE(logger->isBinary());
+    appender->flush();
+    logger->clearAppender();
+
+    auto records = ReadAll(path);
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].message, "value 1");
+    EXPECT_EQ(records[0].site.fmt, "{}");
+    unlink(path.c_str());
+    unlink(textPath.c_str());
+}
+
+TEST(BinLog, Config) {
+    auto path = TempFile("config");
+    auto node = YAML::Load(
+        "logs:\n"
+        "  - name: test_binlog_config\n"
+        "    level: info\n"
+        "    appenders:\n"
+        "      - type: BinaryLogAppender\n"
+        "        file: " + path + "\n"
+        "        async_policy: block\n");
+    Config::LoadFromYaml(node);
+    auto logger = FLEXY_LOG_NAME("test_binlog_config");
+    EXPECT_TRUE(logger->isBinary());
+    auto yaml = YAML::Load(logger->toYamlString());
+    EXPECT_EQ(yaml["appenders"][0]["type"].as<std::string>(), "BinaryLogAppender");
+    EXPECT_EQ(yaml["appenders"][0]["file"].as<std::string>(), path);
+    EXPECT_EQ(yaml["appenders"][0]["async_policy"].as<std::string>(), "block");
+    logger->clearAppender();
+    unlink(path.c_str());
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
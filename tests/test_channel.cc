@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "flexy/fiber/channel.h"
+#include "flexy/schedule/iomanager.h"
+#include "flexy/thread/mpmc_queue.h"
+
+using flexy::IOManager;
+using flexy::MPMCQueue;
+using flexy::fiber::Channel;
+using flexy::fiber::SelectCase;
+
+TEST(MPMCQueue, Basic) {
+    MPMCQueue<std::unique_ptr<int>> q(3);
+    ASSERT_EQ(q.capacity(), 4u);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(q.tryPush(std::make_unique<int>(i)));
+    }
+    auto extra = std::make_unique<int>(4);
+    ASSERT_FALSE(q.tryPush(std::move(extra)));
+    ASSERT_TRUE(extra);  // 失败时不移走
+    ASSERT_TRUE(q.full());
+
+    std::unique_ptr<int> v;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(q.tryPop(v));
+        ASSERT_EQ(*v, i);
+    }
+    ASSERT_FALSE(q.tryPop(v));
+    ASSERT_TRUE(q.empty());
+    // 析构时释放剩余元素
+    q.tryPush(std::make_unique<int>(5));
+}
+
+TEST(MPMCQueue, Concurrent) {
+    static constexpr int N = 100000;
+    MPMCQueue<int> q(64);
+    std::atomic<long> sum = 0;
+    std::atomic<int> count = 0;
+    std::vector<std::thread> ts;
+    for (int p = 0; p < 2; ++p) {
+        ts.emplace_back([&q]() {
+            for (int i = 1; i <= N; ++i) {
+                while (!q.tryPush(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        ts.emplace_back([&]() {
+            int v;
+            while (count < 2 * N) {
+                if (q.tryPop(v)) {
+                    sum += v;
+                    ++count;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : ts) {
+        t.join();
+    }
+    ASSERT_EQ(count, 2 * N);
+    ASSERT_EQ(sum, 2L * N * (N + 1) / 2);
+}
+
+TEST(Channel, Buffered) {
+    Channel<std::string> ch(2);
+    ASSERT_EQ(ch.capacity(), 2u);
+    ASSERT_TRUE(ch.trySend("a"));
+    ASSERT_TRUE(ch.trySend("b"));
+    ASSERT_FALSE(ch.trySend("c"));
+    ASSERT_EQ(ch.size(), 2u);
+    std::string v;
+    ASSERT_TRUE(ch.tryRecv(v));
+    ASSERT_EQ(v, "a");
+    ch.close();
+    ASSERT_FALSE(ch.trySend("d"));
+    // 关闭后先取完缓冲区
+    ASSERT_TRUE(ch.tryRecv(v));
+    ASSERT_EQ(v, "b");
+    ASSERT_FALSE(ch.tryRecv(v));
+}
+
+// 多个生产者和消费者通过小缓冲区传递, 阻塞双方都会发生
+TEST(Channel, ProducerConsumer) {
+    static constexpr int N = 20000;
+    static constexpr int kProducers = 4;
+    Channel<std::unique_ptr<int>> ch(4);
+    std::atomic<long> sum = 0;
+    std::atomic<int> producers = kProducers;
+    {
+        IOManager iom(2, false, "channel");
+        for (int p = 0; p < kProducers; ++p) {
+            iom.async([&]() {
+                for (int i = 1; i <= N; ++i) {
+                    ASSERT_TRUE(ch.send(std::make_unique<int>(i)));
+                }
+                if (--producers == 0) {
+                    ch.close();
+                }
+            });
+        }
+        for (int c = 0; c < 3; ++c) {
+            iom.async([&]() {
+                std::unique_ptr<int> v;
+                while (ch.recv(v)) {
+                    sum += *v;
+                }
+            });
+        }
+        iom.stop();
+    }
+    ASSERT_EQ(sum, kProducers * (long)N * (N + 1) / 2);
+}
+
+TEST(Channel, Unbuffered) {
+    Channel<int> ping, pong;
+    // 没有接收方时无缓冲通道不能发送
+    ASSERT_FALSE(ping.trySend(0));
+    std::atomic<int> rounds = 0;
+    {
+        IOManager iom(2, false, "channel");
+        iom.async([&]() {
+            int v;
+            while (ping.recv(v)) {
+                pong.send(v + 1);
+            }
+            pong.close();
+        });
+        iom.async([&]() {
+            for (int i = 0; i < 1000; i += 2) {
+                ASSERT_TRUE(ping.send(i));
+                int v;
+                ASSERT_TRUE(pong.recv(v));
+                ASSERT_EQ(v, i + 1);
+                ++rounds;
+            }
+            ping.close();
+            int v;
+            ASSERT_FALSE(pong.recv(v));
+            ASSERT_FALSE(ping.send(1));
+        });
+        iom.stop();
+    }
+    ASSERT_EQ(rounds, 500);
+}
+
+TEST(Channel, Select) {
+    Channel<int> a, b(1);
+    Channel<std::string> quit;
+    std::atomic<int> fromA = 0, fromB = 0, timeouts = 0;
+    std::string reason;
+    {
+        IOManager iom(2, false, "channel");
+        iom.async([&]() {
+            int va, vb;
+            for (;;) {
+                SelectCase cases[] = {a.recvCase(va), b.recvCase(vb),
+                                      quit.recvCase(reason)};
+                int i = flexy::fiber::select(cases, 200);
+                if (i == 0) {
+                    fromA += va;
+                } else if (i == 1) {
+                    fromB += vb;
+                } else if (i == 2) {
+                    break;
+                } else {
+                    ++timeouts;
+                }
+            }
+        });
+        iom.async([&]() {
+            for (int i = 0; i < 100; ++i) {
+                ASSERT_TRUE(a.send(1));
+                ASSERT_TRUE(b.send(2));
+            }
+            // 让 select 超时一次
+            Channel<int> never;
+            ASSERT_FALSE(never.send(0, 300));
+            ASSERT_TRUE(quit.send("done"));
+        });
+        iom.stop();
+    }
+    ASSERT_EQ(fromA, 100);
+    ASSERT_EQ(fromB, 200);
+    ASSERT_GE(timeouts, 1);
+    ASSERT_EQ(reason, "done");
+}
+
+// select 中的发送分支和超时, 缓冲区满后发送分支阻塞
+TEST(Channel, SelectSendAndTimeout) {
+    Channel<int> out(2), in;
+    int got = -1;
+    int first = -2, second = -2, third = -2;
+    {
+        IOManager iom(1, false, "channel");
+        iom.async([&]() {
+            int v = 7, r;
+            SelectCase cases[] = {out.sendCase(v), in.recvCase(r)};
+            first = flexy::fiber::select(cases);
+            v = 8;
+            second = flexy::fiber::select(cases, 0);
+            third = flexy::fiber::select(cases, 50);
+            out.recv(got);
+        });
+        iom.stop();
+    }
+    ASSERT_EQ(first, 0);
+    ASSERT_EQ(second, 0);
+    ASSERT_EQ(third, -1);
+    ASSERT_EQ(got, 7);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
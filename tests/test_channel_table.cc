@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <atomic>
+#include <vector>
+#include "flexy/schedule/iomanager.h"
+
+// 当前进程可以使用的最大 fd
+static int MaxFd() {
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    return limit.rlim_cur > 65536 ? 65535 : (int)limit.rlim_cur - 1;
+}
+
+// 远超初始大小的 fd 也能注册事件, 未注册过的 fd 删除事件直接失败
+TEST(ChannelTable, HighFd) {
+    flexy::IOManager iom(1, false, "table");
+    int efd = eventfd(0, EFD_NONBLOCK);
+    int high = dup2(efd, MaxFd());
+    ASSERT_EQ(high, MaxFd());
+    EXPECT_FALSE(iom.delRead(high - 1));
+    EXPECT_FALSE(iom.cancelAll(100000));
+
+    std::atomic<bool> fired = false;
+    iom.async([&iom, high, &fired]() {
+        iom.onRead(high, [&fired]() { fired = true; });
+        uint64_t one = 1;
+        EXPECT_EQ(write(high, &one, sizeof(one)), (ssize_t)sizeof(one));
+    });
+    iom.stop();
+    EXPECT_TRUE(fired);
+    close(high);
+    close(efd);
+}
+
+// 多个线程同时在不同的页上注册和取消事件
+TEST(ChannelTable, Concurrent) {
+    static constexpr int kFds = 64;
+    std::vector<int> fds;
+    // 尽量分散到不同的页上
+    int stride = (MaxFd() - 100) / kFds;
+    for (int i = 0; i < kFds; ++i) {
+        int efd = eventfd(0, EFD_NONBLOCK);
+        int fd = dup2(efd, 100 + i * stride);
+        ASSERT_GE(fd, 0);
+        close(efd);
+        fds.push_back(fd);
+    }
+
+    std::atomic<int> count = 0;
+    {
+        flexy::IOManager iom(4, false, "table");
+        for (int fd : fds) {
+            iom.async([&iom, fd, &count]() {
+                for (int i = 0; i < 100; ++i) {
+                    iom.onRead(fd, [&count]() { ++count; });
+                    EXPECT_TRUE(iom.cancelRead(fd));
+                }
+            });
+        }
+        iom.stop();
+    }
+    EXPECT_EQ(count, kFds * 100);
+    for (int fd : fds) {
+        close(fd);
+    }
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "flexy/util/config.h"
+
+using namespace flexy;
+
+TEST(ConfigSnapshot, CacheRefresh) {
+    auto var = Config::Lookup<int>("test.snapshot.refresh", 1);
+    const int* first = &var->getValue();
+    // 版本号不变时返回同一份缓存
+    EXPECT_EQ(&var->getValue(), first);
+    EXPECT_EQ(*first, 1);
+
+    auto version = ConfigVarBase::GetVersion();
+    var->setValue(1);
+    EXPECT_EQ(ConfigVarBase::GetVersion(), version);
+    var->setValue(2);
+    EXPECT_GT(ConfigVarBase::GetVersion(), version);
+    EXPECT_EQ(var->getValue(), 2);
+    // 上一个快照仍然有效
+    EXPECT_EQ(*first, 1);
+
+    // 其他线程看到新值
+    int seen = 0;
+    std::thread([&]() { seen = var->getValue(); }).join();
+    EXPECT_EQ(seen, 2);
+}
+
+TEST(ConfigSnapshot, Snapshot) {
+    auto var = Config::Lookup<std::vector<int>>("test.snapshot.vec", {1, 2, 3});
+    auto snapshot = var->getSnapshot();
+    var->setValue({4, 5});
+    EXPECT_EQ(*snapshot, std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(var->getValue(), std::vector<int>({4, 5}));
+}
+
+TEST(ConfigSnapshot, Listener) {
+    auto var = Config::Lookup<int>("test.snapshot.listener", 0);
+    int old_seen = -1, new_seen = -1, current = -1;
+    var->addListener([&](const int& old_value, const int& new_value) {
+        old_seen = old_value;
+        new_seen = new_value;
+        // 回调时新值已经发布, 回调中可以读取和修改监听者
+        current = var->getValue();
+        var->getListener(1);
+    });
+    var->setValue(5);
+    EXPECT_EQ(old_seen, 0);
+    EXPECT_EQ(new_seen, 5);
+    EXPECT_EQ(current, 5);
+    var->clearListener();
+}
+
+// 监听者在回调中修改同一个配置项, 不会死锁
+TEST(ConfigSnapshot, ListenerSetValue) {
+    auto var = Config::Lookup<int>("test.snapshot.clamp", 0);
+    std::vector<int> seen;
+    var->addListener([&](const int&, const int& new_value) {
+        seen.push_back(new_value);
+        if (new_value > 10) {
+            var->setValue(10);
+        }
+    });
+    var->setValue(5);
+    var->setValue(100);
+    EXPECT_EQ(var->getValue(), 10);
+    EXPECT_EQ(seen, std::vector<int>({5, 100, 10}));
+    var->clearListener();
+}
+
+// 读线程不断读取, 写线程不断修改, 读到的值总是完整的某一次写入
+TEST(ConfigSnapshot, ConcurrentReadWrite) {
+    auto var = Config::Lookup<std::string>("test.snapshot.concurrent", std::string(64, 'a'));
+    std::atomic<bool> stop{false};
+    std::atomic<int> bad{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto& value = var->getValue();
+                if (value.size() != 64 || value.find_first_not_of(value[0]) != std::string::npos) {
+                    ++bad;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 2000; ++i) {
+        var->setValue(std::string(64, 'a' + i % 26));
+    }
+    stop = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+    EXPECT_EQ(bad.load(), 0);
+    EXPECT_EQ(var->getValue(), std::string(64, 'a' + 1999 % 26));
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
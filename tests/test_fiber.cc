@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <vector>
+#include "flexy/fiber/allocator.h"
 #include "flexy/fiber/fiber.h"
 #include "flexy/util/log.h"
 #include "flexy/util/memory.h"
@@ -67,6 +68,46 @@ TEST(Fiber, Main) {
     }
 }
 
+TEST(Fiber, StackPool) {
+    auto before = PooledStackAllocator::GetStats();
+    {
+        auto fiber1 = flexy::fiber_make_shared(64 * 1024, []() {});
+        auto fiber2 = flexy::fiber_make_shared(64 * 1024, []() {});
+        auto stats = PooledStackAllocator::GetStats();
+        ASSERT_EQ(stats.outstanding, before.outstanding + 2);
+    }
+    auto after_free = PooledStackAllocator::GetStats();
+    ASSERT_EQ(after_free.outstanding, before.outstanding);
+    {
+        // 相同大小类的栈从线程缓存中复用
+        auto fiber = flexy::fiber_make_shared(64 * 1024, []() {});
+        auto stats = PooledStackAllocator::GetStats();
+        ASSERT_EQ(stats.hits, after_free.hits + 1);
+        ASSERT_EQ(stats.misses, after_free.misses);
+    }
+}
+
+static int overflow(int depth) {
+    volatile char buf[1024];
+    buf[0] = (char)depth;
+    if (depth >= 0) {  // 实际上不会终止, 直到撞上保护页
+        return overflow(depth + 1) + buf[0];
+    }
+    return buf[0];
+}
+
+TEST(FiberDeathTest, StackGuard) {
+    ASSERT_DEATH(
+        {
+            flexy::Fiber::GetThis();
+            auto fiber = flexy::fiber_make_shared(16 * 1024, []() {
+                overflow(0);
+            });
+            fiber->resume();
+        },
+        "");
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -1,16 +1,22 @@
-#include <flexy/fiber/mutex.h>
-#include <flexy/schedule/iomanager.h>
-#include <flexy/util/log.h>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <vector>
+#include "flexy/fiber/mutex.h"
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/log.h"
+
+using flexy::IOManager;
+namespace fiber = flexy::fiber;
 
 static auto& g_logger = FLEXY_LOG_ROOT();
 
-int sum;
+static int sum;
 
-flexy::fiber::mutex mutex;
+static flexy::fiber::mutex mutex;
 // flexy::NullMutex mutex;
 // flexy::mutex mutex;
 
-void add() {
+static void add() {
     LOCK_GUARD(mutex);
     for (int i = 0; i < 1000000; ++i) {
         ++sum;
@@ -18,7 +24,7 @@ void add() {
     FLEXY_LOG_DEBUG(g_logger) << "add finish!";
 }
 
-void diff() {
+static void diff() {
     LOCK_GUARD(mutex);
     for (int i = 0; i < 500000; ++i) {
         --sum;
@@ -26,11 +32,91 @@ void diff() {
     FLEXY_LOG_DEBUG(g_logger) << "diff finish!";
 }
 
-int main() {
+TEST(FiberMutex, Sum) {
     flexy::Scheduler iom(2);
     iom.start();
     iom.async(add);
     iom.async(diff);
     iom.stop();
     FLEXY_LOG_DEBUG(g_logger) << "sum = " << sum;
-}
\ No newline at end of file
+    EXPECT_EQ(sum, 500000);
+}
+
+// 让出执行权并重新排队
+static void Reschedule() {
+    flexy::Scheduler::GetThis()->async(flexy::Fiber::GetThis());
+    flexy::Fiber::Yield();
+}
+
+// 多个协程在多个线程上竞争同一把锁, 临界区内的非原子计数不能丢失
+static void Contend(fiber::mutex& mtx, int fibers, int rounds) {
+    int64_t sum = 0;
+    {
+        IOManager iom(2, false, "mutex");
+        for (int i = 0; i < fibers; ++i) {
+            iom.async([&]() {
+                for (int j = 0; j < rounds; ++j) {
+                    std::lock_guard lock(mtx);
+                    ++sum;
+                    if (j % 64 == 0) {
+                        // 持有锁时让出, 迫使其他协程挂起
+                        Reschedule();
+                    }
+                }
+            });
+        }
+        iom.stop();
+    }
+    ASSERT_EQ(sum, (int64_t)fibers * rounds);
+}
+
+TEST(FiberMutex, Barging) {
+    fiber::mutex mtx;
+    ASSERT_TRUE(mtx.try_lock());
+    ASSERT_FALSE(mtx.try_lock());
+    mtx.unlock();
+    Contend(mtx, 8, 5000);
+    auto stats = mtx.getStats();
+    EXPECT_GT(stats.contended, 0u);
+    EXPECT_EQ(stats.handoffs, 0u);
+}
+
+TEST(FiberMutex, Handoff) {
+    fiber::mutex mtx(fiber::mutex::kHandoff);
+    Contend(mtx, 8, 5000);
+    auto stats = mtx.getStats();
+    EXPECT_GT(stats.parked, 0u);
+    EXPECT_GT(stats.handoffs, 0u);
+}
+
+// 交接模式下挂起的协程按先来先得的顺序获得锁
+TEST(FiberMutex, HandoffOrder) {
+    fiber::mutex mtx(fiber::mutex::kHandoff);
+    std::vector<int> arrive, order;
+    {
+        IOManager iom(1, false, "mutex");
+        iom.async([&]() {
+            mtx.lock();
+            for (int i = 0; i < 5; ++i) {
+                flexy::IOManager::GetThis()->async([&, i]() {
+                    arrive.push_back(i);
+                    std::lock_guard lock(mtx);
+                    order.push_back(i);
+                });
+            }
+            // 等待其他协程全部挂起
+            for (int i = 0; i < 10; ++i) {
+                Reschedule();
+            }
+            mtx.unlock();
+        });
+        iom.stop();
+    }
+    ASSERT_EQ(arrive.size(), 5u);
+    ASSERT_EQ(order, arrive);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
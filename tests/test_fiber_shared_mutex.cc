@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include "flexy/fiber/mutex.h"
+#include "flexy/schedule/iomanager.h"
+
+using flexy::IOManager;
+namespace fiber = flexy::fiber;
+
+// 让出执行权并重新排队
+static void Reschedule() {
+    flexy::Scheduler::GetThis()->async(flexy::Fiber::GetThis());
+    flexy::Fiber::Yield();
+}
+
+TEST(FiberSharedMutex, ReadersAndWriters) {
+    fiber::shared_mutex mtx;
+    ASSERT_TRUE(mtx.try_lock_shared());
+    ASSERT_TRUE(mtx.try_lock_shared());
+    ASSERT_FALSE(mtx.try_lock());
+    mtx.unlock_shared();
+    mtx.unlock_shared();
+    ASSERT_TRUE(mtx.try_lock());
+    ASSERT_FALSE(mtx.try_lock_shared());
+    mtx.unlock();
+
+    // 写者保持 a == b, 读者检查不会看到写了一半的状态
+    int64_t a = 0, b = 0;
+    std::atomic<int> readers = 0, max_readers = 0;
+    std::atomic<bool> broken = false;
+    {
+        IOManager iom(2, false, "shared_mutex");
+        for (int i = 0; i < 4; ++i) {
+            iom.async([&]() {
+                for (int j = 0; j < 2000; ++j) {
+                    std::unique_lock lock(mtx);
+                    ++a;
+                    Reschedule();
+                    ++b;
+                }
+            });
+        }
+        for (int i = 0; i < 8; ++i) {
+            iom.async([&]() {
+                for (int j = 0; j < 2000; ++j) {
+                    std::shared_lock lock(mtx);
+                    int n = ++readers;
+                    int m = max_readers;
+                    while (n > m && !max_readers.compare_exchange_weak(m, n)) {
+                    }
+                    if (a != b) {
+                        broken = true;
+                    }
+                    Reschedule();
+                    --readers;
+                }
+            });
+        }
+        iom.stop();
+    }
+    ASSERT_FALSE(broken);
+    ASSERT_EQ(a, 4 * 2000);
+    ASSERT_EQ(b, 4 * 2000);
+    // 读者之间可以并发
+    ASSERT_GT(max_readers, 1);
+    auto stats = mtx.getStats();
+    EXPECT_GT(stats.parked, 0u);
+    EXPECT_GT(stats.handoffs, 0u);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
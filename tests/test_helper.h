@@ -0,0 +1,131 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include "flexy/net/address.h"
+#include "flexy/net/socket.h"
+#include "flexy/util/util.h"
+
+// 测试用的服务器, 绑定端口 0 后通过 getAddress 取得实际监听的地址
+template <typename Server>
+class TestServerT : public Server {
+public:
+    using Server::Server;
+    flexy::Address::ptr getAddress() const {
+        return this->socks_[0]->getLocalAddress();
+    }
+};
+
+// 测试用的 HTTP/1.1 客户端, 读取 Content-Length 或 chunked 编码的响应, 头部名转为小写
+class Client {
+public:
+    explicit Client(const flexy::Address::ptr& addr)
+        : sock_(flexy::Socket::CreateTCP(addr->getFamily())) {
+        sock_->connect(addr);
+    }
+
+    struct Response {
+        int status = 0;
+        std::string header;                         // 包括结尾空行的原始头部
+        std::map<std::string, std::string> headers;
+        std::string body;
+        bool chunked = false;
+    };
+
+    bool send(const std::string& data) {
+        return sock_->send(data.data(), data.size()) == (ssize_t)data.size();
+    }
+
+    // 读取一个响应, 连接关闭时返回 false; until_close 为 true 时消息体读到连接关闭
+    bool recv(Response& rsp, bool until_close = false) {
+        return readHeader(rsp) && readBody(rsp, until_close);
+    }
+
+    // 发送请求并读取响应, head 为 true 时不读取消息体
+    bool request(const std::string& req, Response& rsp, bool head = false) {
+        return send(req) && readHeader(rsp) && (head || readBody(rsp, false));
+    }
+
+    flexy::Socket::ptr& getSocket() { return sock_; }
+
+private:
+    bool readHeader(Response& rsp) {
+        size_t pos;
+        while ((pos = buffer_.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        rsp = Response();
+        rsp.header = buffer_.substr(0, pos + 4);
+        buffer_.erase(0, pos + 4);
+        rsp.status = std::stoi(rsp.header.substr(9, 3));
+        size_t begin = rsp.header.find("\r\n") + 2;
+        while (begin < pos) {
+            size_t end = rsp.header.find("\r\n", begin);
+            std::string line = rsp.header.substr(begin, end - begin);
+            auto colon = line.find(':');
+            rsp.headers[flexy::ToLower(line.substr(0, colon))] =
+                flexy::Trim(line.substr(colon + 1), " ");
+            begin = end + 2;
+        }
+        auto it = rsp.headers.find("transfer-encoding");
+        rsp.chunked = it != rsp.headers.end() && it->second == "chunked";
+        return true;
+    }
+
+    bool readBody(Response& rsp, bool until_close) {
+        if (until_close) {
+            while (fill()) {
+            }
+            rsp.body.swap(buffer_);
+            return true;
+        }
+        if (!rsp.chunked) {
+            auto it = rsp.headers.find("content-length");
+            size_t len = it == rsp.headers.end() ? 0 : std::stoul(it->second);
+            return readFix(len, rsp.body);
+        }
+        while (true) {
+            size_t pos;
+            while ((pos = buffer_.find("\r\n")) == std::string::npos) {
+                if (!fill()) {
+                    return false;
+                }
+            }
+            size_t len = std::stoul(buffer_.substr(0, pos), nullptr, 16);
+            buffer_.erase(0, pos + 2);
+            if (!readFix(len + 2, rsp.body)) {
+                return false;
+            }
+            rsp.body.resize(rsp.body.size() - 2);
+            if (len == 0) {
+                return true;
+            }
+        }
+    }
+
+    bool fill() {
+        char buf[4096];
+        int n = sock_->recv(buf, sizeof(buf));
+        if (n <= 0) {
+            return false;
+        }
+        buffer_.append(buf, n);
+        return true;
+    }
+
+    bool readFix(size_t len, std::string& out) {
+        while (buffer_.size() < len) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        out.append(buffer_, 0, len);
+        buffer_.erase(0, len);
+        return true;
+    }
+
+    flexy::Socket::ptr sock_;
+    std::string buffer_;
+};
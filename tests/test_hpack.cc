@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <deque>
+#include <random>
+#include "flexy/http2/hpack.h"
+
+using namespace flexy::http2;
+
+using Headers = std::vector<std::pair<std::string, std::string>>;
+
+static std::string ToHex(const std::string& data) {
+    static const char* digits = "0123456789abcdef";
+    std::string out;
+    for (unsigned char c : data) {
+        out.push_back(digits[c >> 4]);
+        out.push_back(digits[c & 0xf]);
+    }
+    return out;
+}
+
+TEST(DynamicTable, StaticLookup) {
+    for (uint32_t i = 1; i < DynamicTable::kStaticSize; ++i) {
+        auto [name, value] = DynamicTable::GetStaticHeaders(i);
+        int32_t first = DynamicTable::GetStaticHeadersIndex(name);
+        ASSERT_GT(first, 0);
+        EXPECT_LE((uint32_t)first, i);
+        EXPECT_EQ(DynamicTable::GetStaticHeaders(first).first, name);
+        EXPECT_EQ(DynamicTable::GetStaticHeadersPair(name, value),
+                  std::make_pair((int32_t)i, true));
+    }
+    EXPECT_EQ(DynamicTable::GetStaticHeadersIndex(":status"), 8);
+    EXPECT_EQ(DynamicTable::GetStaticHeadersPair(":status", "404"),
+              std::make_pair(13, true));
+    EXPECT_EQ(DynamicTable::GetStaticHeadersPair(":status", "302"),
+              std::make_pair(8, false));
+    EXPECT_EQ(DynamicTable::GetStaticHeadersIndex("x-custom"), -1);
+    EXPECT_EQ(DynamicTable::GetStaticHeadersIndex(""), -1);
+    EXPECT_EQ(DynamicTable::GetStaticHeadersIndex("Host"), -1);
+}
+
+// 与按 RFC 7541 直接实现的线性表比较
+TEST(DynamicTable, MatchesLinearTable) {
+    std::mt19937 rng(7);
+    DynamicTable table;
+    std::deque<std::pair<std::string, std::string>> model;  // 最新的在前
+    int32_t max_size = 4096, data_size = 0;
+    auto evict = [&]() {
+        auto& [n, v] = model.back();
+        data_size -= DynamicTable::EntrySize(n, v);
+        model.pop_back();
+    };
+    for (int i = 0; i < 20000; ++i) {
+        if (rng() % 500 == 0) {
+            max_size = rng() % 5000;
+            table.sexMaxDataSize(max_size);
+            while (data_size > max_size) {
+                evict();
+            }
+        }
+        std::string name = "x-name-" + std::to_string(rng() % 40);
+        std::string value(rng() % 300, 'a' + rng() % 4);
+        table.update(name, value);
+        int32_t len = DynamicTable::EntrySize(name, value);
+        while (!model.empty() && data_size + len > max_size) {
+            evict();
+        }
+        if (len <= max_size) {
+            model.emplace_front(name, value);
+            data_size += len;
+        }
+        ASSERT_EQ(table.size(), model.size());
+        ASSERT_EQ(table.getDataSize(), data_size);
+
+        std::string query = "x-name-" + std::to_string(rng() % 40);
+        std::string qvalue(rng() % 300, 'a' + rng() % 4);
+        int32_t name_idx = -1;
+        std::pair<int32_t, bool> expect(-1, false);
+        for (size_t j = 0; j < model.size(); ++j) {
+            if (model[j].first != query) {
+                continue;
+            }
+            if (name_idx == -1) {
+                name_idx = j + DynamicTable::kStaticSize;
+                expect.first = name_idx;
+            }
+            if (model[j].second == qvalue) {
+                expect = {j + DynamicTable::kStaticSize, true};
+                break;
+            }
+        }
+        ASSERT_EQ(table.findPair(query, qvalue), expect);
+        ASSERT_EQ(table.findIndex(query), name_idx);
+        if (!model.empty()) {
+            size_t j = rng() % model.size();
+            auto [n, v] = table.getPair(j + DynamicTable::kStaticSize);
+            ASSERT_EQ(n, model[j].first);
+            ASSERT_EQ(v, model[j].second);
+        }
+    }
+}
+
+// https://httpwg.org/specs/rfc7541.html#request.examples.with.huffman.coding
+TEST(HPack, RfcRequestExamples) {
+    DynamicTable send_table, recv_table;
+    std::pair<Headers, std::string> requests[] = {
+        {{{":method", "GET"},
+          {":scheme", "http"},
+          {":path", "/"},
+          {":authority", "www.example.com"}},
+         "828684418cf1e3c2e5f23a6ba0ab90f4ff"},
+        {{{":method", "GET"},
+          {":scheme", "http"},
+          {":path", "/"},
+          {":authority", "www.example.com"},
+          {"cache-control", "no-cache"}},
+         "828684be5886a8eb10649cbf"},
+        {{{":method", "GET"},
+          {":scheme", "https"},
+          {":path", "/index.html"},
+          {":authority", "www.example.com"},
+          {"custom-key", "custom-value"}},
+         "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"},
+    };
+    for (auto& [headers, hex] : requests) {
+        std::string block;
+        HPack(send_table).pack(headers, block);
+        EXPECT_EQ(ToHex(block), hex);
+        HPack decoder(recv_table);
+        ASSERT_GE(decoder.parse(block), 0);
+        ASSERT_EQ(decoder.getHeaders().size(), headers.size());
+        for (size_t i = 0; i < headers.size(); ++i) {
+            EXPECT_EQ(decoder.getHeaders()[i].name, headers[i].first);
+            EXPECT_EQ(decoder.getHeaders()[i].value, headers[i].second);
+        }
+    }
+    EXPECT_EQ(send_table.getDataSize(), 164);
+    EXPECT_EQ(send_table.getPair(62).first, "custom-key");
+    EXPECT_EQ(send_table.getPair(64).first, ":authority");
+    EXPECT_EQ(recv_table.getDataSize(), 164);
+}
+
+TEST(HPack, PackRepresentations) {
+    DynamicTable send_table, recv_table;
+    Headers headers = {{"authorization", "Bearer token"},
+                       {"x-trace", std::string(5000, 't')},
+                       {"x-grpc", "1"}};
+    for (int i = 0; i < 2; ++i) {
+        HPack encoder(send_table);
+        std::string block;
+        encoder.pack(headers, block);
+        auto& fields = encoder.getHeaders();
+        ASSERT_EQ(fields.size(), 3u);
+        EXPECT_EQ(fields[0].type, IndexType::NEVER_INDEXED_INDEXED_NAME);
+        EXPECT_EQ(fields[0].index, 23u);
+        EXPECT_EQ(fields[1].type, IndexType::WITHOUT_INDEXING_NEW_NAME);
+        // 第二次 x-grpc 已经在动态表中
+        EXPECT_EQ(fields[2].type, i == 0 ? IndexType::WITH_INDEXING_NEW_NAME
+                                         : IndexType::INDEXED);
+
+        HPack decoder(recv_table);
+        ASSERT_GE(decoder.parse(block), 0);
+        ASSERT_EQ(decoder.getHeaders().size(), 3u);
+        for (size_t j = 0; j < headers.size(); ++j) {
+            EXPECT_EQ(decoder.getHeaders()[j].type, fields[j].type);
+            EXPECT_EQ(decoder.getHeaders()[j].name, headers[j].first);
+            EXPECT_EQ(decoder.getHeaders()[j].value, headers[j].second);
+        }
+    }
+    EXPECT_EQ(send_table.size(), 1u);
+    EXPECT_EQ(recv_table.size(), 1u);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
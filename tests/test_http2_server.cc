@@ -0,0 +1,451 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include "flexy/http2/http2_server.h"
+#include "flexy/net/address.h"
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/hash_util.h"
+#include "test_helper.h"
+
+using namespace flexy;
+using namespace flexy::http2;
+
+using Headers = std::vector<std::pair<std::string, std::string>>;
+
+// 测试用的 HTTP/2 客户端, 直接收发帧
+class H2Client {
+public:
+    explicit H2Client(const Socket::ptr& sock)
+        : stream_(std::make_shared<SockStream>(sock, false)) {}
+
+    bool sendPreface(const std::vector<SettingsItem>& items = {}) {
+        if (stream_->writeFixSize(Http2Session::kPreface.data(),
+                                  Http2Session::kPreface.size()) <= 0) {
+            return false;
+        }
+        auto settings = std::make_shared<SettingsFrame>();
+        settings->items = items;
+        return sendFrame(FrameType::SETTINGS, 0, 0, settings);
+    }
+
+    bool sendFrame(FrameType type, uint8_t flags, uint32_t id,
+                   const IFrame::ptr& data) {
+        auto frame = std::make_shared<Frame>();
+        frame->header.len_type = 0;
+        frame->header.r_id = 0;
+        frame->header.type = static_cast<uint8_t>(type);
+        frame->header.flags = flags;
+        frame->header.identifier = id;
+        frame->data = data;
+        return (ssize_t)codec_.serializeTo(stream_.get(), frame) > 0;
+    }
+
+    bool sendRequest(uint32_t id, const std::string& path,
+                     const std::string& body = "", const Headers& extra = {}) {
+        Headers headers = {{":method", body.empty() ? "GET" : "POST"},
+                           {":scheme", "http"},
+                           {":path", path},
+                           {":authority", "localhost"}};
+        headers.insert(headers.end(), extra.begin(), extra.end());
+        auto frame = std::make_shared<HeadersFrame>();
+        HPack hpack(sendTable_);
+        hpack.pack(headers, frame->data);
+        uint8_t flags = static_cast<uint8_t>(FrameFlagHeaders::END_HEADERS);
+        if (body.empty()) {
+            flags |= static_cast<uint8_t>(FrameFlagHeaders::END_STREAM);
+        }
+        if (!sendFrame(FrameType::HEADERS, flags, id, frame)) {
+            return false;
+        }
+        if (body.empty()) {
+            return true;
+        }
+        // 按默认的 SETTINGS_MAX_FRAME_SIZE 分帧
+        for (size_t offset = 0; offset < body.size(); offset += 16384) {
+            auto data = std::make_shared<DataFrame>();
+            data->data = body.substr(offset, 16384);
+            bool last = offset + 16384 >= body.size();
+            if (!sendFrame(FrameType::DATA,
+                           last ? static_cast<uint8_t>(FrameFlagData::END_STREAM)
+                                : 0,
+                           id, data)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool sendWindowUpdate(uint32_t id, uint32_t increment) {
+        auto update = std::make_shared<WindowUpdateFrame>();
+        update->increment = increment;
+        return sendFrame(FrameType::WINDOW_UPDATE, 0, id, update);
+    }
+
+    // 读取一个帧, 解码响应头部并累计响应消息体
+    Frame::ptr recv() {
+        auto frame = codec_.parseFrom(stream_.get());
+        if (!frame) {
+            return nullptr;
+        }
+        uint32_t id = frame->header.identifier;
+        switch (static_cast<FrameType>(frame->header.type)) {
+            case FrameType::HEADERS:
+            case FrameType::CONTINUATION: {
+                auto headers = std::static_pointer_cast<HeadersFrame>(frame->data);
+                block_.append(headers->data);
+                if (frame->header.flags &
+                    static_cast<uint8_t>(FrameFlagHeaders::END_HEADERS)) {
+                    HPack hpack(recvTable_);
+                    EXPECT_GE(hpack.parse(block_), 0);
+                    for (auto& h : hpack.getHeaders()) {
+                        headers_[id].emplace_back(h.name, h.value);
+                    }
+                    block_.clear();
+                }
+                break;
+            }
+            case FrameType::DATA:
+                bodies_[id].append(
+                    std::static_pointer_cast<DataFrame>(frame->data)->data);
+                break;
+            default:
+                break;
+        }
+        if (id && (frame->header.flags &
+                   static_cast<uint8_t>(FrameFlagData::END_STREAM))) {
+            ended_.insert(id);
+        }
+        return frame;
+    }
+
+    // 读取帧直到 ids 中的流全部结束
+    bool waitStreams(const std::set<uint32_t>& ids) {
+        while (!std::includes(ended_.begin(), ended_.end(), ids.begin(),
+                              ids.end())) {
+            if (!recv()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string getHeader(uint32_t id, const std::string& name) {
+        for (auto& [k, v] : headers_[id]) {
+            if (k == name) {
+                return v;
+            }
+        }
+        return "";
+    }
+    std::string& getBody(uint32_t id) { return bodies_[id]; }
+    bool isEnded(uint32_t id) { return ended_.count(id); }
+    SockStream::ptr& getStream() { return stream_; }
+
+private:
+    SockStream::ptr stream_;
+    FrameCodec codec_;
+    DynamicTable sendTable_;
+    DynamicTable recvTable_;
+    std::string block_;
+    std::map<uint32_t, Headers> headers_;
+    std::map<uint32_t, std::string> bodies_;
+    std::set<uint32_t> ended_;
+};
+
+using TestServer = TestServerT<Http2Server>;
+
+static constexpr size_t kFileSize = 200 * 1024;
+
+// 在 IOManager 中启动 Http2Server 并运行 cb(地址)
+// workers 大于 0 时连接在另外的 workers 个线程中处理, 监听和 cb 仍在单线程中运行
+template <typename F>
+static void RunServer(F&& cb, size_t workers = 0) {
+    std::unique_ptr<IOManager> worker;
+    if (workers) {
+        worker = std::make_unique<IOManager>(workers, false, "http2_worker");
+    }
+    // /file 的响应为 kFileSize 字节的临时文件, 请求头 x-length 可以声明更大的长度
+    std::shared_ptr<FILE> file(tmpfile(), fclose);
+    for (size_t i = 0; i < kFileSize; ++i) {
+        fputc('a' + i % 26, file.get());
+    }
+    fflush(file.get());
+    IOManager iom(1, false, "http2");
+    iom.async([&]() {
+        auto server = std::make_shared<TestServer>(
+            true, worker ? worker.get() : &iom, &iom, &iom);
+        auto dispatch = server->getServletDispatch();
+        dispatch->addServlet("/hello", [](const http::HttpRequest::ptr& req,
+                                          const http::HttpResponse::ptr& rsp,
+                                          const SockStream::ptr&) {
+            rsp->setHeader("Content-Type", "text/plain");
+            rsp->setBody("hello " + std::to_string(req->getStreamId()));
+            return 0;
+        });
+        dispatch->addServlet("/echo", [](const http::HttpRequest::ptr& req,
+                                         const http::HttpResponse::ptr& rsp,
+                                         const SockStream::ptr&) {
+            rsp->setBody(std::string(req->getBody()));
+            return 0;
+        });
+        dispatch->addServlet("/large", [](const http::HttpRequest::ptr& req,
+                                          const http::HttpResponse::ptr& rsp,
+                                          const SockStream::ptr&) {
+            rsp->setBody(std::string(1 << 20, 'l'));
+            return 0;
+        });
+        dispatch->addServlet("/file", [&file](const http::HttpRequest::ptr& req,
+                                              const http::HttpResponse::ptr& rsp,
+                                              const SockStream::ptr&) {
+            auto length = req->getHeader("x-length");
+            rsp->setBodyFile(file, fileno(file.get()), 0,
+                             length.empty() ? kFileSize : std::stoul(length));
+            return 0;
+        });
+        ASSERT_TRUE(server->bind(IPv4Address::Create("127.0.0.1")));
+        server->start();
+        cb(server->getAddress());
+        server->stop();
+    });
+}
+
+TEST(HPack, DynamicTableSizeUpdate) {
+    DynamicTable send_table, recv_table;
+    Headers headers = {{":method", "GET"}, {"x-custom", "value"}};
+    std::string block;
+    HPack(send_table).pack(headers, block);
+    EXPECT_EQ(send_table.size(), 1u);
+
+    HPack decoder(recv_table, 4096);
+    ASSERT_GE(decoder.parse(block), 0);
+    ASSERT_EQ(decoder.getHeaders().size(), 2u);
+    EXPECT_EQ(decoder.getHeaders()[1].value, "value");
+    EXPECT_EQ(recv_table.size(), 1u);
+
+    // 大小更新为 0 清空动态表, 之后引用动态表中的字段是错误
+    auto ba = std::make_shared<ByteArray>();
+    HPack::WriteVarInt<5, true>(ba, 0);
+    HPack::WriteVarInt<7, true>(ba, 62);
+    ba->setPosition(0);
+    std::string update = ba->toString();
+    HPack decoder2(recv_table, 4096);
+    EXPECT_LT(decoder2.parse(update), 0);
+    EXPECT_EQ(recv_table.size(), 0u);
+
+    // 大小更新不能超过 SETTINGS_HEADER_TABLE_SIZE
+    ba = std::make_shared<ByteArray>();
+    HPack::WriteVarInt<5, true>(ba, 8192);
+    ba->setPosition(0);
+    update = ba->toString();
+    HPack decoder3(recv_table, 4096);
+    EXPECT_LT(decoder3.parse(update), 0);
+}
+
+TEST(Http2Server, Multiplex) {
+    RunServer([](const Address::ptr& addr) {
+        auto sock = Socket::CreateTCP(addr->getFamily());
+        ASSERT_TRUE(sock->connect(addr));
+        H2Client client(sock);
+        ASSERT_TRUE(client.sendPreface());
+        std::string body(60 * 1024, 'b');
+        ASSERT_TRUE(client.sendRequest(1, "/hello"));
+        ASSERT_TRUE(client.sendRequest(3, "/echo", body));
+        ASSERT_TRUE(client.sendRequest(5, "/hello"));
+        ASSERT_TRUE(client.waitStreams({1, 3, 5}));
+        EXPECT_EQ(client.getHeader(1, ":status"), "200");
+        EXPECT_EQ(client.getHeader(1, "content-type"), "text/plain");
+        EXPECT_EQ(client.getBody(1), "hello 1");
+        EXPECT_EQ(client.getBody(5), "hello 5");
+        EXPECT_EQ(client.getHeader(3, "content-length"),
+                  std::to_string(body.size()));
+        EXPECT_EQ(client.getBody(3), body);
+        sock->close();
+    });
+}
+
+TEST(Http2Server, FlowControl) {
+    RunServer([](const Address::ptr& addr) {
+        auto sock = Socket::CreateTCP(addr->getFamily());
+        ASSERT_TRUE(sock->connect(addr));
+        H2Client client(sock);
+        // 流级窗口只有 100 字节, 服务端发送 100 字节后等待 WINDOW_UPDATE
+        ASSERT_TRUE(client.sendPreface(
+            {{(uint16_t)SettingsFrame::Settings::INITIAL_WINDOW_SIZE, 100}}));
+        std::string body(1000, 'f');
+        ASSERT_TRUE(client.sendRequest(1, "/echo", body));
+        while (client.getBody(1).size() < 100) {
+            ASSERT_TRUE(client.recv());
+        }
+        EXPECT_EQ(client.getBody(1).size(), 100u);
+        EXPECT_FALSE(client.isEnded(1));
+        ASSERT_TRUE(client.sendWindowUpdate(1, 900));
+        ASSERT_TRUE(client.waitStreams({1}));
+        EXPECT_EQ(client.getBody(1), body);
+        sock->close();
+    });
+}
+
+// 连接级窗口溢出时服务端可能正在为其他流写头部和消息体
+// 连接在多个线程中处理并反复运行, 发送 GOAWAY 与写响应的锁顺序不一致时会死锁
+TEST(Http2Server, WindowOverflowWhileStreaming) {
+    RunServer([](const Address::ptr& addr) {
+        for (int i = 0; i < 50; ++i) {
+            auto sock = Socket::CreateTCP(addr->getFamily());
+            ASSERT_TRUE(sock->connect(addr));
+            H2Client client(sock);
+            ASSERT_TRUE(client.sendPreface(
+                {{(uint16_t)SettingsFrame::Settings::INITIAL_WINDOW_SIZE,
+                  0x7fffffffu}}));
+            for (uint32_t id = 1; id < 16; id += 2) {
+                ASSERT_TRUE(client.sendRequest(id, "/large"));
+            }
+            // 等到服务端开始发送消息体, 连接级窗口由哪个流占用不确定
+            Frame::ptr frame;
+            do {
+                frame = client.recv();
+                ASSERT_TRUE(frame);
+            } while (frame->header.type != static_cast<uint8_t>(FrameType::DATA));
+            // 连接级窗口不超过默认的 65535, 第一次增加后接近上限但不会溢出
+            // 服务端全速发送 8MB 也用不完, 第二次增加一定溢出
+            ASSERT_TRUE(client.sendWindowUpdate(0, 0x7fffffffu - 65535));
+            ASSERT_TRUE(client.sendWindowUpdate(0, 0x7fffffffu));
+            // 服务端发送 FLOW_CONTROL_ERROR 的 GOAWAY 后关闭连接
+            bool goaway = false;
+            while ((frame = client.recv())) {
+                if (frame->header.type ==
+                    static_cast<uint8_t>(FrameType::GOAWAY)) {
+                    auto data =
+                        std::static_pointer_cast<GoAwayFrame>(frame->data);
+                    EXPECT_EQ(data->error_code,
+                              static_cast<uint32_t>(
+                                  Http2Error::FLOW_CONTROL_ERROR));
+                    goaway = true;
+                }
+            }
+            EXPECT_TRUE(goaway);
+            sock->close();
+        }
+    }, 4);
+}
+
+TEST(Http2Server, FileBody) {
+    RunServer([](const Address::ptr& addr) {
+        auto sock = Socket::CreateTCP(addr->getFamily());
+        ASSERT_TRUE(sock->connect(addr));
+        H2Client client(sock);
+        ASSERT_TRUE(client.sendPreface());
+        // 文件比连接级窗口大, 分多次按窗口读取发送
+        ASSERT_TRUE(client.sendRequest(1, "/file"));
+        while (client.getBody(1).size() < 65535) {
+            ASSERT_TRUE(client.recv());
+        }
+        ASSERT_TRUE(client.sendWindowUpdate(0, kFileSize));
+        ASSERT_TRUE(client.sendWindowUpdate(1, kFileSize));
+        ASSERT_TRUE(client.waitStreams({1}));
+        EXPECT_EQ(client.getHeader(1, "content-length"), std::to_string(kFileSize));
+        auto& body = client.getBody(1);
+        ASSERT_EQ(body.size(), kFileSize);
+        for (size_t i = 0; i < kFileSize; ++i) {
+            ASSERT_EQ(body[i], (char)('a' + i % 26));
+        }
+
+        // 声明的长度超过文件大小, 读不全时重置流
+        ASSERT_TRUE(client.sendWindowUpdate(0, kFileSize));
+        ASSERT_TRUE(client.sendRequest(
+            3, "/file", "", {{"x-length", std::to_string(kFileSize + 100)}}));
+        ASSERT_TRUE(client.sendWindowUpdate(3, kFileSize));
+        Frame::ptr frame;
+        do {
+            frame = client.recv();
+            ASSERT_TRUE(frame);
+        } while (frame->header.type != static_cast<uint8_t>(FrameType::RST_STREAM));
+        EXPECT_EQ(frame->header.identifier, 3u);
+        EXPECT_EQ(std::static_pointer_cast<RstStreamFrame>(frame->data)->error_code,
+                  static_cast<uint32_t>(Http2Error::INTERNAL_ERROR));
+        // 读不全的那一帧不会发送
+        EXPECT_LE(client.getBody(3).size(), kFileSize);
+        EXPECT_FALSE(client.isEnded(3));
+        sock->close();
+    });
+}
+
+// 连接前言分多次到达时等待其余部分, 不按 HTTP/1.1 处理
+TEST(Http2Server, SplitPreface) {
+    RunServer([](const Address::ptr& addr) {
+        // 只发送前言的开头后关闭, 服务器不应一直等待
+        auto closed = Socket::CreateTCP(addr->getFamily());
+        ASSERT_TRUE(closed->connect(addr));
+        ASSERT_EQ(closed->send((const void*)"PR", 2), 2);
+        closed->close();
+
+        auto sock = Socket::CreateTCP(addr->getFamily());
+        ASSERT_TRUE(sock->connect(addr));
+        auto preface = Http2Session::kPreface;
+        ASSERT_EQ(sock->send((const void*)preface.data(), 2), 2);
+        usleep(50 * 1000);
+        ASSERT_EQ(sock->send((const void*)(preface.data() + 2), preface.size() - 2),
+                  (ssize_t)preface.size() - 2);
+        H2Client client(sock);
+        ASSERT_TRUE(client.sendFrame(FrameType::SETTINGS, 0, 0,
+                                     std::make_shared<SettingsFrame>()));
+        ASSERT_TRUE(client.sendRequest(1, "/hello"));
+        ASSERT_TRUE(client.waitStreams({1}));
+        EXPECT_EQ(client.getBody(1), "hello 1");
+        sock->close();
+    });
+}
+
+TEST(Http2Server, H2cUpgrade) {
+    RunServer([](const Address::ptr& addr) {
+        auto sock = Socket::CreateTCP(addr->getFamily());
+        ASSERT_TRUE(sock->connect(addr));
+        // SETTINGS_MAX_CONCURRENT_STREAMS = 100, base64url 编码
+        std::string settings("\x00\x03\x00\x00\x00\x64", 6);
+        std::string encoded = base64encode(settings);
+        std::string req =
+            "GET /hello HTTP/1.1\r\nHost: localhost\r\n"
+            "Connection: Upgrade, HTTP2-Settings\r\nUpgrade: h2c\r\n"
+            "HTTP2-Settings: " + encoded + "\r\n\r\n";
+        ASSERT_EQ(sock->send((const void*)req.data(), req.size()),
+                  (ssize_t)req.size());
+        std::string rsp;
+        char c;
+        while (rsp.find("\r\n\r\n") == std::string::npos &&
+               sock->recv(&c, 1) == 1) {
+            rsp.push_back(c);
+        }
+        EXPECT_EQ(rsp.find("HTTP/1.1 101 Switching Protocols\r\n"), 0u);
+
+        H2Client client(sock);
+        ASSERT_TRUE(client.sendPreface());
+        ASSERT_TRUE(client.waitStreams({1}));
+        EXPECT_EQ(client.getHeader(1, ":status"), "200");
+        EXPECT_EQ(client.getBody(1), "hello 1");
+        sock->close();
+    });
+}
+
+TEST(Http2Server, Http11) {
+    RunServer([](const Address::ptr& addr) {
+        auto sock = Socket::CreateTCP(addr->getFamily());
+        ASSERT_TRUE(sock->connect(addr));
+        std::string req = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        ASSERT_EQ(sock->send((const void*)req.data(), req.size()),
+                  (ssize_t)req.size());
+        std::string rsp;
+        char buf[1024];
+        while (rsp.find("hello 0") == std::string::npos) {
+            int n = sock->recv(buf, sizeof(buf));
+            ASSERT_GT(n, 0);
+            rsp.append(buf, n);
+        }
+        EXPECT_EQ(rsp.find("HTTP/1.1 200 OK\r\n"), 0u);
+        sock->close();
+    });
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
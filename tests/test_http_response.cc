@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <limits.h>
+#include "flexy/http/http_parser.h"
+#include "flexy/http/http_session.h"
+#include "flexy/net/address.h"
+#include "flexy/schedule/iomanager.h"
+
+using namespace flexy;
+using namespace flexy::http;
+
+static bool StartsWith(const std::string& s, std::string_view prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+static bool EndsWith(const std::string& s, std::string_view suffix) {
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+TEST(HttpResponse, SerializeHeader) {
+    HttpResponse rsp(0x11, true);
+    rsp.setStatus(HttpStatus::NOT_FOUND);
+    rsp.setHeader("Content-Type", "text/html");
+    rsp.setHeader("Connection", "keep-alive");
+    rsp.setBody("hello");
+    std::string out = "prefix";
+    rsp.serializeHeader(out);
+    EXPECT_TRUE(StartsWith(out, "prefixHTTP/1.1 404 Not Found\r\n"));
+    EXPECT_NE(out.find("Content-Type: text/html\r\n"), std::string::npos);
+    EXPECT_NE(out.find("connection: close\r\n"), std::string::npos);
+    EXPECT_EQ(out.find("keep-alive"), std::string::npos);
+    EXPECT_NE(out.find("\r\ndate: "), std::string::npos);
+    EXPECT_TRUE(EndsWith(out, "content-length: 5\r\n\r\n"));
+
+    // 自定义原因短语, 用户设置的 date 不重复输出
+    out.clear();
+    rsp.setClose(false);
+    rsp.setReason("Gone Away");
+    rsp.setHeader("Date", "x");
+    rsp.serializeHeader(out);
+    EXPECT_TRUE(StartsWith(out, "HTTP/1.1 404 Gone Away\r\n"));
+    EXPECT_EQ(out.find("\r\ndate: "), std::string::npos);
+    EXPECT_NE(out.find("Date: x\r\n"), std::string::npos);
+
+    // 101 响应没有 content-length
+    out.clear();
+    HttpResponse upgrade(0x11, false);
+    upgrade.setStatus(HttpStatus::SWITCHING_PROTOCOLS);
+    upgrade.serializeHeader(out);
+    EXPECT_EQ(out.find("content-length"), std::string::npos);
+}
+
+TEST(HttpResponse, SerializeHeaderKeepsLength) {
+    // HEAD 响应没有消息体, 保留调用者设置的 Content-Length
+    HttpResponse head(0x11, false);
+    head.setHeadOnly(true);
+    head.setHeader("Content-Length", "1234");
+    std::string out;
+    head.serializeHeader(out);
+    EXPECT_NE(out.find("Content-Length: 1234\r\n"), std::string::npos);
+    EXPECT_EQ(out.find("content-length"), std::string::npos);
+
+    // 调用者设置了 transfer-encoding 时不再补 content-length
+    HttpResponse chunked(0x11, false);
+    chunked.setHeader("Transfer-Encoding", "chunked");
+    out.clear();
+    chunked.serializeHeader(out);
+    EXPECT_NE(out.find("Transfer-Encoding: chunked\r\n"), std::string::npos);
+    EXPECT_EQ(out.find("content-length"), std::string::npos);
+
+    // 有消息体时按消息体生成
+    HttpResponse body(0x11, false);
+    body.setHeader("Content-Length", "1234");
+    body.setBody("hello");
+    out.clear();
+    body.serializeHeader(out);
+    EXPECT_EQ(out.find("1234"), std::string::npos);
+    EXPECT_TRUE(EndsWith(out, "content-length: 5\r\n\r\n"));
+}
+
+TEST(HttpResponse, SendResponse) {
+    std::string body(1 << 20, 'x');
+    std::atomic<int> done = 0;
+    {
+        IOManager iom(1, false, "http");
+        iom.async([&]() {
+            auto listen_sock = Socket::CreateTCPSocket();
+            ASSERT_TRUE(listen_sock->bind(IPv4Address::Create("127.0.0.1")));
+            ASSERT_TRUE(listen_sock->listen());
+            auto addr = listen_sock->getLocalAddress();
+
+            go [listen_sock, &body, &done]() {
+                HttpSession session(listen_sock->accept());
+                for (int i = 0; i < 2; ++i) {
+                    auto rsp = std::make_unique<HttpResponse>(0x11, false);
+                    rsp->setHeader("x-index", std::to_string(i));
+                    rsp->setBodyRef(i == 0 ? std::string_view(body) : "tail");
+                    EXPECT_GT(session.sendResponse(rsp), 0);
+                }
+                ++done;
+            };
+
+            auto sock = Socket::CreateTCP(addr->getFamily());
+            ASSERT_TRUE(sock->connect(addr));
+            std::string data;
+            char buf[64 * 1024];
+            int n = 0;
+            while ((n = sock->recv(buf, sizeof(buf))) > 0) {
+                data.append(buf, n);
+            }
+            sock->close();
+
+            for (int i = 0; i < 2; ++i) {
+                HttpResponseParser parser;
+                size_t nparse = parser.execute(data.data(), data.size(), false);
+                ASSERT_TRUE(parser.isFinished());
+                ASSERT_FALSE(parser.hasError());
+                auto& rsp = parser.getData();
+                EXPECT_EQ(rsp->getStatus(), HttpStatus::OK);
+                EXPECT_EQ(rsp->getHeader("x-index"), std::to_string(i));
+                size_t length = parser.getContentLength();
+                EXPECT_EQ(length, i == 0 ? body.size() : 4u);
+                // execute 会把未解析的数据移动到开头
+                data.resize(data.size() - nparse);
+                ASSERT_GE(data.size(), length);
+                EXPECT_EQ(data.compare(0, length, i == 0 ? body : "tail"), 0);
+                data.erase(0, length);
+            }
+            EXPECT_TRUE(data.empty());
+            ++done;
+        });
+    }
+    EXPECT_EQ(done, 2);
+}
+
+// 一批响应的 iovec 数量超过 IOV_MAX 时要分多次 writev 发送
+TEST(HttpResponse, SendResponsesOverIovMax) {
+    const size_t count = IOV_MAX;
+    std::atomic<int> done = 0;
+    {
+        IOManager iom(1, false, "http");
+        iom.async([&]() {
+            auto listen_sock = Socket::CreateTCPSocket();
+            ASSERT_TRUE(listen_sock->bind(IPv4Address::Create("127.0.0.1")));
+            ASSERT_TRUE(listen_sock->listen());
+            auto addr = listen_sock->getLocalAddress();
+
+            go [listen_sock, count, &done]() {
+                HttpSession session(listen_sock->accept());
+                std::vector<HttpResponse::ptr> rsps;
+                for (size_t i = 0; i < count; ++i) {
+                    auto rsp = std::make_unique<HttpResponse>(0x11, false);
+                    rsp->setBodyRef("ok");
+                    rsps.push_back(std::move(rsp));
+                }
+                // 每个响应一个头部和一个 body, 共 2 * IOV_MAX 个 iovec
+                EXPECT_GT(session.sendResponses(rsps), 0);
+                ++done;
+            };
+
+            auto sock = Socket::CreateTCP(addr->getFamily());
+            ASSERT_TRUE(sock->connect(addr));
+            std::string data;
+            char buf[64 * 1024];
+            int n = 0;
+            while ((n = sock->recv(buf, sizeof(buf))) > 0) {
+                data.append(buf, n);
+            }
+            sock->close();
+
+            size_t parsed = 0;
+            while (!data.empty()) {
+                HttpResponseParser parser;
+                size_t nparse = parser.execute(data.data(), data.size(), false);
+                ASSERT_TRUE(parser.isFinished());
+                data.resize(data.size() - nparse);
+                ASSERT_EQ(data.compare(0, 2, "ok"), 0);
+                data.erase(0, 2);
+                ++parsed;
+            }
+            EXPECT_EQ(parsed, count);
+            ++done;
+        });
+    }
+    EXPECT_EQ(done, 2);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
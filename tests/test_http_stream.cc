@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include "flexy/http/http_parser.h"
+#include "flexy/http/http_server.h"
+#include "flexy/net/address.h"
+#include "flexy/schedule/iomanager.h"
+#include "test_helper.h"
+
+using namespace flexy;
+using namespace flexy::http;
+
+using TestServer = TestServerT<HttpServer>;
+
+static std::string Chunked(const std::string& body, size_t chunk) {
+    std::string out;
+    char buf[32];
+    for (size_t i = 0; i < body.size(); i += chunk) {
+        size_t len = std::min(chunk, body.size() - i);
+        snprintf(buf, sizeof(buf), "%zx;ext=1\r\n", len);
+        out.append(buf).append(body, i, len).append("\r\n");
+    }
+    return out + "0\r\nx-trailer: 1\r\n\r\n";
+}
+
+// 流式 servlet: 每次读取 1000 字节, 按读取的顺序流式回显, 最后追加读取次数
+static int32_t StreamEcho(const HttpRequest::ptr& req,
+                          const HttpResponse::ptr& rsp, const SockStream::ptr&) {
+    auto& in = req->getBodyStream();
+    EXPECT_TRUE(in);
+    auto out = rsp->getBodyStream();
+    EXPECT_TRUE(out);
+    rsp->setHeader("Content-Type", "application/octet-stream");
+    char buf[1000];
+    ssize_t n;
+    int reads = 0;
+    while ((n = in->read(buf, sizeof(buf))) > 0) {
+        EXPECT_EQ(out->writeFixSize(buf, n), n);
+        ++reads;
+    }
+    EXPECT_EQ(n, 0);
+    std::string tail = "|" + std::to_string(reads);
+    out->writeFixSize(tail.data(), tail.size());
+    return 0;
+}
+
+template <typename F>
+static void RunServer(F&& cb) {
+    IOManager iom(1, false, "stream");
+    iom.async([&]() {
+        auto server = std::make_shared<TestServer>(true);
+        auto dispatch = server->getServletDispatch();
+        auto stream = std::make_shared<FuncionServlet>(StreamEcho);
+        stream->setStreamBody(true);
+        dispatch->addServlet("/stream", stream);
+        // 只返回长度的 HEAD 处理, 不设置消息体
+        dispatch->addServlet("/head", [](const HttpRequest::ptr&,
+                                         const HttpResponse::ptr& rsp,
+                                         const SockStream::ptr&) {
+            rsp->setHeader("Content-Length", "1234");
+            return 0;
+        });
+        dispatch->addServlet("/echo", [](const HttpRequest::ptr& req,
+                                         const HttpResponse::ptr& rsp,
+                                         const SockStream::ptr&) {
+            EXPECT_FALSE(req->getBodyStream());
+            rsp->setBody(std::string(req->getBody()));
+            return 0;
+        });
+        ASSERT_TRUE(server->bind(IPv4Address::Create("127.0.0.1")));
+        server->start();
+        cb(server->getAddress());
+        server->stop();
+    });
+}
+
+static std::string MakeBody(size_t size) {
+    std::string body(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        body[i] = 'a' + i % 26;
+    }
+    return body;
+}
+
+TEST(HttpStream, ChunkedRequest) {
+    RunServer([](const Address::ptr& addr) {
+        Client client(addr);
+        std::string body = MakeBody(10000);
+        // chunked 请求后紧跟一个 pipelining 请求
+        ASSERT_TRUE(client.send(
+            "POST /stream HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n" +
+            Chunked(body, 3000) +
+            "POST /echo HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n" +
+            Chunked("hello", 2)));
+        Client::Response rsp;
+        ASSERT_TRUE(client.recv(rsp));
+        EXPECT_TRUE(rsp.chunked);
+        EXPECT_EQ(rsp.header.find("content-length"), std::string::npos);
+        EXPECT_EQ(rsp.body.substr(0, body.size()), body);
+        ASSERT_TRUE(client.recv(rsp));
+        EXPECT_FALSE(rsp.chunked);
+        EXPECT_EQ(rsp.body, "hello");
+    });
+}
+
+TEST(HttpStream, LargeContentLength) {
+    RunServer([](const Address::ptr& addr) {
+        Client client(addr);
+        std::string body = MakeBody(200 * 1024);
+        ASSERT_TRUE(client.send(
+            "GET /echo HTTP/1.1\r\n\r\n"
+            "POST /stream HTTP/1.1\r\nContent-Length: " +
+            std::to_string(body.size()) + "\r\n\r\n" + body +
+            "GET /echo HTTP/1.1\r\n\r\n"));
+        Client::Response rsp;
+        ASSERT_TRUE(client.recv(rsp));
+        EXPECT_EQ(rsp.body, "");
+        ASSERT_TRUE(client.recv(rsp));
+        EXPECT_TRUE(rsp.chunked);
+        ASSERT_GT(rsp.body.size(), body.size());
+        EXPECT_EQ(rsp.body.substr(0, body.size()), body);
+        // 每次最多读取 1000 字节
+        EXPECT_GE(std::stoi(rsp.body.substr(body.size() + 1)), 205);
+        ASSERT_TRUE(client.recv(rsp));
+        EXPECT_EQ(rsp.body, "");
+    });
+}
+
+TEST(HttpStream, BufferedFallback) {
+    RunServer([](const Address::ptr& addr) {
+        Client client(addr);
+        // 超出读缓冲区, 非流式 servlet 预先读取完整的消息体
+        std::string body = MakeBody(20000);
+        ASSERT_TRUE(client.send(
+            "POST /echo HTTP/1.1\r\nContent-Length: 20000\r\n\r\n" + body));
+        Client::Response rsp;
+        ASSERT_TRUE(client.recv(rsp));
+        EXPECT_EQ(rsp.body, body);
+        // 小消息体也可以流式读取
+        ASSERT_TRUE(client.send(
+            "POST /stream HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"));
+        ASSERT_TRUE(client.recv(rsp));
+        EXPECT_EQ(rsp.body, "hello|1");
+        // 超过 http.request.max_bopdy_size
+        std::string large = MakeBody(HttpRequestParser::GetHttpRequestMaxBodySize() + 1);
+        ASSERT_TRUE(client.send("POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n" +
+                                Chunked(large, 8192)));
+        ASSERT_TRUE(client.recv(rsp));
+        EXPECT_EQ(rsp.header.find("HTTP/1.1 413"), 0u);
+        EXPECT_NE(rsp.header.find("connection: close"), std::string::npos);
+    });
+}
+
+TEST(HttpStream, Http10Response) {
+    RunServer([](const Address::ptr& addr) {
+        Client client(addr);
+        ASSERT_TRUE(client.send(
+            "POST /stream HTTP/1.0\r\nContent-Length: 3\r\n\r\nabc"));
+        Client::Response rsp;
+        ASSERT_TRUE(client.recv(rsp, true));
+        EXPECT_FALSE(rsp.chunked);
+        EXPECT_NE(rsp.header.find("connection: close"), std::string::npos);
+        EXPECT_EQ(rsp.body, "abc|1");
+    });
+}
+
+TEST(HttpStream, HeadContentLength) {
+    RunServer([](const Address::ptr& addr) {
+        Client client(addr);
+        Client::Response rsp;
+        ASSERT_TRUE(client.request("HEAD /head HTTP/1.1\r\n\r\n", rsp, true));
+        EXPECT_EQ(rsp.status, 200);
+        EXPECT_EQ(rsp.headers["content-length"], "1234");
+        // 同一连接上的下一个响应不受影响
+        ASSERT_TRUE(client.request("POST /echo HTTP/1.1\r\nContent-Length: 2\r\n\r\nok",
+                                   rsp));
+        EXPECT_EQ(rsp.body, "ok");
+    });
+}
+
+TEST(HttpStream, InvalidChunk) {
+    RunServer([](const Address::ptr& addr) {
+        Client client(addr);
+        ASSERT_TRUE(client.send(
+            "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+            "zz\r\nhello\r\n0\r\n\r\n"));
+        Client::Response rsp;
+        ASSERT_TRUE(client.recv(rsp));
+        EXPECT_EQ(rsp.header.find("HTTP/1.1 400"), 0u);
+        EXPECT_FALSE(client.recv(rsp));
+    });
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
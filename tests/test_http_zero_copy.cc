@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include "flexy/http/http_parser.h"
+#include "flexy/http/http_session.h"
+#include "flexy/net/address.h"
+#include "flexy/fiber/this_fiber.h"
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/config.h"
+
+using namespace flexy;
+using namespace flexy::http;
+
+TEST(HttpZeroCopy, Parser) {
+    std::string data = "POST /index.html?a=1#top HTTP/1.1\r\n"
+                       "Host: www.example.com\r\n"
+                       "Content-Length: 10\r\n"
+                       "X-Dup: 1\r\n"
+                       "x-dup: 2\r\n\r\n";
+    HttpRequestParser parser(true);
+    EXPECT_TRUE(parser.isZeroCopy());
+    size_t n = parser.execute(data.data(), data.size());
+    EXPECT_EQ(n, data.size());
+    ASSERT_FALSE(parser.hasError());
+    ASSERT_TRUE(parser.isFinished());
+    EXPECT_EQ(parser.getContentLength(), 10u);
+
+    auto& req = parser.getData();
+    // 请求行中的字段直接指向输入缓冲区
+    EXPECT_EQ(req->getPath(), "/index.html");
+    EXPECT_EQ(req->getQuery(), "a=1");
+    EXPECT_EQ(req->getFragment(), "top");
+    EXPECT_GE(req->getPath().data(), data.data());
+    EXPECT_LT(req->getPath().data(), data.data() + data.size());
+
+    EXPECT_EQ(req->getHeader("host"), "www.example.com");
+    EXPECT_EQ(req->getHeaderAs<int>("content-length"), 10);
+    EXPECT_EQ(req->getHeader("X-DUP"), "2");
+    EXPECT_TRUE(req->hasHeader("Host"));
+    EXPECT_FALSE(req->hasHeader("Accept"));
+
+    // 修改头部会覆盖解析出的引用
+    req->setHeader("Host", "other");
+    EXPECT_EQ(req->getHeader("host"), "other");
+    req->delHeader("x-dup");
+    EXPECT_FALSE(req->hasHeader("x-dup"));
+
+    // getHeaders 之后头部不再依赖输入缓冲区
+    auto& headers = req->getHeaders();
+    data.assign(data.size(), '\0');
+    EXPECT_EQ(headers.size(), 2u);
+    EXPECT_EQ(req->getHeader("host"), "other");
+    EXPECT_EQ(req->getHeader("content-length"), "10");
+}
+
+TEST(HttpZeroCopy, ManyHeaders) {
+    std::string data = "GET / HTTP/1.1\r\n";
+    for (int i = 0; i < 40; ++i) {
+        data += "h" + std::to_string(i) + ": v" + std::to_string(i) + "\r\n";
+    }
+    data += "\r\n";
+    HttpRequestParser parser(true);
+    parser.execute(data.data(), data.size());
+    ASSERT_TRUE(parser.isFinished());
+    auto& req = parser.getData();
+    for (int i = 0; i < 40; ++i) {
+        EXPECT_EQ(req->getHeader("H" + std::to_string(i)),
+                  "v" + std::to_string(i));
+    }
+    EXPECT_EQ(req->getHeaders().size(), 40u);
+}
+
+TEST(HttpZeroCopy, Pipeline) {
+    std::atomic<int> done = 0;
+    {
+        IOManager iom(1, false, "http");
+        iom.async([&done]() {
+            auto listen_sock = Socket::CreateTCPSocket();
+            ASSERT_TRUE(listen_sock->bind(IPv4Address::Create("127.0.0.1")));
+            ASSERT_TRUE(listen_sock->listen());
+            auto addr = listen_sock->getLocalAddress();
+
+            go [listen_sock, &done]() {
+                HttpSession session(listen_sock->accept());
+                auto req = session.recvRequest();
+                ASSERT_TRUE(req);
+                EXPECT_EQ(req->getMehod(), HttpMethod::POST);
+                EXPECT_EQ(req->getPath(), "/a");
+                EXPECT_EQ(req->getBody(), "hello");
+                req = session.recvRequest();
+                ASSERT_TRUE(req);
+                EXPECT_EQ(req->getPath(), "/b");
+                EXPECT_EQ(req->getHeader("host"), "b");
+                EXPECT_TRUE(req->getBody().empty());
+                req = session.recvRequest();
+                ASSERT_TRUE(req);
+                EXPECT_EQ(req->getPath(), "/c");
+                EXPECT_EQ(req->getBody(), "world");
+                EXPECT_FALSE(session.recvRequest());
+                ++done;
+            };
+
+            auto sock = Socket::CreateTCP(addr->getFamily());
+            ASSERT_TRUE(sock->connect(addr));
+            // 前两个请求一次发送, 第三个请求的头部和消息体分开发送
+            std::string data = "POST /a HTTP/1.1\r\nHost: a\r\nContent-Length: 5\r\n\r\nhello"
+                               "GET /b HTTP/1.1\r\nHost: b\r\n\r\n"
+                               "POST /c HTTP/1.1\r\nContent-";
+            EXPECT_EQ(sock->send(data.data(), data.size()), (int)data.size());
+            this_fiber::sleep_for(std::chrono::milliseconds(10));
+            data = "Length: 5\r\n\r\nwor";
+            EXPECT_EQ(sock->send(data.data(), data.size()), (int)data.size());
+            this_fiber::sleep_for(std::chrono::milliseconds(10));
+            EXPECT_EQ(sock->send((const void*)"ld", 2), 2);
+            sock->close();
+            ++done;
+        });
+    }
+    EXPECT_EQ(done, 2);
+}
+
+TEST(HttpZeroCopy, RecvRequests) {
+    std::atomic<int> done = 0;
+    {
+        IOManager iom(1, false, "http");
+        iom.async([&done]() {
+            auto listen_sock = Socket::CreateTCPSocket();
+            ASSERT_TRUE(listen_sock->bind(IPv4Address::Create("127.0.0.1")));
+            ASSERT_TRUE(listen_sock->listen());
+            auto addr = listen_sock->getLocalAddress();
+
+            go [listen_sock, &done]() {
+                HttpSession session(listen_sock->accept());
+                std::vector<HttpRequest::ptr> reqs;
+                // 缓冲区中有三个完整的请求和半个请求, 最多取两个
+                ASSERT_EQ(session.recvRequests(reqs, 2), 2u);
+                EXPECT_EQ(reqs[0]->getPath(), "/0");
+                EXPECT_EQ(reqs[1]->getPath(), "/1");
+                EXPECT_EQ(reqs[1]->getBody(), "ab");
+                ASSERT_EQ(session.recvRequests(reqs, 16), 1u);
+                EXPECT_EQ(reqs[0]->getPath(), "/2");
+                // 不完整的请求需要再次读取
+                ASSERT_EQ(session.recvRequests(reqs, 16), 1u);
+                EXPECT_EQ(reqs[0]->getPath(), "/3");
+                EXPECT_EQ(session.recvRequests(reqs, 16), 0u);
+                ++done;
+            };
+
+            auto sock = Socket::CreateTCP(addr->getFamily());
+            ASSERT_TRUE(sock->connect(addr));
+            std::string data = "GET /0 HTTP/1.1\r\n\r\n"
+                               "POST /1 HTTP/1.1\r\nContent-Length: 2\r\n\r\nab"
+                               "GET /2 HTTP/1.1\r\n\r\n"
+                               "GET /3 HTTP/1.1\r\n";
+            EXPECT_EQ(sock->send(data.data(), data.size()), (int)data.size());
+            this_fiber::sleep_for(std::chrono::milliseconds(10));
+            EXPECT_EQ(sock->send((const void*)"\r\n", 2), 2);
+            sock->close();
+            ++done;
+        });
+    }
+    EXPECT_EQ(done, 2);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "flexy/http2/huffman.h"
+
+using namespace flexy::http2;
+
+static std::string FromHex(std::string_view hex) {
+    std::string out;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        out.push_back((char)std::stoi(std::string(hex.substr(i, 2)), nullptr, 16));
+    }
+    return out;
+}
+
+// https://httpwg.org/specs/rfc7541.html#request.examples.with.huffman.coding
+TEST(Huffman, RfcExamples) {
+    std::pair<std::string, std::string> cases[] = {
+        {"www.example.com", "f1e3c2e5f23a6ba0ab90f4ff"},
+        {"no-cache", "a8eb10649cbf"},
+        {"custom-key", "25a849e95ba97d7f"},
+        {"custom-value", "25a849e95bb8e8b4bf"},
+        {"302", "6402"},
+        {"private", "aec3771a4b"},
+        {"Mon, 21 Oct 2013 20:13:21 GMT",
+         "d07abe941054d444a8200595040b8166e082a62d1bff"},
+        {"https://www.example.com", "9d29ad171863c78f0b97c8e9ae82ae43d3"},
+    };
+    for (auto& [plain, hex] : cases) {
+        std::string encoded, decoded;
+        huffman::EncodeString(plain, encoded, 0);
+        EXPECT_EQ(encoded, FromHex(hex)) << plain;
+        EXPECT_EQ(huffman::EncodeLen(plain), (int)encoded.size());
+        EXPECT_EQ(huffman::DecodeString(FromHex(hex), decoded),
+                  (int)plain.size());
+        EXPECT_EQ(decoded, plain);
+    }
+}
+
+TEST(Huffman, RoundTrip) {
+    std::mt19937 rng(42);
+    std::string all;
+    for (int i = 0; i < 256; ++i) {
+        all.push_back((char)i);
+    }
+    std::vector<std::string> inputs = {"", "a", all};
+    for (int i = 0; i < 200; ++i) {
+        std::string s(rng() % 64, 0);
+        for (auto& c : s) {
+            c = (char)rng();
+        }
+        inputs.push_back(std::move(s));
+    }
+    for (auto& in : inputs) {
+        std::string encoded, decoded;
+        huffman::EncodeString(in, encoded, 0);
+        ASSERT_EQ(huffman::DecodeString(encoded, decoded), (int)in.size());
+        EXPECT_EQ(decoded, in);
+    }
+}
+
+TEST(Huffman, InvalidPadding) {
+    std::string out;
+    // 'a' = 00011, 填充不是全 1
+    EXPECT_EQ(huffman::DecodeString(FromHex("18"), out), -1);
+    // 填充达到 8 bit
+    EXPECT_EQ(huffman::DecodeString(FromHex("1fff"), out), -1);
+    // 包含 EOS
+    EXPECT_EQ(huffman::DecodeString(FromHex("ffffffff"), out), -1);
+    // 正确的填充
+    EXPECT_EQ(huffman::DecodeString(FromHex("1f"), out), 1);
+    EXPECT_EQ(out, "a");
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
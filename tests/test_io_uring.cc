@@ -0,0 +1,130 @@
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "flexy/net/hook.h"
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/config.h"
+
+// 监听 127.0.0.1 的随机端口, 返回监听 socket, port 为实际端口
+static int Listen(uint16_t& port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    EXPECT_EQ(bind(sock, (sockaddr*)&addr, sizeof(addr)), 0);
+    EXPECT_EQ(listen(sock, 16), 0);
+    socklen_t len = sizeof(addr);
+    getsockname(sock, (sockaddr*)&addr, &len);
+    port = ntohs(addr.sin_port);
+    return sock;
+}
+
+static int Connect(uint16_t port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    EXPECT_EQ(connect(sock, (sockaddr*)&addr, sizeof(addr)), 0);
+    return sock;
+}
+
+static void RunEcho(bool uring) {
+    flexy::Config::LookupBase("iomanager.io_uring")->fromString(uring ? "1" : "0");
+    flexy::IOManager iom(2, false, "uring");
+    flexy::Config::LookupBase("iomanager.io_uring")->fromString("0");
+    if (uring && !iom.isUring()) {
+        GTEST_SKIP() << "io_uring is not supported";
+    }
+    ASSERT_EQ(iom.isUring(), uring);
+
+    std::atomic<int> done = 0;
+    iom.async([&done]() {
+        uint16_t port = 0;
+        int listen_sock = Listen(port);
+
+        go [listen_sock, &done]() {
+            int client = accept(listen_sock, nullptr, nullptr);
+            EXPECT_GE(client, 0);
+            char buf[64];
+            ssize_t n = 0;
+            while ((n = read(client, buf, sizeof(buf))) > 0) {
+                EXPECT_EQ(write(client, buf, n), n);
+            }
+            EXPECT_EQ(n, 0);
+            close(client);
+            close(listen_sock);
+            ++done;
+        };
+
+        int sock = Connect(port);
+        EXPECT_EQ(send(sock, "hello", 5, 0), 5);
+        char buf[64] = {0};
+        EXPECT_EQ(recv(sock, buf, sizeof(buf), 0), 5);
+        EXPECT_STREQ(buf, "hello");
+
+        iovec iov[2] = {{(void*)"ab", 2}, {(void*)"cd", 2}};
+        EXPECT_EQ(writev(sock, iov, 2), 4);
+        char a[2], b[2];
+        iovec riov[2] = {{a, 2}, {b, 2}};
+        EXPECT_EQ(readv(sock, riov, 2), 4);
+        EXPECT_EQ(std::string(a, 2) + std::string(b, 2), "abcd");
+
+        // 读超时
+        timeval tv{0, 100 * 1000};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        EXPECT_EQ(read(sock, buf, sizeof(buf)), -1);
+        EXPECT_EQ(errno, ETIMEDOUT);
+
+        close(sock);
+        ++done;
+    });
+    iom.stop();
+    ASSERT_EQ(done, 2);
+}
+
+// 关闭 fd 时应取消其上未完成的 io_uring 请求, 唤醒阻塞在 read 上的协程
+TEST(IOManager, IOUringCloseWakesReader) {
+    flexy::Config::LookupBase("iomanager.io_uring")->fromString("1");
+    flexy::IOManager iom(1, false, "uring");
+    flexy::Config::LookupBase("iomanager.io_uring")->fromString("0");
+    if (!iom.isUring()) {
+        GTEST_SKIP() << "io_uring is not supported";
+    }
+
+    std::atomic<int> done = 0;
+    iom.async([&done]() {
+        uint16_t port = 0;
+        int listen_sock = Listen(port);
+        int sock = Connect(port);
+        int peer = accept(listen_sock, nullptr, nullptr);
+        go [sock, &done]() {
+            char buf[16];
+            ssize_t n = read(sock, buf, sizeof(buf));
+            EXPECT_LE(n, 0);
+            if (n < 0) {
+                EXPECT_EQ(errno, EBADF);
+            }
+            ++done;
+        };
+        usleep(50 * 1000);
+        close(sock);
+        close(peer);
+        close(listen_sock);
+        ++done;
+    });
+    iom.stop();
+    ASSERT_EQ(done, 2);
+}
+
+TEST(IOManager, Epoll) { RunEcho(false); }
+
+TEST(IOManager, IOUring) { RunEcho(true); }
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "flexy/util/log.h"
+
+using namespace flexy;
+
+// 记录格式化后的日志
+class CaptureAppender : public LogAppender {
+public:
+    void log(Logger::ptr& logger, LogContext::ptr& context) override {
+        if (context->getLevel() >= level_) {
+            ++calls;
+            LogBuffer buffer;
+            formatter_->format(buffer, logger, context);
+            content.append(buffer.data(), buffer.size());
+        }
+    }
+    void write(std::string_view data) override {}
+    std::string toYamlString() const override { return ""; }
+    std::string toJsonString() const override { return ""; }
+
+    std::string content;
+    int calls = 0;
+};
+
+TEST(LogFormatter, Fields) {
+    auto logger = FLEXY_LOG_NAME("test_formatter");
+    logger->clearAppender();
+    auto appender = std::make_shared<CaptureAppender>();
+    appender->setFormatter(
+        std::make_shared<LogFormatter>("[%p]%T%c%T%l%T[%%] %m%n"));
+    logger->addAppender(appender);
+    logger->setLevel(LogLevel::DEBUG);
+
+    int line = __LINE__ + 1;
+    FLEXY_LOG_FMT_INFO(logger, "hello {} {}", 42, "world");
+    EXPECT_EQ(appender->content, "[INFO]\ttest_formatter\t" +
+                                     std::to_string(line) + "\t[%] hello 42 world\n");
+
+    appender->content.clear();
+    FLEXY_LOG_WARN(logger) << "stream " << 1.5;
+    EXPECT_NE(appender->content.find("stream 1.5\n"), std::string::npos);
+    logger->clearAppender();
+}
+
+TEST(LogFormatter, Error) {
+    LogFormatter formatter("%m %q");
+    EXPECT_TRUE(formatter.isError());
+}
+
+static int Evaluated(int& count) { return ++count; }
+
+TEST(LogFormatter, DisabledSkipsArgs) {
+    auto logger = FLEXY_LOG_NAME("test_formatter_disabled");
+    logger->clearAppender();
+    auto appender = std::make_shared<CaptureAppender>();
+    logger->addAppender(appender);
+    logger->setLevel(LogLevel::ERROR);
+
+    int count = 0;
+    FLEXY_LOG_FMT_DEBUG(logger, "{}", Evaluated(count));
+    FLEXY_LOG_INFO(logger) << Evaluated(count);
+    EXPECT_EQ(count, 0);
+    EXPECT_EQ(appender->calls, 0);
+
+    FLEXY_LOG_FMT_ERROR(logger, "{}", Evaluated(count));
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(appender->calls, 1);
+    logger->clearAppender();
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
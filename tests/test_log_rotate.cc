@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <filesystem>
+#include <thread>
+#include "flexy/util/config.h"
+#include "flexy/util/log.h"
+
+using namespace flexy;
+namespace fs = std::filesystem;
+
+static std::string TempDir(const char* name) {
+    auto dir = std::string("/tmp/flexy_test_log_rotate_") + name + "_" +
+               std::to_string(getpid());
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+// 目录中 log.txt 的轮转文件
+static std::vector<std::string> RotatedFiles(const std::string& dir) {
+    std::vector<std::string> files;
+    for (auto& entry : fs::directory_iterator(dir)) {
+        auto name = entry.path().filename().string();
+        if (name.rfind("log.txt.", 0) == 0) {
+            files.push_back(name);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// 等待后台线程换成新文件并完成压缩和清理
+static std::vector<std::string> WaitRotated(const std::string& dir, size_t count,
+                                            bool compress) {
+    std::vector<std::string> files;
+    for (int i = 0; i < 500; ++i) {
+        files = RotatedFiles(dir);
+        bool done = files.size() == count && fs::file_size(dir + "/log.txt") == 0;
+        for (auto& f : files) {
+            if (compress && (f.size() < 3 || f.substr(f.size() - 3) != ".gz")) {
+                done = false;
+            }
+        }
+        if (done) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return files;
+}
+
+static std::string ReadGzip(const std::string& file) {
+    gzFile in = gzopen(file.c_str(), "rb");
+    std::string content;
+    char buf[4096];
+    int n;
+    while ((n = gzread(in, buf, sizeof(buf))) > 0) {
+        content.append(buf, n);
+    }
+    gzclose(in);
+    return content;
+}
+
+TEST(LogRotate, BySize) {
+    auto dir = TempDir("size");
+    LogRotation rotation;
+    rotation.maxSize = 1000;
+    auto appender = std::make_shared<FileLogAppender>(dir + "/log.txt", rotation);
+    std::string line(99, 'x');
+    line.push_back('\n');
+    for (int i = 0; i < 10; ++i) {
+        appender->write(line);
+    }
+    auto files = WaitRotated(dir, 1, false);
+    ASSERT_EQ(files.size(), 1u);
+    EXPECT_EQ(fs::file_size(dir + "/" + files[0]), 1000u);
+
+    // 轮转后写入新文件
+    appender->write(line);
+    appender.reset();
+    EXPECT_EQ(fs::file_size(dir + "/log.txt"), 100u);
+    fs::remove_all(dir);
+}
+
+TEST(LogRotate, DestroyWhileRotating) {
+    auto dir = TempDir("destroy");
+    LogRotation rotation;
+    rotation.maxSize = 100;
+    rotation.compress = true;
+    std::string line(99, 'x');
+    line.push_back('\n');
+    // 触发轮转后立即析构, 等待后台线程换完文件
+    for (int i = 0; i < 50; ++i) {
+        auto appender = std::make_shared<FileLogAppender>(dir + "/log.txt", rotation);
+        appender->write(line);
+        appender.reset();
+    }
+    EXPECT_FALSE(RotatedFiles(dir).empty());
+    // 等待压缩完成再删除目录
+    for (int i = 0; i < 500; ++i) {
+        auto files = RotatedFiles(dir);
+        if (std::all_of(files.begin(), files.end(), [](auto& f) {
+                return f.size() > 3 && f.substr(f.size() - 3) == ".gz";
+            })) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    fs::remove_all(dir);
+}
+
+TEST(LogRotate, CompressAndRetention) {
+    auto dir = TempDir("compress");
+    LogRotation rotation;
+    rotation.maxSize = 100;
+    rotation.maxFiles = 2;
+    rotation.compress = true;
+    auto appender = std::make_shared<FileLogAppender>(dir + "/log.txt", rotation);
+    for (int i = 0; i < 5; ++i) {
+        auto line = std::string(99, '0' + i) + "\n";
+        appender->write(line);
+        // 同一秒内的轮转文件名带 -N 后缀
+        WaitRotated(dir, std::min(i + 1, 2), true);
+    }
+    appender.reset();
+    auto files = RotatedFiles(dir);
+    ASSERT_EQ(files.size(), 2u);
+    // 保留的是最后两个
+    std::vector<std::string> contents = {ReadGzip(dir + "/" + files[0]),
+                                         ReadGzip(dir + "/" + files[1])};
+    std::sort(contents.begin(), contents.end());
+    EXPECT_EQ(contents[0], std::string(99, '3') + "\n");
+    EXPECT_EQ(contents[1], std::string(99, '4') + "\n");
+    fs::remove_all(dir);
+}
+
+TEST(LogRotate, Config) {
+    auto dir = TempDir("config");
+    auto node = YAML::Load(
+        "logs:\n"
+        "  - name: test_log_rotate\n"
+        "    level: info\n"
+        "    appenders:\n"
+        "      - type: FileLogAppender\n"
+        "        file: " + dir + "/log.txt\n"
+        "        max_size: 64M\n"
+        "        rotate: daily\n"
+        "        max_files: 7\n"
+        "        compress: true\n");
+    Config::LoadFromYaml(node);
+    auto logger = FLEXY_LOG_NAME("test_log_rotate");
+    auto yaml = YAML::Load(logger->toYamlString());
+    auto appender = yaml["appenders"][0];
+    EXPECT_EQ(appender["max_size"].as<uint64_t>(), 64u << 20);
+    EXPECT_EQ(appender["rotate"].as<std::string>(), "daily");
+    EXPECT_EQ(appender["max_files"].as<int>(), 7);
+    EXPECT_TRUE(appender["compress"].as<bool>());
+
+    Json::Value json;
+    Json::Reader().parse(logger->toJsonString(), json);
+    EXPECT_EQ(json["appenders"][0]["max_size"].asUInt64(), 64u << 20);
+    EXPECT_EQ(json["appenders"][0]["rotate"].asString(), "daily");
+
+    // 配置的字符串形式可以重新加载
+    auto logs = Config::LookupBase("logs");
+    ASSERT_TRUE(logs);
+    auto str = logs->toString();
+    EXPECT_NE(str.find("max_size: 67108864"), std::string::npos);
+    logs->fromString(str);
+    EXPECT_EQ(logs->toString(), str);
+    logger->clearAppender();
+    fs::remove_all(dir);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
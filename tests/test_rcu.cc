@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "flexy/fiber/mutex.h"
+#include "flexy/schedule/iomanager.h"
+#include "flexy/thread/rcu.h"
+
+using namespace flexy;
+
+// 记录析构, 析构后 valid 为 false
+struct Tracked {
+    static std::atomic<int> s_alive;
+    explicit Tracked(int v) : value(v) { ++s_alive; }
+    ~Tracked() {
+        valid = false;
+        --s_alive;
+    }
+    int value;
+    std::atomic<bool> valid{true};
+};
+std::atomic<int> Tracked::s_alive{0};
+
+TEST(Rcu, RetireWaitsForReaders) {
+    RcuPtr<Tracked> ptr(std::make_unique<Tracked>(1));
+    std::atomic<bool> entered{false}, leave{false};
+    std::thread reader([&]() {
+        rcu::ReadGuard guard;
+        auto p = ptr.load();
+        entered = true;
+        while (!leave) {
+            std::this_thread::yield();
+        }
+        // 读者离开前旧对象不会被释放
+        EXPECT_TRUE(p->valid);
+        EXPECT_EQ(p->value, 1);
+    });
+    while (!entered) {
+        std::this_thread::yield();
+    }
+    ptr.store(std::make_unique<Tracked>(2));
+    EXPECT_EQ(Tracked::s_alive, 2);
+    {
+        // 替换之后开始的读者看到新值
+        rcu::ReadGuard guard;
+        EXPECT_EQ(ptr.load()->value, 2);
+        // 嵌套
+        rcu::ReadGuard inner;
+        EXPECT_TRUE(rcu::InReadSection());
+    }
+    EXPECT_FALSE(rcu::InReadSection());
+    EXPECT_GT(rcu::Reclaim(), 0u);
+    leave = true;
+    reader.join();
+    EXPECT_EQ(rcu::Reclaim(), 0u);
+    EXPECT_EQ(Tracked::s_alive, 1);
+}
+
+TEST(Rcu, Synchronize) {
+    std::atomic<int> stage{0};
+    std::thread reader([&]() {
+        rcu::ReadGuard guard;
+        stage = 1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        stage = 2;
+    });
+    while (stage == 0) {
+        std::this_thread::yield();
+    }
+    rcu::Synchronize();
+    EXPECT_EQ(stage, 2);
+    reader.join();
+}
+
+// 多个读者线程不断读取, 写者不断替换, 读者不能看到已经释放的对象
+TEST(Rcu, Stress) {
+    RcuPtr<Tracked> ptr(std::make_unique<Tracked>(0));
+    std::atomic<bool> stop{false};
+    std::atomic<bool> broken{false};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                rcu::ReadGuard guard;
+                auto p = ptr.load();
+                for (int j = 0; j < 10; ++j) {
+                    if (!p->valid) {
+                        broken = true;
+                    }
+                }
+            }
+        });
+    }
+    for (int i = 1; i <= 20000; ++i) {
+        ptr.store(std::make_unique<Tracked>(i));
+    }
+    stop = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+    rcu::Synchronize();
+    EXPECT_FALSE(broken);
+    EXPECT_EQ(Tracked::s_alive, 1);
+}
+
+// 在协程中 Synchronize 让出协程, 不阻塞同一线程上的其他协程
+TEST(Rcu, SynchronizeInFiber) {
+    std::atomic<int> stage{0};
+    std::thread reader([&]() {
+        rcu::ReadGuard guard;
+        stage = 1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    });
+    while (stage == 0) {
+        std::this_thread::yield();
+    }
+    std::atomic<bool> synced{false};
+    bool progressed = false;
+    {
+        IOManager iom(1, false, "rcu");
+        iom.async([&]() {
+            rcu::Synchronize();
+            synced = true;
+        });
+        iom.async([&]() {
+            // Synchronize 等待期间本协程可以运行
+            progressed = !synced;
+        });
+        iom.stop();
+    }
+    reader.join();
+    EXPECT_TRUE(synced);
+    EXPECT_TRUE(progressed);
+}
+
+// 协程锁在普通线程中竞争时让出线程等待
+TEST(FiberMutexFallback, Threads) {
+    fiber::mutex mtx;
+    fiber::shared_mutex rw;
+    int64_t sum = 0;
+    std::vector<std::thread> ts;
+    for (int i = 0; i < 4; ++i) {
+        ts.emplace_back([&]() {
+            for (int j = 0; j < 20000; ++j) {
+                {
+                    std::lock_guard lock(mtx);
+                    ++sum;
+                }
+                std::lock_guard lock(rw);
+                --sum;
+                ++sum;
+            }
+        });
+    }
+    for (auto& t : ts) {
+        t.join();
+    }
+    EXPECT_EQ(sum, 4 * 20000);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "flexy/http/servlet.h"
+
+using namespace flexy;
+using namespace flexy::http;
+
+// 只有名字的 servlet, 用于比较匹配结果
+class NamedServlet : public Servlet {
+public:
+    explicit NamedServlet(std::string_view name) : Servlet(name) {}
+    int32_t handle(const HttpRequest::ptr&, const HttpResponse::ptr&,
+                   const SockStream::ptr&) override {
+        return 0;
+    }
+};
+
+static Servlet::ptr Named(const std::string& name) {
+    return std::make_shared<NamedServlet>(name);
+}
+
+static std::string Find(const Router& router, HttpMethod method,
+                        std::string_view path, Router::Params* params = nullptr) {
+    auto slt = router.find(method, path, params);
+    return slt ? (*slt)->getName() : "";
+}
+
+TEST(Router, StaticAndSplit) {
+    Router router;
+    EXPECT_TRUE(router.add("/user/list", Named("list")));
+    EXPECT_TRUE(router.add("/user/login", Named("login")));
+    EXPECT_TRUE(router.add("/user", Named("user")));
+    EXPECT_TRUE(router.add("/", Named("root")));
+    EXPECT_EQ(router.size(), 4u);
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user/list"), "list");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user/login"), "login");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user"), "user");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/"), "root");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user/"), "");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user/lo"), "");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/users"), "");
+    EXPECT_EQ(Find(router, HttpMethod::GET, ""), "");
+}
+
+TEST(Router, ParamsAndWildcard) {
+    Router router;
+    EXPECT_TRUE(router.add("/user/:id", Named("user")));
+    EXPECT_TRUE(router.add("/user/:id/post/:post", Named("post")));
+    EXPECT_TRUE(router.add("/user/me", Named("me")));
+    EXPECT_TRUE(router.add("/static/*path", Named("static")));
+    EXPECT_TRUE(router.add("/static/index.html", Named("index")));
+    // 参数名冲突
+    EXPECT_FALSE(router.add("/user/:name/x", Named("x")));
+
+    Router::Params params;
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user/42", &params), "user");
+    ASSERT_EQ(params.size(), 1u);
+    EXPECT_EQ(params[0].first, "id");
+    EXPECT_EQ(params[0].second, "42");
+
+    params.clear();
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user/42/post/7", &params), "post");
+    ASSERT_EQ(params.size(), 2u);
+    EXPECT_EQ(params[1].first, "post");
+    EXPECT_EQ(params[1].second, "7");
+
+    // 静态优先于参数
+    params.clear();
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user/me", &params), "me");
+    EXPECT_TRUE(params.empty());
+    // 静态部分匹配失败后回溯到参数
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user/mex", &params), "user");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user/", &params), "");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/user/42/post", &params), "");
+
+    params.clear();
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/static/js/app.js", &params),
+              "static");
+    ASSERT_EQ(params.size(), 1u);
+    EXPECT_EQ(params[0].first, "path");
+    EXPECT_EQ(params[0].second, "js/app.js");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/static/index.html"), "index");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/static/index.htm"), "static");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/static/"), "static");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/static"), "");
+
+    // 前缀路由中的 ':' 不是参数
+    EXPECT_TRUE(router.addPrefix("/ns:a/", Named("ns")));
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/ns:a/b"), "ns");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/ns:b/b"), "");
+}
+
+TEST(Router, Methods) {
+    Router router;
+    EXPECT_TRUE(router.add(HttpMethod::GET, "/item/:id", Named("get")));
+    EXPECT_TRUE(router.add(HttpMethod::DELETE, "/item/:id", Named("delete")));
+    EXPECT_TRUE(router.add("/item/:id", Named("any")));
+    EXPECT_TRUE(router.add(HttpMethod::POST, "/item/*", Named("post")));
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/item/1"), "get");
+    EXPECT_EQ(Find(router, HttpMethod::DELETE, "/item/1"), "delete");
+    EXPECT_EQ(Find(router, HttpMethod::PUT, "/item/1"), "any");
+    EXPECT_EQ(Find(router, HttpMethod::POST, "/item/1"), "any");
+    EXPECT_EQ(Find(router, HttpMethod::POST, "/item/1/2"), "post");
+    EXPECT_EQ(Find(router, HttpMethod::GET, "/item/1/2"), "");
+}
+
+TEST(ServletDispatch, Route) {
+    auto dispatch = std::make_shared<ServletDispatch>();
+    dispatch->addServlet("/user/:id", Named("user"));
+    dispatch->addServlet(HttpMethod::POST, "/user/:id", Named("update"));
+    dispatch->addGlobServlet("/static/*", Named("static"));
+    dispatch->addGlobServlet("/*.html", Named("html"));
+    dispatch->addServlet("/static/exact", Named("exact"));
+
+    HttpRequest req;
+    EXPECT_EQ(dispatch->getMatchedServlet(HttpMethod::GET, "/user/7", &req)->getName(),
+              "user");
+    EXPECT_EQ(req.getParam("id"), "7");
+    EXPECT_EQ(dispatch->getMatchedServlet(HttpMethod::POST, "/user/7")->getName(),
+              "update");
+    EXPECT_EQ(dispatch->getMatchedServlet("/static/a/b")->getName(), "static");
+    EXPECT_EQ(dispatch->getMatchedServlet("/static/exact")->getName(), "exact");
+    // 非前缀 glob 仍然使用 fnmatch
+    EXPECT_EQ(dispatch->getMatchedServlet("/doc/a.html")->getName(), "html");
+    EXPECT_EQ(dispatch->getMatchedServlet("/none")->getName(), "NotFoundServlet");
+    EXPECT_EQ(dispatch->getGlobServlet("/doc/a.html")->getName(), "html");
+    // 前缀 glob 先于其他 glob 匹配, 与加入顺序无关
+    dispatch->addGlobServlet("/doc/*", Named("doc"));
+    EXPECT_EQ(dispatch->getMatchedServlet("/doc/a.html")->getName(), "doc");
+    dispatch->delGlobServlet("/doc/*");
+    EXPECT_EQ(dispatch->getServlet("/user/:id")->getName(), "user");
+
+    dispatch->delServlet("/user/:id");
+    EXPECT_EQ(dispatch->getMatchedServlet("/user/7")->getName(), "NotFoundServlet");
+    EXPECT_EQ(dispatch->getMatchedServlet(HttpMethod::POST, "/user/7")->getName(),
+              "update");
+    dispatch->delServlet(HttpMethod::POST, "/user/:id");
+    dispatch->delGlobServlet("/static/x");
+    EXPECT_EQ(dispatch->getMatchedServlet("/static/a")->getName(), "NotFoundServlet");
+    dispatch->setDefault(Named("default"));
+    EXPECT_EQ(dispatch->getMatchedServlet("/none")->getName(), "default");
+}
+
+TEST(ServletDispatch, Conflict) {
+    auto dispatch = std::make_shared<ServletDispatch>();
+    EXPECT_TRUE(dispatch->addServlet("/a/:id", Named("id")));
+    // 参数名冲突的路由不加入, 已有的路由不受影响
+    EXPECT_FALSE(dispatch->addServlet("/a/:name/x", Named("name")));
+    EXPECT_FALSE(dispatch->getServlet("/a/:name/x"));
+    EXPECT_FALSE(dispatch->addServlet(HttpMethod::POST, "/a/:name", Named("post")));
+    EXPECT_EQ(dispatch->getMatchedServlet(HttpMethod::POST, "/a/1")->getName(), "id");
+    EXPECT_EQ(dispatch->getMatchedServlet("/a/1/x")->getName(), "NotFoundServlet");
+    // 替换同一路由仍然成功
+    EXPECT_TRUE(dispatch->addServlet("/a/:id", Named("id2")));
+    EXPECT_EQ(dispatch->getMatchedServlet("/a/1")->getName(), "id2");
+    EXPECT_TRUE(dispatch->addServlet("/a/:id/x", Named("x")));
+    EXPECT_EQ(dispatch->getMatchedServlet("/a/1/x")->getName(), "x");
+
+    // 字面匹配含 '*' 的路径
+    EXPECT_TRUE(dispatch->addGlobServlet("/lit/\\*", Named("literal")));
+    EXPECT_EQ(dispatch->getMatchedServlet("/lit/*")->getName(), "literal");
+    EXPECT_EQ(dispatch->getMatchedServlet("/lit/a")->getName(), "NotFoundServlet");
+}
+
+// 修改路由对其他线程立即可见, 查找与修改并发
+TEST(ServletDispatch, ConcurrentUpdate) {
+    auto dispatch = std::make_shared<ServletDispatch>();
+    dispatch->addServlet("/fixed", Named("fixed"));
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                auto slt = dispatch->getMatchedServlet("/fixed");
+                ASSERT_EQ(slt->getName(), "fixed");
+            }
+        });
+    }
+    for (int i = 0; i < 200; ++i) {
+        dispatch->addServlet("/r" + std::to_string(i), Named("r"));
+    }
+    stop = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+    std::thread([&]() {
+        EXPECT_EQ(dispatch->getMatchedServlet("/r199")->getName(), "r");
+        dispatch->delServlet("/r199");
+    }).join();
+    EXPECT_EQ(dispatch->getMatchedServlet("/r199")->getName(), "NotFoundServlet");
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
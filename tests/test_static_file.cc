@@ -0,0 +1,289 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include "flexy/http/http_server.h"
+#include "flexy/http/static_file_servlet.h"
+#include "flexy/net/address.h"
+#include "flexy/schedule/iomanager.h"
+#include "flexy/util/config.h"
+#include "flexy/util/util.h"
+#include "test_helper.h"
+
+using namespace flexy;
+using namespace flexy::http;
+
+using TestServer = TestServerT<HttpServer>;
+
+static void WriteFile(const std::string& path, const std::string& data) {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs << data;
+}
+
+static std::string MakeBody(size_t size) {
+    std::string body(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        body[i] = 'a' + i % 26;
+    }
+    return body;
+}
+
+class StaticFileTest : public testing::Test {
+protected:
+    void SetUp() override {
+        char tmpl[] = "/tmp/flexy_static_XXXXXX";
+        ASSERT_TRUE(mkdtemp(tmpl));
+        root_ = tmpl;
+        ASSERT_EQ(mkdir((root_ + "/sub").c_str(), 0755), 0);
+        WriteFile(root_ + "/index.html", "<html>index</html>");
+        WriteFile(root_ + "/big.bin", MakeBody(300 * 1024));
+        WriteFile(root_ + "/app.js", "console.log('plain')");
+        WriteFile(root_ + "/app.js.gz", "gzipped bytes");
+        WriteFile(root_ + "/sub/index.html", "sub index");
+        WriteFile(root_ + "/../flexy_static_secret", "secret");
+    }
+
+    void TearDown() override {
+        std::string cmd = "rm -rf " + root_ + " /tmp/flexy_static_secret";
+        ASSERT_EQ(system(cmd.c_str()), 0);
+    }
+
+    template <typename F>
+    void run(F&& cb) {
+        IOManager iom(1, false, "static");
+        iom.async([&]() {
+            auto server = std::make_shared<TestServer>(true);
+            servlet_ = std::make_shared<StaticFileServlet>(root_, "/static/");
+            server->getServletDispatch()->addGlobServlet("/static/*", servlet_);
+            ASSERT_TRUE(server->bind(IPv4Address::Create("127.0.0.1")));
+            server->start();
+            Client client(server->getAddress());
+            cb(client);
+            server->stop();
+        });
+    }
+
+    std::string root_;
+    StaticFileServlet::ptr servlet_;
+};
+
+TEST_F(StaticFileTest, GetAndHead) {
+    run([this](Client& client) {
+        Client::Response rsp;
+        ASSERT_TRUE(client.request("GET /static/big.bin HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 200);
+        EXPECT_EQ(rsp.body, MakeBody(300 * 1024));
+        EXPECT_EQ(rsp.headers["accept-ranges"], "bytes");
+        EXPECT_FALSE(rsp.headers["etag"].empty());
+
+        // HEAD 保留 content-length, 不发送消息体; 之后的请求仍能正确读取
+        ASSERT_TRUE(client.request("HEAD /static/big.bin HTTP/1.1\r\n\r\n", rsp,
+                                   true));
+        EXPECT_EQ(rsp.status, 200);
+        EXPECT_EQ(rsp.headers["content-length"], std::to_string(300 * 1024));
+
+        ASSERT_TRUE(client.request("GET /static/ HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "<html>index</html>");
+        EXPECT_EQ(rsp.headers["content-type"], "text/html; charset=utf-8");
+        ASSERT_TRUE(client.request("GET /static/sub HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "sub index");
+        ASSERT_TRUE(client.request("GET /static/%73ub/./index.html HTTP/1.1\r\n\r\n",
+                                   rsp));
+        EXPECT_EQ(rsp.body, "sub index");
+
+        ASSERT_TRUE(client.request("GET /static/none HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 404);
+        ASSERT_TRUE(client.request(
+            "GET /static/../flexy_static_secret HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 403);
+        ASSERT_TRUE(client.request(
+            "GET /static/%2e%2e/flexy_static_secret HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 403);
+        ASSERT_TRUE(client.request("POST /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 405);
+    });
+}
+
+TEST_F(StaticFileTest, Range) {
+    run([](Client& client) {
+        std::string body = MakeBody(300 * 1024);
+        Client::Response rsp;
+        ASSERT_TRUE(client.request(
+            "GET /static/big.bin HTTP/1.1\r\nRange: bytes=100-199\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 206);
+        EXPECT_EQ(rsp.body, body.substr(100, 100));
+        EXPECT_EQ(rsp.headers["content-range"],
+                  "bytes 100-199/" + std::to_string(body.size()));
+
+        ASSERT_TRUE(client.request(
+            "GET /static/big.bin HTTP/1.1\r\nRange: bytes=-10\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 206);
+        EXPECT_EQ(rsp.body, body.substr(body.size() - 10));
+
+        ASSERT_TRUE(client.request(
+            "GET /static/big.bin HTTP/1.1\r\nRange: bytes=307000-\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 206);
+        EXPECT_EQ(rsp.body, body.substr(307000));
+
+        ASSERT_TRUE(client.request(
+            "GET /static/big.bin HTTP/1.1\r\nRange: bytes=999999-\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 416);
+        EXPECT_EQ(rsp.headers["content-range"],
+                  "bytes */" + std::to_string(body.size()));
+
+        // If-Range 不匹配时发送完整的文件
+        ASSERT_TRUE(client.request(
+            "GET /static/big.bin HTTP/1.1\r\nRange: bytes=0-0\r\n"
+            "If-Range: \"stale\"\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 200);
+        EXPECT_EQ(rsp.body.size(), body.size());
+    });
+
+    uint64_t offset, length;
+    EXPECT_EQ(StaticFileServlet::ParseRange("bytes=0-1,5-6", 10, offset, length), 0);
+    EXPECT_EQ(StaticFileServlet::ParseRange("bytes=5-2", 10, offset, length), 0);
+    EXPECT_EQ(StaticFileServlet::ParseRange("items=0-1", 10, offset, length), 0);
+    EXPECT_EQ(StaticFileServlet::ParseRange("bytes=-0", 10, offset, length), -1);
+    EXPECT_EQ(StaticFileServlet::ParseRange("bytes=3-100", 10, offset, length), 1);
+    EXPECT_EQ(offset, 3u);
+    EXPECT_EQ(length, 7u);
+}
+
+TEST_F(StaticFileTest, Conditional) {
+    run([](Client& client) {
+        Client::Response rsp;
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        std::string etag = rsp.headers["etag"];
+        std::string last_modified = rsp.headers["last-modified"];
+
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n"
+                                   "If-None-Match: \"x\", " + etag + "\r\n\r\n",
+                                   rsp));
+        EXPECT_EQ(rsp.status, 304);
+        EXPECT_EQ(rsp.headers.count("content-length"), 0u);
+        EXPECT_TRUE(rsp.body.empty());
+
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n"
+                                   "If-Modified-Since: " + last_modified +
+                                   "\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 304);
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n"
+                                   "If-Modified-Since: Thu, 01 Jan 1970 00:00:00 GMT"
+                                   "\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 200);
+        EXPECT_EQ(rsp.body, "<html>index</html>");
+    });
+    time_t t = 1784298057;
+    EXPECT_EQ(StaticFileServlet::ParseHttpDate(StaticFileServlet::FormatHttpDate(t)),
+              t);
+    EXPECT_EQ(StaticFileServlet::FormatHttpDate(784111777),
+              "Sun, 06 Nov 1994 08:49:37 GMT");
+}
+
+TEST_F(StaticFileTest, Precompressed) {
+    run([](Client& client) {
+        Client::Response rsp;
+        ASSERT_TRUE(client.request("GET /static/app.js HTTP/1.1\r\n"
+                                   "Accept-Encoding: br, gzip\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "gzipped bytes");
+        EXPECT_EQ(rsp.headers["content-encoding"], "gzip");
+        EXPECT_EQ(rsp.headers["vary"], "Accept-Encoding");
+        EXPECT_EQ(rsp.headers["content-type"],
+                  "application/javascript; charset=utf-8");
+        ASSERT_TRUE(client.request("GET /static/app.js HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "console.log('plain')");
+        EXPECT_EQ(rsp.headers.count("content-encoding"), 0u);
+        ASSERT_TRUE(client.request("GET /static/app.js HTTP/1.1\r\n"
+                                   "Accept-Encoding: gzip;q=0, br\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "console.log('plain')");
+    });
+    EXPECT_TRUE(StaticFileServlet::AcceptGzip("gzip"));
+    EXPECT_TRUE(StaticFileServlet::AcceptGzip("br;q=1.0, GZIP;q=0.5"));
+    EXPECT_TRUE(StaticFileServlet::AcceptGzip("*"));
+    EXPECT_TRUE(StaticFileServlet::AcceptGzip("x-gzip ; q=0.001"));
+    EXPECT_FALSE(StaticFileServlet::AcceptGzip(""));
+    EXPECT_FALSE(StaticFileServlet::AcceptGzip("br, deflate"));
+    EXPECT_FALSE(StaticFileServlet::AcceptGzip("gzip;q=0"));
+    EXPECT_FALSE(StaticFileServlet::AcceptGzip("gzip;q=0.000, *"));
+    EXPECT_FALSE(StaticFileServlet::AcceptGzip("*;q=0"));
+    EXPECT_FALSE(StaticFileServlet::AcceptGzip("gzipx"));
+}
+
+TEST_F(StaticFileTest, Invalidation) {
+    auto interval = Config::LookupBase("http.static_file.check_interval");
+    interval->fromString("0");
+    run([this](Client& client) {
+        Client::Response rsp;
+        ASSERT_TRUE(client.request("GET /static/new.txt HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 404);
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        std::string etag = rsp.headers["etag"];
+        EXPECT_GE(servlet_->getCache().size(), 2u);
+
+        // 负缓存在文件创建后失效
+        WriteFile(root_ + "/new.txt", "created");
+        ASSERT_TRUE(client.request("GET /static/new.txt HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 200);
+        EXPECT_EQ(rsp.body, "created");
+
+        WriteFile(root_ + "/index.html", "<html>changed</html>");
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "<html>changed</html>");
+        EXPECT_NE(rsp.headers["etag"], etag);
+
+        // 原子替换(rename)同样失效, 旧的 fd 不再使用
+        WriteFile(root_ + "/index.tmp", "<html>renamed</html>");
+        ASSERT_EQ(rename((root_ + "/index.tmp").c_str(),
+                         (root_ + "/index.html").c_str()), 0);
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "<html>renamed</html>");
+
+        ASSERT_EQ(unlink((root_ + "/new.txt").c_str()), 0);
+        ASSERT_TRUE(client.request("GET /static/new.txt HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.status, 404);
+    });
+    interval->fromString("100");
+}
+
+TEST_F(StaticFileTest, CheckInterval) {
+    auto interval = Config::LookupBase("http.static_file.check_interval");
+    interval->fromString("1000");
+    run([this](Client& client) {
+        Client::Response rsp;
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        std::string etag = rsp.headers["etag"];
+        // 间隔之内不读取事件, 仍然返回缓存的文件
+        WriteFile(root_ + "/index.html", "<html>changed</html>");
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.headers["etag"], etag);
+        usleep(1100 * 1000);
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "<html>changed</html>");
+    });
+    interval->fromString("100");
+}
+
+TEST_F(StaticFileTest, Eviction) {
+    auto size = Config::LookupBase("http.static_file.cache_size");
+    size->fromString("1");
+    run([this](Client& client) {
+        Client::Response rsp;
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        ASSERT_TRUE(client.request("GET /static/sub/ HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "sub index");
+        EXPECT_EQ(servlet_->getCache().size(), 1u);
+        // 根目录已取消监听, 再次访问时重新监听, 修改仍然可见
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "<html>index</html>");
+        WriteFile(root_ + "/index.html", "<html>changed</html>");
+        usleep(200 * 1000);
+        ASSERT_TRUE(client.request("GET /static/index.html HTTP/1.1\r\n\r\n", rsp));
+        EXPECT_EQ(rsp.body, "<html>changed</html>");
+    });
+    size->fromString("1024");
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -116,6 +116,91 @@ TEST(__Task, Function) {
     ASSERT_EQ(ans, -2);
 }
 
+// detail::__task 是 __task_Function 的替代, 用法相同, 只能移动
+TEST(__Task, SmallTask) {
+    static_assert(!std::is_copy_constructible_v<__task>);
+    static_assert(std::is_nothrow_move_constructible_v<__task>);
+    int ans = 0;
+    __task t1([](int a, int b, int& ans) { ans = a + b; }, 1, 2, std::ref(ans));
+    t1();
+    ASSERT_EQ(ans, 3);
+
+    struct plus {
+        int ans = 0;
+        void operator()(int a, int b) { ans = a + b; }
+    };
+    plus p;
+    __task t2(&plus::operator(), &p, 4, 5);
+    t2();
+    ASSERT_EQ(p.ans, 9);
+
+    __task t3(&test_unique, std::make_unique<int>(0x99));
+    __task t4(std::move(t3));
+    ASSERT_FALSE(t3);
+    t4();
+
+    __task t5(&max<int>, 0x99, -2, std::ref(ans));
+    __task t6;
+    t6 = std::move(t5);
+    t6();
+    ASSERT_EQ(ans, -2);
+    t6 = nullptr;
+    ASSERT_FALSE(t6);
+}
+
+TEST(__Task, SmallBuffer) {
+    using small = __task_small<64>;
+    struct Big {
+        char data[128] = {};
+        void operator()() {}
+    };
+    auto lambda = [a = 1, b = 2.0, c = std::string("hello")]() {};
+    static_assert(small::is_inline_v<decltype(lambda)>);
+    static_assert(!small::is_inline_v<Big>);
+    static_assert(!std::is_copy_constructible_v<small>);
+    static_assert(std::is_nothrow_move_constructible_v<small>);
+
+    // 内联和堆上存储的对象都只析构一次, 移动后原对象为空
+    static int s_alive = 0;
+    struct Counted {
+        int* sum;
+        explicit Counted(int* s) : sum(s) { ++s_alive; }
+        Counted(Counted&& other) noexcept : sum(other.sum) { ++s_alive; }
+        ~Counted() { --s_alive; }
+        void operator()() { ++*sum; }
+    };
+    struct BigCounted : Counted {
+        using Counted::Counted;
+        char pad[128] = {};
+    };
+    int sum = 0;
+    {
+        small t1(Counted{&sum});
+        small t2(BigCounted{&sum});
+        ASSERT_EQ(s_alive, 2);
+        small t3(std::move(t1));
+        small t4;
+        t4 = std::move(t2);
+        ASSERT_FALSE(t1);
+        ASSERT_FALSE(t2);
+        t3();
+        t4();
+        ASSERT_EQ(sum, 2);
+        ASSERT_EQ(s_alive, 2);
+        t3.swap(t4);
+        t3();
+        ASSERT_EQ(sum, 3);
+        t4 = nullptr;
+        ASSERT_EQ(s_alive, 1);
+    }
+    ASSERT_EQ(s_alive, 0);
+
+    // 只能移动的捕获
+    small t5([p = std::make_unique<int>(7), &sum]() { sum = *p; });
+    t5();
+    ASSERT_EQ(sum, 7);
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "flexy/schedule/iomanager.h"
+
+using namespace std::chrono_literals;
+
+// 线程都阻塞在 epoll_wait 中时, 外部线程投递的任务要能及时被执行
+TEST(Tickle, NoLostWakeup) {
+    flexy::IOManager iom(4, false, "tickle");
+    std::this_thread::sleep_for(50ms);
+    for (int i = 0; i < 200; ++i) {
+        std::atomic<bool> done = false;
+        auto start = std::chrono::steady_clock::now();
+        iom.async([&done]() { done = true; });
+        while (!done) {
+            std::this_thread::yield();
+        }
+        // epoll_wait 的最长超时是 3s, 丢失唤醒会等到超时
+        ASSERT_LT(std::chrono::steady_clock::now() - start, 1s);
+    }
+    auto stats = iom.getTickleStats();
+    EXPECT_GT(stats.sent, 0u);
+    iom.stop();
+}
+
+// 一批任务只需要很少的 eventfd 写入
+TEST(Tickle, Coalesce) {
+    flexy::IOManager iom(4, false, "tickle");
+    std::this_thread::sleep_for(50ms);
+    std::atomic<int> count = 0;
+    static constexpr int N = 10000;
+    for (int i = 0; i < N; ++i) {
+        iom.async([&count]() { ++count; });
+    }
+    iom.stop();
+    EXPECT_EQ(count, N);
+    auto stats = iom.getTickleStats();
+    EXPECT_LT(stats.sent, (uint64_t)N / 10);
+}
+
+// stop 时各线程依次唤醒, 不需要等 epoll_wait 超时
+TEST(Tickle, StopWakesAll) {
+    flexy::IOManager iom(4, false, "tickle");
+    std::this_thread::sleep_for(50ms);
+    auto start = std::chrono::steady_clock::now();
+    iom.stop();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
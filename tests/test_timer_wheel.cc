@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <map>
+#include "flexy/schedule/timer.h"
+#include "flexy/util/config.h"
+#include "flexy/util/util.h"
+
+class TestTimerManager : public flexy::TimerManager {
+public:
+    TestTimerManager() {
+        onRefreshNearest([]() {});
+    }
+    void onTimerInsertedAtFront() override {}
+};
+
+// 驱动定时器直到全部到期, 检查每个定时器的触发时间
+static void RunTimers(bool wheel) {
+    flexy::Config::LookupBase("timer.wheel")->fromString(wheel ? "1" : "0");
+    TestTimerManager tm;
+    flexy::Config::LookupBase("timer.wheel")->fromString("0");
+
+    uint64_t start = flexy::GetTimeMs();
+    std::map<int, uint64_t> fired;
+    std::vector<flexy::Timer::ptr> timers;
+    const int delays[] = {0, 1, 3, 10, 50, 255, 256, 257, 300, 700, 1100};
+    for (int i = 0; i < (int)(sizeof(delays) / sizeof(delays[0])); ++i) {
+        timers.push_back(tm.addTimer(delays[i], [&fired, i]() {
+            fired[i] = flexy::GetTimeMs();
+        }));
+    }
+    // 取消的定时器不会触发
+    auto canceled = tm.addTimer(20, [&fired]() { fired[100] = 0; });
+    ASSERT_TRUE(canceled->cancel());
+    ASSERT_FALSE(canceled->cancel());
+    // 重置到更晚的时间
+    auto reset = tm.addTimer(10, [&fired]() {
+        fired[101] = flexy::GetTimeMs();
+    });
+    ASSERT_TRUE(reset->reset(400, true));
+    // 循环定时器触发 3 次后取消
+    int count = 0;
+    flexy::Timer::ptr rec;
+    rec = tm.addRecTimer(30, [&count, &rec]() {
+        if (++count == 3) {
+            rec->cancel();
+        }
+    });
+
+    while (tm.hasTimer()) {
+        uint64_t next = tm.getNextTimer();
+        if (next) {
+            usleep(next * 1000);
+        }
+        for (auto& cb : tm.listExpiriedTimer()) {
+            cb();
+        }
+    }
+
+    ASSERT_EQ(fired.size(), sizeof(delays) / sizeof(delays[0]) + 1);
+    ASSERT_EQ(fired.count(100), 0u);
+    ASSERT_EQ(count, 3);
+    for (auto& [i, time] : fired) {
+        uint64_t expect = start + (i == 101 ? 400 : delays[i]);
+        EXPECT_GE(time, expect) << "timer " << i;
+        EXPECT_LE(time, expect + 50) << "timer " << i;
+    }
+}
+
+TEST(Timer, Set) { RunTimers(false); }
+
+TEST(Timer, Wheel) { RunTimers(true); }
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
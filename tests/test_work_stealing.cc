@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "flexy/schedule/iomanager.h"
+#include "flexy/schedule/work_stealing_queue.h"
+#include "flexy/util/config.h"
+
+TEST(WorkStealingQueue, PushPopSteal) {
+    flexy::WorkStealingQueue<intptr_t> q(2);
+    for (intptr_t i = 0; i < 100; ++i) {  // 触发多次扩容
+        q.push(i);
+    }
+    ASSERT_EQ(q.size(), 100u);
+
+    intptr_t v = -1;
+    ASSERT_TRUE(q.steal(v));
+    ASSERT_EQ(v, 0);
+    ASSERT_TRUE(q.pop(v));
+    ASSERT_EQ(v, 99);
+
+    intptr_t expect = 1;
+    while (q.steal(v)) {
+        if (v == 98) {
+            ASSERT_TRUE(q.empty());
+        }
+        ASSERT_EQ(v, expect++);
+    }
+    ASSERT_EQ(expect, 99);
+    ASSERT_FALSE(q.pop(v));
+}
+
+TEST(WorkStealingQueue, Concurrent) {
+    static constexpr intptr_t N = 200000;
+    flexy::WorkStealingQueue<intptr_t> q;
+    std::atomic<bool> done = false;
+    std::atomic<intptr_t> sum = 0;
+    std::atomic<intptr_t> count = 0;
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < 3; ++i) {
+        thieves.emplace_back([&]() {
+            intptr_t v;
+            while (!done || !q.empty()) {
+                if (q.steal(v)) {
+                    sum += v;
+                    ++count;
+                }
+            }
+        });
+    }
+
+    intptr_t v;
+    for (intptr_t i = 1; i <= N; ++i) {
+        q.push(i);
+        if (i % 3 == 0 && q.pop(v)) {
+            sum += v;
+            ++count;
+        }
+    }
+    while (q.pop(v)) {
+        sum += v;
+        ++count;
+    }
+    done = true;
+    for (auto& t : thieves) {
+        t.join();
+    }
+    ASSERT_EQ(count, N);
+    ASSERT_EQ(sum, N * (N + 1) / 2);
+}
+
+static std::atomic<int> s_count = 0;
+
+static void spawn(int depth) {
+    ++s_count;
+    if (depth > 0) {
+        go std::bind(spawn, depth - 1);
+        go std::bind(spawn, depth - 1);
+    }
+}
+
+TEST(Scheduler, WorkStealing) {
+    flexy::Config::LookupBase("scheduler.work_stealing")->fromString("1");
+    {
+        flexy::IOManager iom(4, false, "steal");
+        ASSERT_TRUE(iom.isWorkStealing());
+        iom.async(spawn, 14);
+
+        // 协程重新调度自己时不能饿死本地队列中的其他任务
+        std::atomic<bool> stop = false;
+        iom.async([&stop]() {
+            while (!stop) {
+                flexy::Scheduler::GetThis()->async(flexy::Fiber::GetThis());
+                flexy::Fiber::Yield();
+            }
+        });
+        iom.async([&stop]() {
+            go [&stop]() { stop = true; };
+        });
+        iom.async_first([]() { ++s_count; });
+        iom.stop();
+    }
+    flexy::Config::LookupBase("scheduler.work_stealing")->fromString("0");
+    ASSERT_EQ(s_count, (1 << 15) - 1 + 1);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
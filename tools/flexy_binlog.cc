@@ -0,0 +1,72 @@
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include "flexy/util/binlog.h"
+#include "flexy/util/log.h"
+
+// 把 BinaryLogAppender 输出的二进制日志解码成文本日志
+// 用法: flexy_binlog [-p pattern] file...
+// pattern 与 LogFormatter 相同, 默认为日志器的默认格式
+
+using namespace flexy;
+
+static const char* kDefaultPattern =
+    "%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T%F%T[%p]%T[%c]%T<%f:%l>%T%m%n";
+
+static bool Decode(const char* file, LogFormatter& formatter) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        std::cerr << "open " << file << " failed" << std::endl;
+        return false;
+    }
+    binlog::Reader reader(in);
+    binlog::Record record;
+    LogBuffer buffer;
+    while (reader.next(record)) {
+        auto logger = FLEXY_LOG_NAME(std::string(record.loggerName));
+        LogContext context(logger, static_cast<LogLevel::Level>(record.level),
+                           record.site->file.c_str(), record.site->func.c_str(),
+                           record.site->line, record.elapse, record.threadId,
+                           record.fiberId, record.time, record.threadName);
+        context.getSS() << record.message;
+        LogContext::ptr ptr = &context;
+        buffer.clear();
+        formatter.format(buffer, logger, ptr);
+        std::cout.write(buffer.data(), buffer.size());
+    }
+    std::cout.flush();
+    if (reader.isError()) {
+        std::cerr << file << ": truncated or corrupted binary log" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string pattern = kDefaultPattern;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                pattern = optarg;
+                break;
+            default:
+                std::cerr << "usage: " << argv[0] << " [-p pattern] file..." << std::endl;
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        std::cerr << "usage: " << argv[0] << " [-p pattern] file..." << std::endl;
+        return 1;
+    }
+    LogFormatter formatter(pattern);
+    if (formatter.isError()) {
+        std::cerr << "invalid pattern: " << pattern << std::endl;
+        return 1;
+    }
+    bool ok = true;
+    for (int i = optind; i < argc; ++i) {
+        ok = Decode(argv[i], formatter) && ok;
+    }
+    return ok ? 0 : 1;
+}